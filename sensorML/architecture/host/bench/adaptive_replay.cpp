@@ -0,0 +1,252 @@
+// adaptive_replay: samples and inferences saved by AdaptiveRate on a trace
+//
+// A recorded LDR trace (one calibrated value per line, the last
+// comma-separated column is used, sampled at --hz) or, without --csv, a
+// synthetic indoor day of --hours: a flat level with ADC noise and a slow
+// daylight drift, lamp switches every few minutes (crossing the dark/bright
+// thresholds) and short shadows.
+//
+// The trace is replayed through the loop() path of main.ino twice:
+//  1) fixed: every sample, 40-sample window, hop 10
+//  2) adaptive: AdaptiveRate between --min-hz and --hz; only every stride-th
+//     trace sample is read and pushed with pushResampled(); a full window
+//     runs when windowDue()
+//
+// Reports samples read, inferences, LED actions, and how closely the adaptive
+// label follows the fixed one: the share of fixed inferences where the latest
+// adaptive label agrees, and the delay until the adaptive label catches up
+// after each fixed label change. It also checks that every adaptive window,
+// in particular those right after a jump back to full rate, spans exactly
+// window - 1 grid steps of trace time. Exits 1 if fewer than 99 % agree, a
+// label change is caught up more than --max-lag-s seconds late, or a window
+// span is off.
+//
+// Usage:
+//   adaptive_replay [--csv FILE] [--hz N] [--min-hz N] [--hours N] [--max-lag-s N]
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -I shim -iquote ../lab -o adaptive_replay
+//       bench/adaptive_replay.cpp ../lab/adaptive_rate.cpp ../lab/features.cpp
+//       ../lab/inference.cpp ../lab/controller.cpp
+
+#include "adaptive_rate.h"
+#include "controller.h"
+#include "features.h"
+#include "inference.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+const int kWindow = 40;
+const int kHop = 10;
+
+std::vector<float> loadCsv(const char* path)
+{
+  std::vector<float> out;
+  FILE* f = fopen(path, "r");
+  if (!f) return out;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    const char* v = strrchr(line, ',');
+    v = v ? v + 1 : line;
+    char* end;
+    const float x = strtof(v, &end);
+    if (end != v) out.push_back(x);
+  }
+  fclose(f);
+  return out;
+}
+
+std::vector<float> makeDay(float hz, float hours)
+{
+  std::mt19937 rng(7);
+  std::normal_distribution<float> noise(0.0f, 6.0f);
+  std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+  const size_t n = (size_t)(hours * 3600.0f * hz);
+  std::vector<float> out(n);
+  float lamp = 0.0f;                  // 0, +1100 (lamp on) or -1100 (blinds shut)
+  size_t nextSwitch = (size_t)(hz * 600.0f);
+  size_t shadowEnd = 0;
+  for (size_t i = 0; i < n; i++) {
+    const float t = (float)i / hz;
+    if (i == nextSwitch) {
+      const float r = uni(rng);
+      lamp = r < 0.4f ? 0.0f : (r < 0.7f ? 1100.0f : -1100.0f);
+      nextSwitch = i + (size_t)(hz * (180.0f + 900.0f * uni(rng)));
+    }
+    if (shadowEnd < i && uni(rng) < 1.0f / (hz * 240.0f)) {
+      shadowEnd = i + (size_t)(hz * (1.0f + 3.0f * uni(rng)));   // someone walks by
+    }
+    const float daylight = 250.0f * sinf(t * 2.0f * 3.14159265f / (4.0f * 3600.0f));
+    const float shadow = i < shadowEnd ? -450.0f : 0.0f;
+    out[i] = 2000.0f + daylight + lamp + shadow + noise(rng);
+  }
+  return out;
+}
+
+struct Inference {
+  double tS;
+  const char* label;
+  ControlAction action;
+};
+
+struct RunResult {
+  uint64_t samples = 0;
+  std::vector<Inference> inferences;
+  uint32_t ledChanges = 0;
+  uint32_t jumps = 0;
+  uint32_t stepsDown = 0;
+  uint32_t jumpWindows = 0;   // windows run right after a jump
+  double spanErrMax = 0.0;    // grid steps, over all windows
+};
+
+// Newest minus oldest point of a full window
+float windowSpan(const WindowBuffer& w)
+{
+  const float newest = w.buf[(w.head - 1 + w.capacity) % w.capacity];
+  const float oldest = w.buf[(w.head - w.size + w.capacity) % w.capacity];
+  return newest - oldest;
+}
+
+RunResult replay(const std::vector<float>& trace, float hz, bool adaptive, float minHz)
+{
+  RunResult res;
+  WindowBuffer win;
+  std::vector<float> storage(kWindow);
+  initWindowWith(win, storage.data(), kWindow);
+  // Trace index of every window point, resampled like the values
+  WindowBuffer times;
+  std::vector<float> timeStorage(kWindow);
+  initWindowWith(times, timeStorage.data(), kWindow);
+  Controller ctrl;
+  ctrl.begin(2);
+  AdaptiveRate rate;
+  AdaptiveRateConfig ac;
+  ac.minHz = adaptive ? minHz : hz;
+  ac.maxHz = hz;
+  rate.begin(ac);
+
+  ControlAction last = ACTION_SAFE_OFF;
+  size_t i = 0;
+  bool jumped = false;
+  while (i < trace.size()) {
+    const float x = trace[i];
+    res.samples++;
+    if (adaptive) {
+      // This sample closes a gap of the stride it was read at
+      const int s = rate.stride();
+      if (rate.onSample(x)) jumped = true;
+      pushResampled(win, x, s);
+      pushResampled(times, (float)i, s);
+    } else {
+      pushSample(win, x);
+      pushSample(times, (float)i);
+    }
+    if (isWindowFull(win) && (!adaptive || rate.windowDue())) {
+      const double err = fabs(windowSpan(times) - (float)(kWindow - 1));
+      if (err > res.spanErrMax) res.spanErrMax = err;
+      if (jumped) res.jumpWindows++;
+      jumped = false;
+      Features f;
+      computeFeatures(win, f);
+      const InferenceResult r = fallbackClassify(f);
+      const ControlAction a = ctrl.safetyAndActuate(r, 0.05f);
+      if (a != last) res.ledChanges++;
+      last = a;
+      res.inferences.push_back({(double)i / hz, r.label, a});
+      if (adaptive) rate.onWindow(f);
+      popOldest(win, kHop);
+      popOldest(times, kHop);
+    }
+    i += rate.stride();
+  }
+  res.jumps = rate.jumps();
+  res.stepsDown = rate.stepsDown();
+  return res;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const char* csv = nullptr;
+  float hz = 20.0f;
+  float minHz = 2.0f;
+  float hours = 4.0f;
+  float maxLagS = 3.0f;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--csv")) csv = argv[i + 1];
+    else if (!strcmp(argv[i], "--hz")) hz = (float)atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--min-hz")) minHz = (float)atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--hours")) hours = (float)atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--max-lag-s")) maxLagS = (float)atof(argv[i + 1]);
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  const std::vector<float> trace = csv ? loadCsv(csv) : makeDay(hz, hours);
+  if (trace.size() < (size_t)kWindow) {
+    fprintf(stderr, "trace too short (%zu samples)\n", trace.size());
+    return 2;
+  }
+  printf("trace: %s, %zu samples at %.1f Hz (%.2f h), adaptive %.1f..%.1f Hz\n",
+         csv ? csv : "synthetic day", trace.size(), hz, trace.size() / hz / 3600.0, minHz, hz);
+
+  const RunResult fixed = replay(trace, hz, false, minHz);
+  const RunResult adapt = replay(trace, hz, true, minHz);
+
+  // Agreement: latest adaptive label at each fixed inference time
+  size_t k = 0;
+  const char* cur = nullptr;
+  uint64_t agree = 0;
+  for (const Inference& in : fixed.inferences) {
+    while (k < adapt.inferences.size() && adapt.inferences[k].tS <= in.tS) cur = adapt.inferences[k++].label;
+    if (cur && !strcmp(cur, in.label)) agree++;
+  }
+  // Lag: after each fixed label change, until the adaptive label matches
+  uint32_t changes = 0;
+  double lagSum = 0.0, lagMax = 0.0;
+  k = 0;
+  cur = nullptr;
+  for (size_t j = 1; j < fixed.inferences.size(); j++) {
+    const Inference& in = fixed.inferences[j];
+    if (!strcmp(in.label, fixed.inferences[j - 1].label)) continue;
+    changes++;
+    while (k < adapt.inferences.size() && adapt.inferences[k].tS < in.tS) cur = adapt.inferences[k++].label;
+    double lag = 0.0;
+    if (!cur || strcmp(cur, in.label)) {
+      size_t m = k;
+      while (m < adapt.inferences.size() && strcmp(adapt.inferences[m].label, in.label)) m++;
+      lag = m < adapt.inferences.size() ? adapt.inferences[m].tS - in.tS : trace.size() / hz - in.tS;
+    }
+    lagSum += lag;
+    if (lag > lagMax) lagMax = lag;
+  }
+
+  const double agreePct = fixed.inferences.empty() ? 100.0 : 100.0 * agree / fixed.inferences.size();
+  printf("%-9s samples=%-9llu inferences=%-7zu led_changes=%u\n", "fixed",
+         (unsigned long long)fixed.samples, fixed.inferences.size(), fixed.ledChanges);
+  printf("%-9s samples=%-9llu inferences=%-7zu led_changes=%u jumps=%u steps_down=%u\n", "adaptive",
+         (unsigned long long)adapt.samples, adapt.inferences.size(), adapt.ledChanges, adapt.jumps,
+         adapt.stepsDown);
+  printf("saved: %.1f %% of samples, %.1f %% of inferences\n",
+         100.0 * (1.0 - (double)adapt.samples / fixed.samples),
+         100.0 * (1.0 - (double)adapt.inferences.size() / fixed.inferences.size()));
+  printf("label agreement %.2f %%, %u label changes caught up after mean %.2f s, max %.2f s\n",
+         agreePct, changes, changes ? lagSum / changes : 0.0, lagMax);
+
+  printf("window span: max error %.3f grid steps, %u windows right after a jump\n", adapt.spanErrMax,
+         adapt.jumpWindows);
+
+  const bool ok = agreePct >= 99.0 && lagMax <= maxLagS && adapt.spanErrMax <= 0.05 && fixed.spanErrMax <= 0.05;
+  printf("check: %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
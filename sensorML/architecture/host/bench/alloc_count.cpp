@@ -0,0 +1,147 @@
+#include "alloc_count.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+// glibc's own entry points; defining malloc & co. here interposes them for
+// the whole process, including allocations made inside libstdc++
+extern "C" {
+void* __libc_malloc(size_t n);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t n);
+void* __libc_memalign(size_t align, size_t n);
+void __libc_free(void* p);
+}
+
+namespace {
+
+std::atomic<uint64_t> g_allocs{0};
+std::atomic<uint64_t> g_frees{0};
+std::atomic<uint64_t> g_bytes{0};
+
+inline void countAlloc(size_t n)
+{
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  g_bytes.fetch_add(n, std::memory_order_relaxed);
+}
+
+inline void countFree(void* p)
+{
+  if (p) g_frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* newOrThrow(size_t n)
+{
+  countAlloc(n);
+  void* p = __libc_malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void* newAlignedOrThrow(size_t n, std::align_val_t align)
+{
+  countAlloc(n);
+  void* p = __libc_memalign((size_t)align, n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+}  // namespace
+
+AllocCounts allocCounts()
+{
+  return {g_allocs.load(std::memory_order_relaxed), g_frees.load(std::memory_order_relaxed),
+          g_bytes.load(std::memory_order_relaxed)};
+}
+
+// -------------------- C allocator --------------------
+extern "C" {
+
+void* malloc(size_t n)
+{
+  countAlloc(n);
+  return __libc_malloc(n);
+}
+
+void* calloc(size_t n, size_t size)
+{
+  countAlloc(n * size);
+  return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t n)
+{
+  if (!p) {
+    countAlloc(n);
+    return __libc_realloc(p, n);
+  }
+  if (n == 0) {
+    countFree(p);
+    return __libc_realloc(p, n);
+  }
+  // Grown or shrunk in place: no new block. Moved: a new block and a free
+  void* q = __libc_realloc(p, n);
+  if (q && q != p) {
+    countAlloc(n);
+    countFree(p);
+  }
+  return q;
+}
+
+void* memalign(size_t align, size_t n)
+{
+  countAlloc(n);
+  return __libc_memalign(align, n);
+}
+
+void* aligned_alloc(size_t align, size_t n)
+{
+  countAlloc(n);
+  return __libc_memalign(align, n);
+}
+
+int posix_memalign(void** out, size_t align, size_t n)
+{
+  countAlloc(n);
+  *out = __libc_memalign(align, n);
+  return *out ? 0 : ENOMEM;
+}
+
+void free(void* p)
+{
+  countFree(p);
+  __libc_free(p);
+}
+
+}  // extern "C"
+
+// -------------------- C++ allocator --------------------
+void* operator new(size_t n) { return newOrThrow(n); }
+void* operator new[](size_t n) { return newOrThrow(n); }
+void* operator new(size_t n, std::align_val_t a) { return newAlignedOrThrow(n, a); }
+void* operator new[](size_t n, std::align_val_t a) { return newAlignedOrThrow(n, a); }
+
+void* operator new(size_t n, const std::nothrow_t&) noexcept
+{
+  countAlloc(n);
+  return __libc_malloc(n ? n : 1);
+}
+
+void* operator new[](size_t n, const std::nothrow_t&) noexcept
+{
+  countAlloc(n);
+  return __libc_malloc(n ? n : 1);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
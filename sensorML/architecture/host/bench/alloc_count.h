@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Allocation-counting allocator for the host benches
+// Linking alloc_count.cpp into an executable replaces operator new/delete
+// and malloc/calloc/realloc/free (glibc: forwarded to __libc_malloc & co.)
+// with versions that count calls and bytes, from any thread. A steady-state
+// loop on the device (sample -> features -> infer -> actuate) must not touch
+// the heap: every allocation there is a fragmentation and latency risk that
+// only shows after days. Benches read allocCounts() around their loops.
+
+struct AllocCounts {
+  uint64_t allocs;   // new, malloc, calloc, realloc to a new block
+  uint64_t frees;
+  uint64_t bytes;    // requested, total
+};
+
+AllocCounts allocCounts();
@@ -0,0 +1,243 @@
+// engine_bench: fleet replay through the sharded pipeline engine
+//
+//  1) builds a synthetic fleet stream: --devices LDR-like random walks that
+//     cross the dark/bright thresholds, interleaved in arrival order, with
+//     --hot-pct of the devices sending --hot-x times more samples (skew)
+//  2) replays it in batches through Engine with 1, 2, 4, ... --max-workers
+//     workers: samples/s, samples/s per core, speedup vs 1 worker, steals
+//  3) check: every device's (label, action) digest == a plain
+//     single-threaded loop over the same stream (initWindow + Controller per
+//     device, as in main.ino); exits 1 on mismatch
+//  4) small batches: the same stream through --max-workers workers (at
+//     least 2) in batches of --small-batch samples, so workers are still
+//     leaving drain() when the next batch is queued. Same digest check;
+//     exits 1 if a batch has not returned after 30 s
+//
+// Usage:
+//   engine_bench [--devices N] [--samples N] [--hot-pct P] [--hot-x X]
+//                [--batch N] [--small-batch N] [--max-workers N] [--scalar-features]
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -pthread -I shim -iquote ../lab -iquote engine
+//       -o engine_bench bench/engine_bench.cpp engine/engine.cpp
+//       engine/features_batch.cpp ../lab/features.cpp ../lab/inference.cpp ../lab/controller.cpp
+
+#include "engine.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  uint32_t devices = 4096;
+  uint32_t samples = 400;     // per normal device
+  int hotPct = 1;
+  int hotX = 50;
+  size_t batch = 65536;
+  size_t smallBatch = 8;
+  int maxWorkers = 0;         // 0: hardware_concurrency
+  bool scalarFeatures = false;
+};
+
+double secondsSince(Clock::time_point t0)
+{
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+// Random walk in LDR counts (0..4095), drifting across 1200/2800
+std::vector<EngineSample> buildStream(const Options& o)
+{
+  std::mt19937 rng(42);
+  std::normal_distribution<float> step(0.0f, 40.0f);
+  std::vector<float> level(o.devices);
+  std::vector<uint32_t> left(o.devices);
+  size_t total = 0;
+  for (uint32_t d = 0; d < o.devices; d++) {
+    level[d] = (float)(rng() % 4096);
+    const bool hot = (int)(rng() % 100) < o.hotPct;
+    left[d] = hot ? o.samples * o.hotX : o.samples;
+    total += left[d];
+  }
+
+  std::vector<EngineSample> out;
+  out.reserve(total);
+  std::vector<uint32_t> live(o.devices);
+  for (uint32_t d = 0; d < o.devices; d++) live[d] = d;
+  while (!live.empty()) {
+    const size_t k = rng() % live.size();
+    const uint32_t d = live[k];
+    float v = level[d] + step(rng);
+    if (v < 0.0f) v = 0.0f;
+    if (v > 4095.0f) v = 4095.0f;
+    level[d] = v;
+    out.push_back({d, v});
+    if (--left[d] == 0) {
+      live[k] = live.back();
+      live.pop_back();
+    }
+  }
+  return out;
+}
+
+// Reference: one device at a time, exactly like loop() in main.ino
+std::vector<uint64_t> referenceDigests(const Options& o, const EngineConfig& cfg,
+                                       const std::vector<EngineSample>& stream)
+{
+  struct Ref { WindowBuffer win; Controller ctrl; uint64_t digest; };
+  std::vector<Ref> ref(o.devices);
+  for (Ref& r : ref) {
+    initWindow(r.win, cfg.window);
+    r.ctrl.begin(-1);
+    r.digest = 1469598103934665603ull;
+  }
+  for (const EngineSample& s : stream) {
+    Ref& r = ref[s.device];
+    pushSample(r.win, s.value * cfg.scale + cfg.offset);
+    if (!isWindowFull(r.win)) continue;
+    Features f;
+    computeFeatures(r.win, f);
+    InferenceResult res = fallbackClassify(f);
+    ControlAction a = r.ctrl.safetyAndActuate(res, cfg.uncertainty);
+    const uint8_t label = strcmp(res.label, "dark") == 0 ? 0 : strcmp(res.label, "bright") == 0 ? 2 : 1;
+    r.digest = (r.digest ^ label) * 1099511628211ull;
+    r.digest = (r.digest ^ (uint8_t)a) * 1099511628211ull;
+    popOldest(r.win, cfg.hop);
+  }
+  std::vector<uint64_t> out(o.devices);
+  for (uint32_t d = 0; d < o.devices; d++) {
+    out[d] = ref[d].digest;
+    free(ref[d].win.buf);
+  }
+  return out;
+}
+
+// Devices whose digest differs from the reference
+uint32_t countMismatches(const Engine& eng, const std::vector<uint64_t>& expect)
+{
+  uint32_t bad = 0;
+  for (uint32_t d = 0; d < expect.size(); d++) {
+    const DeviceState* ds = eng.device(d);
+    if (!ds || ds->digest != expect[d]) bad++;
+  }
+  return bad;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  Options o;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--scalar-features")) {
+      o.scalarFeatures = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      fprintf(stderr, "missing value for %s\n", argv[i]);
+      return 2;
+    }
+    if (!strcmp(argv[i], "--devices")) o.devices = (uint32_t)atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--samples")) o.samples = (uint32_t)atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--hot-pct")) o.hotPct = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--hot-x")) o.hotX = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--batch")) o.batch = (size_t)atol(argv[++i]);
+    else if (!strcmp(argv[i], "--small-batch")) o.smallBatch = (size_t)atol(argv[++i]);
+    else if (!strcmp(argv[i], "--max-workers")) o.maxWorkers = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  const int hw = (int)std::thread::hardware_concurrency();
+  if (o.maxWorkers <= 0) o.maxWorkers = hw > 0 ? hw : 1;
+  if (o.batch == 0) o.batch = 65536;
+  if (o.smallBatch == 0) o.smallBatch = 1;
+
+  EngineConfig cfg;
+  cfg.batchFeatures = !o.scalarFeatures;
+  const std::vector<EngineSample> stream = buildStream(o);
+  printf("stream: %u devices, %zu samples (%d%% hot x%d), batch %zu, %d hardware threads\n",
+         o.devices, stream.size(), o.hotPct, o.hotX, o.batch, hw);
+  printf("features: %s\n", cfg.batchFeatures ? featureBatchIsa() : "scalar");
+
+  const std::vector<uint64_t> expect = referenceDigests(o, cfg, stream);
+
+  bool ok = true;
+  double base = 0.0;
+  std::vector<int> counts;
+  for (int w = 1; w < o.maxWorkers; w *= 2) counts.push_back(w);
+  counts.push_back(o.maxWorkers);
+
+  printf("%8s %14s %14s %8s %8s %10s %10s\n",
+         "workers", "samples/s", "per core", "speedup", "steals", "windows", "arena KiB");
+  for (int w : counts) {
+    Engine eng(cfg, w);
+    const auto t0 = Clock::now();
+    for (size_t i = 0; i < stream.size(); i += o.batch) {
+      const size_t n = stream.size() - i < o.batch ? stream.size() - i : o.batch;
+      eng.process(stream.data() + i, n);
+    }
+    const double sec = secondsSince(t0);
+    const double rate = stream.size() / sec;
+    if (w == 1) base = rate;
+    const EngineStats st = eng.stats();
+    printf("%8d %14.0f %14.0f %7.2fx %8llu %10llu %10zu\n", w, rate, rate / w, rate / base,
+           (unsigned long long)st.steals, (unsigned long long)st.windows,
+           eng.arenaBytes() / 1024);
+
+    const uint32_t bad = countMismatches(eng, expect);
+    if (bad) {
+      printf("  check FAILED: %u devices differ from the single-threaded reference\n", bad);
+      ok = false;
+    }
+  }
+  // Many small batches: a hung process() is reported instead of waited out
+  {
+    const int w = o.maxWorkers > 1 ? o.maxWorkers : 2;
+    Engine eng(cfg, w);
+    std::atomic<size_t> done{0};
+    const auto t0 = Clock::now();
+    std::thread watchdog([&] {
+      size_t last = 0;
+      auto lastMove = Clock::now();
+      while (done.load() < stream.size()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        const size_t now = done.load();
+        if (now != last) {
+          last = now;
+          lastMove = Clock::now();
+        } else if (secondsSince(lastMove) > 30.0) {
+          printf("  check FAILED: process() stuck for 30 s at sample %zu with %d workers\n", now, w);
+          fflush(stdout);
+          std::_Exit(1);
+        }
+      }
+    });
+    size_t batches = 0;
+    for (size_t i = 0; i < stream.size(); i += o.smallBatch) {
+      const size_t n = stream.size() - i < o.smallBatch ? stream.size() - i : o.smallBatch;
+      eng.process(stream.data() + i, n);
+      done.store(i + n);
+      batches++;
+    }
+    watchdog.join();
+    const double sec = secondsSince(t0);
+    printf("small batches: %zu batches of %zu with %d workers, %.1f us/batch\n", batches, o.smallBatch, w,
+           sec * 1e6 / batches);
+    const uint32_t bad = countMismatches(eng, expect);
+    if (bad) {
+      printf("  check FAILED: %u devices differ from the single-threaded reference\n", bad);
+      ok = false;
+    }
+  }
+  printf("check: %s\n", ok ? "ok (per-device outputs match the single-threaded loop)" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+// features_batch_bench: scalar computeFeatures() vs the cross-device kernel
+//
+//  1) scalar: computeFeatures() on every window, one device at a time
+//  2) batch: batchAddWindow() (transpose) + computeFeaturesBatch() per 16
+//  3) kernel only: computeFeaturesBatch() on already transposed batches
+//  4) check: every field of every window vs the scalar result, in ulp;
+//     exits 1 if any field is more than --max-ulp apart
+//
+// Windows are 40 samples (main.ino) with random ring offsets, filled with
+// LDR-like random walks. Each pass is repeated --reps times.
+//
+// Usage:
+//   features_batch_bench [--devices N] [--window N] [--reps N] [--max-ulp N]
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -I shim -iquote ../lab -iquote engine
+//       -o features_batch_bench bench/features_batch_bench.cpp
+//       engine/features_batch.cpp ../lab/features.cpp
+
+#include "features_batch.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point t0)
+{
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+// Distance in units in the last place (same sign assumed near equality)
+uint32_t ulpDiff(float a, float b)
+{
+  if (a == b) return 0;
+  int32_t ia, ib;
+  memcpy(&ia, &a, 4);
+  memcpy(&ib, &b, 4);
+  if (ia < 0) ia = INT32_MIN - ia;
+  if (ib < 0) ib = INT32_MIN - ib;
+  return ia > ib ? (uint32_t)(ia - ib) : (uint32_t)(ib - ia);
+}
+
+float sink = 0.0f;   // keeps results alive
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  int devices = 65536;
+  int window = 40;
+  int reps = 20;
+  uint32_t maxUlp = 4;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--devices")) devices = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--window")) window = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--reps")) reps = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--max-ulp")) maxUlp = (uint32_t)atoi(argv[i + 1]);
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  devices = (devices + kFeatureLanes - 1) / kFeatureLanes * kFeatureLanes;
+
+  // Full windows with the ring head at a random position
+  std::mt19937 rng(7);
+  std::normal_distribution<float> step(0.0f, 40.0f);
+  std::vector<WindowBuffer> wins(devices);
+  for (WindowBuffer& w : wins) {
+    initWindow(w, window);
+    float v = (float)(rng() % 4096);
+    const int extra = (int)(rng() % window);
+    for (int i = 0; i < window + extra; i++) {
+      v += step(rng);
+      if (v < 0.0f) v = 0.0f;
+      if (v > 4095.0f) v = 4095.0f;
+      pushSample(w, v);
+    }
+  }
+
+  const int nBatches = devices / kFeatureLanes;
+  float* storage = (float*)aligned_alloc(64, sizeof(float) * window * kFeatureLanes * nBatches);
+  std::vector<FeatureBatch> batches(nBatches);
+  for (int b = 0; b < nBatches; b++) {
+    initFeatureBatch(batches[b], storage + (size_t)b * window * kFeatureLanes, window);
+  }
+
+  std::vector<Features> scalar(devices), batched(devices);
+  const double windows = (double)devices * reps;
+  printf("%d windows x %d samples, %d reps, kernel %s\n", devices, window, reps, featureBatchIsa());
+
+  auto t0 = Clock::now();
+  for (int r = 0; r < reps; r++) {
+    for (int d = 0; d < devices; d++) computeFeatures(wins[d], scalar[d]);
+    sink += scalar[r % devices].std;
+  }
+  const double tScalar = secondsSince(t0);
+
+  t0 = Clock::now();
+  for (int r = 0; r < reps; r++) {
+    FeatureBatch& b = batches[0];
+    for (int d = 0; d < devices; d += kFeatureLanes) {
+      b.lanes = 0;
+      for (int l = 0; l < kFeatureLanes; l++) batchAddWindow(b, wins[d + l]);
+      computeFeaturesBatch(b, &batched[d]);
+    }
+    sink += batched[r % devices].std;
+  }
+  const double tBatch = secondsSince(t0);
+
+  for (int b = 0; b < nBatches; b++) {
+    batches[b].lanes = 0;
+    for (int l = 0; l < kFeatureLanes; l++) batchAddWindow(batches[b], wins[b * kFeatureLanes + l]);
+  }
+  t0 = Clock::now();
+  for (int r = 0; r < reps; r++) {
+    for (int b = 0; b < nBatches; b++) computeFeaturesBatch(batches[b], &batched[b * kFeatureLanes]);
+    sink += batched[r % devices].std;
+  }
+  const double tKernel = secondsSince(t0);
+
+  printf("%-26s %12.0f windows/s %8.1f ns/window\n", "scalar computeFeatures",
+         windows / tScalar, tScalar * 1e9 / windows);
+  printf("%-26s %12.0f windows/s %8.1f ns/window  %5.2fx\n", "batch (transpose+kernel)",
+         windows / tBatch, tBatch * 1e9 / windows, tScalar / tBatch);
+  printf("%-26s %12.0f windows/s %8.1f ns/window  %5.2fx\n", "kernel only",
+         windows / tKernel, tKernel * 1e9 / windows, tScalar / tKernel);
+
+  static const char* kField[] = {"mean", "std", "min", "max", "slope"};
+  uint32_t worst[5] = {0, 0, 0, 0, 0};
+  int exact = 0;
+  for (int d = 0; d < devices; d++) {
+    const float* s = &scalar[d].mean;
+    const float* b = &batched[d].mean;
+    bool same = true;
+    for (int k = 0; k < 5; k++) {
+      const uint32_t u = ulpDiff(s[k], b[k]);
+      if (u > worst[k]) worst[k] = u;
+      if (u) same = false;
+    }
+    exact += same;
+  }
+  bool ok = true;
+  printf("check: %d/%d windows bit-identical; max ulp:", exact, devices);
+  for (int k = 0; k < 5; k++) {
+    printf(" %s=%u", kField[k], worst[k]);
+    if (worst[k] > maxUlp) ok = false;
+  }
+  printf(" -> %s\n", ok ? "ok" : "FAILED");
+
+  for (WindowBuffer& w : wins) free(w.buf);
+  free(storage);
+  return ok ? 0 : (sink == 12345.0f ? 2 : 1);
+}
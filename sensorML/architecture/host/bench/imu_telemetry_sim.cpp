@@ -0,0 +1,399 @@
+// imu_telemetry_sim: the MPU6050 MQTT sketch (sensorML/lab/mpu6050/mqtt) in
+// its three telemetry modes, run on host against a stand-in broker
+//
+// The sketch is built three times, once per IMU_TELEMETRY_MODE (JSON,
+// COMPACT, BATCH). Each copy runs its own setup()/loop() in real time for
+// --seconds on the host shim. The IMU is a hook (shim/Adafruit_MPU6050.h)
+// that records every read together with the slot it was due in. During the
+// run the sim stalls loop() for 3.5 periods, so slots are dropped, and then
+// halves the period. The broker (standin_broker.h) stores every telemetry
+// message with its receive time. Each message is decoded afterwards, and
+// the sim reports for each mode:
+//  - msgs/s, payload bytes per sample (and with MQTT framing)
+//  - latency: the receive time minus the sample's timestamp, in ms
+// It fails (exit 1) in any of these cases:
+//  - a decoded sample does not match the read stamped with its timestamp
+//    (for a batch, t0_ms + i * period_ms)
+//  - a sample read while the link was up never arrives
+//  - sample timestamps leave the period grid
+//  - latency exceeds the mode's bound (BATCH_MAX_LATENCY_MS for batches)
+//    by more than --tolerance-ms
+//
+// Usage:
+//   imu_telemetry_sim [--seconds S] [--tolerance-ms T]
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -pthread -I shim -o imu_telemetry_sim bench/imu_telemetry_sim.cpp bench/standin_broker.cpp
+
+#include <Adafruit_MPU6050.h>
+#include <Adafruit_Sensor.h>
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <atomic>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "standin_broker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define IMU_TELEMETRY_MODE TELEMETRY_JSON
+namespace imu_json {
+#include "../../../lab/mpu6050/mqtt/ESP32_SensorML_MPU6050_MQTT_NodeRED.ino"
+}
+#undef IMU_TELEMETRY_MODE
+
+#define IMU_TELEMETRY_MODE TELEMETRY_COMPACT
+namespace imu_compact {
+#include "../../../lab/mpu6050/mqtt/ESP32_SensorML_MPU6050_MQTT_NodeRED.ino"
+}
+#undef IMU_TELEMETRY_MODE
+
+#define IMU_TELEMETRY_MODE TELEMETRY_BATCH
+namespace imu_batch {
+#include "../../../lab/mpu6050/mqtt/ESP32_SensorML_MPU6050_MQTT_NodeRED.ino"
+}
+#undef IMU_TELEMETRY_MODE
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// One copy of the sketch
+struct Sketch {
+  const char* name;
+  void (*setup)();
+  void (*loop)();
+  bool (*linkUp)();
+  void (*flush)();   // batch mode only
+  unsigned long* lastSampleMs;
+  unsigned long* periodMs;
+  uint32_t latencyBoundMs;
+};
+
+#define SKETCH(ns, name, flush, bound) \
+  {name, ns::setup, ns::loop, ns::linkUp, flush, &ns::lastSampleMs, &ns::cfg.samplePeriodMs, bound}
+
+Sketch g_sketches[3] = {
+  SKETCH(imu_json, "json", nullptr, 0),
+  SKETCH(imu_compact, "compact", nullptr, 0),
+  SKETCH(imu_batch, "batch", imu_batch::telemetryBatchFlush, imu_batch::BATCH_MAX_LATENCY_MS),
+};
+
+const int kValues = imu_batch::IMU_VALUES;
+
+// One IMU read, stamped with the slot the sketch took it in
+struct Read {
+  uint32_t ts;
+  uint32_t periodMs;
+  bool linkUp;
+  HostImuSample s;
+};
+
+const Sketch* g_active = nullptr;   // loop() thread only
+std::vector<Read> g_reads;
+uint32_t g_k = 0;
+
+void imuRead(HostImuSample& s)
+{
+  const float t = (float)g_k++ * 0.02f;
+  s.ax = 2.0f * sinf(t);
+  s.ay = 1.5f * cosf(1.3f * t);
+  s.az = 9.81f + 0.3f * sinf(3.1f * t);
+  s.gx = 0.8f * sinf(0.7f * t);
+  s.gy = -0.4f * cosf(t);
+  s.gz = 0.05f;
+  s.tempC = 24.5f + 0.01f * (float)(g_k % 50);
+  g_reads.push_back({(uint32_t)*g_active->lastSampleMs, (uint32_t)*g_active->periodMs, g_active->linkUp(), s});
+}
+
+struct Msg {
+  std::vector<uint8_t> payload;
+  size_t topicLen;
+  uint32_t rxMs;
+};
+
+std::mutex g_msgMutex;
+std::vector<Msg> g_msgs;
+
+void onPublish(const char* topic, const uint8_t* payload, size_t len, bool retained)
+{
+  if (retained) return;   // metadata
+  if (std::strcmp(topic, imu_json::TOPIC_TELE) != 0 && std::strcmp(topic, imu_json::TOPIC_TELE_BIN) != 0) return;
+  const uint32_t rx = millis();
+  std::lock_guard<std::mutex> lock(g_msgMutex);
+  g_msgs.push_back({std::vector<uint8_t>(payload, payload + len), std::strlen(topic), rx});
+}
+
+// The loop() arithmetic for one read: calibrated values, gyro in deg/s
+void calibrated(const HostImuSample& s, float out[kValues])
+{
+  const imu_batch::ImuConfig& c = imu_batch::cfg;
+  const float gx = s.gx * 180.0f / PI;
+  const float gy = s.gy * 180.0f / PI;
+  const float gz = s.gz * 180.0f / PI;
+  out[0] = s.ax * c.accelCal.scaleX + c.accelCal.offX;
+  out[1] = s.ay * c.accelCal.scaleY + c.accelCal.offY;
+  out[2] = s.az * c.accelCal.scaleZ + c.accelCal.offZ;
+  out[3] = gx * c.gyroCal.scaleX + c.gyroCal.offX;
+  out[4] = gy * c.gyroCal.scaleY + c.gyroCal.offY;
+  out[5] = gz * c.gyroCal.scaleZ + c.gyroCal.offZ;
+  out[6] = s.tempC;
+}
+
+// A decoded sample: its timestamp and values (counts, or JSON floats)
+struct Sample {
+  uint32_t ts;
+  float v[kValues];
+  uint32_t rxMs;
+};
+
+uint16_t le16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+uint32_t le32(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+// The number after key, searching from pos; pos moves past it
+bool jsonNumber(const std::string& s, size_t& pos, const char* key, double& v)
+{
+  const size_t k = s.find(key, pos);
+  if (k == std::string::npos) return false;
+  const char* p = s.c_str() + k + std::strlen(key);
+  char* end;
+  v = std::strtod(p, &end);
+  pos = (size_t)(end - s.c_str());
+  return end != p;
+}
+
+bool decodeJson(const Msg& m, std::vector<Sample>& out)
+{
+  const std::string s(m.payload.begin(), m.payload.end());
+  Sample smp;
+  smp.rxMs = m.rxMs;
+  double v;
+  size_t pos = 0;
+  if (!jsonNumber(s, pos, "\"ts_ms\":", v)) return false;
+  smp.ts = (uint32_t)v;
+  const char* keys[kValues] = {"\"x\":", "\"y\":", "\"z\":", "\"x\":", "\"y\":", "\"z\":", "\"temp_c\":"};
+  for (int i = 0; i < kValues; i++) {
+    if (!jsonNumber(s, pos, keys[i], v)) return false;
+    smp.v[i] = (float)v;
+  }
+  out.push_back(smp);
+  return true;
+}
+
+bool decodeCompact(const Msg& m, std::vector<Sample>& out)
+{
+  if (m.payload.size() != sizeof(imu_compact::ImuRecordV1) || m.payload[0] != 1) return false;
+  const uint8_t* p = m.payload.data();
+  Sample smp;
+  smp.rxMs = m.rxMs;
+  smp.ts = le32(p + 2);
+  for (int i = 0; i < kValues; i++) smp.v[i] = (float)(int16_t)le16(p + 6 + 2 * i);
+  out.push_back(smp);
+  return true;
+}
+
+bool decodeBatch(const Msg& m, std::vector<Sample>& out)
+{
+  const std::vector<uint8_t>& b = m.payload;
+  if (b.size() < imu_batch::BATCH_HEADER_SIZE || b[0] != 2 || b[1] == 0) return false;
+  const int n = b[1];
+  const uint32_t t0 = le32(&b[2]);
+  const uint16_t period = le16(&b[6]);
+  int32_t cur[kValues];
+  for (int i = 0; i < kValues; i++) cur[i] = (int16_t)le16(&b[8 + 2 * i]);
+  size_t o = imu_batch::BATCH_HEADER_SIZE;
+  for (int k = 0; k < n; k++) {
+    if (k > 0) {
+      for (int i = 0; i < kValues; i++) {
+        uint32_t z = 0;
+        for (unsigned shift = 0;; shift += 7) {
+          if (o >= b.size() || shift > 28) return false;
+          const uint8_t c = b[o++];
+          z |= (uint32_t)(c & 0x7F) << shift;
+          if (!(c & 0x80)) break;
+        }
+        cur[i] += (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+      }
+    }
+    Sample smp;
+    smp.rxMs = m.rxMs;
+    smp.ts = t0 + (uint32_t)k * period;
+    for (int i = 0; i < kValues; i++) smp.v[i] = (float)cur[i];
+    out.push_back(smp);
+  }
+  return o == b.size();
+}
+
+uint64_t nowUs()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             Clock::now().time_since_epoch()).count();
+}
+
+void loopOnce(const Sketch& sk)
+{
+  sk.loop();
+  std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+uint32_t percentile(std::vector<uint32_t> v, double q)
+{
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t)(q * (double)v.size()))];
+}
+
+int runMode(int mode, double seconds, uint32_t toleranceMs)
+{
+  const Sketch& sk = g_sketches[mode];
+  g_active = &sk;
+  g_reads.clear();
+  {
+    std::lock_guard<std::mutex> lock(g_msgMutex);
+    g_msgs.clear();
+  }
+
+  sk.setup();
+  const uint64_t t0 = nowUs();
+  while (!sk.linkUp() && nowUs() - t0 < 3000000) loopOnce(sk);
+  if (!sk.linkUp()) {
+    std::printf("FAIL: %s: link not up after 3 s\n", sk.name);
+    return 1;
+  }
+
+  // Steady sampling, a stall that drops slots, then half the period
+  const uint64_t runUs = (uint64_t)(seconds * 1e6);
+  const uint64_t start = nowUs();
+  bool stalled = false, halved = false;
+  for (uint64_t el = 0; el < runUs; el = nowUs() - start) {
+    if (!stalled && el > runUs * 2 / 5) {
+      std::this_thread::sleep_for(std::chrono::microseconds(*sk.periodMs * 3500));
+      stalled = true;
+    }
+    if (!halved && el > runUs * 3 / 5) {
+      *sk.periodMs /= 2;
+      halved = true;
+    }
+    loopOnce(sk);
+  }
+  if (sk.flush) sk.flush();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  const double runS = (double)(nowUs() - start) / 1e6;
+
+  std::vector<Msg> msgs;
+  {
+    std::lock_guard<std::mutex> lock(g_msgMutex);
+    msgs.swap(g_msgs);
+  }
+
+  int failures = 0;
+  std::vector<Sample> samples;
+  size_t payloadBytes = 0, wireBytes = 0;
+  for (const Msg& m : msgs) {
+    const bool ok = mode == 0 ? decodeJson(m, samples) : mode == 1 ? decodeCompact(m, samples) : decodeBatch(m, samples);
+    if (!ok) {
+      std::printf("FAIL: %s: undecodable message (%zu bytes)\n", sk.name, m.payload.size());
+      failures++;
+    }
+    const size_t rem = 2 + m.topicLen + m.payload.size();
+    payloadBytes += m.payload.size();
+    wireBytes += rem + 1 + (rem >= 128 ? 2 : 1);
+  }
+
+  std::map<uint32_t, const Read*> byTs;
+  for (size_t i = 0; i < g_reads.size(); i++) {
+    const Read& r = g_reads[i];
+    byTs[r.ts] = &r;
+    if (i > 0) {
+      const uint32_t d = r.ts - g_reads[i - 1].ts;
+      if (d == 0 || d % r.periodMs != 0) {
+        std::printf("FAIL: %s: read %zu at %u ms is off the %u ms grid (previous %u ms)\n", sk.name, i, r.ts,
+                    r.periodMs, g_reads[i - 1].ts);
+        failures++;
+      }
+    }
+  }
+
+  // Decoded samples against the read stamped with the same time
+  std::map<uint32_t, bool> seen;
+  std::vector<uint32_t> latency;
+  int mismatches = 0;
+  for (const Sample& smp : samples) {
+    auto it = byTs.find(smp.ts);
+    bool match = it != byTs.end();
+    if (match) {
+      float c[kValues];
+      calibrated(it->second->s, c);
+      int16_t counts[kValues];
+      imu_batch::quantizeSample(c[0], c[1], c[2], c[3], c[4], c[5], c[6], counts);
+      for (int i = 0; i < kValues && match; i++) {
+        match = mode == 0 ? std::fabs(smp.v[i] - c[i]) <= 0.0011f : smp.v[i] == (float)counts[i];
+      }
+    }
+    if (!match) {
+      if (mismatches++ < 3) std::printf("FAIL: %s: sample at %u ms does not match the read at that time\n", sk.name, smp.ts);
+      continue;
+    }
+    seen[smp.ts] = true;
+    latency.push_back(smp.rxMs - smp.ts);
+  }
+  failures += mismatches;
+
+  int missing = 0;
+  for (const Read& r : g_reads) {
+    if (r.linkUp && !seen.count(r.ts)) missing++;
+  }
+  if (missing) {
+    std::printf("FAIL: %s: %d samples read while the link was up never arrived\n", sk.name, missing);
+    failures++;
+  }
+
+  const uint32_t bound = sk.latencyBoundMs + toleranceMs;
+  if (percentile(latency, 1.0) > bound) {
+    std::printf("FAIL: %s: latency max %u ms > %u ms\n", sk.name, percentile(latency, 1.0), bound);
+    failures++;
+  }
+
+  const double n = samples.empty() ? 1.0 : (double)samples.size();
+  std::printf("%-8s %zu msgs (%.1f/s), %zu samples, %.1f B/sample payload (%.1f with MQTT framing), "
+              "latency p50 %u ms, max %u ms\n",
+              sk.name, msgs.size(), msgs.size() / runS, samples.size(), payloadBytes / n, wireBytes / n,
+              percentile(latency, 0.5), percentile(latency, 1.0));
+  return failures;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  double seconds = 3.0;
+  uint32_t toleranceMs = 50;
+  for (int i = 1; i < argc; i++) {
+    const bool hasArg = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--seconds") && hasArg) seconds = std::atof(argv[++i]);
+    else if (!std::strcmp(argv[i], "--tolerance-ms") && hasArg) toleranceMs = (uint32_t)std::atoi(argv[++i]);
+  }
+
+  StandInBroker broker(onPublish);
+  broker.install();
+  hostImuRead = imuRead;
+  Serial.out = nullptr;
+
+  std::printf("%.1f s per mode at 50 Hz, a 3.5-period stall at 40%%, 100 Hz from 60%%\n", seconds);
+  int failures = 0;
+  for (int mode = 0; mode < 3; mode++) failures += runMode(mode, seconds, toleranceMs);
+
+  if (failures) std::printf("FAILED: %d checks\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,477 @@
+// ingest_bench: replay a recorded fleet capture through the ingest service
+//
+//  1) decode only: every capture line straight into ingestMessage()
+//     (JSON scan + column append, no sockets)
+//  2) end to end: a stand-in broker thread on a socketpair answers
+//     CONNECT/SUBSCRIBE, then streams the capture as MQTT PUBLISH frames
+//     (only topics matching the subscriptions) into MqttSubscriber ->
+//     ingestMessage(); reports msgs/s, MB/s and read -> row lag
+//  3) replay times: a capstone that reboots during a broker outage, then
+//     replays its journal ("replay":1, original ts) after reconnecting.
+//     DeviceClock must map every replayed row back to the wall time it was
+//     recorded at (within the network delay), and keep live rows at their
+//     receive time. The rows then go into a time-series store (tsstore.h),
+//     as telemetry_ingest --store does; every message must come back from
+//     a raw query, the replayed ones at their recorded time, and from a
+//     1 s bucketed query
+//  4) unsafe names: JSON keys and a topic that would leave the output
+//     directory as file paths ("../x", "a/b", ".hidden", device "..") must
+//     be refused by the columns and by the store, and nothing may be
+//     written outside it
+//
+// Capture format is `mosquitto_sub -v` output, one "topic payload" per line:
+//   mosquitto_sub -v -t 'device/+/telemetry' -t 'tinyml/esp32/#' > fleet.txt
+// Without a capture, a synthetic fleet is written to fleet_capture.txt first
+// (IMU 50 Hz, LDR 20 Hz, TinyML 2 Hz telemetry in the labs' exact formats).
+//
+// Usage:
+//   ingest_bench [capture.txt] [--devices N] [--seconds S] [--passes P]
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -pthread -iquote ingest -iquote tsstore -o ingest_bench
+//       bench/ingest_bench.cpp ingest/mqtt_sub.cpp ingest/ingest.cpp ingest/columns.cpp
+//       tsstore/tsstore.cpp tsstore/gorilla.cpp
+
+#include "ingest.h"
+#include "mqtt_sub.h"
+#include "tsstore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* kFilters[] = {"device/+/telemetry", "tinyml/esp32/telemetry", "tinyml/esp32/+/telemetry"};
+const size_t kFilterCount = sizeof(kFilters) / sizeof(kFilters[0]);
+
+double secondsSince(Clock::time_point t0)
+{
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+struct CaptureLine {
+  std::string topic;
+  std::string payload;
+};
+
+// Synthetic fleet: 60% IMU, 30% LDR, 10% TinyML capstones
+void writeSyntheticCapture(const char* path, int devices, int seconds)
+{
+  FILE* f = std::fopen(path, "w");
+  if (!f) return;
+  srand(1);
+  for (int ms = 0; ms < seconds * 1000; ms += 20) {
+    for (int d = 0; d < devices; d++) {
+      const int kind = d % 10;
+      const float n = (float)(rand() % 1000) / 1000.0f;
+      if (kind < 6) {
+        std::fprintf(f, "device/imu%03d/telemetry {\"id\":\"MPU6050_ESP32_%03d\",\"ts_ms\":%d,"
+                        "\"accel\":{\"uom\":\"m/s2\",\"unc\":0.150,\"x\":%.3f,\"y\":%.3f,\"z\":%.3f},"
+                        "\"gyro\":{\"uom\":\"deg/s\",\"unc\":1.000,\"x\":%.3f,\"y\":%.3f,\"z\":%.3f},"
+                        "\"temp_c\":%.2f}\n",
+                     d, d, ms, 0.1f * n, -0.2f * n, 9.81f - n, 3.0f * n, -1.0f * n, 0.5f * n,
+                     27.0f + n);
+      } else if (kind < 9) {
+        if (ms % 50 != 0) continue;
+        std::fprintf(f, "device/ldr%03d/telemetry {\"id\":\"LDR_ESP32_%03d\",\"property\":\"LightLevel\","
+                        "\"value\":%.2f,\"uom\":\"adc_counts\",\"uncertainty\":20.0000,\"ts_ms\":%d}\n",
+                     d, d, 1500.0f + 500.0f * n, ms);
+      } else {
+        if (ms % 500 != 0) continue;
+        std::fprintf(f, "tinyml/esp32/cap%03d/telemetry {\"ts\":%d,\"pred\":%d,\"stable\":%d,\"post\":%d,"
+                        "\"act\":0,\"conf\":%.3f,\"conf_z\":%.3f,\"anom\":0,\"infer_us\":%d,\"uptime_s\":%d}\n",
+                     d, ms, rand() % 3, 1, 1, 0.5f + 0.5f * n, n - 0.5f, 900 + rand() % 200, ms / 1000);
+      }
+    }
+  }
+  std::fclose(f);
+}
+
+bool loadCapture(const char* path, std::vector<CaptureLine>& out)
+{
+  FILE* f = std::fopen(path, "r");
+  if (!f) return false;
+  std::vector<char> line(64 * 1024);
+  while (std::fgets(line.data(), (int)line.size(), f)) {
+    char* sp = std::strchr(line.data(), ' ');
+    if (!sp) continue;
+    size_t n = std::strlen(sp + 1);
+    while (n && (sp[n] == '\n' || sp[n] == '\r')) n--;
+    out.push_back({std::string(line.data(), sp), std::string(sp + 1, n)});
+  }
+  std::fclose(f);
+  return true;
+}
+
+bool subscribed(const std::string& topic)
+{
+  for (const char* f : kFilters) {
+    if (mqttTopicMatches(f, topic.data(), topic.size())) return true;
+  }
+  return false;
+}
+
+// MQTT PUBLISH (QoS 0) frame
+void appendPublish(std::vector<uint8_t>& out, const std::string& topic, const std::string& payload)
+{
+  size_t rem = 2 + topic.size() + payload.size();
+  out.push_back(0x30);
+  do {
+    uint8_t b = rem % 128;
+    rem /= 128;
+    if (rem) b |= 0x80;
+    out.push_back(b);
+  } while (rem);
+  out.push_back((uint8_t)(topic.size() >> 8));
+  out.push_back((uint8_t)(topic.size() & 0xFF));
+  out.insert(out.end(), topic.begin(), topic.end());
+  out.insert(out.end(), payload.begin(), payload.end());
+}
+
+bool readExact(int fd, uint8_t* p, size_t n)
+{
+  while (n) {
+    ssize_t r = ::read(fd, p, n);
+    if (r <= 0) return false;
+    p += r;
+    n -= (size_t)r;
+  }
+  return true;
+}
+
+// Reads one control packet, returns its type (or -1)
+int readPacket(int fd, std::vector<uint8_t>& body)
+{
+  uint8_t first;
+  if (!readExact(fd, &first, 1)) return -1;
+  size_t rem = 0;
+  for (unsigned shift = 0; shift < 28; shift += 7) {
+    uint8_t b;
+    if (!readExact(fd, &b, 1)) return -1;
+    rem |= (size_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) break;
+  }
+  body.resize(rem);
+  if (rem && !readExact(fd, body.data(), rem)) return -1;
+  return first >> 4;
+}
+
+// Stand-in broker: CONNACK, SUBACK per SUBSCRIBE, then the frames
+void standInBroker(int fd, const std::vector<uint8_t>& frames, int passes)
+{
+  std::vector<uint8_t> body;
+  if (readPacket(fd, body) != 1) return;
+  const uint8_t connack[4] = {0x20, 0x02, 0x00, 0x00};
+  if (::write(fd, connack, 4) != 4) return;
+
+  for (size_t i = 0; i < kFilterCount; i++) {
+    if (readPacket(fd, body) != 8 || body.size() < 2) return;
+    const uint8_t suback[5] = {0x90, 0x03, body[0], body[1], 0x00};
+    if (::write(fd, suback, 5) != 5) return;
+  }
+
+  for (int p = 0; p < passes; p++) {
+    const uint8_t* d = frames.data();
+    size_t left = frames.size();
+    while (left) {
+      ssize_t w = ::write(fd, d, left);
+      if (w <= 0) return;
+      d += w;
+      left -= (size_t)w;
+    }
+  }
+  ::shutdown(fd, SHUT_WR);
+}
+
+// One message of the replay scenario; "wall" carries the true record time
+struct TimedMessage {
+  int64_t rxMs;
+  std::string payload;
+  bool operator<(const TimedMessage& o) const { return rxMs < o.rxMs; }
+};
+
+int checkReplayTimes()
+{
+  const int64_t epochMs = 1700000000000ll;   // wall time of the first boot
+  const int64_t downFrom = 10000, downTo = 20000, rebootAt = 15000;
+  std::vector<TimedMessage> msgs;
+  std::vector<std::pair<int64_t, int64_t>> journal;   // (ts, wall), oldest first
+  char buf[160];
+  srand(2);
+  for (int64_t wall = 0; wall < 30000; wall += 500) {
+    const int64_t ts = wall < rebootAt ? wall : wall - rebootAt;
+    if (wall >= downFrom && wall < downTo) {
+      journal.emplace_back(ts, wall);
+      continue;
+    }
+    std::snprintf(buf, sizeof(buf), "{\"ts\":%lld,\"conf\":0.900,\"wall\":%lld}", (long long)ts,
+                  (long long)wall);
+    msgs.push_back({wall + 20 + rand() % 60, buf});
+  }
+  for (size_t k = 0; k < journal.size(); k++) {   // 10 Hz after reconnecting
+    std::snprintf(buf, sizeof(buf), "{\"ts\":%lld,\"conf\":0.900,\"wall\":%lld,\"replay\":1}",
+                  (long long)journal[k].first, (long long)journal[k].second);
+    msgs.push_back({downTo + 100 * (int64_t)k + 20 + rand() % 60, buf});
+  }
+  std::stable_sort(msgs.begin(), msgs.end());
+
+  const std::string topic = "tinyml/esp32/lab12/telemetry";
+  const char* dbRoot = "ingest_bench_db";
+  std::error_code ec;
+  std::filesystem::remove_all(dbRoot, ec);
+  TsStore db;
+  if (!db.open(dbRoot)) {
+    std::printf("FAIL: cannot open store %s\n", dbRoot);
+    return 1;
+  }
+  FleetColumns fleet;
+  IngestStats st;
+  DeviceClock clock;
+  std::vector<int64_t> tMs;
+  int failures = 0, replayed = 0;
+  int64_t worstMs = 0;
+  size_t next = 0;
+  for (int64_t drainAt = 1000; next < msgs.size(); drainAt += 1000) {   // once per second, as the service does
+    for (; next < msgs.size() && msgs[next].rxMs < drainAt; next++) {
+      ingestMessage(fleet, st, topic.data(), topic.size(), msgs[next].payload.data(), msgs[next].payload.size(),
+                    (epochMs + msgs[next].rxMs) * 1000);
+    }
+    if (fleet.size() == 0) continue;
+    DeviceColumns& d = fleet.at(0);
+    clock.rowTimesMs(d, tMs);
+    const std::vector<float>* wall = nullptr;
+    const std::vector<float>* replay = nullptr;
+    for (const Column& c : d.columns()) {
+      if (c.name == "wall") wall = &c.values;
+      if (c.name == "replay") replay = &c.values;
+    }
+    for (size_t r = 0; r < d.rows(); r++) {
+      const int64_t rx = d.rxUs()[r] / 1000;
+      if (!replay || (*replay)[r] != 1.0f) {
+        if (tMs[r] != rx) {
+          std::printf("FAIL: live row at %lld ms stored at %lld ms\n", (long long)rx, (long long)tMs[r]);
+          failures++;
+        }
+        continue;
+      }
+      replayed++;
+      const int64_t err = std::llabs(tMs[r] - (epochMs + (int64_t)(*wall)[r]));
+      if (err > worstMs) worstMs = err;
+      if (err > 80) {
+        std::printf("FAIL: replayed row recorded at %lld ms stored %lld ms off\n", (long long)(*wall)[r],
+                    (long long)err);
+        failures++;
+      }
+    }
+    for (const Column& c : d.columns()) {   // as appendToStore in telemetry_ingest
+      for (size_t r = 0; r < d.rows(); r++) {
+        if (!std::isnan(c.values[r])) db.append(d.id(), c.name, tMs[r], c.values[r]);
+      }
+    }
+    d.clear();
+    if (drainAt % 10000 == 0) db.flush();
+  }
+  db.flush();
+  std::printf("replay times: %d replayed rows across a reboot, worst error %lld ms\n", replayed,
+              (long long)worstMs);
+
+  // Every message back from the store, replayed ones at their recorded time
+  const std::vector<TsPoint> pts = db.query("tinyml/esp32/lab12", "wall", epochMs, epochMs + 60000, 0);
+  const std::vector<TsPoint> secs = db.query("tinyml/esp32/lab12", "wall", epochMs, epochMs + 60000, 1000);
+  uint32_t inSecs = 0;
+  for (const TsPoint& p : secs) inSecs += p.count;
+  int found = 0;
+  for (const auto& j : journal) {
+    for (const TsPoint& p : pts) {
+      if (p.mean == (float)j.second && std::llabs(p.t - (epochMs + j.second)) <= 80) {
+        found++;
+        break;
+      }
+    }
+  }
+  bool sorted = true;
+  for (size_t k = 1; k < pts.size(); k++) sorted = sorted && pts[k - 1].t <= pts[k].t;
+  std::printf("replay store: %zu points queried (%u in 1 s buckets), %llu appended late, "
+              "%d of %zu journaled at their recorded time\n",
+              pts.size(), inSecs, (unsigned long long)db.stats().late, found, journal.size());
+  if (pts.size() != msgs.size() || inSecs != msgs.size() || !sorted || found != (int)journal.size()) {
+    std::printf("FAIL: store returned %zu raw / %u bucketed points of %zu messages (sorted %d), "
+                "%d of %zu journaled rows at their recorded time\n",
+                pts.size(), inSecs, msgs.size(), sorted ? 1 : 0, found, journal.size());
+    failures++;
+  }
+  db.close();
+  std::filesystem::remove_all(dbRoot, ec);
+  if (replayed != (int)journal.size()) {
+    std::printf("FAIL: %d of %zu journaled rows replayed\n", replayed, journal.size());
+    failures++;
+  }
+  return failures;
+}
+
+int checkUnsafeNames()
+{
+  namespace fs = std::filesystem;
+  const char* root = "ingest_bench_names";
+  std::error_code ec;
+  fs::remove_all(root, ec);
+  // Nested, so a path that climbs out still lands under root and is found
+  const std::string dir = std::string(root) + "/a/b/c/cols";
+  const std::string dbRoot = std::string(root) + "/d/e/f/db";
+  fs::create_directories(dir, ec);
+
+  const std::string topic = "../telemetry";   // device ".."
+  const std::string payload = "{\"ts\":1,\"../../x\":1,\"a/b\":2,\".hidden\":3,\"ok\":4,\"nested\":{\"..\":5}}";
+  FleetColumns fleet;
+  IngestStats st;
+  ingestMessage(fleet, st, topic.data(), topic.size(), payload.data(), payload.size(), 0);
+  DeviceColumns& d = fleet.at(0);
+  const bool colsOk = d.columns().size() == 1 && d.columns()[0].name == "ok" && st.badFields == 4;
+  d.flush(dir);
+
+  TsStore db;
+  db.open(dbRoot);
+  const bool badRefused = !db.append(d.id(), "../../x", 0, 1.0f) && !db.append(d.id(), "a/b", 0, 2.0f) &&
+                          db.query(d.id(), "../../x", 0, 1, 0).empty();
+  const bool okStored = db.append(d.id(), "ok", 0, 4.0f);
+  const uint64_t badNames = db.stats().badNames;
+  db.close();
+
+  // Every file written is inside its own directory
+  int escaped = 0;
+  for (const fs::directory_entry& e : fs::recursive_directory_iterator(root, ec)) {
+    const std::string p = e.path().string();
+    if (!e.is_directory() && p.rfind(dir + "/", 0) != 0 && p.rfind(dbRoot + "/", 0) != 0) escaped++;
+  }
+  const bool layoutOk = fs::exists(dir + "/_../ok.f32") && fs::exists(dbRoot + "/_../ok");
+  std::printf("unsafe names: %llu of 5 JSON fields refused, %llu of 2 store appends refused, %d files outside\n",
+              (unsigned long long)st.badFields, (unsigned long long)badNames, escaped);
+  int failures = 0;
+  if (!colsOk || !badRefused || !okStored || badNames != 2 || escaped || !layoutOk) {
+    std::printf("FAIL: unsafe names not refused (columns %d, store %d/%d, layout %d, escaped %d)\n", colsOk ? 1 : 0,
+                badRefused ? 1 : 0, okStored ? 1 : 0, layoutOk ? 1 : 0, escaped);
+    failures++;
+  }
+  fs::remove_all(root, ec);
+  return failures;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const char* capturePath = nullptr;
+  int devices = 200, seconds = 10, passes = 3;
+  for (int i = 1; i < argc; i++) {
+    const bool hasArg = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--devices") && hasArg) devices = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--seconds") && hasArg) seconds = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--passes") && hasArg) passes = std::atoi(argv[++i]);
+    else capturePath = argv[i];
+  }
+  if (!capturePath) {
+    capturePath = "fleet_capture.txt";
+    writeSyntheticCapture(capturePath, devices, seconds);
+    std::printf("synthetic capture: %s (%d devices, %d s)\n", capturePath, devices, seconds);
+  }
+
+  std::vector<CaptureLine> capture;
+  if (!loadCapture(capturePath, capture) || capture.empty()) {
+    std::fprintf(stderr, "cannot read capture %s\n", capturePath);
+    return 1;
+  }
+
+  std::vector<uint8_t> frames;
+  size_t matched = 0, payloadBytes = 0;
+  for (const CaptureLine& l : capture) {
+    if (!subscribed(l.topic)) continue;
+    appendPublish(frames, l.topic, l.payload);
+    matched++;
+    payloadBytes += l.payload.size();
+  }
+  std::printf("capture: %zu messages, %zu on subscribed topics, %.1f MB of frames\n",
+              capture.size(), matched, frames.size() / 1e6);
+
+  // 1) Decode only
+  {
+    FleetColumns fleet;
+    IngestStats st;
+    auto t0 = Clock::now();
+    for (int p = 0; p < passes; p++) {
+      for (const CaptureLine& l : capture) {
+        ingestMessage(fleet, st, l.topic.data(), l.topic.size(), l.payload.data(), l.payload.size(), 0);
+      }
+    }
+    const double s = secondsSince(t0);
+    std::printf("decode only: %.0f msgs/s, %.1f MB/s, %.0f ns/msg, devices=%zu parse_err=%llu\n",
+                st.msgs / s, st.bytes / s / 1e6, s * 1e9 / st.msgs, fleet.size(),
+                (unsigned long long)st.parseErrors);
+  }
+
+  // 2) End to end through the stand-in broker
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+    std::perror("socketpair");
+    return 1;
+  }
+  std::thread broker(standInBroker, sv[1], std::cref(frames), passes);
+
+  FleetColumns fleet;
+  IngestStats st;
+  MqttSubscriber sub;
+  if (!sub.attach(sv[0], "ingest_bench")) {
+    std::fprintf(stderr, "handshake with stand-in broker failed\n");
+    broker.join();
+    return 1;
+  }
+  for (const char* f : kFilters) sub.subscribe(f);
+
+  MqttMessage m;
+  size_t maxBacklog = 0;
+  auto t0 = Clock::now();
+  while (sub.readSome(1000) >= 0) {
+    const size_t backlog = sub.backlogBytes();
+    if (backlog > maxBacklog) maxBacklog = backlog;
+    while (sub.next(m)) {
+      ingestMessage(fleet, st, m.topic, m.topicLen, m.payload, m.len, 0);
+      st.lag.add((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     Clock::now().time_since_epoch()).count() - m.rxNs);
+    }
+  }
+  const double s = secondsSince(t0);
+  broker.join();
+  ::close(sv[1]);
+
+  uint64_t columns = 0;
+  for (size_t i = 0; i < fleet.size(); i++) columns += fleet.at(i).columns().size();
+
+  std::printf("end to end: %llu msgs in %.3f s, %.0f msgs/s, %.1f MB/s payload\n",
+              (unsigned long long)st.msgs, s, st.msgs / s, st.bytes / s / 1e6);
+  std::printf("lag (read -> row): p50 %.1f us, p99 %.1f us, max %.1f us; max backlog %zu bytes\n",
+              st.lag.percentileNs(0.50) / 1e3, st.lag.percentileNs(0.99) / 1e3,
+              st.lag.maxNs / 1e3, maxBacklog);
+  std::printf("store: %zu devices, %llu columns, %llu rows, parse_err=%llu\n",
+              fleet.size(), (unsigned long long)columns,
+              (unsigned long long)fleet.bufferedRows(), (unsigned long long)st.parseErrors);
+
+  const bool ok = st.msgs == (uint64_t)matched * passes && st.parseErrors == 0;
+  if (!ok) std::printf("FAIL: expected %zu msgs without parse errors\n", matched * passes);
+
+  // 3) Replay times
+  const int replayFailures = checkReplayTimes();
+  const int nameFailures = checkUnsafeNames();
+  return ok && replayFailures == 0 && nameFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+// journal_bench: the lab-12 capstone's store-and-forward journal
+// (tinyML/lab/lab-12-capstone/lab-12.h), on host
+//
+// The sketch header is compiled as is against the shim. Its "journal"
+// partition is in memory with NOR semantics (shim/esp_partition.h), and its
+// own logDrainTask runs on a thread and erases sectors ahead of the writer.
+//  1) append cost per record. The ring wraps and nothing is acked, so the
+//     oldest records are dropped. Every sector is erased by the drain task,
+//     and the writer waits for it between sectors (a sector is 32 s of
+//     records at 2 Hz on device)
+//  2) overrun: with a 35 ms erase, a burst of appends outruns the drain
+//     task. The records are dropped, and no append ever waits for an erase
+//  3) replay msgs/s through the sketch's mqttClient into a stand-in broker
+//     (journalPeek, renderRecord, publish, journalAck)
+//  4) replayJournal() in real time, to check the JOURNAL_REPLAY_HZ cap
+//  5) reboot: journalBegin() recovers head and tail from the flash
+// It fails (exit 1) if any check does not hold.
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -pthread -I shim -o journal_bench bench/journal_bench.cpp bench/standin_broker.cpp
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <atomic>
+#include <math.h>
+#include <stdint.h>
+
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "standin_broker.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace lab12 {
+#include "../../../../tinyML/lab/lab-12-capstone/lab-12.h"
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const uint32_t kEraseUs = 35000;   // ESP32 sector erase, ~30-40 ms
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+  if (ok) return;
+  std::printf("FAIL: %s\n", what);
+  failures++;
+}
+
+double secondsSince(Clock::time_point t0)
+{
+  return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+uint32_t pending() { return lab12::journalHead - lab12::journalTail; }
+
+lab12::TelemetryRecord record(uint32_t i)
+{
+  lab12::TelemetryRecord r = {};
+  r.ts = i * 500;
+  r.pred = (int8_t)(i % 3);
+  r.conf = 0.5f;
+  return r;
+}
+
+// The drain task has erased the sector the writer asked for
+bool eraseCaughtUp()
+{
+  return lab12::journalEraseDone.load(std::memory_order_acquire) ==
+         lab12::journalEraseWant.load(std::memory_order_acquire);
+}
+
+void waitForErase()
+{
+  while (!eraseCaughtUp()) delay(1);
+}
+
+}  // namespace
+
+int main()
+{
+  Serial.out = nullptr;
+  HostPartition* part = hostPartitionAdd(JOURNAL_LABEL, JOURNAL_SECTORS * JOURNAL_SECTOR);
+
+  lab12::journalBegin();
+  check(lab12::journalSlots == JOURNAL_SECTORS * JOURNAL_PER_SECTOR, "journalBegin did not find the partition");
+  xTaskCreatePinnedToCore(lab12::logDrainTask, "logDrain", 4096, nullptr, tskIDLE_PRIORITY, &lab12::logDrainHandle,
+                          tskNO_AFFINITY);
+  waitForErase();
+
+  // 1) Append cost; the writer only ever enters erased sectors
+  const uint32_t kAppends = 20000;
+  const uint32_t erases0 = part->erases.load();
+  double appendS = 0;
+  for (uint32_t i = 0; i < kAppends;) {
+    waitForErase();
+    auto t0 = Clock::now();
+    for (uint32_t k = 0; k < JOURNAL_PER_SECTOR && i < kAppends; k++, i++) lab12::journalAppend(record(i));
+    appendS += secondsSince(t0);
+  }
+  std::printf("append: %u records, %.1f ns/record, pending=%u dropped=%u, %u sectors erased by the drain task\n",
+              kAppends, appendS * 1e9 / kAppends, pending(), lab12::journalDropped,
+              part->erases.load() - erases0);
+  check(lab12::journalHead == kAppends, "an append was lost with the next sector erased");
+  check(pending() + lab12::journalDropped == kAppends, "pending + dropped != appended");
+  check(pending() <= lab12::journalSlots - JOURNAL_PER_SECTOR, "pending reaches into the sector erased ahead");
+
+  // 2) Overrun: appends faster than the drain task can erase
+  waitForErase();
+  part->eraseUs = kEraseUs;
+  const uint32_t head0 = lab12::journalHead, dropped0 = lab12::journalDropped;
+  const uint32_t kBurst = 4 * JOURNAL_PER_SECTOR;
+  double maxAppendUs = 0;
+  for (uint32_t i = 0; i < kBurst; i++) {
+    auto t0 = Clock::now();
+    lab12::journalAppend(record(i));
+    double us = secondsSince(t0) * 1e6;
+    if (us > maxAppendUs) maxAppendUs = us;
+  }
+  const uint32_t written = lab12::journalHead - head0;
+  const uint32_t lost = kBurst - written;   // the rest of journalDropped is the ring giving up its oldest
+  std::printf("overrun: %u appends in a burst, %u written, %u lost, longest append %.1f us (erase %u ms)\n",
+              kBurst, written, lost, maxAppendUs, kEraseUs / 1000);
+  check(lost > 0, "a burst faster than the erase lost nothing");
+  check(lab12::journalDropped - dropped0 >= lost, "lost appends are not counted in journalDropped");
+  check(maxAppendUs < kEraseUs / 2, "an append waited for a sector erase");
+  waitForErase();
+  part->eraseUs = 0;
+
+  // 3) Unlimited replay through the sketch's client into the stand-in broker
+  std::atomic<uint32_t> received{0};
+  StandInBroker broker([&](const char* topic, const uint8_t*, size_t, bool) {
+    if (std::strcmp(topic, lab12::TOPIC_TELEM) == 0) received.fetch_add(1);
+  });
+  broker.install();
+  lab12::mqttClient.setServer(lab12::MQTT_HOST, lab12::MQTT_PORT);
+  check(lab12::mqttClient.connect(lab12::MQTT_CLIENT_ID), "MQTT connect to the stand-in broker");
+
+  const uint32_t toReplay = pending();
+  uint32_t replayed = 0;
+  lab12::TelemetryRecord rec;
+  char payload[OUTBOX_PAYLOAD];
+  auto t0 = Clock::now();
+  while (lab12::journalPeek(rec)) {
+    int n = lab12::renderRecord(rec, true, payload, sizeof(payload));
+    if (!lab12::mqttClient.publish(lab12::TOPIC_TELEM, (const uint8_t*)payload, n)) break;
+    lab12::journalAck();
+    replayed++;
+  }
+  double s = secondsSince(t0);
+  for (int i = 0; i < 2000 && received.load() < replayed; i++) delay(1);
+  std::printf("replay: %u msgs in %.3f s, %.0f msgs/s (broker received %u)\n", replayed, s, replayed / s,
+              received.load());
+  check(replayed == toReplay && pending() == 0, "replay did not drain the journal");
+  check(received.load() == replayed, "the broker did not receive every replayed record");
+
+  // 4) Rate-limited replay, as loop() runs it
+  for (uint32_t i = 0; i < 2 * JOURNAL_PER_SECTOR;) {
+    waitForErase();
+    for (uint32_t k = 0; k < JOURNAL_PER_SECTOR; k++, i++) lab12::journalAppend(record(i));
+  }
+  const uint32_t kLimitedMs = 3000;
+  lab12::replayTokens = 0.0f;
+  lab12::replayLastMs = millis();
+  const uint32_t before = pending(), start = millis();
+  while (millis() - start < kLimitedMs) {
+    lab12::replayJournal();
+    delay(1);
+  }
+  const uint32_t sent = before - pending();
+  const float cap = lab12::JOURNAL_REPLAY_HZ * kLimitedMs / 1000.0f;
+  std::printf("limited replay: %u msgs in %.1f s (cap %.0f/s + burst %.0f)\n", sent, kLimitedMs / 1000.0,
+              lab12::JOURNAL_REPLAY_HZ, lab12::JOURNAL_REPLAY_BURST);
+  check(sent >= cap - 2 && sent <= cap + lab12::JOURNAL_REPLAY_BURST, "replay rate is not held at JOURNAL_REPLAY_HZ");
+
+  // 5) Reboot: the cursor is recovered from the acks written in place
+  const uint32_t headBefore = lab12::journalHead, pendingBefore = pending();
+  lab12::journalPart = nullptr;
+  lab12::journalHead = lab12::journalTail = 0;
+  lab12::journalBegin();
+  waitForErase();
+  std::printf("reboot: head %u -> %u, pending before=%u after=%u\n", headBefore, lab12::journalHead, pendingBefore,
+              pending());
+  check(lab12::journalHead == headBefore && pending() == pendingBefore, "journalBegin lost the cursor");
+
+  lab12::mqttClient.disconnect();
+  if (failures) {
+    std::printf("FAILED: %d checks\n", failures);
+    return 1;
+  }
+  return 0;
+}
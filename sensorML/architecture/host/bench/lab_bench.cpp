@@ -0,0 +1,250 @@
+// lab_bench: Google Benchmark suite for the lab pipeline modules
+//
+// The device code from lab/ (built against shim/Arduino.h), one benchmark per
+// stage of loop():
+//   BM_ComputeFeatures/<window>     computeFeatures() on a full window
+//   BM_PushAndFeatures/<window>     pushSample + computeFeatures + popOldest(hop)
+//   BM_FallbackClassify             fallbackClassify()
+//   BM_TinyMLInfer                  TinyML::infer() (label "tflm" when a model
+//                                   loaded, "fallback" otherwise)
+//   BM_SafetyAndActuate             Controller::safetyAndActuate(), labels
+//                                   alternating so the debounce path runs
+//   BM_ParseSensorML/<outputs>      parseSensorMLFromProgmem() on the main.ino
+//                                   document padded with extra <output> blocks
+//   BM_WindowPipeline/<window>      features -> infer -> safetyAndActuate
+// Window sizes: 10, 40 (main.ino), 160, 640 samples.
+//
+// Every benchmark reports allocs_per_iter, counted by the allocator in
+// alloc_count.cpp. The steady-state loops (all but BM_ParseSensorML, which
+// runs once at boot and builds String temporaries) must not allocate: such
+// a benchmark is marked ERROR and lab_bench exits 1.
+//
+// Machine-readable output for regression tracking:
+//   ./lab_bench --benchmark_format=json > lab_bench.json
+//   ./lab_bench --benchmark_out=lab_bench.json --benchmark_out_format=json
+// Two such files can be compared with tools/compare.py from the Google
+// Benchmark sources.
+//
+// Build: the CMake host build (host/CMakeLists.txt), target lab_bench.
+
+#include "alloc_count.h"
+#include "controller.h"
+#include "features.h"
+#include "inference.h"
+#include "sensorml_parser.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int kHop = 10;
+int g_allocFailures = 0;
+
+// Allocations made by the benchmark loop since `before`, per iteration; a
+// steady-state loop that allocates fails the run
+void countAllocs(benchmark::State& state, uint64_t before, bool steadyState = true)
+{
+  const uint64_t n = allocCounts().allocs - before;
+  state.counters["allocs_per_iter"] = benchmark::Counter((double)n, benchmark::Counter::kAvgIterations);
+  if (n == 0 || !steadyState) return;
+  g_allocFailures++;
+  state.SkipWithError("steady-state loop allocates");
+}
+
+// main.ino's SensorML document
+const char kSensorML[] PROGMEM = R"XML(
+<SensorML>
+  <member>
+    <System>
+      <identifier>LDR_ESP32_01</identifier>
+      <outputs>
+        <output name="light">
+          <uom>adc_counts</uom>
+          <calibration>
+            <scale>1.0</scale>
+            <offset>0.0</offset>
+          </calibration>
+          <samplingRateHz>20</samplingRateHz>
+          <minSamplingRateHz>2</minSamplingRateHz>
+          <maxSamplingRateHz>20</maxSamplingRateHz>
+          <uncertainty>0.05</uncertainty>
+        </output>
+      </outputs>
+    </System>
+  </member>
+</SensorML>
+)XML";
+
+std::vector<float> makeSamples(size_t n)
+{
+  std::mt19937 rng(11);
+  std::normal_distribution<float> noise(0.0f, 8.0f);
+  std::vector<float> out(n);
+  for (size_t i = 0; i < n; i++) out[i] = 2000.0f + 900.0f * sinf(i * 0.01f) + noise(rng);
+  return out;
+}
+
+// Window of `size` samples, full
+struct FullWindow {
+  std::vector<float> storage;
+  WindowBuffer w;
+
+  explicit FullWindow(int size) : storage(size)
+  {
+    initWindowWith(w, storage.data(), size);
+    for (float x : makeSamples(size)) pushSample(w, x);
+  }
+};
+
+void BM_ComputeFeatures(benchmark::State& state)
+{
+  FullWindow fw((int)state.range(0));
+  Features f;
+  const uint64_t allocsBefore = allocCounts().allocs;
+  for (auto _ : state) {
+    computeFeatures(fw.w, f);
+    benchmark::DoNotOptimize(f);
+  }
+  countAllocs(state, allocsBefore);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ComputeFeatures)->Arg(10)->Arg(40)->Arg(160)->Arg(640);
+
+void BM_PushAndFeatures(benchmark::State& state)
+{
+  const int size = (int)state.range(0);
+  FullWindow fw(size);
+  const std::vector<float> samples = makeSamples(4096);
+  size_t k = 0;
+  Features f;
+  const uint64_t allocsBefore = allocCounts().allocs;
+  for (auto _ : state) {
+    for (int i = 0; i < kHop; i++) pushSample(fw.w, samples[k++ & 4095]);
+    computeFeatures(fw.w, f);
+    benchmark::DoNotOptimize(f);
+    popOldest(fw.w, kHop);
+  }
+  countAllocs(state, allocsBefore);
+  state.SetItemsProcessed(state.iterations() * kHop);
+}
+BENCHMARK(BM_PushAndFeatures)->Arg(10)->Arg(40)->Arg(160)->Arg(640);
+
+// Features from a sweep over the three classes
+std::vector<Features> makeFeatures()
+{
+  std::vector<Features> out;
+  for (int i = 0; i < 64; i++) {
+    const float mean = 600.0f + i * 50.0f;
+    out.push_back({mean, 12.0f, mean - 30.0f, mean + 30.0f, 0.5f});
+  }
+  return out;
+}
+
+void BM_FallbackClassify(benchmark::State& state)
+{
+  const std::vector<Features> fs = makeFeatures();
+  size_t k = 0;
+  const uint64_t allocsBefore = allocCounts().allocs;
+  for (auto _ : state) {
+    InferenceResult r = fallbackClassify(fs[k++ & 63]);
+    benchmark::DoNotOptimize(r);
+  }
+  countAllocs(state, allocsBefore);
+}
+BENCHMARK(BM_FallbackClassify);
+
+void BM_TinyMLInfer(benchmark::State& state)
+{
+  TinyML ml;
+  ml.begin();
+  state.SetLabel(ml.isReady() ? "tflm" : "fallback");
+  const std::vector<Features> fs = makeFeatures();
+  size_t k = 0;
+  const uint64_t allocsBefore = allocCounts().allocs;
+  for (auto _ : state) {
+    InferenceResult r = ml.infer(fs[k++ & 63]);
+    benchmark::DoNotOptimize(r);
+  }
+  countAllocs(state, allocsBefore);
+}
+BENCHMARK(BM_TinyMLInfer);
+
+void BM_SafetyAndActuate(benchmark::State& state)
+{
+  Controller ctrl;
+  ctrl.begin(2);
+  const std::vector<Features> fs = makeFeatures();
+  std::vector<InferenceResult> rs;
+  for (const Features& f : fs) rs.push_back(fallbackClassify(f));
+  size_t k = 0;
+  const uint64_t allocsBefore = allocCounts().allocs;
+  for (auto _ : state) {
+    ControlAction a = ctrl.safetyAndActuate(rs[(k++ * 7) & 63], 0.05f);
+    benchmark::DoNotOptimize(a);
+  }
+  countAllocs(state, allocsBefore);
+}
+BENCHMARK(BM_SafetyAndActuate);
+
+void BM_ParseSensorML(benchmark::State& state)
+{
+  // The lab document, plus range(0) - 1 more <output> blocks before it ends
+  std::string doc = kSensorML;
+  const std::string extra =
+      "        <output name=\"aux\">\n"
+      "          <uom>adc_counts</uom>\n"
+      "          <samplingRateHz>5</samplingRateHz>\n"
+      "        </output>\n";
+  const size_t at = doc.find("      </outputs>");
+  for (int i = 1; i < state.range(0); i++) doc.insert(at, extra);
+
+  SensorConfig cfg;
+  const uint64_t allocsBefore = allocCounts().allocs;
+  for (auto _ : state) {
+    bool ok = parseSensorMLFromProgmem(doc.c_str(), cfg);
+    benchmark::DoNotOptimize(ok);
+  }
+  countAllocs(state, allocsBefore, false);
+  state.SetBytesProcessed(state.iterations() * (int64_t)doc.size());
+}
+BENCHMARK(BM_ParseSensorML)->Arg(1)->Arg(8)->Arg(32);
+
+void BM_WindowPipeline(benchmark::State& state)
+{
+  FullWindow fw((int)state.range(0));
+  TinyML ml;
+  ml.begin();
+  Controller ctrl;
+  ctrl.begin(2);
+  const uint64_t allocsBefore = allocCounts().allocs;
+  for (auto _ : state) {
+    Features f;
+    computeFeatures(fw.w, f);
+    const InferenceResult r = ml.isReady() ? ml.infer(f) : fallbackClassify(f);
+    ControlAction a = ctrl.safetyAndActuate(r, 0.05f);
+    benchmark::DoNotOptimize(a);
+  }
+  countAllocs(state, allocsBefore);
+}
+BENCHMARK(BM_WindowPipeline)->Arg(10)->Arg(40)->Arg(160)->Arg(640);
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  if (g_allocFailures) {
+    fprintf(stderr, "FAILED: %d benchmark runs allocated in their steady-state loop\n", g_allocFailures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,204 @@
+// ldr_reconfig_sim: live SensorML reconfiguration of the LDR MQTT sketch
+// (sensorML/lab/ldr/extension), run on host against a stand-in broker
+//
+// The sketch's own setup()/loop() run in real time on the host shim, with a
+// fake ADC (shim/Arduino.h, WiFi.h, PubSubClient.h). The broker is a thread
+// on a socketpair (standin_broker.h). Once the link is up, the broker sends
+// --updates SensorML documents to the config topic, --gap-ms apart. They
+// alternate between two configs (20 <-> 50 Hz, uncertainty, uom), so every
+// update changes the period, the report band and the telemetry fragments.
+// For each update it measures:
+//  - stall: the longest loop() call between the publish and the new period
+//    taking effect. Those calls parse the document, apply the patch and
+//    republish the metadata, so this is the time sampling cannot run
+//  - span: the sample interval across the change
+//  - apply latency: from the publish until the new period is active
+// It fails (exit 1) in any of these cases:
+//  - an update is not applied within 1 s
+//  - a span exceeds the longer of the two periods + --tolerance-ms
+//  - the retained metadata is not republished with the new rate
+//
+// Usage:
+//   ldr_reconfig_sim [--updates N] [--gap-ms G] [--tolerance-ms T]
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -pthread -I shim -o ldr_reconfig_sim bench/ldr_reconfig_sim.cpp bench/standin_broker.cpp
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <atomic>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "standin_broker.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ldr {
+#include "../../../lab/ldr/extension/ESP32_SensorML_LDR_MQTT_NodeRED.ino"
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* kConfigs[2] = {
+  "<SensorML><samplingRateHz>50</samplingRateHz><uncertainty>5</uncertainty><uom>adc</uom></SensorML>",
+  "<SensorML><samplingRateHz>20</samplingRateHz><uncertainty>20</uncertainty><uom>adc_counts</uom></SensorML>",
+};
+const char* kConfigRate[2] = {"\"samplingRateHz\":50.00", "\"samplingRateHz\":20.00"};
+
+uint64_t nowUs()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             Clock::now().time_since_epoch()).count();
+}
+
+std::vector<uint64_t> g_samplesUs;   // one per ADC read, loop() thread only
+
+int fakeLdr(int)
+{
+  g_samplesUs.push_back(nowUs());
+  return 1800 + rand() % 400;
+}
+
+std::mutex g_metaMutex;
+std::string g_meta;   // last retained metadata
+int g_metaCount = 0;
+
+void onPublish(const char* topic, const uint8_t* payload, size_t len, bool retained)
+{
+  if (!retained || std::strcmp(topic, ldr::TOPIC_META.c_str()) != 0) return;
+  std::lock_guard<std::mutex> lock(g_metaMutex);
+  g_meta.assign((const char*)payload, len);
+  g_metaCount++;
+}
+
+// One loop() call, as the core's loopTask makes it; returns its duration.
+// The short sleep after it keeps the link helper and broker threads
+// scheduled on a single-core VM.
+uint64_t loopOnce()
+{
+  const uint64_t t0 = nowUs();
+  ldr::loop();
+  const uint64_t d = nowUs() - t0;
+  std::this_thread::sleep_for(std::chrono::microseconds(50));
+  return d;
+}
+
+void runFor(uint32_t ms, uint64_t& maxLoopUs)
+{
+  const uint64_t end = nowUs() + ms * 1000ull;
+  while (nowUs() < end) maxLoopUs = std::max(maxLoopUs, loopOnce());
+}
+
+uint64_t percentile(std::vector<uint64_t> v, double q)
+{
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t)(q * (double)v.size()))];
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  int updates = 20;
+  uint32_t gapMs = 400;
+  double toleranceMs = 5.0;
+  for (int i = 1; i < argc; i++) {
+    const bool hasArg = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--updates") && hasArg) updates = std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--gap-ms") && hasArg) gapMs = (uint32_t)std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--tolerance-ms") && hasArg) toleranceMs = std::atof(argv[++i]);
+  }
+
+  StandInBroker broker(onPublish);
+  broker.install();
+  hostAnalogRead = fakeLdr;
+  Serial.out = nullptr;
+
+  ldr::setup();
+  uint64_t maxLoopUs = 0;
+  const uint64_t t0 = nowUs();
+  while (!(ldr::linkUp() && broker.hasSubscriber(ldr::TOPIC_CFG.c_str())) && nowUs() - t0 < 3000000) {
+    maxLoopUs = std::max(maxLoopUs, loopOnce());
+  }
+  if (!ldr::linkUp()) {
+    std::printf("FAIL: link not up after 3 s\n");
+    return 1;
+  }
+  std::printf("link up after %.1f ms; sampling at %.0f Hz\n", (nowUs() - t0) / 1e3, ldr::samplingRateHz);
+  runFor(500, maxLoopUs);
+
+  std::vector<uint64_t> stalls, applies;
+  double worstExcessMs = -1e9;
+  int failures = 0;
+  for (int k = 0; k < updates; k++) {
+    const int c = k % 2;
+    const unsigned long oldPeriod = ldr::samplePeriodMs;
+    int metaBefore;
+    {
+      std::lock_guard<std::mutex> lock(g_metaMutex);
+      metaBefore = g_metaCount;
+    }
+
+    const uint64_t tPub = nowUs();
+    broker.publish(ldr::TOPIC_CFG.c_str(), kConfigs[c], std::strlen(kConfigs[c]));
+
+    // Until the new period is active: the longest loop() call is the stall
+    uint64_t stall = 0;
+    size_t samplesBefore = 0;
+    while (ldr::samplePeriodMs == oldPeriod && nowUs() - tPub < 1000000) {
+      samplesBefore = g_samplesUs.size();
+      stall = std::max(stall, loopOnce());
+    }
+    if (ldr::samplePeriodMs == oldPeriod) {
+      std::printf("FAIL: update %d not applied within 1 s\n", k + 1);
+      failures++;
+      continue;
+    }
+    applies.push_back(nowUs() - tPub);
+    stalls.push_back(stall);
+
+    const uint64_t gapEnd = tPub + gapMs * 1000ull;
+    while (nowUs() < gapEnd) maxLoopUs = std::max(maxLoopUs, loopOnce());
+
+    if (samplesBefore >= 1 && g_samplesUs.size() > samplesBefore) {
+      const double spanMs = (g_samplesUs[samplesBefore] - g_samplesUs[samplesBefore - 1]) / 1e3;
+      const double longer = (double)std::max(oldPeriod, ldr::samplePeriodMs);
+      worstExcessMs = std::max(worstExcessMs, spanMs - longer);
+      if (spanMs > longer + toleranceMs) {
+        std::printf("FAIL: update %d: sample interval across the change %.1f ms (periods %lu -> %lu ms)\n",
+                    k + 1, spanMs, oldPeriod, ldr::samplePeriodMs);
+        failures++;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(g_metaMutex);
+    if (g_metaCount == metaBefore || g_meta.find(kConfigRate[c]) == std::string::npos) {
+      std::printf("FAIL: update %d: metadata not republished with %s\n", k + 1, kConfigRate[c]);
+      failures++;
+    }
+  }
+
+  std::printf("%d updates (20 <-> 50 Hz), %zu samples, %u broker sessions\n", updates,
+              g_samplesUs.size(), broker.connects());
+  std::printf("stall (longest loop() until applied): p50 %llu us, max %llu us; other loop() max %llu us\n",
+              (unsigned long long)percentile(stalls, 0.5), (unsigned long long)percentile(stalls, 1.0),
+              (unsigned long long)maxLoopUs);
+  std::printf("apply latency (publish -> new period): p50 %.2f ms, max %.2f ms\n",
+              percentile(applies, 0.5) / 1e3, percentile(applies, 1.0) / 1e3);
+  std::printf("sample interval across a change: at most %+.2f ms vs the longer period (tolerance %.1f ms)\n",
+              worstExcessMs, toleranceMs);
+
+  if (failures) std::printf("FAILED: %d checks\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+// periodic_sim: PeriodicTask (lab/periodic.h) against the usual
+// `if (now - last >= PERIOD) { last = now; ... }` on a virtual clock
+//
+// A simulated loop() at --hz (default 20, as main.ino) for --minutes of
+// virtual time. Every pass costs 0.2-1.5 ms, a sampling pass 2 ms more, and
+// every few seconds loop() stalls for 30-180 ms (a Serial burst, a WiFi
+// reconnect). The clock starts 10 s before the 32-bit micros() wrap.
+//
+// Schedulers compared on the same pass/stall sequence:
+//   naive      last = now (phase drift)
+//   catch-up   PeriodicTask, PERIODIC_CATCH_UP, maxCatchUp 2
+//   skip       PeriodicTask, PERIODIC_SKIP
+//
+// Checks (exit 1 on failure):
+//  - catch-up and skip: runs + skipped == slots elapsed (+-1), i.e. no slot
+//    is lost silently, across the wrap
+//  - catch-up completes more runs than naive (drift is gone)
+//  - no run starts before its slot (lateness never negative)
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -I shim -iquote ../lab -o periodic_sim
+//       bench/periodic_sim.cpp ../lab/periodic.cpp
+
+#include "periodic.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+// One simulated loop() pass: its cost, and whether a stall follows it
+struct Pass {
+  uint32_t costUs;
+  uint32_t stallUs;
+};
+
+std::vector<Pass> makePasses(uint64_t totalUs)
+{
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<uint32_t> cost(200, 1500);
+  std::uniform_int_distribution<uint32_t> stallGap(2000000, 8000000);
+  std::uniform_int_distribution<uint32_t> stallLen(30000, 180000);
+  std::vector<Pass> out;
+  uint64_t t = 0;
+  uint64_t nextStall = stallGap(rng);
+  while (t < totalUs) {
+    Pass p = {cost(rng), 0};
+    if (t >= nextStall) {
+      p.stallUs = stallLen(rng);
+      nextStall = t + stallGap(rng);
+    }
+    t += p.costUs + p.stallUs;
+    out.push_back(p);
+  }
+  return out;
+}
+
+struct NaiveResult {
+  uint32_t runs;
+  uint32_t jitterMaxUs;
+};
+
+// The pattern the sketches use, with a lateness measure against the ideal grid
+NaiveResult runNaive(const std::vector<Pass>& passes, uint32_t t0, uint32_t periodUs,
+                     uint32_t workUs, uint32_t& tEnd)
+{
+  NaiveResult r = {0, 0};
+  uint32_t now = t0;
+  uint32_t last = t0;
+  for (const Pass& p : passes) {
+    if (now - last >= periodUs) {
+      const uint32_t late = now - last - periodUs;
+      if (late > r.jitterMaxUs) r.jitterMaxUs = late;
+      last = now;
+      r.runs++;
+      now += workUs;
+    }
+    now += p.costUs + p.stallUs;
+  }
+  tEnd = now;
+  return r;
+}
+
+struct TaskResult {
+  PeriodicMetrics m;
+  bool neverEarly;
+  uint64_t slots;
+};
+
+TaskResult runTask(const std::vector<Pass>& passes, uint32_t t0, uint32_t periodUs,
+                   uint32_t workUs, PeriodicPolicy policy, uint32_t& tEnd)
+{
+  PeriodicTask task;
+  task.begin(periodUs, t0, policy, 2);
+  TaskResult r;
+  r.neverEarly = true;
+  uint32_t now = t0;
+  for (const Pass& p : passes) {
+    const uint32_t slot = task.nextDueUs();
+    if (task.due(now)) {
+      if ((int32_t)(now - slot) < 0) r.neverEarly = false;
+      now += workUs;
+    }
+    now += p.costUs + p.stallUs;
+  }
+  tEnd = now;
+  r.m = task.metrics(now);
+  r.slots = (uint64_t)(uint32_t)(now - t0) / periodUs;
+  return r;
+}
+
+void printTask(const char* label, const TaskResult& r)
+{
+  printf("%-9s runs=%-6u rate=%.3f/%.3f Hz overruns=%-4u skipped=%-4u jitter_max_us=%-6u hist=",
+         label, r.m.runs, r.m.actualHz, r.m.nominalHz, r.m.overruns, r.m.skipped, r.m.jitter.maxUs);
+  for (int i = 0; i < kJitterBuckets; i++) printf("%s%u", i ? "/" : "", r.m.jitter.counts[i]);
+  printf("\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  float hz = 20.0f;
+  float minutes = 10.0f;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--hz")) hz = (float)atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--minutes")) minutes = (float)atof(argv[i + 1]);
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  const uint32_t periodUs = (uint32_t)(1000000.0f / hz);
+  const uint32_t workUs = 2000;
+  const uint64_t totalUs = (uint64_t)(minutes * 60e6f);
+  const uint32_t t0 = 0xFFFFFFFFu - 10000000u;   // 10 s before micros() wraps
+  const std::vector<Pass> passes = makePasses(totalUs);
+
+  printf("%.1f Hz, %.1f min virtual, %zu loop() passes, clock starts at %u\n",
+         hz, minutes, passes.size(), t0);
+
+  uint32_t tEnd;
+  const NaiveResult naive = runNaive(passes, t0, periodUs, workUs, tEnd);
+  const double naiveSlots = (double)(uint32_t)(tEnd - t0) / periodUs;
+  printf("%-9s runs=%-6u rate=%.3f/%.3f Hz (%.2f %% of slots) late_max_us=%u (vs last + period)\n",
+         "naive", naive.runs, naive.runs * 1e6 / (double)(uint32_t)(tEnd - t0), 1e6 / periodUs,
+         100.0 * naive.runs / naiveSlots, naive.jitterMaxUs);
+
+  const TaskResult catchUp = runTask(passes, t0, periodUs, workUs, PERIODIC_CATCH_UP, tEnd);
+  printTask("catch-up", catchUp);
+  const TaskResult skip = runTask(passes, t0, periodUs, workUs, PERIODIC_SKIP, tEnd);
+  printTask("skip", skip);
+
+  bool ok = true;
+  for (const TaskResult* r : {&catchUp, &skip}) {
+    const int64_t diff = (int64_t)r->m.runs + r->m.skipped - (int64_t)r->slots;
+    if (diff < -1 || diff > 1) {
+      printf("  FAILED: runs + skipped = %u, slots = %llu\n", r->m.runs + r->m.skipped,
+             (unsigned long long)r->slots);
+      ok = false;
+    }
+    if (!r->neverEarly) {
+      printf("  FAILED: a run started before its slot\n");
+      ok = false;
+    }
+  }
+  if (catchUp.m.runs <= naive.runs) {
+    printf("  FAILED: catch-up runs %u <= naive runs %u\n", catchUp.m.runs, naive.runs);
+    ok = false;
+  }
+  printf("check: %s\n", ok ? "ok (every slot run or counted as skipped, across the wrap)" : "FAILED");
+  return ok ? 0 : 1;
+}
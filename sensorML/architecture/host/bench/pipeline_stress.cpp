@@ -0,0 +1,213 @@
+// pipeline_stress: sampling jitter with and without the dual-task pipeline
+//
+// A synthetic LDR is sampled at --hz for --seconds. Every --stall-every
+// windows the window handler blocks for --stall-ms, standing in for a slow
+// Serial line or an MQTT publish that waits on the network. Every
+// --read-stall-every samples the sensor read itself blocks for
+// --read-stall-ms, so the sampler misses timer periods.
+//
+//  1) loop mode: sample and process in one thread, as loop() in main.ino
+//     does; a stall delays the following samples
+//  2) pipeline mode: Pipeline (lab/pipeline.h) with the sampler and worker
+//     on separate threads; a stall only makes the ring deeper
+//
+// Both report the jitter histogram (|actual - scheduled| sample time), worst
+// jitter, windows, drops and ring depth (pipeline only). Exits 1 if pipeline
+// mode loses samples to a full ring, has at least as many samples 5 ms late
+// as loop mode (the worst case alone is dominated by OS noise on a shared
+// host), or its samples + missed periods do not account for the run.
+//
+// --trace FILE dumps the trace ring (lab/trace.h) after pipeline mode: the
+// last TRACE_RING_EVENTS sample/window/log events of the sampler and worker
+// threads, for host/tools/trace_to_chrome. Needs a build with SENSORML_TRACE
+// (CMake: -DSENSORML_TRACE=ON).
+//
+// Usage:
+//   pipeline_stress [--hz N] [--seconds N] [--stall-ms N] [--stall-every N]
+//                   [--read-stall-ms N] [--read-stall-every N] [--trace FILE]
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -pthread -I shim -iquote ../lab -o pipeline_stress
+//       bench/pipeline_stress.cpp ../lab/pipeline.cpp ../lab/features.cpp
+//       ../lab/inference.cpp ../lab/controller.cpp ../lab/trace.cpp
+
+#include "pipeline.h"
+#include "trace.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int g_stallMs = 20;
+int g_stallEvery = 5;
+int g_readStallMs = 3;
+int g_readStallEvery = 1000;
+uint32_t g_windows = 0;
+uint32_t g_sampleIndex = 0;
+
+// Slow light changes plus noise, crossing the dark/bright thresholds
+float readSynthetic()
+{
+  if (g_readStallEvery > 0 && g_sampleIndex % g_readStallEvery == (uint32_t)g_readStallEvery - 1) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(g_readStallMs));
+  }
+  const float t = (float)(g_sampleIndex++) * 0.002f;
+  return 2000.0f + 1500.0f * sinf(t) + (float)(rand() % 64);
+}
+
+void slowHandler(const PipelineWindow&)
+{
+  if (g_stallEvery > 0 && ++g_windows % g_stallEvery == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(g_stallMs));
+  }
+}
+
+void printHist(const char* label, const JitterHist& h)
+{
+  printf("  %-9s jitter_max_us=%-7u", label, h.maxUs);
+  uint32_t lo = 0;
+  for (int i = 0; i < kJitterBuckets; i++) {
+    if (i < kJitterBuckets - 1) {
+      printf(" [%u,%u)=%u", lo, kJitterBoundsUs[i], h.counts[i]);
+      lo = kJitterBoundsUs[i];
+    } else {
+      printf(" >=%u=%u", lo, h.counts[i]);
+    }
+  }
+  printf("\n");
+}
+
+// Print into a file (trace dump)
+class FilePrint : public Print {
+public:
+  explicit FilePrint(FILE* f) : f_(f) {}
+  size_t write(uint8_t c) override { return fputc(c, f_) == EOF ? 0 : 1; }
+  size_t write(const uint8_t* b, size_t n) override { return fwrite(b, 1, n, f_); }
+
+private:
+  FILE* f_;
+};
+
+// loop() of main.ino, with the same schedule as the pipeline sampler
+void runLoopMode(float hz, int seconds, JitterHist& hist, uint32_t& windows)
+{
+  TinyML ml;
+  Controller ctrl;
+  ml.begin();
+  ctrl.begin(-1);
+  WindowBuffer win;
+  initWindow(win, 40);
+
+  const uint32_t periodUs = (uint32_t)(1000000.0f / hz);
+  const uint32_t n = (uint32_t)(hz * seconds);
+  Clock::time_point next = Clock::now();
+  uint32_t scheduledUs = micros();
+  for (uint32_t i = 0; i < n; i++) {
+    next += std::chrono::microseconds(periodUs);
+    scheduledUs += periodUs;
+    std::this_thread::sleep_until(next);
+
+    const int32_t late = (int32_t)(micros() - scheduledUs);
+    hist.add(late < 0 ? (uint32_t)-late : (uint32_t)late);
+
+    pushSample(win, readSynthetic());
+    if (!isWindowFull(win)) continue;
+    PipelineWindow w;
+    computeFeatures(win, w.f);
+    w.r = ml.isReady() ? ml.infer(w.f) : fallbackClassify(w.f);
+    w.action = ctrl.safetyAndActuate(w.r, 0.05f);
+    windows++;
+    slowHandler(w);
+    popOldest(win, 10);
+  }
+  free(win.buf);
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  float hz = 1000.0f;
+  int seconds = 5;
+  const char* tracePath = nullptr;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--hz")) hz = (float)atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seconds")) seconds = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--stall-ms")) g_stallMs = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--stall-every")) g_stallEvery = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--read-stall-ms")) g_readStallMs = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--read-stall-every")) g_readStallEvery = atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--trace")) tracePath = argv[i + 1];
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  printf("%.0f Hz for %d s, handler stalls %d ms every %d windows, read stalls %d ms every %d samples"
+         " (window 40, hop 10)\n",
+         hz, seconds, g_stallMs, g_stallEvery, g_readStallMs, g_readStallEvery);
+
+  JitterHist loopHist;
+  uint32_t loopWindows = 0;
+  runLoopMode(hz, seconds, loopHist, loopWindows);
+  printf("loop mode: windows=%u\n", loopWindows);
+  printHist("loop", loopHist);
+
+  g_windows = 0;
+  g_sampleIndex = 0;
+  TinyML ml;
+  Controller ctrl;
+  ml.begin();
+  ctrl.begin(-1);
+  PipelineConfig cfg;
+  cfg.samplingRateHz = hz;
+  cfg.read = readSynthetic;
+  cfg.onWindow = slowHandler;
+
+  Pipeline pipe;
+  traceClear();
+  pipe.begin(cfg, ml, ctrl);
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  pipe.end();
+
+  if (tracePath) {
+    FILE* f = fopen(tracePath, "w");
+    if (!f) {
+      fprintf(stderr, "cannot open %s\n", tracePath);
+      return 2;
+    }
+    FilePrint out(f);
+    const uint32_t events = traceDump(out);
+    fclose(f);
+    printf("trace: %u events -> %s%s\n", events, tracePath,
+           events ? "" : " (built without SENSORML_TRACE?)");
+  }
+
+  const PipelineMetrics m = pipe.metrics();
+  printf("pipeline mode: samples=%u missed=%u windows=%u dropped=%u depth_max=%u/%u depth_mean=%.2f\n",
+         m.samples, m.missed, m.windows, m.dropped, m.depthMax, kPipelineRingCapacity, m.depthMean);
+  printHist("pipeline", m.jitter);
+  pipe.printMetrics(Serial);
+
+  // Last bucket: >= 5 ms late
+  const uint32_t loopLate = loopHist.counts[kJitterBuckets - 1];
+  const uint32_t pipeLate = m.jitter.counts[kJitterBuckets - 1];
+  // Every timer period either got a sample or was counted as missed (the
+  // run is timed by a sleep, so allow a few periods either way)
+  const float periods = hz * (float)seconds;
+  const bool accounted = fabsf((float)(m.samples + m.missed) - periods) <= 0.01f * periods + 2.0f;
+  const bool readStalls = g_readStallEvery > 0 && g_readStallMs * 1000.0f > 1000000.0f / hz;
+  const bool ok = m.dropped == 0 && (pipeLate < loopLate || loopLate == 0) && accounted &&
+                  (m.missed > 0 || !readStalls);
+  printf("samples >= 5 ms late: loop %u, pipeline %u\n", loopLate, pipeLate);
+  printf("timer periods: %.0f, sampled %u + missed %u\n", periods, m.samples, m.missed);
+  printf("check: %s\n", ok ? "ok" : "FAILED (drops, no fewer late samples than loop mode, or periods unaccounted)");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+// report_filter_sim: the report-by-exception filter of the LDR MQTT sketch
+// (sensorML/lab/ldr/extension) and its copy in the LM73 multi-sensor sketch
+// (sensorML/lab/lm73/extension), on host
+//
+// Both sketches are compiled as is against the shim, and only their
+// reportSample() is driven, with the same synthetic 20 Hz series. The series
+// is 2 h long: 1 h flat with noise inside the band, a slow ramp, steps, then
+// a sine. For each copy and mode (every_sample, deadband, swinging_door) it
+// reports:
+//  - samples seen / points sent, overall and over the flat hour
+//  - the largest reconstruction error, as a fraction of the band. Deadband
+//    is rebuilt step-hold, swinging door by linear interpolation between
+//    the published points
+//  - the longest silence between published points
+// It fails (exit 1) in any of these cases:
+//  - a reconstruction error exceeds the band
+//  - a silence exceeds REPORT_HEARTBEAT_MS plus one sample period
+//  - seen/sent disagree with the samples fed and the points returned
+//  - an exception mode cuts the flat hour by less than 100x
+//  - the two copies publish different points for the same input
+//
+// Usage:
+//   report_filter_sim
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -pthread -I shim -o report_filter_sim bench/report_filter_sim.cpp bench/standin_broker.cpp
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <atomic>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace ldr {
+#include "../../../lab/ldr/extension/ESP32_SensorML_LDR_MQTT_NodeRED.ino"
+}
+
+namespace lm73 {
+#include "../../../lab/lm73/extension/ESP32_SensorML_MultiSensor_LDR_RSSI_LM73.ino"
+}
+
+namespace {
+
+const unsigned long kPeriodMs = 50;                  // 20 Hz
+const unsigned long kFlatMs = 3600UL * 1000;         // first hour
+const unsigned long kTotalMs = 2 * 3600UL * 1000;
+const float kBand = 20.0f;                           // REPORT_K * uncertainty
+
+struct Sample {
+  unsigned long t;
+  float v;
+};
+
+struct Point {
+  unsigned long t;
+  float v;
+  bool operator!=(const Point& o) const { return t != o.t || v != o.v; }
+};
+
+struct Run {
+  std::vector<Point> points;
+  uint32_t seen = 0, sent = 0;
+  uint32_t sentFlat = 0;
+};
+
+int failures = 0;
+
+void check(bool ok, const char* copy, const char* mode, const char* what)
+{
+  if (ok) return;
+  std::printf("FAIL: %s %s: %s\n", copy, mode, what);
+  failures++;
+}
+
+std::vector<Sample> makeSeries()
+{
+  std::vector<Sample> s;
+  srand(1);
+  for (unsigned long t = 1000; t < 1000 + kTotalMs; t += kPeriodMs) {
+    const unsigned long u = t - 1000;
+    const float noise = (rand() % 1000 / 1000.0f - 0.5f) * 0.8f * kBand;   // +-0.4 band
+    float v;
+    if (u < kFlatMs) v = 2000.0f + noise;
+    else if (u < kFlatMs + 1200000) v = 2000.0f + (u - kFlatMs) * 0.0005f + noise;   // +600 over 20 min
+    else if (u < kFlatMs + 2400000) v = 2600.0f + ((u / 60000) % 2 ? 300.0f : 0.0f) + noise;
+    else v = 2600.0f + 400.0f * std::sin((u - kFlatMs) / 120000.0f) + noise;
+    s.push_back({t, v});
+  }
+  return s;
+}
+
+// Drive one copy of reportSample (F is that sketch's ReportFilter)
+template <class F, class Sampler>
+Run drive(F f, Sampler reportSample, const std::vector<Sample>& series)
+{
+  Run r;
+  for (const Sample& s : series) {
+    float outV;
+    unsigned long outMs;
+    if (!reportSample(f, s.v, s.t, kBand, outV, outMs)) continue;
+    r.points.push_back({outMs, outV});
+    if (s.t - 1000 < kFlatMs) r.sentFlat++;
+  }
+  r.seen = f.seen;
+  r.sent = f.sent;
+  return r;
+}
+
+// Largest |sample - reconstruction| over the samples up to the last point
+float maxError(const Run& r, const std::vector<Sample>& series, bool interpolate)
+{
+  float worst = 0;
+  size_t k = 0;
+  for (const Sample& s : series) {
+    if (s.t > r.points.back().t) break;
+    while (k + 1 < r.points.size() && r.points[k + 1].t <= s.t) k++;
+    const Point& a = r.points[k];
+    float rec = a.v;
+    if (interpolate && k + 1 < r.points.size()) {
+      const Point& b = r.points[k + 1];
+      rec = a.v + (b.v - a.v) * (float)(s.t - a.t) / (float)(b.t - a.t);
+    }
+    worst = std::max(worst, std::fabs(s.v - rec));
+  }
+  return worst;
+}
+
+unsigned long maxSilence(const Run& r)
+{
+  unsigned long worst = 0;
+  for (size_t k = 1; k < r.points.size(); k++) worst = std::max(worst, r.points[k].t - r.points[k - 1].t);
+  return worst;
+}
+
+const char* modeName(int m)
+{
+  static const char* names[] = {"every_sample", "deadband", "swinging_door"};
+  return names[m];
+}
+
+void report(const char* copy, int mode, const Run& r, const std::vector<Sample>& series)
+{
+  const uint32_t flatSamples = kFlatMs / kPeriodMs;
+  const float err = maxError(r, series, mode == ldr::REPORT_SWINGING_DOOR);
+  const unsigned long silence = maxSilence(r);
+  std::printf("%-5s %-13s seen=%u sent=%u (%.0fx, flat hour %.0fx) max_err=%.2f band, max_silence=%lu ms\n", copy,
+              modeName(mode), r.seen, r.sent, (double)r.seen / r.sent, (double)flatSamples / r.sentFlat,
+              err / kBand, silence);
+
+  check(r.seen == series.size(), copy, modeName(mode), "seen != samples fed");
+  check(r.sent == r.points.size(), copy, modeName(mode), "sent != points returned");
+  check(err <= kBand * 1.001f, copy, modeName(mode), "reconstruction error exceeds the band");
+  check(silence <= ldr::REPORT_HEARTBEAT_MS + kPeriodMs, copy, modeName(mode), "silence exceeds the heartbeat");
+  if (mode == ldr::REPORT_EVERY_SAMPLE) check(r.sent == r.seen, copy, modeName(mode), "a sample was not sent");
+  else check(flatSamples >= 100 * r.sentFlat, copy, modeName(mode), "flat hour cut by less than 100x");
+}
+
+}  // namespace
+
+int main()
+{
+  Serial.out = nullptr;
+  const std::vector<Sample> series = makeSeries();
+
+  for (int mode = ldr::REPORT_EVERY_SAMPLE; mode <= ldr::REPORT_SWINGING_DOOR; mode++) {
+    ldr::ReportFilter lf;
+    lf.mode = (ldr::ReportMode)mode;
+    lm73::ReportFilter mf;
+    mf.mode = (lm73::ReportMode)mode;
+
+    const Run a = drive(lf, ldr::reportSample, series);
+    const Run b = drive(mf, lm73::reportSample, series);
+    report("ldr", mode, a, series);
+    report("lm73", mode, b, series);
+
+    bool same = a.points.size() == b.points.size();
+    for (size_t k = 0; same && k < a.points.size(); k++) same = !(a.points[k] != b.points[k]);
+    check(same, "lm73", modeName(mode), "the copy publishes different points than the LDR filter");
+  }
+
+  if (failures) {
+    std::printf("FAILED: %d checks\n", failures);
+    return 1;
+  }
+  return 0;
+}
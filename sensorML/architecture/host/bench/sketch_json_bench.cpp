@@ -0,0 +1,237 @@
+// sketch_json_bench: telemetry serialization in the LDR and MPU6050 MQTT
+// sketches (sensorML/lab/ldr/extension, sensorML/lab/mpu6050/mqtt)
+//
+// The sketches themselves, on the host shim. Their JsonWriter path (static
+// fragments rendered once from SensorML, plus the per-sample values) is
+// benchmarked against the String concatenation it replaced, kept here
+// verbatim:
+//   BM_LdrTelemetry/JsonWriter     ldr::publishTelemetry()
+//   BM_LdrTelemetry/String         the baseline String builder
+//   BM_ImuTelemetry/JsonWriter     imu::publishTelemetry()
+//   BM_ImuTelemetry/String         the baseline String builder
+// Serial output is discarded and the link is down, so only the rendering is
+// timed. bytes_per_msg is the length of the message checked below.
+//
+// Every benchmark reports allocs_per_iter (alloc_count.cpp). The JsonWriter
+// runs must not allocate: such a run is marked ERROR and the bench exits 1.
+// The host String is std::string, whose small-string buffer hides some of
+// the allocations the baseline makes on the device.
+//
+// Before the benchmarks it checks that both paths render the same bytes,
+// and that a SensorML id too long for its fragment disables telemetry
+// (counted in tlmSkipped, printed as [TLM] skipped=) instead of publishing
+// truncated JSON.
+//
+// Build: the CMake host build (host/CMakeLists.txt), target sketch_json_bench.
+
+#include <Adafruit_MPU6050.h>
+#include <Adafruit_Sensor.h>
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <atomic>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "alloc_count.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <string>
+
+namespace ldr {
+#include "../../../lab/ldr/extension/ESP32_SensorML_LDR_MQTT_NodeRED.ino"
+}
+
+namespace imu {
+#include "../../../lab/mpu6050/mqtt/ESP32_SensorML_MPU6050_MQTT_NodeRED.ino"
+}
+
+namespace {
+
+int g_allocFailures = 0;
+
+void countAllocs(benchmark::State& state, uint64_t before, bool steadyState = true)
+{
+  const uint64_t n = allocCounts().allocs - before;
+  state.counters["allocs_per_iter"] = benchmark::Counter((double)n, benchmark::Counter::kAvgIterations);
+  if (n == 0 || !steadyState) return;
+  g_allocFailures++;
+  state.SkipWithError("steady-state loop allocates");
+}
+
+// The LDR sketch's telemetry builder before JsonWriter
+String ldrBaseline(float value, unsigned long nowMs)
+{
+  using namespace ldr;
+  String msg;
+  msg.reserve(180);
+  msg += "{";
+  msg += "\"id\":\"" + sensorId + "\",";
+  msg += "\"property\":\"" + observedProperty + "\",";
+  msg += "\"value\":" + String(value, 2) + ",";
+  msg += "\"uom\":\"" + uom + "\",";
+  msg += "\"uncertainty\":" + String(uncertainty, 4) + ",";
+  msg += "\"ts_ms\":" + String(nowMs);
+  msg += "}";
+  return msg;
+}
+
+// The MPU6050 sketch's telemetry builder before JsonWriter
+String imuBaseline(float axC, float ayC, float azC, float gxC, float gyC, float gzC, float tempC,
+                   unsigned long ts)
+{
+  const imu::ImuConfig& cfg = imu::cfg;
+  String msg = "{";
+  msg += "\"id\":\"" + cfg.id + "\",";
+  msg += "\"ts_ms\":" + String(ts) + ",";
+  msg += "\"accel\":{\"uom\":\"" + cfg.accelUom + "\",\"unc\":" + String(cfg.accelUnc, 3) +
+         ",\"x\":" + String(axC, 3) + ",\"y\":" + String(ayC, 3) + ",\"z\":" + String(azC, 3) + "},";
+  msg += "\"gyro\":{\"uom\":\"" + cfg.gyroUom + "\",\"unc\":" + String(cfg.gyroUnc, 3) +
+         ",\"x\":" + String(gxC, 3) + ",\"y\":" + String(gyC, 3) + ",\"z\":" + String(gzC, 3) + "},";
+  msg += "\"temp_c\":" + String(tempC, 2);
+  msg += "}";
+  return msg;
+}
+
+void configureSketches()
+{
+  ldr::sensorId = "LDR_ESP32_01";
+  ldr::observedProperty = "LightLevel";
+  ldr::uom = "adc_counts";
+  ldr::uncertainty = 20.0f;
+  ldr::buildTelemetryFragments();
+
+  imu::parseSensorML(imu::cfg);
+  imu::buildTelemetryFragments(imu::cfg);
+}
+
+// One rendered message from the sketch: Serial goes to a memory stream
+template <typename F>
+std::string captureSerial(F render)
+{
+  char* p = nullptr;
+  size_t n = 0;
+  FILE* f = open_memstream(&p, &n);
+  Serial.out = f;
+  render();
+  std::fclose(f);
+  Serial.out = nullptr;
+  std::string s(p, n);
+  std::free(p);
+  if (!s.empty() && s.back() == '\n') s.pop_back();
+  if (!s.empty() && s.back() == '\r') s.pop_back();   // println()
+  return s;
+}
+
+int checkSketches()
+{
+  int failures = 0;
+  const std::string ldrNew = captureSerial([] { ldr::publishTelemetry(2047.25f, 123456); });
+  const String ldrOld = ldrBaseline(2047.25f, 123456);
+  if (ldrNew != ldrOld.c_str()) {
+    std::printf("FAIL: LDR telemetry differs from the baseline\n  %s\n  %s\n", ldrNew.c_str(), ldrOld.c_str());
+    failures++;
+  }
+  const std::string imuNew =
+      captureSerial([] { imu::publishTelemetry(0.12f, -9.81f, 0.5f, 1.25f, -0.5f, 0.0f, 24.5f, 123456); });
+  const String imuOld = imuBaseline(0.12f, -9.81f, 0.5f, 1.25f, -0.5f, 0.0f, 24.5f, 123456);
+  if (imuNew != imuOld.c_str()) {
+    std::printf("FAIL: MPU6050 telemetry differs from the baseline\n  %s\n  %s\n", imuNew.c_str(), imuOld.c_str());
+    failures++;
+  }
+
+  // An id that cannot fit a fragment: nothing is published, the skip is
+  // counted and reported on a [TLM] line
+  const String longId(std::string(160, 'x').c_str());
+  ldr::sensorId = longId;
+  ldr::buildTelemetryFragments();
+  const uint32_t ldrSkipped = ldr::tlmSkipped;
+  if (captureSerial([] { ldr::publishTelemetry(1.0f, 1); }) != "[TLM] skipped=" + std::to_string(ldrSkipped + 1) ||
+      ldr::fragsValid || ldr::tlmSkipped != ldrSkipped + 1) {
+    std::printf("FAIL: LDR published telemetry from an overflowed fragment\n");
+    failures++;
+  }
+  imu::cfg.id = longId;
+  imu::buildTelemetryFragments(imu::cfg);
+  const uint32_t imuSkipped = imu::tlmSkipped;
+  if (captureSerial([] { imu::publishTelemetry(0, 0, 0, 0, 0, 0, 0, 1); }) !=
+          "[TLM] skipped=" + std::to_string(imuSkipped + 1) ||
+      imu::fragsValid || imu::tlmSkipped != imuSkipped + 1) {
+    std::printf("FAIL: MPU6050 published telemetry from an overflowed fragment\n");
+    failures++;
+  }
+
+  configureSketches();
+  return failures;
+}
+
+void BM_LdrTelemetry(benchmark::State& state)
+{
+  const bool jsonWriter = state.range(0) == 0;
+  state.SetLabel(jsonWriter ? "JsonWriter" : "String");
+  float v = 1800.0f;
+  unsigned long ts = 0;
+  const uint64_t allocsBefore = allocCounts().allocs;
+  for (auto _ : state) {
+    v = v < 2400.0f ? v + 0.37f : 1800.0f;
+    ts += 50;
+    if (jsonWriter) {
+      ldr::publishTelemetry(v, ts);
+    } else {
+      String msg = ldrBaseline(v, ts);
+      benchmark::DoNotOptimize(msg);
+    }
+  }
+  countAllocs(state, allocsBefore, jsonWriter);
+  state.counters["bytes_per_msg"] = (double)ldrBaseline(2047.25f, 123456).length();
+}
+BENCHMARK(BM_LdrTelemetry)->Arg(0)->Arg(1);
+
+void BM_ImuTelemetry(benchmark::State& state)
+{
+  const bool jsonWriter = state.range(0) == 0;
+  state.SetLabel(jsonWriter ? "JsonWriter" : "String");
+  float a = 0.0f;
+  unsigned long ts = 0;
+  const uint64_t allocsBefore = allocCounts().allocs;
+  for (auto _ : state) {
+    a = a < 2.0f ? a + 0.013f : -2.0f;
+    ts += 20;
+    if (jsonWriter) {
+      imu::publishTelemetry(a, -a, 9.81f + a, 10.0f * a, -5.0f * a, 0.25f, 24.5f, ts);
+    } else {
+      String msg = imuBaseline(a, -a, 9.81f + a, 10.0f * a, -5.0f * a, 0.25f, 24.5f, ts);
+      benchmark::DoNotOptimize(msg);
+    }
+  }
+  countAllocs(state, allocsBefore, jsonWriter);
+  state.counters["bytes_per_msg"] = (double)imuBaseline(0.12f, -9.81f, 0.5f, 1.25f, -0.5f, 0.0f, 24.5f, 123456).length();
+}
+BENCHMARK(BM_ImuTelemetry)->Arg(0)->Arg(1);
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  Serial.out = nullptr;
+  configureSketches();
+  const int failures = checkSketches();
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  if (failures) {
+    fprintf(stderr, "FAILED: %d output checks\n", failures);
+    return 1;
+  }
+  if (g_allocFailures) {
+    fprintf(stderr, "FAILED: %d benchmark runs allocated in their steady-state loop\n", g_allocFailures);
+    return 1;
+  }
+  return 0;
+}
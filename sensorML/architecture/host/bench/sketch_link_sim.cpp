@@ -0,0 +1,242 @@
+// sketch_link_sim: the LDR and MPU6050 MQTT sketches (sensorML/lab/ldr/
+// extension, sensorML/lab/mpu6050/mqtt) through a broker outage, on host
+//
+// Both sketches run side by side, each calling its own setup()/loop() in
+// real time on its own thread, like two devices on one broker. The broker
+// is a stand-in (standin_broker.h). The ADC and the IMU are hooks that
+// record when each sample is read. The broker goes through three phases:
+//  1. up for --up-ms once both links are up
+//  2. killed for --down-ms. Every session drops, and every dial blocks for
+//     the sketches' 5 s socket timeout, as with a host that does not answer
+//  3. restarted, until both links are up again, then --up-ms more
+// For each sketch and phase it reports the largest sample interval and the
+// longest loop() call. It also reports how long each sketch took to
+// reconnect after the restart. It fails (exit 1) in any of these cases:
+//  - a sample interval exceeds the sketch's period + --tolerance-ms
+//  - a loop() call takes longer than --max-loop-ms
+//  - a sketch does not see the link go down, or is not back within 20 s
+//  - a sketch does not republish its retained metadata after reconnecting
+//
+// Usage:
+//   sketch_link_sim [--up-ms U] [--down-ms D] [--tolerance-ms T] [--max-loop-ms L]
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -pthread -I shim -o sketch_link_sim bench/sketch_link_sim.cpp bench/standin_broker.cpp
+
+#include <Adafruit_MPU6050.h>
+#include <Adafruit_Sensor.h>
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <atomic>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "standin_broker.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ldr {
+#include "../../../lab/ldr/extension/ESP32_SensorML_LDR_MQTT_NodeRED.ino"
+}
+
+namespace imu {
+#include "../../../lab/mpu6050/mqtt/ESP32_SensorML_MPU6050_MQTT_NodeRED.ino"
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t nowUs()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             Clock::now().time_since_epoch()).count();
+}
+
+// One sketch on its own loop() thread
+struct Device {
+  const char* name;
+  void (*setup)();
+  void (*loop)();
+  bool (*linkUp)();
+  const unsigned long* periodMs;
+  std::string metaTopic;
+
+  std::vector<uint64_t> samplesUs{};   // device thread only, until joined
+  std::vector<std::pair<uint64_t, uint64_t>> loops{};   // (start, duration) per loop() call
+  std::atomic<bool> up{false};
+  std::atomic<bool> sawDown{false};
+  std::atomic<bool> run{true};
+  std::atomic<int> metaCount{0};
+  std::thread th{};
+
+  void main()
+  {
+    setup();
+    while (run.load()) {
+      const uint64_t t0 = nowUs();
+      loop();
+      loops.emplace_back(t0, nowUs() - t0);
+      const bool u = linkUp();
+      if (up.load() && !u) sawDown = true;
+      up = u;
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+};
+
+Device g_ldr{"ldr", ldr::setup, ldr::loop, ldr::linkUp, &ldr::samplePeriodMs, ldr::TOPIC_META.c_str()};
+Device g_imu{"mpu6050", imu::setup, imu::loop, imu::linkUp, &imu::cfg.samplePeriodMs, imu::TOPIC_META};
+Device* g_devices[2] = {&g_ldr, &g_imu};
+
+int fakeLdr(int)
+{
+  g_ldr.samplesUs.push_back(nowUs());
+  return 1800 + rand() % 400;
+}
+
+void imuRead(HostImuSample&)
+{
+  g_imu.samplesUs.push_back(nowUs());
+}
+
+void onPublish(const char* topic, const uint8_t*, size_t, bool retained)
+{
+  if (!retained) return;
+  for (Device* d : g_devices) {
+    if (d->metaTopic == topic) d->metaCount++;
+  }
+}
+
+bool waitBothUp(uint64_t timeoutUs)
+{
+  const uint64_t t0 = nowUs();
+  while (!(g_ldr.up && g_imu.up) && nowUs() - t0 < timeoutUs) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return g_ldr.up && g_imu.up;
+}
+
+// Largest sample interval and longest loop() call within [from, to)
+void phaseStats(const Device& d, uint64_t from, uint64_t to, double& maxIntervalMs, double& maxLoopMs)
+{
+  maxIntervalMs = 0;
+  for (size_t i = 1; i < d.samplesUs.size(); i++) {
+    if (d.samplesUs[i] < from || d.samplesUs[i] >= to) continue;
+    maxIntervalMs = std::max(maxIntervalMs, (d.samplesUs[i] - d.samplesUs[i - 1]) / 1e3);
+  }
+  maxLoopMs = 0;
+  for (const auto& l : d.loops) {
+    if (l.first >= from && l.first < to) maxLoopMs = std::max(maxLoopMs, l.second / 1e3);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  uint32_t upMs = 1500;
+  uint32_t downMs = 8000;
+  double toleranceMs = 5.0;
+  double maxLoopMs = 5.0;
+  for (int i = 1; i < argc; i++) {
+    const bool hasArg = i + 1 < argc;
+    if (!std::strcmp(argv[i], "--up-ms") && hasArg) upMs = (uint32_t)std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--down-ms") && hasArg) downMs = (uint32_t)std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "--tolerance-ms") && hasArg) toleranceMs = std::atof(argv[++i]);
+    else if (!std::strcmp(argv[i], "--max-loop-ms") && hasArg) maxLoopMs = std::atof(argv[++i]);
+  }
+
+  StandInBroker broker(onPublish);
+  broker.install();
+  hostAnalogRead = fakeLdr;
+  hostImuRead = imuRead;
+  Serial.out = nullptr;
+
+  for (Device* d : g_devices) d->th = std::thread(&Device::main, d);
+
+  int failures = 0;
+  uint64_t phase[4];
+  uint64_t upAgain[2] = {0, 0};
+  int metaBefore[2];
+  if (!waitBothUp(3000000)) {
+    std::printf("FAIL: links not up after 3 s\n");
+    failures++;
+  } else {
+    phase[0] = nowUs();
+    std::this_thread::sleep_for(std::chrono::milliseconds(upMs));
+
+    phase[1] = nowUs();
+    broker.kill();
+    std::this_thread::sleep_for(std::chrono::milliseconds(downMs));
+    for (int k = 0; k < 2; k++) metaBefore[k] = g_devices[k]->metaCount;
+
+    phase[2] = nowUs();
+    broker.restart();
+    while (nowUs() - phase[2] < 20000000 && !(upAgain[0] && upAgain[1])) {
+      for (int k = 0; k < 2; k++) {
+        if (!upAgain[k] && g_devices[k]->up) upAgain[k] = nowUs();
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(upMs));
+    phase[3] = nowUs();
+  }
+
+  for (Device* d : g_devices) {
+    d->run = false;
+    d->th.join();
+  }
+  if (failures) {
+    std::printf("FAILED: %d checks\n", failures);
+    return 1;
+  }
+
+  const char* phaseName[3] = {"up", "down", "restart"};
+  std::printf("broker up %u ms, down %u ms, restarted; %u sessions\n", upMs, downMs, broker.connects());
+  for (int k = 0; k < 2; k++) {
+    const Device& d = *g_devices[k];
+    const double limit = (double)*d.periodMs + toleranceMs;
+    for (int p = 0; p < 3; p++) {
+      double maxInterval, maxLoop;
+      phaseStats(d, phase[p], phase[p + 1], maxInterval, maxLoop);
+      std::printf("%-8s %-8s period %lu ms: max sample interval %.2f ms, max loop() %.3f ms\n", d.name,
+                  phaseName[p], *d.periodMs, maxInterval, maxLoop);
+      if (maxInterval > limit) {
+        std::printf("FAIL: %s: sample interval %.2f ms > %.1f ms while the broker was %s\n", d.name, maxInterval,
+                    limit, phaseName[p]);
+        failures++;
+      }
+      if (maxLoop > maxLoopMs) {
+        std::printf("FAIL: %s: loop() took %.3f ms > %.1f ms while the broker was %s\n", d.name, maxLoop, maxLoopMs,
+                    phaseName[p]);
+        failures++;
+      }
+    }
+    if (!d.sawDown) {
+      std::printf("FAIL: %s: link never went down\n", d.name);
+      failures++;
+    }
+    if (!upAgain[k]) {
+      std::printf("FAIL: %s: not reconnected within 20 s of the restart\n", d.name);
+      failures++;
+    } else {
+      std::printf("%-8s reconnected %.2f s after the restart\n", d.name, (upAgain[k] - phase[2]) / 1e6);
+    }
+    if (d.metaCount <= metaBefore[k]) {
+      std::printf("FAIL: %s: metadata not republished after reconnecting\n", d.name);
+      failures++;
+    }
+  }
+
+  if (failures) std::printf("FAILED: %d checks\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+// spsc_ring_stress: SpscRing (lab/spsc_ring.h) between two threads
+//
+//  1) paced: a producer thread at --rate Hz (default 100 kHz, a timer ISR
+//     stand-in) and a consumer thread using popBatch(); runs --seconds
+//  2) unpaced: the producer pushes --count records as fast as it can and
+//     retries (yield) when the ring is full: transfer throughput, lossless
+//
+// Each record carries a sequence number and a checksum of its payload.
+// Check: every popped record is intact and sequence numbers only increase;
+// paced, popped + overruns == produced (every missing sequence number is
+// accounted for by an overrun); unpaced, popped == produced. Exits 1
+// otherwise.
+//
+// Usage:
+//   spsc_ring_stress [--rate HZ] [--seconds N] [--count N] [--batch N]
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -pthread -iquote ../lab -o spsc_ring_stress
+//       bench/spsc_ring_stress.cpp
+
+#include "spsc_ring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Sample-sized record (time + value + integrity fields)
+struct Record {
+  uint32_t seq;
+  uint32_t tUs;
+  float value;
+  uint32_t check;
+};
+
+typedef SpscRing<Record, 1024> Ring;
+
+uint32_t checksum(uint32_t seq, uint32_t tUs, float value)
+{
+  uint32_t v;
+  memcpy(&v, &value, 4);
+  uint32_t h = 2166136261u;
+  for (uint32_t x : {seq, tUs, v}) h = (h ^ x) * 16777619u;
+  return h;
+}
+
+Record makeRecord(uint32_t seq, uint32_t tUs)
+{
+  Record r;
+  r.seq = seq;
+  r.tUs = tUs;
+  r.value = (float)(seq % 4096);
+  r.check = checksum(r.seq, r.tUs, r.value);
+  return r;
+}
+
+struct RunResult {
+  uint32_t produced;
+  uint64_t popped;
+  uint32_t overruns;
+  uint32_t highWater;
+  uint64_t corrupt;
+  uint64_t outOfOrder;
+  uint64_t batches;
+  double seconds;
+};
+
+// paceHz 0: unpaced and lossless (retry while full)
+RunResult run(double paceHz, uint32_t count, uint32_t batch)
+{
+  Ring* ring = new Ring();
+  std::atomic<bool> done{false};
+  RunResult res = {};
+
+  std::thread consumer([&] {
+    std::vector<Record> buf(batch);
+    int64_t last = -1;
+    for (;;) {
+      const bool finished = done.load(std::memory_order_acquire);
+      const uint32_t n = ring->popBatch(buf.data(), batch);
+      if (n == 0) {
+        if (finished) break;
+        std::this_thread::yield();
+        continue;
+      }
+      res.batches++;
+      for (uint32_t i = 0; i < n; i++) {
+        const Record& r = buf[i];
+        if (r.check != checksum(r.seq, r.tUs, r.value)) res.corrupt++;
+        if ((int64_t)r.seq <= last) res.outOfOrder++;
+        last = r.seq;
+      }
+      res.popped += n;
+    }
+  });
+
+  const auto t0 = Clock::now();
+  if (paceHz > 0.0) {
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / paceHz));
+    Clock::time_point next = t0;
+    for (uint32_t seq = 0; seq < count; seq++) {
+      next += period;
+      while (Clock::now() < next) std::this_thread::yield();   // one "timer tick"
+      const uint32_t tUs = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                               Clock::now() - t0).count();
+      ring->push(makeRecord(seq, tUs));
+    }
+  } else {
+    for (uint32_t seq = 0; seq < count; seq++) {
+      const Record r = makeRecord(seq, seq);
+      while (!ring->push(r)) std::this_thread::yield();
+    }
+  }
+  done.store(true, std::memory_order_release);
+  consumer.join();
+  res.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+
+  res.produced = count;
+  res.overruns = ring->overruns();
+  res.highWater = ring->highWater();
+  delete ring;
+  return res;
+}
+
+bool report(const char* label, const RunResult& r, bool lossless)
+{
+  const uint64_t expect = lossless ? r.produced : (uint64_t)r.produced - r.overruns;
+  const bool ok = r.corrupt == 0 && r.outOfOrder == 0 && r.popped == expect;
+  printf("%-8s produced=%u popped=%llu overruns=%u high_water=%u/%u corrupt=%llu out_of_order=%llu\n",
+         label, r.produced, (unsigned long long)r.popped, r.overruns, r.highWater, Ring::kCapacity,
+         (unsigned long long)r.corrupt, (unsigned long long)r.outOfOrder);
+  printf("%-8s %.3f s, %.2f M records/s, %.1f records per popBatch -> %s\n", "",
+         r.seconds, r.popped / r.seconds / 1e6,
+         r.batches ? (double)r.popped / r.batches : 0.0, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  double rate = 100000.0;
+  double seconds = 3.0;
+  uint32_t count = 50000000;
+  uint32_t batch = 64;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--rate")) rate = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--seconds")) seconds = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--count")) count = (uint32_t)strtoul(argv[i + 1], nullptr, 10);
+    else if (!strcmp(argv[i], "--batch")) batch = (uint32_t)atoi(argv[i + 1]);
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  batch = std::max<uint32_t>(1, batch);
+  printf("ring: %u x %zu-byte records, popBatch up to %u, %u hardware threads\n",
+         Ring::kCapacity, sizeof(Record), batch, std::thread::hardware_concurrency());
+
+  bool ok = report("paced", run(rate, (uint32_t)(rate * seconds), batch), false);
+  ok = report("unpaced", run(0.0, count, batch), true) && ok;   // overruns = full-ring retries
+  printf("check: %s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+#include "standin_broker.h"
+
+#include <PubSubClient.h>
+
+#include <chrono>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+StandInBroker* g_installed = nullptr;
+
+int dialInstalled(const char*, uint16_t, int timeoutMs)
+{
+  return g_installed ? g_installed->dial(timeoutMs) : -1;
+}
+
+bool readExact(int fd, uint8_t* p, size_t n)
+{
+  while (n) {
+    const ssize_t r = ::read(fd, p, n);
+    if (r <= 0) return false;
+    p += r;
+    n -= (size_t)r;
+  }
+  return true;
+}
+
+// One control packet; returns its first byte, or -1 when the session ended
+int readPacket(int fd, std::vector<uint8_t>& body)
+{
+  uint8_t first;
+  if (!readExact(fd, &first, 1)) return -1;
+  size_t rem = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    uint8_t b;
+    if (shift > 21 || !readExact(fd, &b, 1)) return -1;
+    rem |= (size_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) break;
+  }
+  body.resize(rem);
+  if (rem && !readExact(fd, body.data(), rem)) return -1;
+  return first;
+}
+
+}  // namespace
+
+StandInBroker::~StandInBroker()
+{
+  kill();
+  if (g_installed == this) {
+    g_installed = nullptr;
+    hostMqttDial = hostTcpDial;
+  }
+}
+
+void StandInBroker::install()
+{
+  g_installed = this;
+  hostMqttDial = dialInstalled;
+}
+
+int StandInBroker::dial(int timeoutMs)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_);
+    if (up_) {
+      int sv[2];
+      if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return -1;
+      sessions_.emplace_back(new Session);
+      Session* s = sessions_.back().get();
+      s->fd = sv[1];
+      s->th = std::thread(&StandInBroker::serve, this, s);
+      connects_++;
+      return sv[0];
+    }
+  }
+  // No SYN-ACK from a host that is down: the caller waits out its timeout
+  std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+  return -1;
+}
+
+void StandInBroker::kill()
+{
+  std::vector<std::unique_ptr<Session>> dead;
+  {
+    std::lock_guard<std::mutex> lock(m_);
+    up_ = false;
+    for (auto& s : sessions_) ::shutdown(s->fd, SHUT_RDWR);
+    dead.swap(sessions_);
+  }
+  for (auto& s : dead) {
+    s->th.join();
+    ::close(s->fd);
+  }
+}
+
+void StandInBroker::restart()
+{
+  std::lock_guard<std::mutex> lock(m_);
+  up_ = true;
+}
+
+bool StandInBroker::up() const
+{
+  std::lock_guard<std::mutex> lock(m_);
+  return up_;
+}
+
+uint32_t StandInBroker::connects() const
+{
+  std::lock_guard<std::mutex> lock(m_);
+  return connects_;
+}
+
+bool StandInBroker::sendAll(int fd, const uint8_t* p, size_t n)
+{
+  while (n) {
+    const ssize_t w = ::send(fd, p, n, MSG_NOSIGNAL);
+    if (w <= 0) return false;
+    p += w;
+    n -= (size_t)w;
+  }
+  return true;
+}
+
+int StandInBroker::publish(const char* topic, const void* payload, size_t len)
+{
+  const size_t tl = std::strlen(topic);
+  std::vector<uint8_t> frame;
+  size_t rem = 2 + tl + len;
+  frame.push_back(0x30);
+  do {
+    uint8_t b = rem % 128;
+    rem /= 128;
+    if (rem) b |= 0x80;
+    frame.push_back(b);
+  } while (rem);
+  frame.push_back((uint8_t)(tl >> 8));
+  frame.push_back((uint8_t)tl);
+  frame.insert(frame.end(), topic, topic + tl);
+  frame.insert(frame.end(), (const uint8_t*)payload, (const uint8_t*)payload + len);
+
+  std::lock_guard<std::mutex> lock(m_);
+  int sent = 0;
+  for (auto& s : sessions_) {
+    if (!s->open) continue;
+    for (const std::string& f : s->subs) {
+      if (f != topic) continue;
+      if (sendAll(s->fd, frame.data(), frame.size())) sent++;
+      break;
+    }
+  }
+  return sent;
+}
+
+bool StandInBroker::hasSubscriber(const char* topic) const
+{
+  std::lock_guard<std::mutex> lock(m_);
+  for (auto& s : sessions_) {
+    if (!s->open) continue;
+    for (const std::string& f : s->subs) {
+      if (f == topic) return true;
+    }
+  }
+  return false;
+}
+
+void StandInBroker::serve(Session* s)
+{
+  std::vector<uint8_t> body;
+  for (;;) {
+    const int first = readPacket(s->fd, body);
+    if (first < 0) break;
+
+    switch (first >> 4) {
+      case 1: {   // CONNECT
+        const uint8_t connack[4] = {0x20, 0x02, 0x00, 0x00};
+        std::lock_guard<std::mutex> lock(m_);
+        sendAll(s->fd, connack, sizeof(connack));
+        break;
+      }
+      case 3: {   // PUBLISH (QoS 0)
+        if (body.size() < 2) break;
+        const size_t tl = ((size_t)body[0] << 8) | body[1];
+        if (2 + tl > body.size()) break;
+        const std::string topic((const char*)body.data() + 2, tl);
+        if (onPublish_) onPublish_(topic.c_str(), body.data() + 2 + tl, body.size() - 2 - tl, first & 0x01);
+        break;
+      }
+      case 8: {   // SUBSCRIBE: packet id, then (filter, QoS) pairs
+        if (body.size() < 2) break;
+        std::lock_guard<std::mutex> lock(m_);
+        std::vector<uint8_t> suback = {0x90, 0x02, body[0], body[1]};
+        for (size_t o = 2; o + 2 <= body.size();) {
+          const size_t fl = ((size_t)body[o] << 8) | body[o + 1];
+          if (o + 2 + fl + 1 > body.size()) break;
+          s->subs.emplace_back((const char*)body.data() + o + 2, fl);
+          suback.push_back(0x00);
+          suback[1]++;
+          o += 2 + fl + 1;
+        }
+        sendAll(s->fd, suback.data(), suback.size());
+        break;
+      }
+      case 12: {   // PINGREQ
+        const uint8_t pingresp[2] = {0xD0, 0x00};
+        std::lock_guard<std::mutex> lock(m_);
+        sendAll(s->fd, pingresp, sizeof(pingresp));
+        break;
+      }
+      case 14:    // DISCONNECT
+        ::shutdown(s->fd, SHUT_RDWR);
+        break;
+      default:
+        break;
+    }
+  }
+  std::lock_guard<std::mutex> lock(m_);
+  s->open = false;
+}
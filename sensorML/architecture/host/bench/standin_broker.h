@@ -0,0 +1,64 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Stand-in MQTT broker for the benches that run a lab sketch on host
+// (shim/PubSubClient.h). Each dial() opens a session on a socketpair that
+// its own thread serves. The thread answers CONNECT, SUBSCRIBE and PINGREQ
+// and hands every PUBLISH to onPublish, which is called on that thread.
+// kill() drops every session. While the broker is down, dials behave like
+// an unreachable host: they block for their timeout, then fail. restart()
+// brings it back. Subscriptions match topics exactly; there are no
+// wildcards and no retained store.
+//
+//   StandInBroker broker(onPublish);
+//   broker.install();   // the sketch's mqtt.connect() now dials the broker
+
+class StandInBroker {
+public:
+  using PublishFn = std::function<void(const char* topic, const uint8_t* payload, size_t len, bool retained)>;
+
+  explicit StandInBroker(PublishFn onPublish = nullptr) : onPublish_(std::move(onPublish)) {}
+  ~StandInBroker();
+  StandInBroker(const StandInBroker&) = delete;
+  StandInBroker& operator=(const StandInBroker&) = delete;
+
+  // Route hostMqttDial (every PubSubClient in the process) to this broker
+  void install();
+
+  int dial(int timeoutMs);
+  void kill();
+  void restart();
+  bool up() const;
+
+  // Broker -> client PUBLISH to every live session subscribed to topic;
+  // returns the number of sessions it went to
+  int publish(const char* topic, const void* payload, size_t len);
+  bool hasSubscriber(const char* topic) const;
+
+  uint32_t connects() const;
+
+private:
+  struct Session {
+    int fd = -1;
+    bool open = true;
+    std::vector<std::string> subs;
+    std::thread th;
+  };
+
+  void serve(Session* s);
+  static bool sendAll(int fd, const uint8_t* p, size_t n);
+
+  PublishFn onPublish_;
+  mutable std::mutex m_;   // sessions_, their subs, up_, writes to session fds
+  std::vector<std::unique_ptr<Session>> sessions_;
+  bool up_ = true;
+  uint32_t connects_ = 0;
+};
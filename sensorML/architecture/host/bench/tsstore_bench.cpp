@@ -0,0 +1,144 @@
+// tsstore_bench: a day of 50 Hz IMU telemetry through the time-series store
+//
+//  1) append: 7 series (accel/gyro xyz, temp_c) x 4.32M points, points/s and
+//     compressed bytes per point (vs 12 B for raw int64 ts + float)
+//  2) dashboard queries over the whole day and over one hour at raw,
+//     1 s, 1 min, 5 min and 1 h resolution: latency, rows read, level used
+//  3) check: 1 min rollup buckets == buckets recomputed from raw points
+//  4) reopen: the same query returns the same answer after close()/open()
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -iquote tsstore -o tsstore_bench bench/tsstore_bench.cpp
+//       tsstore/tsstore.cpp tsstore/gorilla.cpp
+
+#include "tsstore.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* kRoot = "tsstore_bench_db";
+const char* kDevice = "device/imu01";
+const char* kFields[] = {"accel.x", "accel.y", "accel.z", "gyro.x", "gyro.y", "gyro.z", "temp_c"};
+const int64_t kDay0 = 1767225600000;   // 2026-01-01T00:00:00Z
+const int64_t kDayMs = 86400000;
+const int64_t kHourMs = 3600000;
+const int kRateHz = 50;
+
+double msSince(Clock::time_point t0)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// Sensor-like values, rounded to 3 decimals like the JSON telemetry
+float sample(int field, int64_t i)
+{
+  const double t = (double)i / kRateHz;
+  double v = std::sin(t * (0.5 + field)) * (field < 3 ? 2.0 : 30.0) + (rand() % 100) * 0.001;
+  if (field == 2) v += 9.81;
+  if (field == 6) v = 27.0 + 0.5 * std::sin(t / 600.0);
+  return (float)(std::round(v * 1000.0) / 1000.0);
+}
+
+const char* levelName(TsLevel l)
+{
+  switch (l) {
+    case TS_1S:   return "1s";
+    case TS_1MIN: return "1min";
+    case TS_1H:   return "1h";
+    default:      return "raw";
+  }
+}
+
+void runQuery(TsStore& db, const char* label, int64_t t0, int64_t t1, int64_t res)
+{
+  TsQueryStats st;
+  auto q0 = Clock::now();
+  std::vector<TsPoint> pts = db.query(kDevice, "accel.z", t0, t1, res, &st);
+  const double ms = msSince(q0);
+  std::printf("  %-22s res=%8lld ms  %9.3f ms  points=%-8zu level=%-4s rows_read=%-8llu blocks=%u/%u\n",
+              label, (long long)res, ms, pts.size(), levelName(st.level),
+              (unsigned long long)st.rowsRead, st.blocksDecoded, st.blocksSkipped);
+}
+
+}  // namespace
+
+int main()
+{
+  std::error_code ec;
+  std::filesystem::remove_all(kRoot, ec);
+
+  TsStore db;
+  if (!db.open(kRoot)) {
+    std::fprintf(stderr, "cannot open %s\n", kRoot);
+    return 1;
+  }
+
+  // 1) Append a day, 20 ms period with 0..2 ms receive jitter
+  const int64_t n = kDayMs / 1000 * kRateHz;
+  const size_t fields = sizeof(kFields) / sizeof(kFields[0]);
+  srand(7);
+  auto t0 = Clock::now();
+  for (int64_t i = 0; i < n; i++) {
+    const int64_t ts = kDay0 + i * (1000 / kRateHz) + rand() % 3;
+    for (size_t f = 0; f < fields; f++) db.append(kDevice, kFields[f], ts, sample((int)f, i));
+  }
+  db.flush();
+  const double appendMs = msSince(t0);
+  const uint64_t points = db.stats().appended;
+  std::printf("append: %llu points in %.0f ms, %.1f M points/s, %.2f bytes/point (raw 12), late=%llu\n",
+              (unsigned long long)points, appendMs, points / appendMs / 1e3,
+              (double)db.stats().rawBytes / points, (unsigned long long)db.stats().late);
+
+  // 2) Queries
+  std::printf("day (%lld points per series):\n", (long long)n);
+  runQuery(db, "raw scan", kDay0, kDay0 + kDayMs, 0);
+  runQuery(db, "1 s buckets", kDay0, kDay0 + kDayMs, 1000);
+  runQuery(db, "1 min buckets", kDay0, kDay0 + kDayMs, 60000);
+  runQuery(db, "5 min buckets", kDay0, kDay0 + kDayMs, 300000);
+  runQuery(db, "1 h buckets", kDay0, kDay0 + kDayMs, kHourMs);
+  runQuery(db, "500 ms (from raw)", kDay0, kDay0 + kDayMs, 500);
+  std::printf("one hour (12:00-13:00):\n");
+  runQuery(db, "raw scan", kDay0 + 12 * kHourMs, kDay0 + 13 * kHourMs, 0);
+  runQuery(db, "1 s buckets", kDay0 + 12 * kHourMs, kDay0 + 13 * kHourMs, 1000);
+  runQuery(db, "1 min buckets", kDay0 + 12 * kHourMs, kDay0 + 13 * kHourMs, 60000);
+
+  // 3) Rollups agree with raw data
+  std::vector<TsPoint> raw = db.query(kDevice, "accel.z", kDay0, kDay0 + kDayMs, 0);
+  std::vector<TsPoint> roll = db.query(kDevice, "accel.z", kDay0, kDay0 + kDayMs, 60000);
+  bool ok = roll.size() == (size_t)(kDayMs / 60000) && raw.size() == (size_t)n;
+  size_t r = 0;
+  for (const TsPoint& b : roll) {
+    float mn = INFINITY, mx = -INFINITY;
+    double sum = 0;
+    uint32_t cnt = 0;
+    for (; r < raw.size() && raw[r].t < b.t + 60000; r++) {
+      mn = std::fmin(mn, raw[r].min);
+      mx = std::fmax(mx, raw[r].max);
+      sum += raw[r].mean;
+      cnt++;
+    }
+    if (cnt != b.count || mn != b.min || mx != b.max || std::fabs(sum / cnt - b.mean) > 1e-4) ok = false;
+  }
+  std::printf("rollup check (1 min vs raw): %s\n", ok ? "ok" : "MISMATCH");
+
+  // 4) Reopen
+  db.close();
+  TsStore again;
+  again.open(kRoot);
+  std::vector<TsPoint> roll2 = again.query(kDevice, "accel.z", kDay0, kDay0 + kDayMs, 60000);
+  const bool same = roll2.size() == roll.size() && roll2.back().count == roll.back().count;
+  std::printf("reopen: %zu buckets (%s)\n", roll2.size(), same ? "same" : "DIFFERENT");
+  again.close();
+
+  std::filesystem::remove_all(kRoot, ec);
+  return ok && same ? 0 : 1;
+}
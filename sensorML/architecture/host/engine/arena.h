@@ -0,0 +1,43 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+
+// Bump allocator over fixed chunks that never move, so pointers into it stay
+// valid while devices are added. Allocations are cache-line aligned and a
+// device's state and window are carved out next to each other. Memory is
+// released only when the arena is destroyed (device state lives as long as
+// the engine).
+class Arena {
+public:
+  explicit Arena(size_t chunkSize = 64 * 1024) : chunkSize_(chunkSize) {}
+  ~Arena()
+  {
+    for (void* c : chunks_) free(c);
+  }
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* alloc(size_t n, size_t align = 64)
+  {
+    used_ = (used_ + align - 1) & ~(align - 1);
+    if (chunks_.empty() || used_ + n > chunkSize_) {
+      const size_t size = n > chunkSize_ ? (n + 63) & ~(size_t)63 : chunkSize_;
+      chunks_.push_back(aligned_alloc(64, size));
+      used_ = 0;
+    }
+    void* p = (uint8_t*)chunks_.back() + used_;
+    used_ += n;
+    bytes_ += n;
+    return p;
+  }
+
+  size_t bytes() const { return bytes_; }
+
+private:
+  size_t chunkSize_;
+  std::vector<void*> chunks_;
+  size_t used_ = 0;
+  size_t bytes_ = 0;
+};
@@ -0,0 +1,247 @@
+#include "engine.h"
+
+#include <algorithm>
+#include <new>
+
+namespace {
+
+// TinyML::infer() with TFLM linked uses one interpreter, tensor set and arena
+// per process (inference.cpp statics), shared by every worker of every Engine
+std::mutex g_inferMutex;
+
+uint8_t labelIndex(const char* label)
+{
+  if (strcmp(label, "dark") == 0) return 0;
+  if (strcmp(label, "bright") == 0) return 2;
+  return 1;
+}
+
+}  // namespace
+
+Engine::Engine(const EngineConfig& cfg, int workers) : cfg_(cfg)
+{
+  if (workers < 1) workers = 1;
+  if (cfg_.shardsPerWorker < 1) cfg_.shardsPerWorker = 1;
+  ml_.begin();   // host build: not ready -> fallbackClassify, as on a device without a model
+
+  const int nShards = workers * cfg_.shardsPerWorker;
+  for (int i = 0; i < nShards; i++) {
+    shards_.push_back(std::make_unique<Shard>());
+    Shard& sh = *shards_.back();
+    initFeatureBatch(sh.batch, (float*)sh.arena.alloc(sizeof(float) * cfg_.window * kFeatureLanes),
+                     cfg_.window);
+  }
+  for (int i = 0; i < workers; i++) queues_.push_back(std::make_unique<WorkerQueue>());
+  for (int i = 1; i < workers; i++) threads_.emplace_back(&Engine::workerLoop, this, i);
+}
+
+Engine::~Engine()
+{
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& t : threads_) t.join();
+}
+
+DeviceState* Engine::addDevice(uint32_t id)
+{
+  if (id >= shardOf_.size()) {
+    shardOf_.resize((size_t)id + 1, UINT32_MAX);
+    localOf_.resize((size_t)id + 1, 0);
+  }
+  // Multiplicative hash: consecutive ids spread over shards
+  const uint32_t s = (uint32_t)(((uint64_t)(id * 2654435761u) * shards_.size()) >> 32);
+  Shard& sh = *shards_[s];
+
+  // State and window from the same arena, adjacent in memory
+  DeviceState* d = new (sh.arena.alloc(sizeof(DeviceState))) DeviceState();
+  float* storage = (float*)sh.arena.alloc(sizeof(float) * cfg_.window, 16);
+  initWindowWith(d->win, storage, cfg_.window);
+  d->ctrl.begin(-1);   // no pin on host
+  d->id = id;
+  d->digest = 1469598103934665603ull;
+
+  shardOf_[id] = s;
+  localOf_[id] = (uint32_t)sh.devices.size();
+  sh.devices.push_back(d);
+  devices_++;
+  return d;
+}
+
+const DeviceState* Engine::device(uint32_t id) const
+{
+  if (id >= shardOf_.size() || shardOf_[id] == UINT32_MAX) return nullptr;
+  return shards_[shardOf_[id]]->devices[localOf_[id]];
+}
+
+void Engine::runShard(Shard& sh)
+{
+  sh.results.clear();
+  for (const EngineSample& s : sh.inbox) {
+    DeviceState& d = *sh.devices[localOf_[s.device]];
+    d.samples++;
+
+    // Same steps as loop() in main.ino
+    pushSample(d.win, s.value * cfg_.scale + cfg_.offset);
+    if (!isWindowFull(d.win)) continue;
+
+    if (cfg_.batchFeatures) {
+      // The window is copied into the batch, so it can slide right away
+      sh.pending[batchAddWindow(sh.batch, d.win)] = &d;
+      if (sh.batch.lanes == kFeatureLanes) flushBatch(sh);
+    } else {
+      Features f;
+      computeFeatures(d.win, f);
+      finishWindow(sh, d, f);
+    }
+    popOldest(d.win, cfg_.hop);
+  }
+  if (sh.batch.lanes > 0) flushBatch(sh);
+  sh.samples += sh.inbox.size();
+  sh.inbox.clear();
+}
+
+void Engine::flushBatch(Shard& sh)
+{
+  Features f[kFeatureLanes];
+  computeFeaturesBatch(sh.batch, f);
+  for (int l = 0; l < sh.batch.lanes; l++) finishWindow(sh, *sh.pending[l], f[l]);
+  sh.batch.lanes = 0;
+}
+
+void Engine::finishWindow(Shard& sh, DeviceState& d, const Features& f)
+{
+  InferenceResult r;
+  if (ml_.isReady()) {
+    std::lock_guard<std::mutex> lk(g_inferMutex);
+    r = ml_.infer(f);
+  } else {
+    r = fallbackClassify(f);
+  }
+  ControlAction a = d.ctrl.safetyAndActuate(r, cfg_.uncertainty);
+
+  const uint8_t label = labelIndex(r.label);
+  d.digest = (d.digest ^ label) * 1099511628211ull;
+  d.digest = (d.digest ^ (uint8_t)a) * 1099511628211ull;
+  if (a == ACTION_LED_ON) d.ledOn++;
+  if (cfg_.keepResults) sh.results.push_back({d.id, d.windows, r.confidence, label, (uint8_t)a});
+  d.windows++;
+  sh.windows++;
+}
+
+bool Engine::nextTask(int w, uint32_t& shard)
+{
+  // Own queue from the front (biggest shards first)
+  {
+    WorkerQueue& q = *queues_[w];
+    std::lock_guard<std::mutex> lk(q.m);
+    if (!q.tasks.empty()) {
+      shard = q.tasks.front();
+      q.tasks.pop_front();
+      return true;
+    }
+  }
+  // Steal from the back (smallest) of the others
+  const int n = (int)queues_.size();
+  for (int i = 1; i < n; i++) {
+    WorkerQueue& v = *queues_[(w + i) % n];
+    std::lock_guard<std::mutex> lk(v.m);
+    if (v.tasks.empty()) continue;
+    shard = v.tasks.back();
+    v.tasks.pop_back();
+    queues_[w]->steals++;   // only worker w writes its own counter
+    return true;
+  }
+  return false;
+}
+
+void Engine::drain(int w)
+{
+  uint32_t s;
+  while (nextTask(w, s)) {
+    runShard(*shards_[s]);
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      std::lock_guard<std::mutex> lk(m_);
+      done_.notify_all();
+    }
+  }
+}
+
+void Engine::workerLoop(int w)
+{
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lk(m_);
+      wake_.wait(lk, [&] { return stop_ || generation_ != seen; });
+      if (stop_) return;
+      seen = generation_;
+    }
+    drain(w);
+  }
+}
+
+void Engine::process(const EngineSample* s, size_t n)
+{
+  // Bucket by shard (new devices get their state here, single-threaded)
+  for (size_t i = 0; i < n; i++) {
+    const uint32_t id = s[i].device;
+    if (id >= shardOf_.size() || shardOf_[id] == UINT32_MAX) addDevice(id);
+    shards_[shardOf_[id]]->inbox.push_back(s[i]);
+  }
+
+  std::vector<uint32_t> order;
+  order.reserve(shards_.size());
+  for (uint32_t i = 0; i < shards_.size(); i++) {
+    if (!shards_[i]->inbox.empty()) order.push_back(i);
+  }
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return shards_[a]->inbox.size() > shards_[b]->inbox.size();
+  });
+
+  batches_++;
+  if (order.empty()) return;
+
+  // Count before queueing: a worker still in drain() from the last batch
+  // takes a task as soon as it is queued, and its decrement must not find 0
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    remaining_.store((uint32_t)order.size(), std::memory_order_release);
+  }
+  const int nw = workers();
+  for (size_t k = 0; k < order.size(); k++) {
+    WorkerQueue& q = *queues_[k % nw];
+    std::lock_guard<std::mutex> lk(q.m);
+    q.tasks.push_back(order[k]);
+  }
+  {
+    std::lock_guard<std::mutex> lk(m_);
+    generation_++;
+  }
+  wake_.notify_all();
+
+  drain(0);
+  std::unique_lock<std::mutex> lk(m_);
+  done_.wait(lk, [&] { return remaining_.load(std::memory_order_acquire) == 0; });
+}
+
+EngineStats Engine::stats() const
+{
+  EngineStats st = {};
+  for (const auto& sh : shards_) {
+    st.samples += sh->samples;
+    st.windows += sh->windows;
+  }
+  for (const auto& q : queues_) st.steals += q->steals;
+  st.batches = batches_;
+  return st;
+}
+
+size_t Engine::arenaBytes() const
+{
+  size_t n = 0;
+  for (const auto& sh : shards_) n += sh->arena.bytes();
+  return n;
+}
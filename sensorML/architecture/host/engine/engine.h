@@ -0,0 +1,144 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "features.h"
+#include "inference.h"
+#include "controller.h"
+#include "arena.h"
+#include "features_batch.h"
+
+// Server-side pipeline engine: runs the device pipeline of main.ino
+// (pushSample -> computeFeatures -> TinyML::infer / fallbackClassify ->
+// Controller::safetyAndActuate -> popOldest) over many device streams, for
+// shadow validation and backfill.
+//
+//  - Devices are sharded by id; a shard owns its devices' WindowBuffer and
+//    Controller state, allocated side by side from the shard's arena, and
+//    is processed by one worker at a time, so state needs no locks and each
+//    device's samples are processed in arrival order.
+//  - process() takes a batch, buckets it by shard on the calling thread,
+//    then hands shards out as tasks: each worker owns a deque (biggest
+//    shards first) and, when it runs dry, steals from the back of the
+//    others'. With many more shards than workers, a few hot devices do not
+//    leave the other cores idle.
+//  - Full windows are queued per shard and their features computed
+//    kFeatureLanes devices at a time (features_batch.h); inference and
+//    control then run per window in queue order, so each device still sees
+//    its windows in order.
+//  - The calling thread works as worker 0, so 1 worker means no threads.
+//  - With TFLM linked, TinyML::infer() runs on process-wide interpreter
+//    state, so workers take turns on it (a mutex); features and control
+//    still run in parallel. Without TFLM, fallbackClassify needs no lock.
+//
+// Device ids are dense small integers (e.g. the ingest device index).
+
+struct EngineSample {
+  uint32_t device;
+  float value;          // raw reading; calibrated with scale/offset like loop()
+};
+
+struct EngineConfig {
+  int window = 40;      // samples (main.ino: 40 @ 20 Hz)
+  int hop = 10;
+  float scale = 1.0f;
+  float offset = 0.0f;
+  float uncertainty = 0.05f;
+  int shardsPerWorker = 16;
+  bool keepResults = false;   // per-window outputs for shadow comparison
+  bool batchFeatures = true;  // false: scalar computeFeatures() per window
+};
+
+struct EngineResult {
+  uint32_t device;
+  uint32_t window;      // per-device window index
+  float confidence;
+  uint8_t label;        // 0 dark, 1 normal, 2 bright
+  uint8_t action;       // ControlAction
+};
+
+struct DeviceState {
+  WindowBuffer win;
+  Controller ctrl;
+  uint32_t id;
+  uint32_t samples;
+  uint32_t windows;
+  uint32_t ledOn;       // windows that ended with ACTION_LED_ON
+  uint64_t digest;      // FNV-1a over (label, action) of every window
+};
+
+struct EngineStats {
+  uint64_t samples;
+  uint64_t windows;
+  uint64_t steals;
+  uint64_t batches;
+};
+
+class Engine {
+public:
+  Engine(const EngineConfig& cfg, int workers);
+  ~Engine();
+  Engine(const Engine&) = delete;
+  Engine& operator=(const Engine&) = delete;
+
+  // Process one batch; returns when every sample has gone through
+  void process(const EngineSample* s, size_t n);
+
+  int workers() const { return (int)queues_.size(); }
+  size_t shards() const { return shards_.size(); }
+  size_t devices() const { return devices_; }
+  const DeviceState* device(uint32_t id) const;
+  const std::vector<EngineResult>& results(size_t shard) const { return shards_[shard]->results; }
+  EngineStats stats() const;
+  size_t arenaBytes() const;
+
+private:
+  struct alignas(64) Shard {
+    Arena arena;
+    std::vector<DeviceState*> devices;
+    std::vector<EngineSample> inbox;
+    std::vector<EngineResult> results;
+    FeatureBatch batch;
+    DeviceState* pending[kFeatureLanes];   // owner of each batch lane
+    uint64_t samples = 0;
+    uint64_t windows = 0;
+  };
+
+  struct alignas(64) WorkerQueue {
+    std::mutex m;
+    std::deque<uint32_t> tasks;
+    uint64_t steals = 0;
+  };
+
+  DeviceState* addDevice(uint32_t id);
+  void runShard(Shard& sh);
+  void flushBatch(Shard& sh);
+  void finishWindow(Shard& sh, DeviceState& d, const Features& f);
+  bool nextTask(int w, uint32_t& shard);
+  void drain(int w);
+  void workerLoop(int w);
+
+  EngineConfig cfg_;
+  TinyML ml_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::vector<uint32_t> shardOf_;   // device id -> shard (UINT32_MAX: unknown)
+  std::vector<uint32_t> localOf_;   // device id -> index in shard.devices
+  size_t devices_ = 0;
+  uint64_t batches_ = 0;
+
+  std::vector<std::thread> threads_;
+  std::mutex m_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  uint64_t generation_ = 0;
+  bool stop_ = false;
+  std::atomic<uint32_t> remaining_{0};
+};
@@ -0,0 +1,194 @@
+#include "features_batch.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FEATURES_BATCH_X86 1
+#endif
+
+namespace {
+
+constexpr int K = kFeatureLanes;
+
+typedef void (*BatchKernel)(const float* soa, int n, Features* out, int lanes);
+
+// Plain C++: lanes innermost, so the compiler can still use the vector unit
+void kernelGeneric(const float* soa, int n, Features* out, int lanes)
+{
+  float sum[K], mn[K], mx[K], mean[K], var[K];
+  for (int l = 0; l < K; l++) {
+    sum[l] = 0.0f;
+    mn[l] = mx[l] = soa[l];
+    var[l] = 0.0f;
+  }
+  for (int i = 0; i < n; i++) {
+    const float* row = soa + i * K;
+    for (int l = 0; l < K; l++) {
+      const float x = row[l];
+      sum[l] += x;
+      if (x < mn[l]) mn[l] = x;
+      if (x > mx[l]) mx[l] = x;
+    }
+  }
+  for (int l = 0; l < K; l++) mean[l] = sum[l] / (float)n;
+  for (int i = 0; i < n; i++) {
+    const float* row = soa + i * K;
+    for (int l = 0; l < K; l++) {
+      const float d = row[l] - mean[l];
+      var[l] += d * d;
+    }
+  }
+  const float* first = soa;
+  const float* last = soa + (n - 1) * K;
+  for (int l = 0; l < lanes; l++) {
+    out[l].mean = mean[l];
+    out[l].std = sqrtf(var[l] / (float)(n - 1));
+    out[l].minv = mn[l];
+    out[l].maxv = mx[l];
+    out[l].slope = (last[l] - first[l]) / (float)(n - 1);
+  }
+}
+
+#if defined(FEATURES_BATCH_X86)
+
+// min/max operand order as in the scalar code: (x < m) ? x : m
+
+__attribute__((target("avx2")))
+void kernelAvx2(const float* soa, int n, Features* out, int lanes)
+{
+  const __m256 fn = _mm256_set1_ps((float)n);
+  const __m256 fn1 = _mm256_set1_ps((float)(n - 1));
+  for (int h = 0; h < lanes; h += 8) {
+    __m256 sum = _mm256_setzero_ps();
+    __m256 mn = _mm256_load_ps(soa + h);
+    __m256 mx = mn;
+    for (int i = 0; i < n; i++) {
+      const __m256 x = _mm256_load_ps(soa + i * K + h);
+      sum = _mm256_add_ps(sum, x);
+      mn = _mm256_min_ps(x, mn);
+      mx = _mm256_max_ps(x, mx);
+    }
+    const __m256 mean = _mm256_div_ps(sum, fn);
+    __m256 var = _mm256_setzero_ps();
+    for (int i = 0; i < n; i++) {
+      const __m256 d = _mm256_sub_ps(_mm256_load_ps(soa + i * K + h), mean);
+      var = _mm256_add_ps(var, _mm256_mul_ps(d, d));
+    }
+    const __m256 sd = _mm256_sqrt_ps(_mm256_div_ps(var, fn1));
+    const __m256 slope = _mm256_div_ps(
+        _mm256_sub_ps(_mm256_load_ps(soa + (n - 1) * K + h), _mm256_load_ps(soa + h)), fn1);
+
+    alignas(32) float r[5][8];
+    _mm256_store_ps(r[0], mean);
+    _mm256_store_ps(r[1], sd);
+    _mm256_store_ps(r[2], mn);
+    _mm256_store_ps(r[3], mx);
+    _mm256_store_ps(r[4], slope);
+    for (int l = 0; l < 8 && h + l < lanes; l++) {
+      out[h + l] = {r[0][l], r[1][l], r[2][l], r[3][l], r[4][l]};
+    }
+  }
+}
+
+__attribute__((target("avx512f")))
+void kernelAvx512(const float* soa, int n, Features* out, int lanes)
+{
+  const __m512 fn = _mm512_set1_ps((float)n);
+  const __m512 fn1 = _mm512_set1_ps((float)(n - 1));
+  __m512 sum = _mm512_setzero_ps();
+  __m512 mn = _mm512_load_ps(soa);
+  __m512 mx = mn;
+  for (int i = 0; i < n; i++) {
+    const __m512 x = _mm512_load_ps(soa + i * K);
+    sum = _mm512_add_ps(sum, x);
+    mn = _mm512_min_ps(x, mn);
+    mx = _mm512_max_ps(x, mx);
+  }
+  const __m512 mean = _mm512_div_ps(sum, fn);
+  __m512 var = _mm512_setzero_ps();
+  for (int i = 0; i < n; i++) {
+    const __m512 d = _mm512_sub_ps(_mm512_load_ps(soa + i * K), mean);
+    // avx512f implies FMA: the _round_ form keeps GCC from fusing this
+    // into one rounding, which would differ from the scalar d * d + var
+    var = _mm512_add_ps(var, _mm512_mul_round_ps(d, d, _MM_FROUND_CUR_DIRECTION));
+  }
+  const __m512 sd = _mm512_sqrt_ps(_mm512_div_ps(var, fn1));
+  const __m512 slope = _mm512_div_ps(
+      _mm512_sub_ps(_mm512_load_ps(soa + (n - 1) * K), _mm512_load_ps(soa)), fn1);
+
+  alignas(64) float r[5][16];
+  _mm512_store_ps(r[0], mean);
+  _mm512_store_ps(r[1], sd);
+  _mm512_store_ps(r[2], mn);
+  _mm512_store_ps(r[3], mx);
+  _mm512_store_ps(r[4], slope);
+  for (int l = 0; l < lanes; l++) {
+    out[l] = {r[0][l], r[1][l], r[2][l], r[3][l], r[4][l]};
+  }
+}
+
+#endif
+
+struct Dispatch {
+  BatchKernel fn;
+  const char* isa;
+};
+
+Dispatch pickKernel()
+{
+#if defined(FEATURES_BATCH_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return {kernelAvx512, "avx512"};
+  if (__builtin_cpu_supports("avx2")) return {kernelAvx2, "avx2"};
+#endif
+  return {kernelGeneric, "generic"};
+}
+
+const Dispatch& kernel()
+{
+  static const Dispatch d = pickKernel();
+  return d;
+}
+
+}  // namespace
+
+void initFeatureBatch(FeatureBatch& b, float* storage, int window)
+{
+  b.soa = storage;
+  b.window = window;
+  b.lanes = 0;
+  memset(storage, 0, sizeof(float) * (size_t)window * K);
+}
+
+int batchAddWindow(FeatureBatch& b, const WindowBuffer& w)
+{
+  if (b.lanes >= K || w.size != b.window || !w.buf) return -1;
+  const int lane = b.lanes++;
+
+  // Oldest sample first, same order as at() in features.cpp
+  int src = w.head - w.size;
+  while (src < 0) src += w.capacity;
+  float* dst = b.soa + lane;
+  for (int i = 0; i < w.size; i++) {
+    dst[i * K] = w.buf[src];
+    if (++src == w.capacity) src = 0;
+  }
+  return lane;
+}
+
+void computeFeaturesBatch(const FeatureBatch& b, Features* out)
+{
+  if (b.lanes <= 0) return;
+  if (b.window <= 1) {
+    for (int l = 0; l < b.lanes; l++) out[l] = {0, 0, 0, 0, 0};
+    return;
+  }
+  kernel().fn(b.soa, b.window, out, b.lanes);
+}
+
+const char* featureBatchIsa()
+{
+  return kernel().isa;
+}
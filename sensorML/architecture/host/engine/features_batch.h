@@ -0,0 +1,37 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "features.h"
+
+// Cross-device computeFeatures(): the windows of up to kFeatureLanes devices
+// are transposed into structure-of-arrays (sample i of lanes 0..15 is one
+// contiguous row), and mean/std/min/max/slope are computed for all lanes at
+// once, one device per SIMD lane.
+//
+// Each lane does the same float operations, in the same order, as the
+// scalar computeFeatures(), so results match it bit for bit unless the
+// compiler contracts the scalar variance loop into FMA (-march with FMA);
+// then std differs by at most a few ulp.
+//
+// Kernel: AVX-512 (16 lanes per instruction) or AVX2 (2 x 8), picked at
+// run time on x86; plain C++ elsewhere. The layout is the same for all.
+
+constexpr int kFeatureLanes = 16;
+
+struct FeatureBatch {
+  float* soa;     // soa[i * kFeatureLanes + lane], i = 0 is the oldest sample
+  int window;     // samples per lane (all windows in a batch are full)
+  int lanes;      // lanes filled so far
+};
+
+// storage: window * kFeatureLanes floats, 64-byte aligned
+void initFeatureBatch(FeatureBatch& b, float* storage, int window);
+// Copies a full window (oldest to newest) into the next lane. Returns the
+// lane, or -1 if the batch is full or w is not a full window of b.window.
+int batchAddWindow(FeatureBatch& b, const WindowBuffer& w);
+// out[0..b.lanes)
+void computeFeaturesBatch(const FeatureBatch& b, Features* out);
+
+// "avx512", "avx2" or "generic"
+const char* featureBatchIsa();
@@ -0,0 +1,154 @@
+#include "columns.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
+
+uint64_t fnv1a64(const char* s, size_t n)
+{
+  uint64_t h = 1469598103934665603ull;
+  for (size_t i = 0; i < n; i++) {
+    h ^= (uint8_t)s[i];
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+bool safeFieldName(const char* s, size_t n)
+{
+  if (n == 0 || s[0] == '.') return false;
+  for (size_t i = 0; i < n; i++) {
+    const unsigned char c = (unsigned char)s[i];
+    if (c < 0x20 || c == '/' || c == '\\') return false;
+    if (c == '.' && i + 1 < n && s[i + 1] == '.') return false;
+  }
+  return true;
+}
+
+DeviceColumns::DeviceColumns(const char* id, size_t n, size_t reserveRows)
+    : id_(id, n)
+{
+  ts_.reserve(reserveRows);
+  rxUs_.reserve(reserveRows);
+}
+
+void DeviceColumns::beginRow(int64_t rxUs)
+{
+  rxUs_.push_back(rxUs);
+  tsPending_ = -1;
+}
+
+bool DeviceColumns::set(const char* field, size_t n, float v)
+{
+  const uint64_t h = fnv1a64(field, n);
+  for (Column& c : cols_) {
+    if (c.hash != h || c.name.size() != n || std::memcmp(c.name.data(), field, n) != 0) continue;
+    if (c.values.size() == rows_) c.values.push_back(v);
+    else c.values[rows_] = v;   // duplicate key: last one wins
+    return true;
+  }
+  if (!safeFieldName(field, n)) return false;
+
+  // First sight of this field: back-fill earlier rows
+  Column c;
+  c.name.assign(field, n);
+  c.hash = h;
+  c.values.reserve(ts_.capacity());
+  c.values.assign(rows_, NAN);
+  c.values.push_back(v);
+  cols_.push_back(std::move(c));
+  return true;
+}
+
+void DeviceColumns::endRow()
+{
+  ts_.push_back(tsPending_);
+  rows_++;
+  for (Column& c : cols_) {
+    if (c.values.size() < rows_) c.values.push_back(NAN);
+  }
+}
+
+namespace {
+
+bool appendFile(const std::string& path, const void* p, size_t n)
+{
+  FILE* f = std::fopen(path.c_str(), "ab");
+  if (!f) return false;
+  const bool ok = std::fwrite(p, 1, n, f) == n;
+  std::fclose(f);
+  return ok;
+}
+
+}  // namespace
+
+bool DeviceColumns::flush(const std::string& dir)
+{
+  // Topic-derived ids contain '/': keep one directory level per device
+  // (and never "." or "..")
+  std::string sub = id_;
+  for (char& c : sub) {
+    if (c == '/') c = '_';
+  }
+  if (sub.empty() || sub == "." || sub == "..") sub.insert(0, "_");
+  const std::string base = dir + "/" + sub;
+  ::mkdir(dir.c_str(), 0755);
+  ::mkdir(base.c_str(), 0755);
+
+  bool ok = appendFile(base + "/ts.i64", ts_.data(), rows_ * sizeof(int64_t)) &&
+            appendFile(base + "/rx_us.i64", rxUs_.data(), rows_ * sizeof(int64_t));
+
+  for (Column& c : cols_) {
+    const std::string path = base + "/" + c.name + ".f32";
+    if (!c.persisted && flushed_ > 0) {
+      // Column appeared after earlier flushes: pad its file to align rows
+      std::vector<float> pad(flushed_, NAN);
+      ok = ok && appendFile(path, pad.data(), pad.size() * sizeof(float));
+    }
+    ok = ok && appendFile(path, c.values.data(), rows_ * sizeof(float));
+    c.persisted = true;
+  }
+
+  FILE* schema = std::fopen((base + "/schema.txt").c_str(), "w");
+  if (schema) {
+    std::fprintf(schema, "ts i64\nrx_us i64\n");
+    for (const Column& c : cols_) std::fprintf(schema, "%s f32\n", c.name.c_str());
+    std::fclose(schema);
+  }
+
+  flushed_ += rows_;
+  clear();
+  return ok;
+}
+
+void DeviceColumns::clear()
+{
+  rows_ = 0;
+  ts_.clear();
+  rxUs_.clear();
+  for (Column& c : cols_) c.values.clear();
+}
+
+DeviceColumns& FleetColumns::device(const char* id, size_t n)
+{
+  uint64_t h = fnv1a64(id, n);
+  for (;;) {
+    auto it = index_.find(h);
+    if (it == index_.end()) break;
+    DeviceColumns& d = *devices_[it->second];
+    if (d.id().size() == n && std::memcmp(d.id().data(), id, n) == 0) return d;
+    h++;   // hash collision: probe the next key
+  }
+  index_.emplace(h, (uint32_t)devices_.size());
+  devices_.push_back(std::make_unique<DeviceColumns>(id, n, reserveRows_));
+  return *devices_.back();
+}
+
+uint64_t FleetColumns::bufferedRows() const
+{
+  uint64_t n = 0;
+  for (const auto& d : devices_) n += d->rows();
+  return n;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Per-device columnar buffers for decoded telemetry.
+// A device has two time columns (device ts, host receive time) plus one
+// float column per numeric field, created the first time the field is seen
+// ("accel.x", "value", "conf", ...). Rows stay aligned: a field missing from
+// a message is NaN in that row, and a late field is back-filled with NaN.
+// Fields and devices are found by a precomputed 64-bit FNV-1a hash, so once
+// a fleet's schema is known the only allocation is amortized column growth.
+
+uint64_t fnv1a64(const char* s, size_t n);
+
+// Field names become file names (<field>.f32). Empty names, names starting
+// with '.', and names holding "..", '/', '\' or control characters are
+// refused, so a JSON key cannot write outside the device directory.
+bool safeFieldName(const char* s, size_t n);
+
+struct Column {
+  std::string name;
+  uint64_t hash;
+  std::vector<float> values;
+  bool persisted = false;   // has a file under the flush directory
+};
+
+class DeviceColumns {
+public:
+  DeviceColumns(const char* id, size_t n, size_t reserveRows);
+
+  void beginRow(int64_t rxUs);
+  void setTimestamp(int64_t ts) { tsPending_ = ts; }
+  // False (nothing stored) if !safeFieldName(field)
+  bool set(const char* field, size_t n, float v);
+  void endRow();
+
+  const std::string& id() const { return id_; }
+  size_t rows() const { return rows_; }
+  uint64_t flushedRows() const { return flushed_; }
+  const std::vector<int64_t>& ts() const { return ts_; }        // -1: none
+  const std::vector<int64_t>& rxUs() const { return rxUs_; }    // wall clock
+  const std::vector<Column>& columns() const { return cols_; }
+
+  // Append the buffered rows to DIR/<id>/ (ts.i64, rx_us.i64,
+  // <field>.f32 + schema.txt), then drop them but keep the capacity.
+  bool flush(const std::string& dir);
+  // Drop the buffered rows without writing them (schema and capacity kept)
+  void clear();
+
+private:
+  std::string id_;
+  std::vector<int64_t> ts_;
+  std::vector<int64_t> rxUs_;
+  std::vector<Column> cols_;
+  size_t rows_ = 0;
+  uint64_t flushed_ = 0;   // rows already written by flush()
+  int64_t tsPending_ = -1;
+};
+
+class FleetColumns {
+public:
+  explicit FleetColumns(size_t reserveRowsPerDevice = 4096)
+      : reserveRows_(reserveRowsPerDevice) {}
+
+  DeviceColumns& device(const char* id, size_t n);
+
+  size_t size() const { return devices_.size(); }
+  DeviceColumns& at(size_t i) { return *devices_[i]; }
+  uint64_t bufferedRows() const;
+
+private:
+  size_t reserveRows_;
+  std::vector<std::unique_ptr<DeviceColumns>> devices_;
+  std::unordered_map<uint64_t, uint32_t> index_;   // fnv1a64(id) -> devices_
+};
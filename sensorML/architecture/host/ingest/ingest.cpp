@@ -0,0 +1,110 @@
+#include "ingest.h"
+#include "json_scan.h"
+
+#include <cstring>
+
+void LagHistogram::add(uint64_t ns)
+{
+  // smallest b with 2^b >= ns
+  int b = ns <= 1 ? 0 : 64 - __builtin_clzll(ns - 1);
+  if (b >= kBuckets) b = kBuckets - 1;
+  buckets[b]++;
+  count++;
+  if (ns > maxNs) maxNs = ns;
+}
+
+uint64_t LagHistogram::percentileNs(double p) const
+{
+  if (count == 0) return 0;
+  const uint64_t rank = (uint64_t)(p * (double)(count - 1)) + 1;
+  uint64_t seen = 0;
+  for (int b = 0; b < kBuckets; b++) {
+    seen += buckets[b];
+    if (seen >= rank) return (1ull << b) < maxNs ? (1ull << b) : maxNs;
+  }
+  return maxNs;
+}
+
+bool ingestMessage(FleetColumns& fleet, IngestStats& st,
+                   const char* topic, size_t topicLen,
+                   const char* payload, size_t len, int64_t rxWallUs)
+{
+  static const char kSuffix[] = "/telemetry";
+  const size_t sufLen = sizeof(kSuffix) - 1;
+  size_t keyLen = topicLen;
+  if (keyLen > sufLen && std::memcmp(topic + keyLen - sufLen, kSuffix, sufLen) == 0) {
+    keyLen -= sufLen;
+  }
+
+  DeviceColumns& dev = fleet.device(topic, keyLen);
+  dev.beginRow(rxWallUs);
+
+  bool isObject = false;
+  for (size_t i = 0; i < len; i++) {
+    if (payload[i] == ' ' || payload[i] == '\t' || payload[i] == '\r' || payload[i] == '\n') continue;
+    isObject = payload[i] == '{';
+    break;
+  }
+
+  JsonScan scan(payload, len);
+  const bool ok = isObject && scan.run([&](const JsonLeaf& leaf) {
+    if (leaf.kind != JsonKind::Number && leaf.kind != JsonKind::Bool) return;
+    if ((leaf.pathLen == 5 && std::memcmp(leaf.path, "ts_ms", 5) == 0) ||
+        (leaf.pathLen == 2 && std::memcmp(leaf.path, "ts", 2) == 0)) {
+      dev.setTimestamp((int64_t)leaf.num);
+      return;
+    }
+    if (!dev.set(leaf.path, leaf.pathLen, (float)leaf.num)) st.badFields++;
+  });
+  dev.endRow();
+
+  st.msgs++;
+  st.bytes += len;
+  st.rows++;
+  if (!ok) st.parseErrors++;
+  return ok;
+}
+
+void DeviceClock::rowTimesMs(const DeviceColumns& d, std::vector<int64_t>& out)
+{
+  const std::vector<float>* replay = nullptr;
+  for (const Column& c : d.columns()) {
+    if (c.name == "replay") replay = &c.values;
+  }
+  auto isReplay = [&](size_t r) { return replay && (*replay)[r] == 1.0f; };
+
+  bool seen = false;
+  int64_t batchMin = 0;
+  for (size_t r = 0; r < d.rows(); r++) {
+    const int64_t ts = d.ts()[r];
+    if (ts < 0 || isReplay(r)) continue;
+    if (ts < lastLiveTs_) {   // reboot
+      if (valid_) {
+        prevOffsetMs_ = offsetMs_;
+        prevValid_ = true;
+      }
+      valid_ = false;
+      seen = false;
+    }
+    lastLiveTs_ = ts;
+    const int64_t off = d.rxUs()[r] / 1000 - ts;
+    if (!seen || off < batchMin) batchMin = off;
+    seen = true;
+  }
+  if (seen) {
+    offsetMs_ = batchMin;
+    valid_ = true;
+  }
+
+  out.resize(d.rows());
+  for (size_t r = 0; r < d.rows(); r++) {
+    const int64_t ts = d.ts()[r];
+    out[r] = d.rxUs()[r] / 1000;
+    if (ts < 0 || !isReplay(r)) continue;
+    if (ts > lastLiveTs_) {   // journaled before the last reboot
+      if (prevValid_) out[r] = ts + prevOffsetMs_;
+    } else if (valid_) {
+      out[r] = ts + offsetMs_;
+    }
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "columns.h"
+
+// Telemetry decode stage: one MQTT message -> one row of its device.
+//  - Device key = topic without the trailing "/telemetry"
+//    ("device/imu01", "tinyml/esp32/lab11"), so payloads without an "id"
+//    (TinyML labs) still land in their own buffers.
+//  - "ts_ms" (sensorML labs) or "ts" (TinyML labs) is the device timestamp;
+//    every other numeric or boolean leaf becomes a float column. Strings
+//    (id, uom) are metadata and are not stored per row.
+
+// Power-of-two latency buckets (ns), enough for p50/p99 without storing
+// samples; percentiles are reported as the bucket's upper bound.
+struct LagHistogram {
+  static constexpr int kBuckets = 40;
+  uint64_t buckets[kBuckets] = {};
+  uint64_t count = 0;
+  uint64_t maxNs = 0;
+
+  void add(uint64_t ns);
+  uint64_t percentileNs(double p) const;
+  void reset() { *this = LagHistogram(); }
+};
+
+struct IngestStats {
+  uint64_t msgs = 0;
+  uint64_t bytes = 0;          // payload bytes
+  uint64_t rows = 0;
+  uint64_t parseErrors = 0;
+  uint64_t badFields = 0;      // numeric fields dropped for an unsafe name
+  LagHistogram lag;            // socket read -> row appended
+};
+
+// Returns false (and counts a parse error) if the payload is not a JSON
+// object; a partial row is still closed so columns stay aligned.
+bool ingestMessage(FleetColumns& fleet, IngestStats& st,
+                   const char* topic, size_t topicLen,
+                   const char* payload, size_t len, int64_t rxWallUs);
+
+// Store time of a device's rows (ms since the epoch). Device ts is uptime,
+// so live rows are keyed by host receive time. A replayed row ("replay":1,
+// store-and-forward) keeps its original ts but arrives late, so its time is
+// ts + the device's uptime-to-wall offset instead. The offset is the
+// smallest rx - ts over the live rows of the latest batch that had any (the
+// least delayed message). A live ts going backwards is a reboot: the offset
+// of the previous boot is kept for records journaled before it, i.e.
+// replayed ts past the newest live ts. Replay rows with no offset to use
+// fall back to receive time.
+class DeviceClock {
+public:
+  // Learns the offset from d's live rows, then fills out[r] for every row
+  void rowTimesMs(const DeviceColumns& d, std::vector<int64_t>& out);
+
+private:
+  bool valid_ = false;
+  bool prevValid_ = false;
+  int64_t offsetMs_ = 0;
+  int64_t prevOffsetMs_ = 0;
+  int64_t lastLiveTs_ = -1;
+};
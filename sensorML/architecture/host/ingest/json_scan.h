@@ -0,0 +1,185 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <charconv>
+
+// Non-allocating JSON scanner for telemetry payloads.
+// Walks one JSON document and reports every leaf value with its flattened
+// path: object keys are joined with '.', array elements use their index
+// ("accel.x", "q.2"). The path is built in a fixed buffer and strings are
+// views into the input (escapes are not decoded), so a scan does no heap
+// work. Numbers go through std::from_chars.
+
+enum class JsonKind : uint8_t { Number, String, Bool, Null };
+
+struct JsonLeaf {
+  const char* path;     // valid only during the callback
+  size_t pathLen;
+  JsonKind kind;
+  double num;           // Number, Bool (0/1)
+  const char* str;      // String: raw bytes between the quotes
+  size_t strLen;
+};
+
+static constexpr size_t kJsonMaxPath = 96;
+static constexpr int kJsonMaxDepth = 8;
+
+class JsonScan {
+public:
+  JsonScan(const char* p, size_t n) : p_(p), end_(p + n) {}
+
+  // Calls onLeaf(const JsonLeaf&) per leaf. Returns false on malformed
+  // input, paths longer than kJsonMaxPath or nesting deeper than
+  // kJsonMaxDepth (leaves before the error have been reported).
+  template <typename Fn>
+  bool run(Fn&& onLeaf)
+  {
+    ws();
+    if (!value(onLeaf, 0)) return false;
+    ws();
+    return p_ == end_;
+  }
+
+private:
+  template <typename Fn>
+  bool value(Fn& onLeaf, int depth)
+  {
+    if (p_ >= end_) return false;
+    JsonLeaf leaf = {path_, pathLen_, JsonKind::Null, 0.0, nullptr, 0};
+
+    switch (*p_) {
+      case '{': return object(onLeaf, depth + 1);
+      case '[': return array(onLeaf, depth + 1);
+      case '"':
+        leaf.kind = JsonKind::String;
+        if (!string(leaf.str, leaf.strLen)) return false;
+        break;
+      case 't':
+        leaf.kind = JsonKind::Bool;
+        leaf.num = 1.0;
+        if (!literal("true", 4)) return false;
+        break;
+      case 'f':
+        leaf.kind = JsonKind::Bool;
+        if (!literal("false", 5)) return false;
+        break;
+      case 'n':
+        if (!literal("null", 4)) return false;
+        break;
+      default:
+        leaf.kind = JsonKind::Number;
+        if (!number(leaf.num)) return false;
+        break;
+    }
+    onLeaf(leaf);
+    return true;
+  }
+
+  template <typename Fn>
+  bool object(Fn& onLeaf, int depth)
+  {
+    if (depth > kJsonMaxDepth) return false;
+    p_++;
+    ws();
+    if (p_ < end_ && *p_ == '}') { p_++; return true; }
+
+    for (;;) {
+      const char* key;
+      size_t keyLen;
+      if (p_ >= end_ || *p_ != '"' || !string(key, keyLen)) return false;
+      ws();
+      if (p_ >= end_ || *p_ != ':') return false;
+      p_++;
+      ws();
+
+      const size_t saved = pathLen_;
+      if (!pushSegment(key, keyLen) || !value(onLeaf, depth)) return false;
+      pathLen_ = saved;
+
+      ws();
+      if (p_ >= end_) return false;
+      if (*p_ == '}') { p_++; return true; }
+      if (*p_ != ',') return false;
+      p_++;
+      ws();
+    }
+  }
+
+  template <typename Fn>
+  bool array(Fn& onLeaf, int depth)
+  {
+    if (depth > kJsonMaxDepth) return false;
+    p_++;
+    ws();
+    if (p_ < end_ && *p_ == ']') { p_++; return true; }
+
+    for (unsigned idx = 0;; idx++) {
+      char digits[10];
+      size_t n = 0;
+      unsigned v = idx;
+      do { digits[sizeof(digits) - 1 - n++] = (char)('0' + v % 10); v /= 10; } while (v);
+
+      const size_t saved = pathLen_;
+      if (!pushSegment(digits + sizeof(digits) - n, n) || !value(onLeaf, depth)) return false;
+      pathLen_ = saved;
+
+      ws();
+      if (p_ >= end_) return false;
+      if (*p_ == ']') { p_++; return true; }
+      if (*p_ != ',') return false;
+      p_++;
+      ws();
+    }
+  }
+
+  // p_ on the opening quote; out excludes the quotes
+  bool string(const char*& s, size_t& n)
+  {
+    s = ++p_;
+    while (p_ < end_ && *p_ != '"') {
+      if (*p_ == '\\') p_++;
+      p_++;
+    }
+    if (p_ >= end_) return false;
+    n = (size_t)(p_ - s);
+    p_++;
+    return true;
+  }
+
+  bool number(double& v)
+  {
+    auto r = std::from_chars(p_, end_, v);
+    if (r.ec != std::errc()) return false;
+    p_ = r.ptr;
+    return true;
+  }
+
+  bool literal(const char* lit, size_t n)
+  {
+    if ((size_t)(end_ - p_) < n) return false;
+    for (size_t i = 0; i < n; i++) {
+      if (p_[i] != lit[i]) return false;
+    }
+    p_ += n;
+    return true;
+  }
+
+  void ws()
+  {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\r' || *p_ == '\n')) p_++;
+  }
+
+  bool pushSegment(const char* s, size_t n)
+  {
+    const size_t sep = pathLen_ ? 1 : 0;
+    if (pathLen_ + sep + n >= kJsonMaxPath) return false;
+    if (sep) path_[pathLen_++] = '.';
+    for (size_t i = 0; i < n; i++) path_[pathLen_++] = s[i];
+    return true;
+  }
+
+  const char* p_;
+  const char* end_;
+  char path_[kJsonMaxPath];
+  size_t pathLen_ = 0;
+};
@@ -0,0 +1,266 @@
+#include "mqtt_sub.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+uint64_t nowNs()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t putRemainingLength(uint8_t* out, size_t len)
+{
+  size_t n = 0;
+  do {
+    uint8_t b = len % 128;
+    len /= 128;
+    if (len) b |= 0x80;
+    out[n++] = b;
+  } while (len);
+  return n;
+}
+
+size_t putString(uint8_t* out, const char* s)
+{
+  const size_t n = std::strlen(s);
+  out[0] = (uint8_t)(n >> 8);
+  out[1] = (uint8_t)(n & 0xFF);
+  std::memcpy(out + 2, s, n);
+  return n + 2;
+}
+
+}  // namespace
+
+bool mqttTopicMatches(const char* filter, const char* topic, size_t topicLen)
+{
+  const char* t = topic;
+  const char* end = topic + topicLen;
+  while (*filter) {
+    if (*filter == '#') return true;
+    // "a/#" also matches the parent level "a"
+    if (t == end && filter[0] == '/' && filter[1] == '#' && filter[2] == '\0') return true;
+    if (*filter == '+') {
+      while (t < end && *t != '/') t++;
+      filter++;
+    } else {
+      if (t >= end || *t != *filter) return false;
+      t++;
+      filter++;
+    }
+  }
+  return t == end;
+}
+
+bool MqttSubscriber::connect(const char* host, uint16_t port, const char* clientId,
+                             uint16_t keepAliveS, int timeoutMs)
+{
+  char service[8];
+  std::snprintf(service, sizeof(service), "%u", (unsigned)port);
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* res = nullptr;
+  if (getaddrinfo(host, service, &hints, &res) != 0) return false;
+
+  int fd = -1;
+  for (addrinfo* a = res; a; a = a->ai_next) {
+    fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0) continue;
+    if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0) break;
+    ::close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  if (fd < 0) return false;
+
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  int rcvbuf = 4 << 20;   // absorb bursts while decode catches up
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  return attach(fd, clientId, keepAliveS, timeoutMs);
+}
+
+bool MqttSubscriber::attach(int fd, const char* clientId, uint16_t keepAliveS, int timeoutMs)
+{
+  close();
+  if (std::strlen(clientId) > 200) {
+    ::close(fd);
+    return false;
+  }
+  fd_ = fd;
+  buf_.assign(bufSize_, 0);
+  have_ = pos_ = 0;
+  failed_ = false;
+  connAck_ = false;
+  keepAliveNs_ = (uint64_t)keepAliveS * 1000000000ull;
+
+  // CONNECT: protocol "MQTT" level 4, clean session, keepalive, client id
+  uint8_t body[300];
+  size_t b = putString(body, "MQTT");
+  body[b++] = 4;
+  body[b++] = 0x02;
+  body[b++] = (uint8_t)(keepAliveS >> 8);
+  body[b++] = (uint8_t)(keepAliveS & 0xFF);
+  b += putString(body + b, clientId);
+
+  uint8_t pkt[310];
+  size_t n = 0;
+  pkt[n++] = 0x10;
+  n += putRemainingLength(pkt + n, b);
+  std::memcpy(pkt + n, body, b);
+  if (!sendAll(pkt, n + b)) return false;
+
+  const uint64_t deadline = nowNs() + (uint64_t)timeoutMs * 1000000ull;
+  MqttMessage m;
+  while (!connAck_ && !failed_ && nowNs() < deadline) {
+    if (readSome(50) < 0) return false;
+    while (next(m)) {}   // nothing is subscribed yet
+  }
+  return connAck_ && !failed_;
+}
+
+void MqttSubscriber::close()
+{
+  if (fd_ >= 0) {
+    const uint8_t disconnect[2] = {0xE0, 0x00};
+    sendAll(disconnect, sizeof(disconnect));
+    ::close(fd_);
+  }
+  fd_ = -1;
+}
+
+bool MqttSubscriber::subscribe(const char* filter)
+{
+  const size_t fl = std::strlen(filter);
+  if (fl > 1024) return false;
+  uint8_t pkt[1040];
+  const size_t rem = 2 + 2 + fl + 1;
+  size_t n = 0;
+  pkt[n++] = 0x82;
+  n += putRemainingLength(pkt + n, rem);
+  pkt[n++] = (uint8_t)(nextPacketId_ >> 8);
+  pkt[n++] = (uint8_t)(nextPacketId_ & 0xFF);
+  nextPacketId_ = nextPacketId_ == 0xFFFF ? 1 : nextPacketId_ + 1;
+  n += putString(pkt + n, filter);
+  pkt[n++] = 0;   // QoS 0
+  return sendAll(pkt, n);
+}
+
+bool MqttSubscriber::sendAll(const uint8_t* p, size_t n)
+{
+  while (n) {
+    ssize_t w = ::send(fd_, p, n, MSG_NOSIGNAL);
+    if (w <= 0) {
+      failed_ = true;
+      return false;
+    }
+    p += w;
+    n -= (size_t)w;
+  }
+  lastTxNs_ = nowNs();
+  return true;
+}
+
+int MqttSubscriber::readSome(int timeoutMs)
+{
+  if (fd_ < 0 || failed_) return -1;
+
+  if (keepAliveNs_ && nowNs() - lastTxNs_ > keepAliveNs_ / 2) {
+    const uint8_t ping[2] = {0xC0, 0x00};
+    if (!sendAll(ping, sizeof(ping))) return -1;
+  }
+
+  // Drop consumed bytes; views handed out by next() end here
+  if (pos_) {
+    std::memmove(buf_.data(), buf_.data() + pos_, have_ - pos_);
+    have_ -= pos_;
+    pos_ = 0;
+  }
+  if (have_ == buf_.size()) {
+    failed_ = true;   // one packet larger than the buffer
+    return -1;
+  }
+
+  pollfd pfd = {fd_, POLLIN, 0};
+  const int pr = ::poll(&pfd, 1, timeoutMs);
+  if (pr < 0) return -1;
+  if (pr == 0) return 0;
+
+  const ssize_t r = ::read(fd_, buf_.data() + have_, buf_.size() - have_);
+  if (r <= 0) {
+    failed_ = true;
+    return -1;
+  }
+  rxNs_ = nowNs();
+  have_ += (size_t)r;
+  return (int)r;
+}
+
+bool MqttSubscriber::next(MqttMessage& m)
+{
+  for (;;) {
+    const size_t avail = have_ - pos_;
+    if (avail < 2) return false;
+
+    // Fixed header: type/flags, remaining length (1..4 bytes, base 128)
+    size_t rem = 0;
+    size_t i = 1;
+    for (unsigned shift = 0;; shift += 7, i++) {
+      if (i > 4) {
+        failed_ = true;
+        return false;
+      }
+      if (i >= avail) return false;
+      const uint8_t b = buf_[pos_ + i];
+      rem |= (size_t)(b & 0x7F) << shift;
+      if (!(b & 0x80)) break;
+    }
+    const size_t hdr = i + 1;
+    if (avail < hdr + rem) return false;
+
+    const uint8_t first = buf_[pos_];
+    const uint8_t* body = buf_.data() + pos_ + hdr;
+    pos_ += hdr + rem;
+
+    switch (first >> 4) {
+      case 3: {   // PUBLISH
+        if (rem < 2) continue;
+        const size_t tl = ((size_t)body[0] << 8) | body[1];
+        size_t off = 2 + tl;
+        if ((first >> 1) & 0x03) off += 2;   // QoS > 0 carries a packet id
+        if (off > rem) continue;
+        m.topic = (const char*)body + 2;
+        m.topicLen = tl;
+        m.payload = (const char*)body + off;
+        m.len = rem - off;
+        m.rxNs = rxNs_;
+        return true;
+      }
+      case 2:     // CONNACK: return code in byte 2
+        if (rem >= 2 && body[1] == 0) connAck_ = true;
+        else failed_ = true;
+        continue;
+      default:    // SUBACK, PINGRESP, ...
+        continue;
+    }
+  }
+}
+
+size_t MqttSubscriber::backlogBytes() const
+{
+  int kernel = 0;
+  if (fd_ >= 0) ioctl(fd_, FIONREAD, &kernel);
+  return (size_t)kernel + (have_ - pos_);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Minimal MQTT 3.1.1 subscriber (QoS 0, clean session) for the ingest path.
+// One socket, one receive buffer allocated at connect; PUBLISH packets are
+// returned as views into that buffer, so the read -> decode loop never
+// copies or allocates:
+//
+//   while (sub.readSome(100) >= 0)
+//     while (sub.next(m)) ingest(m.topic, m.topicLen, m.payload, m.len);
+//
+// Works against any broker (Mosquitto) or a stand-in on a socketpair
+// (attach()), which is what the benchmark uses.
+
+struct MqttMessage {
+  const char* topic;
+  size_t topicLen;
+  const char* payload;
+  size_t len;
+  uint64_t rxNs;   // steady clock when its bytes were read
+};
+
+// MQTT filter match with '+' and '#' wildcards
+bool mqttTopicMatches(const char* filter, const char* topic, size_t topicLen);
+
+class MqttSubscriber {
+public:
+  explicit MqttSubscriber(size_t bufSize = 256 * 1024) : bufSize_(bufSize) {}
+  ~MqttSubscriber() { close(); }
+  MqttSubscriber(const MqttSubscriber&) = delete;
+  MqttSubscriber& operator=(const MqttSubscriber&) = delete;
+
+  // TCP connect + CONNECT/CONNACK (blocks up to timeoutMs)
+  bool connect(const char* host, uint16_t port, const char* clientId,
+               uint16_t keepAliveS = 30, int timeoutMs = 5000);
+  // Same handshake over an already-connected stream socket
+  bool attach(int fd, const char* clientId, uint16_t keepAliveS = 30, int timeoutMs = 5000);
+  void close();
+
+  bool subscribe(const char* filter);   // QoS 0; SUBACK is consumed by next()
+
+  // Wait up to timeoutMs for data and append what is available to the
+  // buffer (invalidates views from earlier next() calls). Sends PINGREQ when
+  // the keepalive is due. Returns bytes read, 0 on timeout, -1 when closed.
+  int readSome(int timeoutMs);
+
+  // Next complete PUBLISH in the buffer; other packets are handled here.
+  bool next(MqttMessage& m);
+
+  // Bytes received by the kernel or buffered here but not yet decoded
+  size_t backlogBytes() const;
+  bool connected() const { return fd_ >= 0 && !failed_; }
+
+private:
+  bool sendAll(const uint8_t* p, size_t n);
+
+  int fd_ = -1;
+  size_t bufSize_;
+  std::vector<uint8_t> buf_;
+  size_t have_ = 0;   // bytes in buf_
+  size_t pos_ = 0;    // first undecoded byte
+  uint64_t rxNs_ = 0;
+  uint64_t lastTxNs_ = 0;
+  uint64_t keepAliveNs_ = 0;
+  uint16_t nextPacketId_ = 1;
+  bool connAck_ = false;
+  bool failed_ = false;
+};
@@ -0,0 +1,213 @@
+// telemetry_ingest: native MQTT telemetry ingestion (replaces the Node-RED
+// JSON function nodes once a fleet outgrows them)
+//
+// Subscribes to the device telemetry topics, decodes every payload in place
+// (json_scan.h) and appends it to per-device column buffers (columns.h).
+// With -o, a device's rows are appended to DIR/<device>/<field>.f32 every
+// --flush-rows rows and on exit (Ctrl-C). With --store, rows are moved into
+// the time-series store (tsstore.h) every second, keyed by host receive
+// time (device ts_ms is uptime, not wall clock). Replayed rows ("replay":1)
+// are keyed by their original ts mapped to wall time (DeviceClock, ingest.h).
+// The store writes its open blocks every 10 s so other readers see data at
+// most that old.
+//
+// Once per second a JSON metrics line goes to stdout:
+//   {"t_s":..,"msgs_s":..,"mb_s":..,"devices":..,"rows":..,"parse_err":..,
+//    "lag_p50_us":..,"lag_p99_us":..,"lag_max_us":..,"backlog_bytes":..}
+// lag = socket read -> row appended; backlog = bytes received but not yet
+// decoded (kernel socket buffer + our buffer). A backlog that keeps growing
+// means the service is falling behind the broker.
+//
+// Usage:
+//   telemetry_ingest [-h HOST] [-p PORT] [-t FILTER]... [-o DIR] [--flush-rows N]
+//                    [--store DIR]
+// Default filters: device/+/telemetry, tinyml/esp32/telemetry,
+//                  tinyml/esp32/+/telemetry
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -iquote ingest -iquote tsstore -o telemetry_ingest
+//       ingest/telemetry_ingest.cpp ingest/mqtt_sub.cpp ingest/ingest.cpp
+//       ingest/columns.cpp tsstore/tsstore.cpp tsstore/gorilla.cpp
+
+#include "ingest.h"
+#include "mqtt_sub.h"
+#include "tsstore.h"
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+volatile std::sig_atomic_t gStop = 0;
+
+void onSignal(int) { gStop = 1; }
+
+uint64_t steadyNs()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t wallUs()
+{
+  return (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void appendToStore(TsStore& db, const DeviceColumns& d, DeviceClock& clock, std::vector<int64_t>& tMs)
+{
+  clock.rowTimesMs(d, tMs);
+  for (const Column& c : d.columns()) {
+    for (size_t r = 0; r < d.rows(); r++) {
+      if (std::isnan(c.values[r])) continue;
+      db.append(d.id(), c.name, tMs[r], c.values[r]);
+    }
+  }
+}
+
+void usage()
+{
+  std::fprintf(stderr,
+               "usage: telemetry_ingest [-h HOST] [-p PORT] [-t FILTER]... "
+               "[-o DIR] [--flush-rows N] [--store DIR]\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  std::string host = "127.0.0.1";
+  uint16_t port = 1883;
+  std::vector<std::string> filters;
+  std::string outDir;
+  size_t flushRows = 65536;
+  std::string storeDir;
+
+  for (int i = 1; i < argc; i++) {
+    const bool hasArg = i + 1 < argc;
+    if (!std::strcmp(argv[i], "-h") && hasArg) host = argv[++i];
+    else if (!std::strcmp(argv[i], "-p") && hasArg) port = (uint16_t)std::atoi(argv[++i]);
+    else if (!std::strcmp(argv[i], "-t") && hasArg) filters.push_back(argv[++i]);
+    else if (!std::strcmp(argv[i], "-o") && hasArg) outDir = argv[++i];
+    else if (!std::strcmp(argv[i], "--flush-rows") && hasArg) flushRows = std::strtoul(argv[++i], nullptr, 10);
+    else if (!std::strcmp(argv[i], "--store") && hasArg) storeDir = argv[++i];
+    else {
+      usage();
+      return 2;
+    }
+  }
+  if (filters.empty()) {
+    filters = {"device/+/telemetry", "tinyml/esp32/telemetry", "tinyml/esp32/+/telemetry"};
+  }
+  if (flushRows == 0) flushRows = 1;
+
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+
+  TsStore db;
+  if (!storeDir.empty() && !db.open(storeDir)) {
+    std::fprintf(stderr, "[ingest] cannot open store %s\n", storeDir.c_str());
+    return 1;
+  }
+  FleetColumns fleet;
+  std::vector<DeviceClock> clocks;   // by fleet index
+  std::vector<int64_t> rowTimes;
+  auto drain = [&](size_t i) {
+    DeviceColumns& d = fleet.at(i);
+    if (!storeDir.empty()) {
+      if (clocks.size() <= i) clocks.resize(fleet.size());
+      appendToStore(db, d, clocks[i], rowTimes);
+    }
+    if (!outDir.empty()) d.flush(outDir);
+    else d.clear();
+  };
+
+  IngestStats st;
+  MqttSubscriber sub;
+  MqttMessage m;
+  uint32_t backoffMs = 500;
+
+  const uint64_t t0 = steadyNs();
+  uint64_t lastReport = t0;
+  uint64_t lastMsgs = 0, lastBytes = 0;
+  uint64_t lastStoreFlush = t0;
+
+  while (!gStop) {
+    if (!sub.connected()) {
+      if (!sub.connect(host.c_str(), port, "telemetry_ingest")) {
+        std::fprintf(stderr, "[ingest] %s:%u unreachable, retry in %u ms\n",
+                     host.c_str(), (unsigned)port, backoffMs);
+        std::this_thread::sleep_for(std::chrono::milliseconds(backoffMs));
+        backoffMs = backoffMs * 2 > 30000 ? 30000 : backoffMs * 2;
+        continue;
+      }
+      for (const std::string& f : filters) sub.subscribe(f.c_str());
+      std::fprintf(stderr, "[ingest] connected to %s:%u, %zu filters\n",
+                   host.c_str(), (unsigned)port, filters.size());
+      backoffMs = 500;
+    }
+
+    if (sub.readSome(100) < 0) {
+      std::fprintf(stderr, "[ingest] connection lost\n");
+      continue;
+    }
+
+    const int64_t rxUs = wallUs();
+    while (sub.next(m)) {
+      ingestMessage(fleet, st, m.topic, m.topicLen, m.payload, m.len, rxUs);
+      st.lag.add(steadyNs() - m.rxNs);
+    }
+
+    if (!outDir.empty() && storeDir.empty()) {
+      for (size_t i = 0; i < fleet.size(); i++) {
+        if (fleet.at(i).rows() >= flushRows) fleet.at(i).flush(outDir);
+      }
+    }
+
+    const uint64_t now = steadyNs();
+    if (now - lastReport >= 1000000000ull) {
+      if (!storeDir.empty()) {
+        for (size_t i = 0; i < fleet.size(); i++) drain(i);
+        if (now - lastStoreFlush >= 10000000000ull) {
+          db.flush();
+          lastStoreFlush = now;
+        }
+      }
+
+      const double dt = (double)(now - lastReport) * 1e-9;
+      std::printf("{\"t_s\":%.0f,\"msgs_s\":%.0f,\"mb_s\":%.2f,\"devices\":%zu,"
+                  "\"rows\":%llu,\"parse_err\":%llu,\"bad_field\":%llu,\"lag_p50_us\":%.1f,"
+                  "\"lag_p99_us\":%.1f,\"lag_max_us\":%.1f,\"backlog_bytes\":%zu}\n",
+                  (double)(now - t0) * 1e-9,
+                  (double)(st.msgs - lastMsgs) / dt,
+                  (double)(st.bytes - lastBytes) / dt / 1e6,
+                  fleet.size(),
+                  (unsigned long long)st.rows,
+                  (unsigned long long)st.parseErrors,
+                  (unsigned long long)st.badFields,
+                  st.lag.percentileNs(0.50) / 1e3,
+                  st.lag.percentileNs(0.99) / 1e3,
+                  st.lag.maxNs / 1e3,
+                  sub.backlogBytes());
+      std::fflush(stdout);
+      lastReport = now;
+      lastMsgs = st.msgs;
+      lastBytes = st.bytes;
+      st.lag.reset();
+    }
+  }
+
+  if (!outDir.empty() || !storeDir.empty()) {
+    for (size_t i = 0; i < fleet.size(); i++) drain(i);
+    db.close();
+    std::fprintf(stderr, "[ingest] flushed %zu devices\n", fleet.size());
+  }
+  return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+// Host stand-in for Adafruit_MPU6050. getEvent() reads hostImuRead (a bench's
+// synthetic motion); without it the sensor lies flat at 25 degC.
+#include <Adafruit_Sensor.h>
+
+typedef enum { MPU6050_RANGE_2_G, MPU6050_RANGE_4_G, MPU6050_RANGE_8_G, MPU6050_RANGE_16_G } mpu6050_accel_range_t;
+typedef enum { MPU6050_RANGE_250_DEG, MPU6050_RANGE_500_DEG, MPU6050_RANGE_1000_DEG, MPU6050_RANGE_2000_DEG } mpu6050_gyro_range_t;
+typedef enum {
+  MPU6050_BAND_260_HZ, MPU6050_BAND_184_HZ, MPU6050_BAND_94_HZ, MPU6050_BAND_44_HZ,
+  MPU6050_BAND_21_HZ, MPU6050_BAND_10_HZ, MPU6050_BAND_5_HZ
+} mpu6050_bandwidth_t;
+
+struct HostImuSample {
+  float ax, ay, az;   // m/s^2
+  float gx, gy, gz;   // rad/s
+  float tempC;
+};
+
+inline void (*hostImuRead)(HostImuSample& s) = nullptr;
+
+class Adafruit_MPU6050 {
+public:
+  bool begin() { return true; }
+  void setAccelerometerRange(mpu6050_accel_range_t) {}
+  void setGyroRange(mpu6050_gyro_range_t) {}
+  void setFilterBandwidth(mpu6050_bandwidth_t) {}
+
+  bool getEvent(sensors_event_t* a, sensors_event_t* g, sensors_event_t* t)
+  {
+    HostImuSample s = {0.0f, 0.0f, 9.81f, 0.0f, 0.0f, 0.0f, 25.0f};
+    if (hostImuRead) hostImuRead(s);
+    a->acceleration = {s.ax, s.ay, s.az};
+    g->gyro = {s.gx, s.gy, s.gz};
+    t->temperature = s.tempC;
+    return true;
+  }
+};
@@ -0,0 +1,12 @@
+#pragma once
+// Host stand-in for Adafruit_Sensor: the event fields the MPU6050 sketch reads
+
+typedef struct {
+  float x, y, z;
+} sensors_vec_t;
+
+typedef struct {
+  sensors_vec_t acceleration;   // m/s^2
+  sensors_vec_t gyro;           // rad/s
+  float temperature;            // degC
+} sensors_event_t;
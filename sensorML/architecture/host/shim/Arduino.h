@@ -0,0 +1,207 @@
+#pragma once
+// Host stand-in for the Arduino core: just enough for the lab modules
+// (features, inference, controller, sensorml_parser, pipeline, ...) to build
+// and run on Linux, so the server-side engine and the benchmarks run the
+// exact device code. GPIO calls are no-ops; millis()/micros() come from the
+// monotonic clock; String and Print cover the members the modules and the
+// MQTT sketches use; PROGMEM data is ordinary memory. Benches that drive a
+// sketch supply its ADC through hostAnalogRead.
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#define LOW    0
+#define HIGH   1
+#define INPUT  0
+#define OUTPUT 1
+
+#define DEC 10
+#define HEX 16
+
+#define PI 3.1415926535897932384626433832795
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+
+typedef uint8_t byte;
+
+using std::min;
+using std::max;
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int digitalRead(int) { return LOW; }
+
+inline int (*hostAnalogRead)(int pin) = nullptr;
+inline int analogRead(int pin) { return hostAnalogRead ? hostAnalogRead(pin) : 0; }
+inline void analogReadResolution(int) {}
+
+inline long random(long howbig) { return howbig > 0 ? rand() % howbig : 0; }
+inline long random(long lo, long hi) { return hi > lo ? lo + random(hi - lo) : lo; }
+inline void randomSeed(unsigned long seed) { srand((unsigned)seed); }
+
+inline uint32_t micros()
+{
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline uint32_t millis()
+{
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+
+inline uint32_t getCpuFrequencyMhz() { return 240; }
+
+// Cycle counter at 240 MHz from the steady clock; heap figures are fixed
+class EspClass {
+public:
+  uint64_t getEfuseMac() const { return 0x0000A4CF12345678ull; }
+  uint32_t getCycleCount() const
+  {
+    return (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch()).count() * 240 / 1000);
+  }
+  uint32_t getFreeHeap() const { return 200000; }
+  uint32_t getMinFreeHeap() const { return 180000; }
+  uint32_t getMaxAllocHeap() const { return 110000; }
+};
+
+inline EspClass ESP;
+
+class String {
+public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(char c) : s_(1, c) {}
+  String(int v, unsigned char base = DEC) : s_(v < 0 ? "-" + num(0ul - (unsigned long)v, base) : num((unsigned long)v, base)) {}
+  String(unsigned v, unsigned char base = DEC) : s_(num(v, base)) {}
+  String(long v, unsigned char base = DEC) : s_(v < 0 ? "-" + num(0ul - (unsigned long)v, base) : num((unsigned long)v, base)) {}
+  String(unsigned long v, unsigned char base = DEC) : s_(num(v, base)) {}
+  String(double v, unsigned char decimals = 2)
+  {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    s_ = buf;
+  }
+
+  unsigned int length() const { return (unsigned int)s_.size(); }
+  const char* c_str() const { return s_.c_str(); }
+  void reserve(unsigned int n) { s_.reserve(n); }
+
+  String& operator+=(const String& o) { s_ += o.s_; return *this; }
+  String& operator+=(const char* o) { s_ += o; return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  bool concat(const char* p, unsigned int n) { s_.append(p, n); return true; }
+  friend String operator+(String a, const String& b) { return a += b; }
+  friend String operator+(String a, const char* b) { return a += b; }
+  friend String operator+(const char* a, const String& b) { return String(a) += b; }
+  bool operator==(const String& o) const { return s_ == o.s_; }
+  bool operator==(const char* o) const { return s_ == o; }
+  bool operator!=(const String& o) const { return s_ != o.s_; }
+  bool operator!=(const char* o) const { return s_ != o; }
+
+  int indexOf(const String& what, unsigned int from = 0) const
+  {
+    const size_t i = s_.find(what.s_, from);
+    return i == std::string::npos ? -1 : (int)i;
+  }
+  String substring(unsigned int from, unsigned int to) const
+  {
+    String r;
+    if (from < to && from < s_.size()) r.s_ = s_.substr(from, to - from);
+    return r;
+  }
+  void trim()
+  {
+    const size_t b = s_.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) { s_.clear(); return; }
+    s_ = s_.substr(b, s_.find_last_not_of(" \t\r\n") - b + 1);
+  }
+  float toFloat() const { return strtof(s_.c_str(), nullptr); }
+  long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+
+private:
+  // Lower-case digits, like the core's utoa()
+  static std::string num(unsigned long v, unsigned char base)
+  {
+    char buf[72];
+    char* p = buf + sizeof(buf);
+    *--p = '\0';
+    do {
+      const unsigned d = (unsigned)(v % base);
+      *--p = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+      v /= base;
+    } while (v);
+    return p;
+  }
+
+  std::string s_;
+};
+
+class Print;
+
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* b, size_t n)
+  {
+    for (size_t i = 0; i < n; i++) write(b[i]);
+    return n;
+  }
+
+  size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(const String& s) { return print(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v, int base = DEC) { return base == DEC ? printf_("%d", v) : printf_("%X", (unsigned)v); }
+  size_t print(unsigned v, int base = DEC) { return printf_(base == DEC ? "%u" : "%X", v); }
+  size_t print(long v, int base = DEC) { return base == DEC ? printf_("%ld", v) : printf_("%lX", (unsigned long)v); }
+  size_t print(unsigned long v, int base = DEC) { return printf_(base == DEC ? "%lu" : "%lX", v); }
+  size_t print(double v, int digits = 2) { return printf_("%.*f", digits, v); }
+  size_t print(const Printable& x) { return x.printTo(*this); }
+  template <typename T>
+  size_t println(T v) { return print(v) + print("\r\n"); }
+  template <typename T>
+  size_t println(T v, int format) { return print(v, format) + print("\r\n"); }
+  size_t println() { return print("\r\n"); }
+
+private:
+  template <typename... A>
+  size_t printf_(const char* fmt, A... a)
+  {
+    char buf[40];
+    const int n = snprintf(buf, sizeof(buf), fmt, a...);
+    return write((const uint8_t*)buf, n < 0 ? 0 : (size_t)n);
+  }
+};
+
+// Serial on host: stdout, or nowhere when a bench sets out = nullptr
+class HostSerial : public Print {
+public:
+  FILE* out = stdout;
+
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override { return !out ? 1 : fputc(c, out) == EOF ? 0 : 1; }
+  size_t write(const uint8_t* b, size_t n) override { return out ? fwrite(b, 1, n, out) : n; }
+};
+
+inline HostSerial Serial;
@@ -0,0 +1,310 @@
+#pragma once
+// Host stand-in for PubSubClient: the subset the MQTT sketches use, speaking
+// MQTT 3.1.1 (QoS 0, clean session) over a stream socket. It behaves like the
+// library where the sketches depend on it:
+//  - connect() blocks: dial, CONNECT, then wait for CONNACK up to
+//    setSocketTimeout() seconds
+//  - one setBufferSize() buffer bounds both directions; a larger publish
+//    fails and a larger incoming packet is dropped
+//  - loop() handles at most one incoming packet per call and returns false
+//    once the connection is gone
+// The socket comes from hostMqttDial: a TCP connect to setServer()'s
+// host:port, or a stand-in broker installed by a bench.
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST    -3
+#define MQTT_CONNECT_FAILED     -2
+#define MQTT_DISCONNECTED       -1
+#define MQTT_CONNECTED           0
+
+inline int hostTcpDial(const char* host, uint16_t port, int)
+{
+  char service[8];
+  snprintf(service, sizeof(service), "%u", (unsigned)port);
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* res = nullptr;
+  if (getaddrinfo(host, service, &hints, &res) != 0) return -1;
+  int fd = -1;
+  for (addrinfo* a = res; a && fd < 0; a = a->ai_next) {
+    fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd >= 0 && ::connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(res);
+  return fd;
+}
+
+// Returns a connected stream socket or -1 (may block up to timeoutMs)
+inline int (*hostMqttDial)(const char* host, uint16_t port, int timeoutMs) = hostTcpDial;
+
+class PubSubClient {
+public:
+  typedef void (*Callback)(char* topic, uint8_t* payload, unsigned int length);
+
+  explicit PubSubClient(WiFiClient&) { setBufferSize(256); }
+  ~PubSubClient()
+  {
+    closeSocket();
+    free(buf_);
+  }
+
+  PubSubClient& setServer(const char* host, uint16_t port)
+  {
+    host_ = host;
+    port_ = port;
+    return *this;
+  }
+  PubSubClient& setCallback(Callback cb)
+  {
+    callback_ = cb;
+    return *this;
+  }
+  PubSubClient& setSocketTimeout(uint16_t s)
+  {
+    socketTimeoutS_ = s;
+    return *this;
+  }
+  PubSubClient& setKeepAlive(uint16_t s)
+  {
+    keepAliveS_ = s;
+    return *this;
+  }
+  bool setBufferSize(uint16_t n)
+  {
+    uint8_t* b = (uint8_t*)realloc(buf_, n);
+    if (!b) return false;
+    buf_ = b;
+    bufSize_ = n;
+    return true;
+  }
+
+  bool connect(const char* id)
+  {
+    closeSocket();
+    fd_ = hostMqttDial(host_, port_, socketTimeoutS_ * 1000);
+    if (fd_ < 0) {
+      state_ = MQTT_CONNECT_FAILED;
+      return false;
+    }
+
+    // CONNECT: "MQTT" level 4, clean session, keepalive, client id
+    const size_t idLen = strlen(id);
+    size_t n = 5;   // room for the fixed header
+    const size_t start = n;
+    n = putString(n, "MQTT", 4);
+    buf_[n++] = 4;
+    buf_[n++] = 0x02;
+    buf_[n++] = (uint8_t)(keepAliveS_ >> 8);
+    buf_[n++] = (uint8_t)keepAliveS_;
+    n = putString(n, id, idLen);
+    if (!sendPacket(0x10, start, n)) {
+      state_ = MQTT_CONNECT_FAILED;
+      return false;
+    }
+
+    uint8_t type;
+    size_t len;
+    if (!readPacket(socketTimeoutS_ * 1000, type, len)) {
+      closeSocket();
+      state_ = MQTT_CONNECTION_TIMEOUT;
+      return false;
+    }
+    if (type != 2 || len < 2 || buf_[1] != 0) {
+      closeSocket();
+      state_ = len >= 2 ? buf_[1] : MQTT_CONNECT_FAILED;
+      return false;
+    }
+    lastInMs_ = lastOutMs_ = millis();
+    pingOutstanding_ = false;
+    state_ = MQTT_CONNECTED;
+    return true;
+  }
+
+  bool connected() { return fd_ >= 0 && state_ == MQTT_CONNECTED; }
+
+  void disconnect()
+  {
+    if (fd_ >= 0) {
+      const uint8_t pkt[2] = {0xE0, 0x00};
+      ::send(fd_, pkt, 2, MSG_NOSIGNAL);
+    }
+    closeSocket();
+    state_ = MQTT_DISCONNECTED;
+  }
+
+  bool publish(const char* topic, const char* payload, bool retained = false)
+  {
+    return publish(topic, (const uint8_t*)payload, payload ? (unsigned)strlen(payload) : 0, retained);
+  }
+
+  bool publish(const char* topic, const uint8_t* payload, unsigned int len, bool retained = false)
+  {
+    if (!connected()) return false;
+    const size_t tl = strlen(topic);
+    if (5 + 2 + tl + len > bufSize_) return false;
+    size_t n = putString(5, topic, tl);
+    memcpy(buf_ + n, payload, len);
+    return sendPacket(retained ? 0x31 : 0x30, 5, n + len);
+  }
+
+  bool subscribe(const char* topic)
+  {
+    if (!connected()) return false;
+    const size_t tl = strlen(topic);
+    if (5 + 2 + 2 + tl + 1 > bufSize_) return false;
+    size_t n = 5;
+    nextMsgId_ = nextMsgId_ == 0xFFFF ? 1 : nextMsgId_ + 1;
+    buf_[n++] = (uint8_t)(nextMsgId_ >> 8);
+    buf_[n++] = (uint8_t)nextMsgId_;
+    n = putString(n, topic, tl);
+    buf_[n++] = 0;   // QoS 0
+    return sendPacket(0x82, 5, n);
+  }
+
+  bool loop()
+  {
+    if (!connected()) return false;
+    const uint32_t now = millis();
+    const uint32_t keepAliveMs = keepAliveS_ * 1000u;
+    if (keepAliveMs && (now - lastInMs_ > keepAliveMs || now - lastOutMs_ > keepAliveMs)) {
+      if (pingOutstanding_) {
+        lost();
+        return false;
+      }
+      if (!sendPacket(0xC0, 5, 5)) return false;
+      pingOutstanding_ = true;
+    }
+
+    pollfd pfd = {fd_, POLLIN, 0};
+    if (::poll(&pfd, 1, 0) <= 0) return true;
+
+    uint8_t type;
+    size_t len;
+    if (!readPacket(socketTimeoutS_ * 1000, type, len)) return connected();
+    lastInMs_ = millis();
+    if (type == 3 && callback_ && len >= 2) {
+      // Topic is moved down one byte and NUL-terminated in place, as the
+      // library does; the payload follows it
+      const size_t tl = ((size_t)buf_[0] << 8) | buf_[1];
+      if (2 + tl <= len) {
+        memmove(buf_, buf_ + 2, tl);
+        buf_[tl] = '\0';
+        callback_((char*)buf_, buf_ + 2 + tl, (unsigned)(len - 2 - tl));
+      }
+    } else if (type == 12) {   // PINGREQ
+      sendPacket(0xD0, 5, 5);
+    } else if (type == 13) {   // PINGRESP
+      pingOutstanding_ = false;
+    }
+    return connected();
+  }
+
+  int state() const { return state_; }
+
+private:
+  size_t putString(size_t at, const char* s, size_t n)
+  {
+    buf_[at++] = (uint8_t)(n >> 8);
+    buf_[at++] = (uint8_t)n;
+    memcpy(buf_ + at, s, n);
+    return at + n;
+  }
+
+  // The body is at buf_[start, end); the fixed header goes just before it
+  bool sendPacket(uint8_t first, size_t start, size_t end)
+  {
+    uint8_t hdr[5];
+    size_t h = 0;
+    size_t rem = end - start;
+    hdr[h++] = first;
+    do {
+      uint8_t b = rem % 128;
+      rem /= 128;
+      if (rem) b |= 0x80;
+      hdr[h++] = b;
+    } while (rem);
+    memcpy(buf_ + start - h, hdr, h);
+    const uint8_t* p = buf_ + start - h;
+    size_t left = end - start + h;
+    while (left) {
+      const ssize_t w = ::send(fd_, p, left, MSG_NOSIGNAL);
+      if (w <= 0) {
+        lost();
+        return false;
+      }
+      p += w;
+      left -= (size_t)w;
+    }
+    lastOutMs_ = millis();
+    return true;
+  }
+
+  bool readByte(int timeoutMs, uint8_t& b)
+  {
+    pollfd pfd = {fd_, POLLIN, 0};
+    if (::poll(&pfd, 1, timeoutMs) <= 0 || ::read(fd_, &b, 1) != 1) {
+      lost();
+      return false;
+    }
+    return true;
+  }
+
+  // One control packet; its body lands at buf_[0, len). A body larger than
+  // the buffer is read and dropped (type 0).
+  bool readPacket(int timeoutMs, uint8_t& type, size_t& len)
+  {
+    uint8_t first, b;
+    if (!readByte(timeoutMs, first)) return false;
+    len = 0;
+    unsigned shift = 0;
+    do {
+      if (shift > 21 || !readByte(timeoutMs, b)) return false;
+      len |= (size_t)(b & 0x7F) << shift;
+      shift += 7;
+    } while (b & 0x80);
+    type = first >> 4;
+    for (size_t i = 0; i < len; i++) {
+      if (!readByte(timeoutMs, b)) return false;
+      if (i < bufSize_) buf_[i] = b;
+    }
+    if (len > bufSize_) type = 0;
+    return true;
+  }
+
+  void lost()
+  {
+    closeSocket();
+    state_ = MQTT_CONNECTION_LOST;
+  }
+
+  void closeSocket()
+  {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+  }
+
+  const char* host_ = "";
+  uint16_t port_ = 1883;
+  Callback callback_ = nullptr;
+  uint8_t* buf_ = nullptr;
+  size_t bufSize_ = 0;
+  uint16_t socketTimeoutS_ = 15;
+  uint16_t keepAliveS_ = 15;
+  uint16_t nextMsgId_ = 0;
+  int fd_ = -1;
+  int state_ = MQTT_DISCONNECTED;
+  uint32_t lastInMs_ = 0;
+  uint32_t lastOutMs_ = 0;
+  bool pingOutstanding_ = false;
+};
@@ -0,0 +1,55 @@
+#pragma once
+// Host stand-in for the ESP32 WiFi library: the calls the MQTT sketches make.
+// begin() joins at once; a bench takes the access point away with
+// WiFi.apUp = false (status() then reports WL_DISCONNECTED).
+#include <Arduino.h>
+#include <atomic>
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+#define WIFI_STA 1
+
+class IPAddress : public Printable {
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : b_{a, b, c, d} {}
+  uint8_t operator[](int i) const { return b_[i]; }
+  size_t printTo(Print& p) const override
+  {
+    size_t n = 0;
+    for (int i = 0; i < 4; i++) {
+      if (i) n += p.print('.');
+      n += p.print((int)b_[i]);
+    }
+    return n;
+  }
+
+private:
+  uint8_t b_[4];
+};
+
+class WiFiClass {
+public:
+  std::atomic<bool> apUp{true};
+
+  void mode(int) {}
+  void begin(const char*, const char*) { joined_ = true; }
+  void disconnect(bool = false) { joined_ = false; }
+  wl_status_t status() const { return joined_ && apUp ? WL_CONNECTED : WL_DISCONNECTED; }
+  IPAddress localIP() const { return IPAddress(192, 168, 1, 50); }
+  int RSSI() const { return -55; }
+  const char* SSID() const { return "host"; }
+
+private:
+  std::atomic<bool> joined_{false};
+};
+
+inline WiFiClass WiFi;
+
+class WiFiClient {};
@@ -0,0 +1,17 @@
+#pragma once
+// Host stand-in for the Wire (I2C) library: an empty bus. Every address
+// NACKs, so device scans find nothing and reads return no bytes.
+#include <stddef.h>
+#include <stdint.h>
+
+class TwoWire {
+public:
+  bool begin(int = -1, int = -1, uint32_t = 0) { return true; }
+  void beginTransmission(uint8_t) {}
+  size_t write(uint8_t) { return 1; }
+  uint8_t endTransmission(bool = true) { return 2; }   // address NACK
+  uint8_t requestFrom(uint8_t, uint8_t, uint8_t = 1) { return 0; }
+  int read() { return -1; }
+};
+
+inline TwoWire Wire;
@@ -0,0 +1,98 @@
+#pragma once
+// Host stand-in for the ESP-IDF partition API, backed by memory with NOR
+// flash semantics: a write can only clear bits (it ANDs into the old
+// contents), and only an erase sets a 4 KiB sector back to 0xFF.
+// Partitions exist once the host program adds them (hostPartitionAdd).
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+
+typedef enum { ESP_PARTITION_TYPE_APP = 0x00, ESP_PARTITION_TYPE_DATA = 0x01 } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_ANY = 0xff } esp_partition_subtype_t;
+
+struct esp_partition_t {
+  esp_partition_type_t type;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+};
+
+struct HostPartition {
+  esp_partition_t part;
+  std::vector<uint8_t> flash;
+  std::atomic<uint32_t> erases{0};     // sectors erased
+  std::atomic<uint32_t> eraseUs{0};    // time one sector erase takes (sleep)
+};
+
+inline std::vector<HostPartition*>& hostPartitions()
+{
+  static std::vector<HostPartition*> parts;
+  return parts;
+}
+
+// Adds an erased data partition. The host program owns it for the whole run.
+inline HostPartition* hostPartitionAdd(const char* label, uint32_t size)
+{
+  HostPartition* p = new HostPartition;
+  p->part.type = ESP_PARTITION_TYPE_DATA;
+  p->part.address = 0;
+  p->part.size = size;
+  std::strncpy(p->part.label, label, sizeof(p->part.label) - 1);
+  p->part.label[sizeof(p->part.label) - 1] = '\0';
+  p->flash.assign(size, 0xFF);
+  hostPartitions().push_back(p);
+  return p;
+}
+
+inline HostPartition* hostPartition(const esp_partition_t* part)
+{
+  for (HostPartition* p : hostPartitions())
+    if (&p->part == part) return p;
+  return nullptr;
+}
+
+inline const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t,
+                                                       const char* label)
+{
+  for (HostPartition* p : hostPartitions())
+    if (p->part.type == type && (!label || std::strcmp(p->part.label, label) == 0)) return &p->part;
+  return nullptr;
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t* part, size_t off, void* dst, size_t len)
+{
+  if (off + len > part->size) return ESP_ERR_INVALID_SIZE;
+  std::memcpy(dst, hostPartition(part)->flash.data() + off, len);
+  return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t* part, size_t off, const void* src, size_t len)
+{
+  if (off + len > part->size) return ESP_ERR_INVALID_SIZE;
+  uint8_t* d = hostPartition(part)->flash.data() + off;
+  const uint8_t* s = static_cast<const uint8_t*>(src);
+  for (size_t i = 0; i < len; i++) d[i] &= s[i];
+  return ESP_OK;
+}
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t* part, size_t off, size_t len)
+{
+  if (off % 4096 || len % 4096) return ESP_ERR_INVALID_ARG;
+  if (off + len > part->size) return ESP_ERR_INVALID_SIZE;
+  HostPartition* p = hostPartition(part);
+  if (uint32_t us = p->eraseUs.load(std::memory_order_relaxed))
+    std::this_thread::sleep_for(std::chrono::microseconds(us * (len / 4096)));
+  std::memset(p->flash.data() + off, 0xFF, len);
+  p->erases.fetch_add((uint32_t)(len / 4096), std::memory_order_relaxed);
+  return ESP_OK;
+}
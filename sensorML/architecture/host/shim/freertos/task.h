@@ -0,0 +1,56 @@
+#pragma once
+// Host stand-in for FreeRTOS tasks: a task is a detached std::thread (never
+// deleted, like the sketches' forever-loop helpers), direct-to-task
+// notifications are a counter + condition variable, ticks are ms.
+#include "freertos/FreeRTOS.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+struct tskTaskControlBlock {
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t notify = 0;
+};
+typedef tskTaskControlBlock* TaskHandle_t;
+
+inline thread_local TaskHandle_t hostCurrentTask = nullptr;
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char*, uint32_t, void* arg,
+                                          UBaseType_t, TaskHandle_t* out, BaseType_t)
+{
+  TaskHandle_t t = new tskTaskControlBlock;
+  if (out) *out = t;   // set before the task runs, as in FreeRTOS
+  std::thread([t, fn, arg] {
+    hostCurrentTask = t;
+    fn(arg);
+  }).detach();
+  return pdPASS;
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return hostCurrentTask; }
+
+inline void xTaskNotifyGive(TaskHandle_t t)
+{
+  std::lock_guard<std::mutex> lock(t->m);
+  t->notify++;
+  t->cv.notify_one();
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks)
+{
+  TaskHandle_t t = hostCurrentTask;
+  std::unique_lock<std::mutex> lock(t->m);
+  auto ready = [t] { return t->notify != 0; };
+  if (ticks == portMAX_DELAY) t->cv.wait(lock, ready);
+  else t->cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+  const uint32_t v = t->notify;
+  if (v) t->notify = clearOnExit ? 0 : v - 1;
+  return v;
+}
+
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 1024; }
+
+inline void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
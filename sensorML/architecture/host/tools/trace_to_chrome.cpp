@@ -0,0 +1,232 @@
+// trace_to_chrome: trace ring dump (lab/trace.h) -> Chrome trace-event JSON
+//
+// Reads a file or stdin ("-") holding a traceDump() block, either alone or
+// inside a whole Serial capture: lines outside
+// "# trace begin" ... "# trace end", and malformed lines (for example a log
+// line interleaved by another task), are skipped. With several dumps in the
+// capture, --dump N picks one (0 = first), default the last.
+//
+// The JSON opens in ui.perfetto.dev or chrome://tracing:
+//  - one track per task/thread, named from the "# thread" lines
+//  - timestamps in us from the first event; 32-bit device cycle counters
+//    are unwrapped (gaps up to 2^31 cycles between consecutive events)
+//  - an E with no open B on its thread (its B was overwritten in the ring)
+//    is dropped
+//
+// Usage:
+//   trace_to_chrome [--dump N] [-o OUT.json] <capture|->
+//
+// Statistics (events, threads, span, dropped) go to stderr.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Event {
+  uint64_t ts;      // unwrapped ticks
+  uint32_t tid;
+  char phase;
+  std::string name;
+};
+
+struct Dump {
+  uint64_t hz = 0;
+  int wrapBits = 64;
+  uint32_t lost = 0;
+  bool complete = false;
+  std::map<uint32_t, std::string> threadNames;
+  std::vector<Event> events;
+  uint64_t lastRaw = 0;
+  uint32_t malformed = 0;
+};
+
+void appendJsonString(std::string& out, const std::string& s)
+{
+  out += '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    if ((unsigned char)c < 0x20) continue;
+    out += c;
+  }
+  out += '"';
+}
+
+// One line of a dump (the block markers are handled by the caller)
+void parseLine(Dump& d, const char* line)
+{
+  if (!strncmp(line, "# thread,", 9)) {
+    char* end;
+    const unsigned long tid = strtoul(line + 9, &end, 10);
+    if (*end == ',') d.threadNames[(uint32_t)tid] = end + 1;
+    return;
+  }
+  unsigned long long raw;
+  unsigned long tid;
+  char phase;
+  char name[96];
+  if (sscanf(line, "%llu,%lu,%c,%95[^\n]", &raw, &tid, &phase, name) != 4 ||
+      (phase != 'B' && phase != 'E' && phase != 'I')) {
+    d.malformed++;
+    return;
+  }
+
+  uint64_t ts = raw;
+  if (d.wrapBits == 32) {
+    // Signed 32-bit step from the previous event: forward across a wrap, or
+    // slightly backward (the other core's counter)
+    if (d.events.empty()) {
+      ts = raw + (1ull << 32);   // headroom for backward steps
+    } else {
+      const int32_t step = (int32_t)((uint32_t)raw - (uint32_t)d.lastRaw);
+      ts = d.events.back().ts + (int64_t)step;
+    }
+  }
+  d.lastRaw = raw;
+  d.events.push_back({ts, (uint32_t)tid, phase, name});
+}
+
+bool readDumps(FILE* in, std::vector<Dump>& dumps)
+{
+  char line[256];
+  bool inDump = false;
+  while (fgets(line, sizeof(line), in)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    const char* begin = strstr(line, "# trace begin");
+    if (begin) {
+      dumps.emplace_back();
+      Dump& d = dumps.back();
+      const char* p;
+      if ((p = strstr(begin, "hz="))) d.hz = strtoull(p + 3, nullptr, 10);
+      if ((p = strstr(begin, "wrap="))) d.wrapBits = atoi(p + 5);
+      if ((p = strstr(begin, "lost="))) d.lost = (uint32_t)strtoul(p + 5, nullptr, 10);
+      inDump = true;
+      continue;
+    }
+    if (!inDump) continue;
+    if (strstr(line, "# trace end")) {
+      dumps.back().complete = true;
+      inDump = false;
+      continue;
+    }
+    parseLine(dumps.back(), line);
+  }
+  return !dumps.empty();
+}
+
+std::string toChromeJson(const Dump& d, uint32_t& dropped, double& spanUs)
+{
+  // Small track ids (1..N) instead of task handles / thread numbers
+  std::map<uint32_t, int> track;
+  for (const Event& e : d.events) track.emplace(e.tid, 0);
+  for (const auto& t : d.threadNames) track.emplace(t.first, 0);
+  int next = 1;
+  for (auto& t : track) t.second = next++;
+
+  uint64_t tMin = d.events.empty() ? 0 : d.events.front().ts;
+  for (const Event& e : d.events) tMin = e.ts < tMin ? e.ts : tMin;
+  const double usPerTick = 1e6 / (double)(d.hz ? d.hz : 1000000000ull);
+
+  std::string out = "{\"traceEvents\":[\n";
+  out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"sensorml\"}}";
+  for (const auto& t : track) {
+    const auto it = d.threadNames.find(t.first);
+    const std::string name = it != d.threadNames.end() ? it->second : "tid " + std::to_string(t.first);
+    out += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(t.second) +
+           ",\"args\":{\"name\":";
+    appendJsonString(out, name);
+    out += "}}";
+  }
+
+  std::map<uint32_t, int> depth;
+  char num[64];
+  dropped = 0;
+  double lastUs = 0.0;
+  for (const Event& e : d.events) {
+    if (e.phase == 'E') {
+      if (depth[e.tid] == 0) {
+        dropped++;
+        continue;
+      }
+      depth[e.tid]--;
+    } else if (e.phase == 'B') {
+      depth[e.tid]++;
+    }
+    const double us = (double)(e.ts - tMin) * usPerTick;
+    if (us > lastUs) lastUs = us;
+    out += ",\n{\"name\":";
+    appendJsonString(out, e.name);
+    snprintf(num, sizeof(num), ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d", e.phase == 'I' ? 'i' : e.phase,
+             us, track[e.tid]);
+    out += num;
+    if (e.phase == 'I') out += ",\"s\":\"t\"";
+    out += '}';
+  }
+  out += "\n],\"displayTimeUnit\":\"ns\"}\n";
+  spanUs = lastUs;
+  return out;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  const char* inPath = nullptr;
+  const char* outPath = nullptr;
+  int dumpIndex = -1;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-o") && i + 1 < argc) outPath = argv[++i];
+    else if (!strcmp(argv[i], "--dump") && i + 1 < argc) dumpIndex = atoi(argv[++i]);
+    else if (!inPath) inPath = argv[i];
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if (!inPath) {
+    fprintf(stderr, "usage: trace_to_chrome [--dump N] [-o OUT.json] <capture|->\n");
+    return 2;
+  }
+
+  FILE* in = strcmp(inPath, "-") ? fopen(inPath, "r") : stdin;
+  if (!in) {
+    fprintf(stderr, "cannot open %s\n", inPath);
+    return 2;
+  }
+  std::vector<Dump> dumps;
+  const bool found = readDumps(in, dumps);
+  if (in != stdin) fclose(in);
+  if (!found) {
+    fprintf(stderr, "no \"# trace begin\" in %s\n", inPath);
+    return 1;
+  }
+  if (dumpIndex >= (int)dumps.size()) {
+    fprintf(stderr, "only %zu dumps in %s\n", dumps.size(), inPath);
+    return 2;
+  }
+  const Dump& d = dumps[dumpIndex < 0 ? dumps.size() - 1 : (size_t)dumpIndex];
+
+  uint32_t dropped = 0;
+  double spanUs = 0.0;
+  const std::string json = toChromeJson(d, dropped, spanUs);
+
+  FILE* out = outPath ? fopen(outPath, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "cannot open %s\n", outPath);
+    return 2;
+  }
+  fwrite(json.data(), 1, json.size(), out);
+  if (out != stdout) fclose(out);
+
+  fprintf(stderr, "dump %d/%zu%s: %zu events, %zu threads, span %.3f ms, hz=%llu, "
+          "lost in ring %u, unmatched E dropped %u, malformed lines %u\n",
+          dumpIndex < 0 ? (int)dumps.size() - 1 : dumpIndex, dumps.size(),
+          d.complete ? "" : " (no \"# trace end\")", d.events.size(), d.threadNames.size(),
+          spanUs / 1000.0, (unsigned long long)d.hz, d.lost, dropped, d.malformed);
+  return 0;
+}
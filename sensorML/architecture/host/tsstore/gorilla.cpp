@@ -0,0 +1,217 @@
+#include "gorilla.h"
+
+#include <cstring>
+
+namespace {
+
+// MSB-first bit packing; put() takes at most 32 bits at a time
+class BitWriter {
+public:
+  explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+  void put(uint64_t bits, int n)
+  {
+    acc_ = (acc_ << n) | (bits & ((1ull << n) - 1));
+    fill_ += n;
+    while (fill_ >= 8) {
+      fill_ -= 8;
+      out_.push_back((uint8_t)(acc_ >> fill_));
+    }
+    acc_ &= (1ull << fill_) - 1;
+  }
+
+  void put64(uint64_t v)
+  {
+    put(v >> 32, 32);
+    put(v & 0xFFFFFFFFull, 32);
+  }
+
+  void finish()
+  {
+    if (fill_) out_.push_back((uint8_t)(acc_ << (8 - fill_)));
+    acc_ = 0;
+    fill_ = 0;
+  }
+
+private:
+  std::vector<uint8_t>& out_;
+  uint64_t acc_ = 0;
+  int fill_ = 0;
+};
+
+class BitReader {
+public:
+  BitReader(const uint8_t* p, size_t len) : p_(p), bits_(len * 8) {}
+
+  uint64_t get(int n)
+  {
+    if (pos_ + (size_t)n > bits_) {
+      ok_ = false;
+      return 0;
+    }
+    uint64_t v = 0;
+    while (n > 0) {
+      const int off = (int)(pos_ & 7);
+      const int avail = 8 - off;
+      const int take = avail < n ? avail : n;
+      const uint8_t b = p_[pos_ >> 3];
+      v = (v << take) | ((b >> (avail - take)) & ((1u << take) - 1));
+      n -= take;
+      pos_ += (size_t)take;
+    }
+    return v;
+  }
+
+  uint64_t get64()
+  {
+    const uint64_t hi = get(32);
+    return (hi << 32) | get(32);
+  }
+
+  bool ok() const { return ok_; }
+
+private:
+  const uint8_t* p_;
+  size_t bits_;
+  size_t pos_ = 0;
+  bool ok_ = true;
+};
+
+// Delta-of-delta buckets: control prefix, payload width
+struct DodBucket {
+  uint32_t prefix;
+  int prefixBits;
+  int bits;
+};
+
+const DodBucket kDodBuckets[] = {
+  {0x2, 2, 7},    // '10'   [-63, 64]
+  {0x6, 3, 9},    // '110'  [-255, 256]
+  {0xE, 4, 12},   // '1110' [-2047, 2048]
+};
+
+uint32_t floatBits(float f)
+{
+  uint32_t u;
+  std::memcpy(&u, &f, 4);
+  return u;
+}
+
+float bitsFloat(uint32_t u)
+{
+  float f;
+  std::memcpy(&f, &u, 4);
+  return f;
+}
+
+}  // namespace
+
+void gorillaEncode(const int64_t* t, const float* v, uint32_t n, std::vector<uint8_t>& out)
+{
+  if (n == 0) return;
+  BitWriter w(out);
+
+  // Timestamps
+  w.put64((uint64_t)t[0]);
+  int64_t prevDelta = 0;
+  for (uint32_t i = 1; i < n; i++) {
+    const int64_t delta = t[i] - t[i - 1];
+    const int64_t dod = delta - prevDelta;
+    prevDelta = delta;
+
+    if (dod == 0) {
+      w.put(0, 1);
+      continue;
+    }
+    bool done = false;
+    for (const DodBucket& b : kDodBuckets) {
+      const int64_t bias = (1ll << (b.bits - 1)) - 1;
+      if (dod >= -bias && dod <= bias + 1) {
+        w.put(b.prefix, b.prefixBits);
+        w.put((uint64_t)(dod + bias), b.bits);
+        done = true;
+        break;
+      }
+    }
+    if (!done) {
+      w.put(0xF, 4);   // '1111' + raw 64-bit
+      w.put64((uint64_t)dod);
+    }
+  }
+
+  // Values
+  uint32_t prev = floatBits(v[0]);
+  w.put(prev, 32);
+  int prevLz = -1, prevTz = 0;
+  for (uint32_t i = 1; i < n; i++) {
+    const uint32_t cur = floatBits(v[i]);
+    const uint32_t x = cur ^ prev;
+    prev = cur;
+
+    if (x == 0) {
+      w.put(0, 1);
+      continue;
+    }
+    w.put(1, 1);
+    int lz = __builtin_clz(x);
+    const int tz = __builtin_ctz(x);
+    if (lz > 31) lz = 31;
+
+    if (prevLz >= 0 && lz >= prevLz && tz >= prevTz) {
+      // Fits in the previous window
+      w.put(0, 1);
+      w.put(x >> prevTz, 32 - prevLz - prevTz);
+    } else {
+      const int meaningful = 32 - lz - tz;
+      w.put(1, 1);
+      w.put((uint32_t)lz, 5);
+      w.put((uint32_t)(meaningful - 1), 5);
+      w.put(x >> tz, meaningful);
+      prevLz = lz;
+      prevTz = tz;
+    }
+  }
+  w.finish();
+}
+
+bool gorillaDecode(const uint8_t* p, size_t len, uint32_t n, int64_t* t, float* v)
+{
+  if (n == 0) return true;
+  BitReader r(p, len);
+
+  t[0] = (int64_t)r.get64();
+  int64_t prevDelta = 0;
+  for (uint32_t i = 1; i < n; i++) {
+    int64_t dod = 0;
+    if (r.get(1)) {
+      int ones = 1;
+      while (ones < 4 && r.get(1)) ones++;
+      if (ones == 4) {
+        dod = (int64_t)r.get64();
+      } else {
+        const DodBucket& b = kDodBuckets[ones - 1];
+        const int64_t bias = (1ll << (b.bits - 1)) - 1;
+        dod = (int64_t)r.get(b.bits) - bias;
+      }
+    }
+    prevDelta += dod;
+    t[i] = t[i - 1] + prevDelta;
+  }
+
+  uint32_t prev = (uint32_t)r.get(32);
+  v[0] = bitsFloat(prev);
+  int lz = 0, tz = 0;
+  for (uint32_t i = 1; i < n; i++) {
+    if (r.get(1)) {
+      if (r.get(1)) {
+        lz = (int)r.get(5);
+        const int meaningful = (int)r.get(5) + 1;
+        tz = 32 - lz - meaningful;
+      }
+      const int meaningful = 32 - lz - tz;
+      prev ^= (uint32_t)r.get(meaningful) << tz;
+    }
+    v[i] = bitsFloat(prev);
+  }
+  return r.ok();
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Block codec for one series (Gorilla-style, per column):
+//  - timestamps (int64 ms): first value raw, first delta as 32 bits, then
+//    delta-of-delta in variable-width buckets ('0' = same interval), so a
+//    steady 50 Hz stream costs ~1-2 bits per sample
+//  - values (float): XOR with the previous value; '0' = unchanged, otherwise
+//    only the meaningful bits, reusing the previous leading/trailing-zero
+//    window when they fit
+// A block is self-contained (decoding needs only its bytes and count).
+
+void gorillaEncode(const int64_t* t, const float* v, uint32_t n, std::vector<uint8_t>& out);
+
+// Decodes n points from p (len bytes). Returns false if the stream is short.
+bool gorillaDecode(const uint8_t* p, size_t len, uint32_t n, int64_t* t, float* v);
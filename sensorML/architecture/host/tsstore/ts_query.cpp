@@ -0,0 +1,56 @@
+// ts_query: command-line front end of TsStore::query()
+//
+// Prints one JSON array of points, ready for a chart:
+//   [{"t":..,"min":..,"max":..,"mean":..,"n":..},...]
+// and the query statistics (level used, rows read, time) on stderr.
+//
+// Usage:
+//   ts_query ROOT DEVICE FIELD T0_MS T1_MS [RESOLUTION_MS]
+//   ts_query fleet_db device/imu01 accel.z 1767225600000 1767312000000 60000
+// RESOLUTION_MS 0 (default) returns raw points.
+//
+// Build (from sensorML/architecture/host):
+//   g++ -O2 -std=c++17 -iquote tsstore -o ts_query tsstore/ts_query.cpp
+//       tsstore/tsstore.cpp tsstore/gorilla.cpp
+
+#include "tsstore.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char** argv)
+{
+  if (argc < 6) {
+    std::fprintf(stderr, "usage: ts_query ROOT DEVICE FIELD T0_MS T1_MS [RESOLUTION_MS]\n");
+    return 2;
+  }
+  TsStore db;
+  if (!db.open(argv[1])) {
+    std::fprintf(stderr, "cannot open %s\n", argv[1]);
+    return 1;
+  }
+  const int64_t t0 = std::strtoll(argv[4], nullptr, 10);
+  const int64_t t1 = std::strtoll(argv[5], nullptr, 10);
+  const int64_t res = argc > 6 ? std::strtoll(argv[6], nullptr, 10) : 0;
+
+  TsQueryStats st;
+  const auto q0 = std::chrono::steady_clock::now();
+  const std::vector<TsPoint> pts = db.query(argv[2], argv[3], t0, t1, res, &st);
+  const double ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - q0).count();
+
+  std::printf("[");
+  for (size_t i = 0; i < pts.size(); i++) {
+    const TsPoint& p = pts[i];
+    std::printf("%s{\"t\":%lld,\"min\":%g,\"max\":%g,\"mean\":%g,\"n\":%u}",
+                i ? "," : "", (long long)p.t, p.min, p.max, p.mean, p.count);
+  }
+  std::printf("]\n");
+
+  static const char* kLevel[] = {"raw", "1s", "1min", "1h"};
+  std::fprintf(stderr, "%zu points, level=%s, rows_read=%llu, segments=%u, %.3f ms\n",
+               pts.size(), kLevel[st.level], (unsigned long long)st.rowsRead,
+               st.segments, ms);
+  return 0;
+}
@@ -0,0 +1,586 @@
+#include "tsstore.h"
+#include "gorilla.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint32_t kBlockMagic = 0x31425354;   // "TSB1"
+
+struct BlockHeader {
+  uint32_t magic;
+  uint32_t count;
+  int64_t t0;
+  int64_t t1;
+  float min;
+  float max;
+  double sum;
+  uint32_t bytes;   // encoded payload after the header
+  uint32_t pad;
+};
+static_assert(sizeof(BlockHeader) == 48, "on-disk layout");
+static_assert(sizeof(TsRollupRecord) == 32, "on-disk layout");
+
+const char* kRollupFile[kTsRollupLevels] = {"r1s.bin", "r1m.bin", "r1h.bin"};
+const char* kLateFile = "late.tsb";
+
+int64_t floorTo(int64_t t, int64_t step)
+{
+  int64_t q = t / step;
+  if (t % step < 0) q--;
+  return q * step;
+}
+
+std::string sanitize(const std::string& s)
+{
+  std::string o = s;
+  for (char& c : o) {
+    if (c == '/') c = '_';
+  }
+  if (o.empty() || o == "." || o == "..") o.insert(0, "_");
+  return o;
+}
+
+bool safeName(const std::string& s)
+{
+  if (s.empty() || s[0] == '.') return false;
+  for (size_t i = 0; i < s.size(); i++) {
+    const unsigned char c = (unsigned char)s[i];
+    if (c < 0x20 || c == '/' || c == '\\') return false;
+    if (c == '.' && i + 1 < s.size() && s[i + 1] == '.') return false;
+  }
+  return true;
+}
+
+bool appendFile(const std::string& path, const void* p, size_t n)
+{
+  FILE* f = std::fopen(path.c_str(), "ab");
+  if (!f) return false;
+  const bool ok = std::fwrite(p, 1, n, f) == n;
+  std::fclose(f);
+  return ok;
+}
+
+// Segment start times present under a series directory, ascending
+std::vector<int64_t> listSegments(const std::string& dir)
+{
+  std::vector<int64_t> segs;
+  std::error_code ec;
+  for (const auto& e : fs::directory_iterator(dir, ec)) {
+    if (!e.is_directory()) continue;
+    const std::string name = e.path().filename().string();
+    char* end;
+    const long long v = std::strtoll(name.c_str(), &end, 10);
+    if (*end == '\0') segs.push_back(v);
+  }
+  std::sort(segs.begin(), segs.end());
+  return segs;
+}
+
+// Collects points or merges them into aligned buckets
+class Bucketer {
+public:
+  Bucketer(int64_t res, std::vector<TsPoint>& out) : res_(res), out_(out) {}
+
+  void add(int64_t t, float mn, float mx, double sum, uint32_t count)
+  {
+    if (count == 0) return;
+    if (res_ == 0) {
+      out_.push_back({t, mn, mx, (float)(sum / count), count});
+      return;
+    }
+    const int64_t b = floorTo(t, res_);
+    if (!out_.empty() && out_.back().t == b) {
+      TsPoint& p = out_.back();
+      p.min = std::min(p.min, mn);
+      p.max = std::max(p.max, mx);
+      p.count += count;
+      sums_.back() += sum;
+      return;
+    }
+    out_.push_back({b, mn, mx, 0.0f, count});
+    sums_.push_back(sum);
+  }
+
+  void finish()
+  {
+    if (res_ == 0) return;
+    for (size_t i = 0; i < out_.size(); i++) out_[i].mean = (float)(sums_[i] / out_[i].count);
+  }
+
+private:
+  int64_t res_;
+  std::vector<TsPoint>& out_;
+  std::vector<double> sums_;
+};
+
+// Merges b into a, both sorted by t. Raw points (res 0) are interleaved;
+// buckets with the same start are combined.
+void mergePoints(std::vector<TsPoint>& a, const std::vector<TsPoint>& b, int64_t res)
+{
+  if (b.empty()) return;
+  std::vector<TsPoint> out;
+  out.reserve(a.size() + b.size());
+  size_t i = 0, j = 0;
+  while (i < a.size() || j < b.size()) {
+    if (j == b.size() || (i < a.size() && a[i].t < b[j].t)) {
+      out.push_back(a[i++]);
+    } else if (i == a.size() || b[j].t < a[i].t || res == 0) {
+      out.push_back(b[j++]);
+    } else {
+      TsPoint p = a[i++];
+      const TsPoint& q = b[j++];
+      const uint32_t n = p.count + q.count;
+      p.mean = (float)(((double)p.mean * p.count + (double)q.mean * q.count) / n);
+      p.min = std::min(p.min, q.min);
+      p.max = std::max(p.max, q.max);
+      p.count = n;
+      out.push_back(p);
+    }
+  }
+  a.swap(out);
+}
+
+}  // namespace
+
+struct TsStore::Mapping {
+  const uint8_t* p = nullptr;
+  size_t size = 0;
+};
+
+struct TsStore::Series {
+  std::string dir;                     // ROOT/<device>/<field>
+  int64_t segment = LLONG_MIN;         // segment of the open block
+  int64_t lastT = LLONG_MIN;
+  std::vector<int64_t> t;              // open block
+  std::vector<float> v;
+  TsRollupRecord acc[kTsRollupLevels];              // open bucket (count 0: none)
+  std::vector<TsRollupRecord> pending[kTsRollupLevels];   // closed, not written
+  std::vector<std::pair<int64_t, float>> late;            // older than lastT, not written
+  std::vector<uint8_t> scratch;
+};
+
+TsStore::TsStore() = default;
+
+TsStore::~TsStore() { close(); }
+
+bool TsStore::open(const std::string& root)
+{
+  close();
+  std::error_code ec;
+  fs::create_directories(root, ec);
+  if (!fs::is_directory(root)) return false;
+  root_ = root;
+  stats_ = {};
+  return true;
+}
+
+void TsStore::close()
+{
+  for (auto& kv : series_) {
+    Series& s = *kv.second;
+    flushLate(s);
+    if (s.segment == LLONG_MIN) continue;
+    flushBlock(s);
+    flushRollups(s, true);
+  }
+  series_.clear();
+  for (auto& kv : maps_) {
+    if (kv.second->p) munmap((void*)kv.second->p, kv.second->size);
+  }
+  maps_.clear();
+}
+
+TsStore::Series& TsStore::series(const std::string& device, const std::string& field)
+{
+  std::string key = device;
+  key += '\0';
+  key += field;
+  auto it = series_.find(key);
+  if (it != series_.end()) return *it->second;
+
+  auto s = std::make_unique<Series>();
+  s->dir = root_ + "/" + sanitize(device) + "/" + field;
+  s->t.reserve(kTsBlockPoints);
+  s->v.reserve(kTsBlockPoints);
+  for (TsRollupRecord& a : s->acc) a = {};
+
+  // Reopened store: appends continue after the newest block on disk
+  const std::vector<int64_t> segs = listSegments(s->dir);
+  if (!segs.empty()) {
+    const Mapping* m = map(s->dir + "/" + std::to_string(segs.back()) + "/raw.tsb");
+    for (size_t off = 0; m && off + sizeof(BlockHeader) <= m->size;) {
+      BlockHeader h;
+      std::memcpy(&h, m->p + off, sizeof(h));
+      if (h.magic != kBlockMagic || off + sizeof(h) + h.bytes > m->size) break;
+      s->lastT = h.t1;
+      off += sizeof(h) + h.bytes;
+    }
+    s->segment = segs.back();
+  }
+
+  Series& ref = *s;
+  series_.emplace(std::move(key), std::move(s));
+  return ref;
+}
+
+void TsStore::switchSegment(Series& s, int64_t segment)
+{
+  if (s.segment != LLONG_MIN) {
+    flushBlock(s);
+    flushRollups(s, true);
+  }
+  s.segment = segment;
+  std::error_code ec;
+  fs::create_directories(s.dir + "/" + std::to_string(segment), ec);
+}
+
+bool TsStore::append(const std::string& device, const std::string& field, int64_t tMs, float v)
+{
+  if (!safeName(field)) {
+    stats_.badNames++;
+    return false;
+  }
+  Series& s = series(device, field);
+  if (tMs < s.lastT) {
+    s.late.emplace_back(tMs, v);
+    stats_.late++;
+    if (s.late.size() == kTsBlockPoints) flushLate(s);
+    return true;
+  }
+  const int64_t seg = floorTo(tMs, kTsSegmentMs);
+  if (seg != s.segment) switchSegment(s, seg);
+
+  s.t.push_back(tMs);
+  s.v.push_back(v);
+  s.lastT = tMs;
+  stats_.appended++;
+
+  for (int l = 0; l < kTsRollupLevels; l++) {
+    TsRollupRecord& a = s.acc[l];
+    const int64_t b = floorTo(tMs, kTsRollupMs[l]);
+    if (a.count && a.start != b) {
+      s.pending[l].push_back(a);
+      a.count = 0;
+    }
+    if (a.count == 0) {
+      a = {b, v, v, 0.0, 0, 0};
+    }
+    a.min = std::min(a.min, v);
+    a.max = std::max(a.max, v);
+    a.sum += v;
+    a.count++;
+  }
+
+  if (s.t.size() == kTsBlockPoints) {
+    flushBlock(s);
+    flushRollups(s, false);
+  }
+  return true;
+}
+
+bool TsStore::writeBlock(const std::string& path, const int64_t* t, const float* v, uint32_t n,
+                         std::vector<uint8_t>& scratch)
+{
+  BlockHeader h = {};
+  h.magic = kBlockMagic;
+  h.count = n;
+  h.t0 = t[0];
+  h.t1 = t[n - 1];
+  h.min = h.max = v[0];
+  for (uint32_t i = 0; i < n; i++) {
+    h.min = std::min(h.min, v[i]);
+    h.max = std::max(h.max, v[i]);
+    h.sum += v[i];
+  }
+
+  scratch.resize(sizeof(h));
+  gorillaEncode(t, v, n, scratch);
+  h.bytes = (uint32_t)(scratch.size() - sizeof(h));
+  std::memcpy(scratch.data(), &h, sizeof(h));
+
+  if (!appendFile(path, scratch.data(), scratch.size())) return false;
+  stats_.blocksWritten++;
+  stats_.rawBytes += scratch.size();
+  return true;
+}
+
+void TsStore::flushBlock(Series& s)
+{
+  if (s.t.empty()) return;
+  writeBlock(s.dir + "/" + std::to_string(s.segment) + "/raw.tsb", s.t.data(), s.v.data(),
+             (uint32_t)s.t.size(), s.scratch);
+  s.t.clear();
+  s.v.clear();
+}
+
+void TsStore::flushLate(Series& s)
+{
+  if (s.late.empty()) return;
+  // Sorted, so each block is in time order and blocks of one segment are
+  // written together
+  std::stable_sort(s.late.begin(), s.late.end(),
+                   [](const std::pair<int64_t, float>& a, const std::pair<int64_t, float>& b) {
+                     return a.first < b.first;
+                   });
+  std::vector<int64_t> t;
+  std::vector<float> v;
+  for (size_t i = 0; i < s.late.size();) {
+    const int64_t seg = floorTo(s.late[i].first, kTsSegmentMs);
+    const std::string dir = s.dir + "/" + std::to_string(seg);
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    t.clear();
+    v.clear();
+    for (; i < s.late.size() && floorTo(s.late[i].first, kTsSegmentMs) == seg && t.size() < kTsBlockPoints; i++) {
+      t.push_back(s.late[i].first);
+      v.push_back(s.late[i].second);
+    }
+    writeBlock(dir + "/" + kLateFile, t.data(), v.data(), (uint32_t)t.size(), s.scratch);
+  }
+  s.late.clear();
+}
+
+void TsStore::flushRollups(Series& s, bool closeOpen)
+{
+  for (int l = 0; l < kTsRollupLevels; l++) {
+    if (closeOpen && s.acc[l].count) {
+      s.pending[l].push_back(s.acc[l]);
+      s.acc[l].count = 0;
+    }
+    if (s.pending[l].empty()) continue;
+    appendFile(s.dir + "/" + std::to_string(s.segment) + "/" + kRollupFile[l],
+               s.pending[l].data(), s.pending[l].size() * sizeof(TsRollupRecord));
+    s.pending[l].clear();
+  }
+}
+
+void TsStore::flush()
+{
+  for (auto& kv : series_) {
+    Series& s = *kv.second;
+    flushLate(s);
+    if (s.segment == LLONG_MIN) continue;
+    flushBlock(s);
+    flushRollups(s, false);
+  }
+}
+
+const TsStore::Mapping* TsStore::map(const std::string& path)
+{
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0 || st.st_size == 0) return nullptr;
+
+  auto& slot = maps_[path];
+  if (!slot) slot = std::make_unique<Mapping>();
+  Mapping& m = *slot;
+  if (m.p && m.size == (size_t)st.st_size) return &m;
+
+  // Segment files only grow: remap at the new size
+  if (m.p) munmap((void*)m.p, m.size);
+  m.p = nullptr;
+  m.size = 0;
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+  void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) return nullptr;
+  m.p = (const uint8_t*)p;
+  m.size = (size_t)st.st_size;
+  return &m;
+}
+
+void TsStore::scanRaw(Series& s, int64_t t0, int64_t t1, int64_t res,
+                      std::vector<TsPoint>& out, TsQueryStats& st)
+{
+  Bucketer b(res, out);
+  std::vector<int64_t> ts(kTsBlockPoints);
+  std::vector<float> vs(kTsBlockPoints);
+
+  for (int64_t seg : listSegments(s.dir)) {
+    if (seg + kTsSegmentMs <= t0 || seg >= t1) continue;
+    st.segments++;
+    const Mapping* m = map(s.dir + "/" + std::to_string(seg) + "/raw.tsb");
+    for (size_t off = 0; m && off + sizeof(BlockHeader) <= m->size;) {
+      BlockHeader h;
+      std::memcpy(&h, m->p + off, sizeof(h));
+      if (h.magic != kBlockMagic || h.count > kTsBlockPoints ||
+          off + sizeof(h) + h.bytes > m->size) {
+        break;   // torn tail after a crash
+      }
+      const uint8_t* payload = m->p + off + sizeof(h);
+      off += sizeof(h) + h.bytes;
+
+      if (h.t1 < t0 || h.t0 >= t1) {
+        st.blocksSkipped++;
+        continue;
+      }
+      if (!gorillaDecode(payload, h.bytes, h.count, ts.data(), vs.data())) break;
+      st.blocksDecoded++;
+      st.rowsRead += h.count;
+      for (uint32_t i = 0; i < h.count; i++) {
+        if (ts[i] >= t0 && ts[i] < t1) b.add(ts[i], vs[i], vs[i], vs[i], 1);
+      }
+    }
+  }
+
+  // Open block (newest data, not on disk yet)
+  for (size_t i = 0; i < s.t.size(); i++) {
+    if (s.t[i] >= t0 && s.t[i] < t1) b.add(s.t[i], s.v[i], s.v[i], s.v[i], 1);
+  }
+  st.rowsRead += s.t.size();
+  b.finish();
+  scanLate(s, t0, t1, res, out, st);
+}
+
+void TsStore::scanRollup(Series& s, int level, int64_t t0, int64_t t1, int64_t res,
+                         std::vector<TsPoint>& out, TsQueryStats& st)
+{
+  Bucketer b(res, out);
+  const int64_t from = floorTo(t0, res);
+  auto take = [&](const TsRollupRecord& r) {
+    if (r.start >= from && r.start < t1) b.add(r.start, r.min, r.max, r.sum, r.count);
+  };
+
+  for (int64_t seg : listSegments(s.dir)) {
+    if (seg + kTsSegmentMs <= from || seg >= t1) continue;
+    st.segments++;
+    const Mapping* m = map(s.dir + "/" + std::to_string(seg) + "/" + kRollupFile[level]);
+    if (!m) continue;
+    const TsRollupRecord* recs = (const TsRollupRecord*)m->p;
+    const size_t n = m->size / sizeof(TsRollupRecord);
+    const TsRollupRecord* first = std::lower_bound(
+        recs, recs + n, from, [](const TsRollupRecord& r, int64_t t) { return r.start < t; });
+    for (const TsRollupRecord* r = first; r < recs + n && r->start < t1; r++) {
+      take(*r);
+      st.rowsRead++;
+    }
+  }
+
+  for (const TsRollupRecord& r : s.pending[level]) take(r);
+  st.rowsRead += s.pending[level].size();
+  if (s.acc[level].count) {
+    take(s.acc[level]);
+    st.rowsRead++;
+  }
+  b.finish();
+  scanLate(s, from, t1, res, out, st);
+}
+
+// Late points of [t0, t1), from late.tsb and the unwritten buffer, merged
+// into out
+void TsStore::scanLate(Series& s, int64_t t0, int64_t t1, int64_t res,
+                       std::vector<TsPoint>& out, TsQueryStats& st)
+{
+  std::vector<std::pair<int64_t, float>> pts;
+  std::vector<int64_t> ts(kTsBlockPoints);
+  std::vector<float> vs(kTsBlockPoints);
+
+  for (int64_t seg : listSegments(s.dir)) {
+    if (seg + kTsSegmentMs <= t0 || seg >= t1) continue;
+    const Mapping* m = map(s.dir + "/" + std::to_string(seg) + "/" + kLateFile);
+    for (size_t off = 0; m && off + sizeof(BlockHeader) <= m->size;) {
+      BlockHeader h;
+      std::memcpy(&h, m->p + off, sizeof(h));
+      if (h.magic != kBlockMagic || h.count > kTsBlockPoints ||
+          off + sizeof(h) + h.bytes > m->size) {
+        break;
+      }
+      const uint8_t* payload = m->p + off + sizeof(h);
+      off += sizeof(h) + h.bytes;
+
+      if (h.t1 < t0 || h.t0 >= t1) {
+        st.blocksSkipped++;
+        continue;
+      }
+      if (!gorillaDecode(payload, h.bytes, h.count, ts.data(), vs.data())) break;
+      st.blocksDecoded++;
+      st.rowsRead += h.count;
+      for (uint32_t i = 0; i < h.count; i++) {
+        if (ts[i] >= t0 && ts[i] < t1) pts.emplace_back(ts[i], vs[i]);
+      }
+    }
+  }
+  for (const auto& p : s.late) {
+    if (p.first >= t0 && p.first < t1) pts.push_back(p);
+  }
+  st.rowsRead += s.late.size();
+  if (pts.empty()) return;
+
+  std::stable_sort(pts.begin(), pts.end(),
+                   [](const std::pair<int64_t, float>& a, const std::pair<int64_t, float>& b) {
+                     return a.first < b.first;
+                   });
+  std::vector<TsPoint> late;
+  Bucketer b(res, late);
+  for (const auto& p : pts) b.add(p.first, p.second, p.second, p.second, 1);
+  b.finish();
+  mergePoints(out, late, res);
+}
+
+std::vector<TsPoint> TsStore::query(const std::string& device, const std::string& field,
+                                    int64_t t0, int64_t t1, int64_t resolutionMs,
+                                    TsQueryStats* stats)
+{
+  std::vector<TsPoint> out;
+  TsQueryStats st = {};
+  if (!safeName(field)) {
+    if (stats) *stats = st;
+    return out;
+  }
+  Series& s = series(device, field);
+  if (resolutionMs < 0) resolutionMs = 0;
+
+  int level = -1;
+  for (int l = kTsRollupLevels - 1; l >= 0 && resolutionMs > 0; l--) {
+    if (resolutionMs % kTsRollupMs[l] == 0) {
+      level = l;
+      break;
+    }
+  }
+
+  if (level < 0) {
+    st.level = TS_RAW;
+    scanRaw(s, t0, t1, resolutionMs, out, st);
+  } else {
+    st.level = (TsLevel)(TS_1S + level);
+    scanRollup(s, level, t0, t1, resolutionMs, out, st);
+  }
+  if (stats) *stats = st;
+  return out;
+}
+
+void TsStore::dropBefore(int64_t tMs)
+{
+  std::error_code ec;
+  for (const auto& dev : fs::directory_iterator(root_, ec)) {
+    if (!dev.is_directory()) continue;
+    for (const auto& field : fs::directory_iterator(dev.path(), ec)) {
+      if (!field.is_directory()) continue;
+      for (int64_t seg : listSegments(field.path().string())) {
+        if (seg + kTsSegmentMs > tMs) continue;
+        const std::string dir = field.path().string() + "/" + std::to_string(seg);
+        for (auto it = maps_.begin(); it != maps_.end();) {
+          if (it->first.compare(0, dir.size() + 1, dir + "/") == 0) {
+            if (it->second->p) munmap((void*)it->second->p, it->second->size);
+            it = maps_.erase(it);
+          } else {
+            ++it;
+          }
+        }
+        fs::remove_all(dir, ec);
+      }
+    }
+  }
+}
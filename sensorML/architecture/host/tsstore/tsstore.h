@@ -0,0 +1,132 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Append-only columnar time-series store for device telemetry.
+//
+// One series per (device, field), e.g. ("device/imu01", "accel.x"). On disk:
+//   ROOT/<device>/<field>/<dayStartMs>/raw.tsb     compressed blocks
+//                                     /r1s.bin     rollup records, 1 s
+//                                     /r1m.bin     rollup records, 1 min
+//                                     /r1h.bin     rollup records, 1 h
+//                                     /late.tsb    late points
+// ('/' in device ids becomes '_'.)
+//  - Segments are one UTC day of one series, so retention is deleting old
+//    day directories (dropBefore()).
+//  - raw.tsb is a sequence of blocks of up to kTsBlockPoints points: a
+//    fixed header (time range, min/max/sum, byte length) followed by the
+//    Gorilla-coded timestamps and values (gorilla.h). Range scans skip
+//    blocks by header and only decode the ones they touch.
+//  - Rollups (min/max/sum/count per bucket) are maintained while appending
+//    and written as fixed-size records, sorted by bucket start, so a range
+//    query is a binary search plus a sequential read.
+//  - Reads go through read-only mmaps of the segment files; data still
+//    buffered in memory (open block, open buckets) is merged into results.
+// Timestamps are int64 ms (UTC). Points normally arrive in time order per
+// series. A point older than the series' newest one (a device journal
+// replayed after an outage) is late: it is buffered apart, written sorted in
+// blocks of the raw format to its segment's late.tsb, and merged into every
+// query result, raw or bucketed (late points are not in the rollup files).
+
+static constexpr uint32_t kTsBlockPoints = 1024;
+static constexpr int64_t kTsSegmentMs = 86400000;   // one day
+
+enum TsLevel : uint8_t { TS_RAW, TS_1S, TS_1MIN, TS_1H };
+static constexpr int kTsRollupLevels = 3;
+static constexpr int64_t kTsRollupMs[kTsRollupLevels] = {1000, 60000, 3600000};
+
+// One result point. For raw data min == max == mean and count == 1.
+struct TsPoint {
+  int64_t t;      // sample time, or bucket start
+  float min;
+  float max;
+  float mean;
+  uint32_t count;
+};
+
+struct TsQueryStats {
+  TsLevel level;             // data the answer was computed from
+  uint64_t rowsRead;         // raw points decoded or rollup records read
+  uint32_t blocksDecoded;
+  uint32_t blocksSkipped;
+  uint32_t segments;
+};
+
+struct TsStoreStats {
+  uint64_t appended;
+  uint64_t late;             // older than the series' newest point
+  uint64_t badNames;         // refused: unsafe field name
+  uint64_t blocksWritten;
+  uint64_t rawBytes;         // compressed block bytes written (headers incl.)
+};
+
+struct TsRollupRecord {
+  int64_t start;
+  float min;
+  float max;
+  double sum;
+  uint32_t count;
+  uint32_t pad;
+};
+
+class TsStore {
+public:
+  TsStore();
+  ~TsStore();
+  TsStore(const TsStore&) = delete;
+  TsStore& operator=(const TsStore&) = delete;
+
+  bool open(const std::string& root);
+  void close();   // flush() + unmap
+
+  // The field name is a directory name: empty names, names starting with
+  // '.' and names holding "..", '/', '\' or control characters are refused
+  // (false, counted in badNames). '/' in the device name becomes '_'.
+  bool append(const std::string& device, const std::string& field, int64_t tMs, float v);
+
+  // Write open blocks and closed rollup buckets of every series
+  void flush();
+
+  // Points of [t0, t1). resolutionMs 0 returns raw points; otherwise buckets
+  // aligned to multiples of resolutionMs, computed from the coarsest rollup
+  // whose bucket divides it (1 h, 1 min, 1 s) or from raw data when none
+  // does. Buckets are whole: the first one may start before t0.
+  std::vector<TsPoint> query(const std::string& device, const std::string& field,
+                             int64_t t0, int64_t t1, int64_t resolutionMs,
+                             TsQueryStats* stats = nullptr);
+
+  // Delete segments that end at or before tMs (all series)
+  void dropBefore(int64_t tMs);
+
+  const TsStoreStats& stats() const { return stats_; }
+
+private:
+  struct Series;
+  struct Mapping;
+
+  Series& series(const std::string& device, const std::string& field);
+  bool writeBlock(const std::string& path, const int64_t* t, const float* v, uint32_t n,
+                  std::vector<uint8_t>& scratch);
+  void flushBlock(Series& s);
+  void flushLate(Series& s);
+  void flushRollups(Series& s, bool closeOpen);
+  void switchSegment(Series& s, int64_t segment);
+  const Mapping* map(const std::string& path);
+
+  void scanRaw(Series& s, int64_t t0, int64_t t1, int64_t res,
+               std::vector<TsPoint>& out, TsQueryStats& st);
+  void scanRollup(Series& s, int level, int64_t t0, int64_t t1, int64_t res,
+                  std::vector<TsPoint>& out, TsQueryStats& st);
+  void scanLate(Series& s, int64_t t0, int64_t t1, int64_t res,
+                std::vector<TsPoint>& out, TsQueryStats& st);
+
+  std::string root_;
+  std::unordered_map<std::string, std::unique_ptr<Series>> series_;
+  std::map<std::string, std::unique_ptr<Mapping>> maps_;
+  TsStoreStats stats_ = {};
+};
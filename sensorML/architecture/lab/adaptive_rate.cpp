@@ -0,0 +1,78 @@
+#include "adaptive_rate.h"
+#include <math.h>
+
+void AdaptiveRate::begin(const AdaptiveRateConfig& cfg)
+{
+  cfg_ = cfg;
+  if (cfg_.maxHz <= 0.0f) cfg_.maxHz = 1.0f;
+  if (cfg_.minHz <= 0.0f || cfg_.minHz > cfg_.maxHz) cfg_.minHz = cfg_.maxHz;
+  // Strides 1, 2, 4, ... and finally maxHz / minHz (rounded down)
+  maxStride_ = (int)(cfg_.maxHz / cfg_.minHz);
+  if (maxStride_ < 1) maxStride_ = 1;
+  stride_ = 1;
+  quiet_ = 0;
+  sinceWindow_ = 0;
+  jumped_ = false;
+  haveMean_ = false;
+  jumps_ = 0;
+  stepsDown_ = 0;
+}
+
+void AdaptiveRate::setStride(int stride)
+{
+  if (stride > maxStride_) stride = maxStride_;
+  if (stride < 1) stride = 1;
+  stride_ = stride;
+  quiet_ = 0;
+}
+
+bool AdaptiveRate::onSample(float x)
+{
+  sinceWindow_++;
+  if (stride_ == 1 || !haveMean_) return false;
+  if (fabsf(x - lastMean_) <= cfg_.jumpDelta) return false;
+  setStride(1);
+  jumps_++;
+  jumped_ = true;   // run the next full window without waiting for the hop
+  return true;
+}
+
+bool AdaptiveRate::onWindow(const Features& f)
+{
+  lastMean_ = f.mean;
+  haveMean_ = true;
+  sinceWindow_ = 0;
+  jumped_ = false;
+
+  // Window points are on the maxHz grid
+  const float slopePerS = fabsf(f.slope) * cfg_.maxHz;
+
+  if (f.std > cfg_.stdActive || slopePerS > cfg_.slopeActive) {
+    quiet_ = 0;
+    if (stride_ == 1) return false;
+    setStride(1);
+    jumps_++;
+    return true;
+  }
+
+  const bool quiet = f.std < cfg_.stdActive * cfg_.hysteresis &&
+                     slopePerS < cfg_.slopeActive * cfg_.hysteresis;
+  if (!quiet) {
+    quiet_ = 0;
+    return false;
+  }
+  if (++quiet_ < cfg_.quietWindows || stride_ >= maxStride_) return false;
+  setStride(stride_ * 2);
+  stepsDown_++;
+  return true;
+}
+
+void AdaptiveRate::printStatus(Print& out) const
+{
+  out.print("[rate] hz="); out.print(rateHz(), 2);
+  out.print('/'); out.print(cfg_.maxHz, 2);
+  out.print(" stride="); out.print(stride_);
+  out.print(" jumps="); out.print(jumps_);
+  out.print(" steps_down="); out.print(stepsDown_);
+  out.println();
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <Arduino.h>
+
+#include "features.h"
+
+// Activity-driven sampling rate
+// A flat signal sampled at samplingRateHz for hours spends ADC reads,
+// inferences and log/radio traffic on nothing. AdaptiveRate steps the rate
+// between the SensorML maxSamplingRateHz and minSamplingRateHz:
+//  - quiet: window std and |slope| below hysteresis * threshold for
+//    quietWindows windows in a row -> halve the rate (down to minHz)
+//  - active: window std or |slope| above threshold, or a single sample this
+//    far (jumpDelta) from the last window mean -> back to maxHz at once
+//  - in between: hold
+// The window stays on the maxHz grid: at a lower rate every real sample is
+// pushed as stride() linearly interpolated points (pushResampled), so the
+// window always spans the same time and Features (slope per sample in
+// particular) mean the same thing to the model at every rate. The caller
+// still slides it by a fixed hop of grid points, but only runs a window once
+// windowDue(): every `hop` real samples, or right after a jump, so a slow
+// rate means fewer inferences while the window stays full and ready.
+
+struct AdaptiveRateConfig {
+  float minHz = 2.0f;
+  float maxHz = 20.0f;
+  float stdActive = 40.0f;      // uom; window std above this is activity
+  float slopeActive = 200.0f;   // uom per second
+  float jumpDelta = 150.0f;     // uom; one sample this far from the last mean
+  float hysteresis = 0.5f;      // quiet below threshold * hysteresis
+  uint8_t quietWindows = 4;     // quiet windows in a row per step down
+  uint8_t hop = 10;             // real samples per window at any rate
+};
+
+class AdaptiveRate {
+public:
+  void begin(const AdaptiveRateConfig& cfg);
+
+  // Per sample, before it is pushed. True if it jumped back to maxHz; the
+  // sample is still pushed with the stride it was read at.
+  bool onSample(float x);
+  // Gate for running a window once it is full
+  bool windowDue() const { return sinceWindow_ >= cfg_.hop || jumped_; }
+  // Per window (Features on the maxHz grid). True if the rate changed.
+  bool onWindow(const Features& f);
+
+  float rateHz() const { return cfg_.maxHz / (float)stride_; }
+  uint32_t periodUs() const { return (uint32_t)(1000000.0f / rateHz()); }
+  int stride() const { return stride_; }   // window points per real sample
+
+  uint32_t jumps() const { return jumps_; }
+  uint32_t stepsDown() const { return stepsDown_; }
+
+  // [rate] hz=5.00/20.00 stride=4 jumps=... steps_down=...
+  void printStatus(Print& out) const;
+
+private:
+  void setStride(int stride);
+
+  AdaptiveRateConfig cfg_;
+  int stride_ = 1;
+  int maxStride_ = 1;
+  uint8_t quiet_ = 0;
+  uint32_t sinceWindow_ = 0;
+  bool jumped_ = false;
+  bool haveMean_ = false;
+  float lastMean_ = 0.0f;
+  uint32_t jumps_ = 0;
+  uint32_t stepsDown_ = 0;
+};
@@ -0,0 +1,238 @@
+#include "binlog.h"
+#include <string.h>
+
+#define BL_FIELD(rec, member, t) { #member, t, (uint8_t)offsetof(rec, member) }
+
+static const BinlogField kRawFields[] = {
+  BL_FIELD(BinlogRawSample, tsUs, BL_U32),
+  BL_FIELD(BinlogRawSample, raw, BL_I16),
+};
+
+static const BinlogField kLabFeatureFields[] = {
+  BL_FIELD(BinlogLabFeatures, tsMs, BL_U32),
+  BL_FIELD(BinlogLabFeatures, mean, BL_F32),
+  BL_FIELD(BinlogLabFeatures, minv, BL_F32),
+  BL_FIELD(BinlogLabFeatures, maxv, BL_F32),
+  BL_FIELD(BinlogLabFeatures, var, BL_F32),
+  BL_FIELD(BinlogLabFeatures, rms, BL_F32),
+  BL_FIELD(BinlogLabFeatures, slope, BL_F32),
+};
+
+static const BinlogField kPipelineFields[] = {
+  BL_FIELD(BinlogPipelineWin, tsMs, BL_U32),
+  BL_FIELD(BinlogPipelineWin, mean, BL_F32),
+  BL_FIELD(BinlogPipelineWin, std, BL_F32),
+  BL_FIELD(BinlogPipelineWin, minv, BL_F32),
+  BL_FIELD(BinlogPipelineWin, maxv, BL_F32),
+  BL_FIELD(BinlogPipelineWin, slope, BL_F32),
+  BL_FIELD(BinlogPipelineWin, conf, BL_F32),
+  BL_FIELD(BinlogPipelineWin, label, BL_U8),
+  BL_FIELD(BinlogPipelineWin, action, BL_U8),
+};
+
+static const BinlogField kRawAccelFields[] = {
+  BL_FIELD(BinlogRawAccel, tsUs, BL_U32),
+  BL_FIELD(BinlogRawAccel, ax, BL_I16),
+  BL_FIELD(BinlogRawAccel, ay, BL_I16),
+  BL_FIELD(BinlogRawAccel, az, BL_I16),
+};
+
+static const BinlogField kLab05Fields[] = {
+  BL_FIELD(BinlogLab05Scores, tsMs, BL_U32),
+  BL_FIELD(BinlogLab05Scores, mean, BL_F32),
+  BL_FIELD(BinlogLab05Scores, minv, BL_F32),
+  BL_FIELD(BinlogLab05Scores, maxv, BL_F32),
+  BL_FIELD(BinlogLab05Scores, var, BL_F32),
+  BL_FIELD(BinlogLab05Scores, rms, BL_F32),
+  BL_FIELD(BinlogLab05Scores, slope, BL_F32),
+  BL_FIELD(BinlogLab05Scores, score0, BL_F32),
+  BL_FIELD(BinlogLab05Scores, score1, BL_F32),
+  BL_FIELD(BinlogLab05Scores, score2, BL_F32),
+  BL_FIELD(BinlogLab05Scores, pred, BL_U8),
+  BL_FIELD(BinlogLab05Scores, inferUs, BL_U32),
+};
+
+static const BinlogField kLab06Fields[] = {
+  BL_FIELD(BinlogLab06Quant, tsMs, BL_U32),
+  BL_FIELD(BinlogLab06Quant, mean, BL_F32),
+  BL_FIELD(BinlogLab06Quant, minv, BL_F32),
+  BL_FIELD(BinlogLab06Quant, maxv, BL_F32),
+  BL_FIELD(BinlogLab06Quant, var, BL_F32),
+  BL_FIELD(BinlogLab06Quant, rms, BL_F32),
+  BL_FIELD(BinlogLab06Quant, slope, BL_F32),
+  BL_FIELD(BinlogLab06Quant, floatPred, BL_U8),
+  BL_FIELD(BinlogLab06Quant, int8Pred, BL_U8),
+  BL_FIELD(BinlogLab06Quant, floatUs, BL_U32),
+  BL_FIELD(BinlogLab06Quant, int8Us, BL_U32),
+};
+
+static const BinlogField kLab07Fields[] = {
+  BL_FIELD(BinlogLab07Stream, tsMs, BL_U32),
+  BL_FIELD(BinlogLab07Stream, mean, BL_F32),
+  BL_FIELD(BinlogLab07Stream, var, BL_F32),
+  BL_FIELD(BinlogLab07Stream, rms, BL_F32),
+  BL_FIELD(BinlogLab07Stream, slope, BL_F32),
+  BL_FIELD(BinlogLab07Stream, pred, BL_U8),
+  BL_FIELD(BinlogLab07Stream, smoothed, BL_U8),
+  BL_FIELD(BinlogLab07Stream, inferUs, BL_U32),
+};
+
+static const BinlogField kLab08Fields[] = {
+  BL_FIELD(BinlogLab08Activity, tsMs, BL_U32),
+  BL_FIELD(BinlogLab08Activity, rmsx, BL_F32),
+  BL_FIELD(BinlogLab08Activity, rmsy, BL_F32),
+  BL_FIELD(BinlogLab08Activity, rmsz, BL_F32),
+  BL_FIELD(BinlogLab08Activity, magRms, BL_F32),
+  BL_FIELD(BinlogLab08Activity, pred, BL_U8),
+  BL_FIELD(BinlogLab08Activity, smoothed, BL_U8),
+  BL_FIELD(BinlogLab08Activity, inferUs, BL_U32),
+};
+
+static const BinlogField kLab09Fields[] = {
+  BL_FIELD(BinlogLab09Anomaly, tsMs, BL_U32),
+  BL_FIELD(BinlogLab09Anomaly, rms, BL_F32),
+  BL_FIELD(BinlogLab09Anomaly, baselineMean, BL_F32),
+  BL_FIELD(BinlogLab09Anomaly, baselineStd, BL_F32),
+  BL_FIELD(BinlogLab09Anomaly, score, BL_F32),
+  BL_FIELD(BinlogLab09Anomaly, alarm, BL_U8),
+  BL_FIELD(BinlogLab09Anomaly, detect, BL_U8),
+};
+
+static const BinlogField kLab10Fields[] = {
+  BL_FIELD(BinlogLab10Control, tsMs, BL_U32),
+  BL_FIELD(BinlogLab10Control, mean, BL_F32),
+  BL_FIELD(BinlogLab10Control, rms, BL_F32),
+  BL_FIELD(BinlogLab10Control, slope, BL_F32),
+  BL_FIELD(BinlogLab10Control, pred, BL_U8),
+  BL_FIELD(BinlogLab10Control, smoothed, BL_U8),
+  BL_FIELD(BinlogLab10Control, postClass, BL_U8),
+  BL_FIELD(BinlogLab10Control, actState, BL_U8),
+  BL_FIELD(BinlogLab10Control, inferUs, BL_U32),
+};
+
+static const BinlogField kLab11Fields[] = {
+  BL_FIELD(BinlogLab11Cloud, tsMs, BL_U32),
+  BL_FIELD(BinlogLab11Cloud, pred, BL_U8),
+  BL_FIELD(BinlogLab11Cloud, conf, BL_F32),
+  BL_FIELD(BinlogLab11Cloud, inferUs, BL_U32),
+  BL_FIELD(BinlogLab11Cloud, wifi, BL_U8),
+  BL_FIELD(BinlogLab11Cloud, mqtt, BL_U8),
+};
+
+static const BinlogField kLab12Fields[] = {
+  BL_FIELD(BinlogLab12Capstone, tsMs, BL_U32),
+  BL_FIELD(BinlogLab12Capstone, pred, BL_U8),
+  BL_FIELD(BinlogLab12Capstone, stable, BL_U8),
+  BL_FIELD(BinlogLab12Capstone, post, BL_U8),
+  BL_FIELD(BinlogLab12Capstone, act, BL_U8),
+  BL_FIELD(BinlogLab12Capstone, conf, BL_F32),
+  BL_FIELD(BinlogLab12Capstone, confZ, BL_F32),
+  BL_FIELD(BinlogLab12Capstone, anom, BL_U8),
+  BL_FIELD(BinlogLab12Capstone, inferUs, BL_U32),
+  BL_FIELD(BinlogLab12Capstone, wifi, BL_U8),
+  BL_FIELD(BinlogLab12Capstone, mqtt, BL_U8),
+};
+
+#define BL_SCHEMA(id, name, rec, fields) \
+  { id, name, (uint8_t)sizeof(rec), (uint8_t)(sizeof(fields) / sizeof(fields[0])), fields }
+
+static const BinlogSchema kSchemas[] = {
+  BL_SCHEMA(BINLOG_RAW_SAMPLE, "raw_sample", BinlogRawSample, kRawFields),
+  BL_SCHEMA(BINLOG_LAB_FEATURES, "lab_features", BinlogLabFeatures, kLabFeatureFields),
+  BL_SCHEMA(BINLOG_PIPELINE_WIN, "pipeline_window", BinlogPipelineWin, kPipelineFields),
+  BL_SCHEMA(BINLOG_RAW_ACCEL, "raw_accel", BinlogRawAccel, kRawAccelFields),
+  BL_SCHEMA(BINLOG_LAB05_SCORES, "lab05_scores", BinlogLab05Scores, kLab05Fields),
+  BL_SCHEMA(BINLOG_LAB06_QUANT, "lab06_quant", BinlogLab06Quant, kLab06Fields),
+  BL_SCHEMA(BINLOG_LAB07_STREAM, "lab07_stream", BinlogLab07Stream, kLab07Fields),
+  BL_SCHEMA(BINLOG_LAB08_ACTIVITY, "lab08_activity", BinlogLab08Activity, kLab08Fields),
+  BL_SCHEMA(BINLOG_LAB09_ANOMALY, "lab09_anomaly", BinlogLab09Anomaly, kLab09Fields),
+  BL_SCHEMA(BINLOG_LAB10_CONTROL, "lab10_control", BinlogLab10Control, kLab10Fields),
+  BL_SCHEMA(BINLOG_LAB11_CLOUD, "lab11_cloud", BinlogLab11Cloud, kLab11Fields),
+  BL_SCHEMA(BINLOG_LAB12_CAPSTONE, "lab12_capstone", BinlogLab12Capstone, kLab12Fields),
+};
+
+const BinlogSchema* binlogSchema(uint8_t type)
+{
+  for (const BinlogSchema& s : kSchemas) {
+    if (s.type == type) return &s;
+  }
+  return nullptr;
+}
+
+uint16_t binlogCrc16(const uint8_t* data, size_t len)
+{
+  // CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+size_t binlogEncodeFrame(uint8_t type, const void* payload, size_t len,
+                         uint8_t* out, size_t outCap)
+{
+  if (len > kBinlogMaxPayload) return 0;
+
+  // Unencoded frame: type | payload | crc16_le
+  uint8_t raw[1 + kBinlogMaxPayload + 2];
+  raw[0] = type;
+  memcpy(raw + 1, payload, len);
+  uint16_t crc = binlogCrc16(raw, 1 + len);
+  raw[1 + len] = (uint8_t)(crc & 0xFF);
+  raw[2 + len] = (uint8_t)(crc >> 8);
+  const size_t rawLen = 3 + len;
+
+  // COBS: worst case one overhead byte per 254 data bytes, plus delimiter
+  if (outCap < rawLen + rawLen / 254 + 2) return 0;
+
+  size_t codeIdx = 0;
+  size_t o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < rawLen; i++) {
+    if (raw[i] == 0) {
+      out[codeIdx] = code;
+      codeIdx = o++;
+      code = 1;
+    } else {
+      out[o++] = raw[i];
+      if (++code == 0xFF) {
+        out[codeIdx] = code;
+        codeIdx = o++;
+        code = 1;
+      }
+    }
+  }
+  out[codeIdx] = code;
+  out[o++] = 0x00;
+  return o;
+}
+
+bool binlogDecodeFrame(uint8_t* frame, size_t frameLen,
+                       uint8_t& type, const uint8_t*& payload, size_t& len)
+{
+  // In-place COBS decode (output never runs ahead of input)
+  size_t in = 0;
+  size_t o = 0;
+  while (in < frameLen) {
+    uint8_t code = frame[in++];
+    if (code == 0) return false;
+    for (uint8_t k = 1; k < code; k++) {
+      if (in >= frameLen) return false;
+      frame[o++] = frame[in++];
+    }
+    if (code != 0xFF && in < frameLen) frame[o++] = 0;
+  }
+
+  if (o < 3) return false;
+  uint16_t crc = (uint16_t)frame[o - 2] | ((uint16_t)frame[o - 1] << 8);
+  if (binlogCrc16(frame, o - 2) != crc) return false;
+
+  type = frame[0];
+  payload = frame + 1;
+  len = o - 3;
+  return true;
+}
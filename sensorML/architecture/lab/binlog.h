@@ -0,0 +1,162 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Framed binary logging (device -> host over Serial)
+// Frame on the wire:  COBS( type | payload | crc16_le ) 0x00
+//  - type:    record type id (BinlogType)
+//  - payload: packed little-endian record (structs below)
+//  - crc16:   CRC-16/CCITT-FALSE over type + payload
+// COBS removes every 0x00 from the frame, so 0x00 is an unambiguous frame
+// delimiter and a decoder can resync after a lost byte.
+// This header has no Arduino dependency so host tools can share it.
+
+enum BinlogType : uint8_t {
+  BINLOG_RAW_SAMPLE   = 1,   // one ADC sample (raw dataset capture)
+  BINLOG_LAB_FEATURES = 2,   // lab feature vector (mean,min,max,var,rms,slope)
+  BINLOG_PIPELINE_WIN = 3,   // architecture pipeline window (features + decision)
+  BINLOG_RAW_ACCEL    = 4,   // one MPU6050 accel sample (lab-08 raw capture)
+  // One per tinyML lab row, same columns as the lab's CSV line
+  BINLOG_LAB05_SCORES   = 5,
+  BINLOG_LAB06_QUANT    = 6,
+  BINLOG_LAB07_STREAM   = 7,
+  BINLOG_LAB08_ACTIVITY = 8,
+  BINLOG_LAB09_ANOMALY  = 9,
+  BINLOG_LAB10_CONTROL  = 10,
+  BINLOG_LAB11_CLOUD    = 11,
+  BINLOG_LAB12_CAPSTONE = 12
+};
+
+struct __attribute__((packed)) BinlogRawSample {
+  uint32_t tsUs;
+  int16_t raw;
+};
+
+struct __attribute__((packed)) BinlogLabFeatures {
+  uint32_t tsMs;
+  float mean, minv, maxv, var, rms, slope;
+};
+
+struct __attribute__((packed)) BinlogPipelineWin {
+  uint32_t tsMs;
+  float mean, std, minv, maxv, slope;
+  float conf;
+  uint8_t label;    // 0 dark, 1 normal, 2 bright
+  uint8_t action;   // ControlAction
+};
+
+struct __attribute__((packed)) BinlogRawAccel {
+  uint32_t tsUs;
+  int16_t ax, ay, az;
+};
+
+// tinyML lab rows. The labs are standalone sketches and declare their own
+// copy of the record they send; the layouts must stay identical.
+struct __attribute__((packed)) BinlogLab05Scores {
+  uint32_t tsMs;
+  float mean, minv, maxv, var, rms, slope;
+  float score0, score1, score2;
+  uint8_t pred;
+  uint32_t inferUs;
+};
+
+struct __attribute__((packed)) BinlogLab06Quant {
+  uint32_t tsMs;
+  float mean, minv, maxv, var, rms, slope;
+  uint8_t floatPred, int8Pred;
+  uint32_t floatUs, int8Us;
+};
+
+struct __attribute__((packed)) BinlogLab07Stream {
+  uint32_t tsMs;
+  float mean, var, rms, slope;
+  uint8_t pred, smoothed;
+  uint32_t inferUs;
+};
+
+struct __attribute__((packed)) BinlogLab08Activity {
+  uint32_t tsMs;
+  float rmsx, rmsy, rmsz, magRms;
+  uint8_t pred, smoothed;
+  uint32_t inferUs;
+};
+
+struct __attribute__((packed)) BinlogLab09Anomaly {
+  uint32_t tsMs;
+  float rms, baselineMean, baselineStd, score;
+  uint8_t alarm;
+  uint8_t detect;   // 0 TRAIN, 1 DETECT
+};
+
+struct __attribute__((packed)) BinlogLab10Control {
+  uint32_t tsMs;
+  float mean, rms, slope;
+  uint8_t pred, smoothed, postClass, actState;
+  uint32_t inferUs;
+};
+
+struct __attribute__((packed)) BinlogLab11Cloud {
+  uint32_t tsMs;
+  uint8_t pred;
+  float conf;
+  uint32_t inferUs;
+  uint8_t wifi, mqtt;
+};
+
+struct __attribute__((packed)) BinlogLab12Capstone {
+  uint32_t tsMs;
+  uint8_t pred, stable, post, act;
+  float conf, confZ;
+  uint8_t anom;
+  uint32_t inferUs;
+  uint8_t wifi, mqtt;
+};
+
+static constexpr size_t kBinlogMaxPayload = 48;
+// type + payload + crc, plus COBS overhead (1 per 254) and the 0x00 delimiter
+static constexpr size_t kBinlogMaxFrame = 1 + kBinlogMaxPayload + 2 + 2 + 1;
+
+// ---------- Schema (shared by device and host decoder) ----------
+enum BinlogFieldType : uint8_t { BL_U8, BL_I16, BL_U32, BL_F32 };
+
+struct BinlogField {
+  const char* name;
+  uint8_t type;     // BinlogFieldType
+  uint8_t offset;   // byte offset inside the payload
+};
+
+struct BinlogSchema {
+  uint8_t type;
+  const char* name;
+  uint8_t size;     // payload size in bytes
+  uint8_t fieldCount;
+  const BinlogField* fields;
+};
+
+// Schema for a record type, or nullptr if unknown
+const BinlogSchema* binlogSchema(uint8_t type);
+
+uint16_t binlogCrc16(const uint8_t* data, size_t len);
+
+// Build a complete frame (COBS + trailing 0x00) into out.
+// Returns frame length, or 0 if payload/out are too small.
+size_t binlogEncodeFrame(uint8_t type, const void* payload, size_t len,
+                         uint8_t* out, size_t outCap);
+
+// Decode one frame (bytes between delimiters, without the 0x00) in place.
+// On success sets type/payload/len (payload points into frame) and returns
+// true; returns false on COBS or CRC error.
+bool binlogDecodeFrame(uint8_t* frame, size_t frameLen,
+                       uint8_t& type, const uint8_t*& payload, size_t& len);
+
+// Encode + write in one call. Out is any Print-like sink with
+// write(const uint8_t*, size_t) (HardwareSerial on device).
+template <class Out>
+inline bool binlogWrite(Out& out, uint8_t type, const void* payload, size_t len)
+{
+  uint8_t frame[kBinlogMaxFrame];
+  size_t n = binlogEncodeFrame(type, payload, len, frame, sizeof(frame));
+  if (n == 0) return false;
+  out.write(frame, n);
+  return true;
+}
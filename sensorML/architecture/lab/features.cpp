@@ -10,6 +10,15 @@ void initWindow(WindowBuffer& w, int capacity)
   for (int i = 0; i < capacity; i++) w.buf[i] = 0.0f;
 }
 
+void initWindowWith(WindowBuffer& w, float* storage, int capacity)
+{
+  w.capacity = capacity;
+  w.size = 0;
+  w.head = 0;
+  w.buf = storage;
+  for (int i = 0; i < capacity; i++) w.buf[i] = 0.0f;
+}
+
 void pushSample(WindowBuffer& w, float x)
 {
   if (!w.buf) return;
@@ -18,6 +27,18 @@ void pushSample(WindowBuffer& w, float x)
   if (w.size < w.capacity) w.size++;
 }
 
+void pushResampled(WindowBuffer& w, float x, int stride)
+{
+  if (stride <= 1 || w.size == 0) {
+    for (int k = 0; k < (stride > 1 ? stride : 1); k++) pushSample(w, x);
+    return;
+  }
+  const float prev = w.buf[(w.head - 1 + w.capacity) % w.capacity];
+  for (int k = 1; k <= stride; k++) {
+    pushSample(w, prev + (x - prev) * (float)k / (float)stride);
+  }
+}
+
 bool isWindowFull(const WindowBuffer& w)
 {
   return w.size >= w.capacity;
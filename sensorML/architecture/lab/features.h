@@ -17,7 +17,12 @@ struct WindowBuffer {
 };
 
 void initWindow(WindowBuffer& w, int capacity);
+// Same, over caller-owned storage (static buffer or arena; no malloc)
+void initWindowWith(WindowBuffer& w, float* storage, int capacity);
 void pushSample(WindowBuffer& w, float x);
+// Push x as `stride` points, linearly interpolated from the newest sample,
+// so a window kept on a faster grid stays on it (adaptive_rate.h)
+void pushResampled(WindowBuffer& w, float x, int stride);
 bool isWindowFull(const WindowBuffer& w);
 void popOldest(WindowBuffer& w, int n); // slide window by n samples
 
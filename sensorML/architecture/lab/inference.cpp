@@ -1,4 +1,8 @@
 #include "inference.h"
+
+// TFLM on the device, and on host when the CMake build links it
+// (SENSORML_TFLM_DIR defines SENSORML_HOST_TFLM)
+#if defined(ARDUINO) || defined(SENSORML_HOST_TFLM)
 #include "model.h"
 
 // Try common TFLM include paths.
@@ -51,6 +55,38 @@ TinyMLStatus TinyML::begin()
   return TINYML_OK;
 }
 
+size_t TinyML::arenaUsedBytes() const
+{
+  return g_interpreter ? g_interpreter->arena_used_bytes() : 0;
+}
+
+size_t TinyML::arenaSizeBytes()
+{
+  return kArenaSize;
+}
+
+#else
+
+// Host build without TFLM (server-side engine, benchmarks): infer() takes
+// the same fallback path as a device without a valid model.
+TinyMLStatus TinyML::begin()
+{
+  ready_ = false;
+  return TINYML_MODEL_INVALID;
+}
+
+size_t TinyML::arenaUsedBytes() const
+{
+  return 0;
+}
+
+size_t TinyML::arenaSizeBytes()
+{
+  return 0;
+}
+
+#endif
+
 static InferenceResult makeResult(const float p0, const float p1, const float p2)
 {
   InferenceResult r;
@@ -69,6 +105,7 @@ static InferenceResult makeResult(const float p0, const float p1, const float p2
 InferenceResult TinyML::infer(const Features& f)
 {
   if (!ready_) return fallbackClassify(f);
+#if defined(ARDUINO) || defined(SENSORML_HOST_TFLM)
 
   // Fill input features: mean, std, min, max, slope
   g_input->data.f[0] = f.mean;
@@ -87,6 +124,9 @@ InferenceResult TinyML::infer(const Features& f)
   float p2 = g_output->data.f[2];
 
   return makeResult(p0, p1, p2);
+#else
+  return fallbackClassify(f);
+#endif
 }
 
 InferenceResult fallbackClassify(const Features& f)
@@ -21,6 +21,10 @@ public:
   bool isReady() const { return ready_; }
   InferenceResult infer(const Features& f);
 
+  // TFLM tensor arena: bytes AllocateTensors() used / reserved (0 without TFLM)
+  size_t arenaUsedBytes() const;
+  static size_t arenaSizeBytes();
+
 private:
   bool ready_ = false;
 };
@@ -0,0 +1,69 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Scheduling-jitter histogram
+// One set of buckets for PeriodicTask (how late a run started) and Pipeline
+// (|actual - scheduled| sample time), so [sched] and [pipe] lines and the
+// host benches compare like with like.
+//  - JitterHist: plain counters, for code that runs on one task, and the
+//    snapshot type both metrics structs carry
+//  - AtomicJitterHist: the same counters, written by one task and read from
+//    any other (relaxed: each counter is exact, a snapshot is not a cut)
+
+static constexpr int kJitterBuckets = 8;
+
+// Upper bounds (us) of the buckets; the last one is open-ended
+static constexpr uint32_t kJitterBoundsUs[kJitterBuckets - 1] = {
+  50, 100, 200, 500, 1000, 2000, 5000
+};
+
+inline int jitterBucket(uint32_t us)
+{
+  int b = 0;
+  while (b < kJitterBuckets - 1 && us >= kJitterBoundsUs[b]) b++;
+  return b;
+}
+
+struct JitterHist {
+  uint32_t maxUs = 0;
+  uint32_t counts[kJitterBuckets] = {};
+
+  void add(uint32_t us)
+  {
+    counts[jitterBucket(us)]++;
+    if (us > maxUs) maxUs = us;
+  }
+
+  void reset() { *this = JitterHist(); }
+
+  // jitter_max_us=... jitter_hist=a/b/.../h
+  void print(Print& out) const
+  {
+    out.print(" jitter_max_us="); out.print(maxUs);
+    out.print(" jitter_hist=");
+    for (int i = 0; i < kJitterBuckets; i++) {
+      if (i) out.print('/');
+      out.print(counts[i]);
+    }
+  }
+};
+
+struct AtomicJitterHist {
+  std::atomic<uint32_t> maxUs{0};
+  std::atomic<uint32_t> counts[kJitterBuckets] = {};
+
+  void add(uint32_t us)
+  {
+    counts[jitterBucket(us)].fetch_add(1, std::memory_order_relaxed);
+    if (us > maxUs.load(std::memory_order_relaxed)) maxUs.store(us, std::memory_order_relaxed);
+  }
+
+  JitterHist snapshot() const
+  {
+    JitterHist h;
+    h.maxUs = maxUs.load(std::memory_order_relaxed);
+    for (int i = 0; i < kJitterBuckets; i++) h.counts[i] = counts[i].load(std::memory_order_relaxed);
+    return h;
+  }
+};
@@ -0,0 +1,157 @@
+#include "log_ring.h"
+#include "mem_stats.h"
+#include "trace.h"
+#include <atomic>
+
+#if defined(ARDUINO)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+// Power of two so indices wrap with a mask
+static constexpr uint32_t kLogCapacity = 64;
+static constexpr uint32_t kLogMask = kLogCapacity - 1;
+
+static LogRecord g_ring[kLogCapacity];
+static std::atomic<uint32_t> g_head{0};    // written by producer
+static std::atomic<uint32_t> g_tail{0};    // written by consumer
+static std::atomic<uint32_t> g_dropped{0};
+static std::atomic<LogReportFn> g_report{nullptr};   // cleared by the drainer once printed
+
+bool logPush(uint32_t tsMs, uint8_t stage, const LogFormat* fmt, const char* tag,
+             const float* values, int count)
+{
+  const uint32_t head = g_head.load(std::memory_order_relaxed);
+  const uint32_t tail = g_tail.load(std::memory_order_acquire);
+  if (head - tail >= kLogCapacity) {
+    g_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (count > kLogMaxValues) count = kLogMaxValues;
+  if (count < 0) count = 0;
+
+  LogRecord& r = g_ring[head & kLogMask];
+  r.tsMs = tsMs;
+  r.stage = stage;
+  r.count = (uint8_t)count;
+  r.fmt = fmt;
+  r.tag = tag;
+  for (int i = 0; i < count; i++) r.v[i] = values[i];
+
+  g_head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+static void formatTag(Print& out, const LogRecord& r)
+{
+  out.print(' ');
+  if (r.fmt && r.fmt->tagKey) {
+    out.print(r.fmt->tagKey);
+    out.print('=');
+  }
+  out.print(r.tag);
+}
+
+static void formatRecord(Print& out, const LogRecord& r)
+{
+  const int tagAt = r.fmt ? r.fmt->tagAt : kLogMaxValues;
+  out.print(r.tsMs);
+  for (int i = 0; i < r.count; i++) {
+    if (r.tag && i == tagAt) formatTag(out, r);
+    out.print(' ');
+    if (r.fmt && r.fmt->keys[i]) {
+      out.print(r.fmt->keys[i]);
+      out.print('=');
+    }
+    out.print(r.v[i], r.fmt ? r.fmt->decimals[i] : 3);
+  }
+  if (r.tag && tagAt >= r.count) formatTag(out, r);
+  out.println();
+}
+
+int logDrain(Print& out, int maxRecords)
+{
+  static uint32_t reportedDrops = 0;
+
+  int n = 0;
+  uint32_t tail = g_tail.load(std::memory_order_relaxed);
+  while (n < maxRecords) {
+    const uint32_t head = g_head.load(std::memory_order_acquire);
+    if (tail == head) break;
+
+    TRACE_BEGIN("log_write");
+    formatRecord(out, g_ring[tail & kLogMask]);
+    TRACE_END("log_write");
+    tail++;
+    g_tail.store(tail, std::memory_order_release);
+    n++;
+  }
+
+  const uint32_t drops = g_dropped.load(std::memory_order_relaxed);
+  if (drops != reportedDrops) {
+    out.print("[log] dropped="); out.println(drops);
+    reportedDrops = drops;
+  }
+
+  if (LogReportFn report = g_report.load(std::memory_order_acquire)) {
+    TRACE_SCOPE("log_report");
+    report(out);
+    g_report.store(nullptr, std::memory_order_release);
+  }
+  return n;
+}
+
+uint32_t logDropped()
+{
+  return g_dropped.load(std::memory_order_relaxed);
+}
+
+bool logReportIdle()
+{
+  return g_report.load(std::memory_order_acquire) == nullptr;
+}
+
+void logRequestReport(LogReportFn fn)
+{
+  LogReportFn idle = nullptr;
+  g_report.compare_exchange_strong(idle, fn, std::memory_order_release, std::memory_order_relaxed);
+}
+
+#if defined(ARDUINO)
+
+static void drainTask(void* arg)
+{
+  Print* out = static_cast<Print*>(arg);
+  TRACE_THREAD("logDrain");
+  memWatchTask("logDrain");
+  for (;;) {
+    if (logDrain(*out, 8) == 0) vTaskDelay(pdMS_TO_TICKS(5));
+  }
+}
+
+void logStartDrainer(Print& out, int core)
+{
+  // arduino-esp32 runs loopTask at priority 1, so the drainer sits at idle
+  // priority, below it: on loop()'s core it runs only while loop() blocks,
+  // and unpinned it mostly runs on the other core, beside the idle task
+  xTaskCreatePinnedToCore(drainTask, "logDrain", 4096, &out, tskIDLE_PRIORITY, nullptr,
+                          core < 0 ? tskNO_AFFINITY : core);
+}
+
+#else
+
+void logStartDrainer(Print& out, int)
+{
+  std::thread([&out] {
+    TRACE_THREAD("logDrain");
+    for (;;) {
+      if (logDrain(out, 8) == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  }).detach();
+}
+
+#endif
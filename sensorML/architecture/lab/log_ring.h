@@ -0,0 +1,62 @@
+#pragma once
+#include <Arduino.h>
+
+// Asynchronous log ring
+// The control path enqueues a small binary record (never blocks, never
+// formats). A low-priority drainer formats records and writes them to
+// Serial/Print off the control path.
+// Single producer (control path) / single consumer (drainer), lock-free.
+
+enum LogStage : uint8_t {
+  LOG_STAGE_SAMPLE   = 0,
+  LOG_STAGE_FEATURES = 1,
+  LOG_STAGE_INFER    = 2,
+  LOG_STAGE_CONTROL  = 3
+};
+
+static constexpr int kLogMaxValues = 6;
+
+// Static description of a record layout: key names + decimals per value.
+// Must outlive the ring (use static const objects).
+// A line is "<tsMs> key=value key=value ...". A key may carry its own
+// separator (e.g. "| action"), which is printed as is.
+struct LogFormat {
+  const char* keys[kLogMaxValues];
+  uint8_t decimals[kLogMaxValues];
+  const char* tagKey;   // printed as tagKey=tag when the record has a tag
+  uint8_t tagAt;        // the tag goes before value tagAt (>= count: last)
+};
+
+struct LogRecord {
+  uint32_t tsMs;
+  uint8_t stage;
+  uint8_t count;              // number of valid values
+  const LogFormat* fmt;
+  const char* tag;            // static string only (e.g. class label)
+  float v[kLogMaxValues];
+};
+
+// Enqueue one record stamped tsMs: the time of the event it describes (a
+// sample or window time), not the time it is logged. Returns false (and
+// counts a drop) if the ring is full.
+bool logPush(uint32_t tsMs, uint8_t stage, const LogFormat* fmt, const char* tag,
+             const float* values, int count);
+
+// Format and write up to maxRecords pending records. Returns records written.
+int logDrain(Print& out, int maxRecords);
+
+// Records dropped because the ring was full (since boot)
+uint32_t logDropped();
+
+// Reports (metrics, trace dumps) are printed by the drainer too, between
+// log lines, so Serial has a single writer. The caller fills whatever fn
+// prints, then requests it; it may refill that data once logReportIdle()
+// is true again (fn has returned).
+typedef void (*LogReportFn)(Print& out);
+bool logReportIdle();
+// Ignored while the previous report is pending or running
+void logRequestReport(LogReportFn fn);
+
+// Start the background drainer (idle-priority task on ESP32, thread on host).
+// core: ESP32 core to pin the task to, -1 for any (ignored on host)
+void logStartDrainer(Print& out, int core = -1);
@@ -4,6 +4,13 @@
 #include "features.h"
 #include "inference.h"
 #include "controller.h"
+#include "log_ring.h"
+#include "binlog.h"
+#include "pipeline.h"
+#include "periodic.h"
+#include "adaptive_rate.h"
+#include "mem_stats.h"
+#include "trace.h"
 
 // ---------- Sensor wiring ----------
 static const int PIN_LDR = 34;     // ADC1 (ESP32 DevKit)
@@ -23,6 +30,8 @@ static const char kSensorML[] PROGMEM = R"XML(
             <offset>0.0</offset>
           </calibration>
           <samplingRateHz>20</samplingRateHz>
+          <minSamplingRateHz>2</minSamplingRateHz>
+          <maxSamplingRateHz>20</maxSamplingRateHz>
           <uncertainty>0.05</uncertainty>
         </output>
       </outputs>
@@ -31,15 +40,80 @@ static const char kSensorML[] PROGMEM = R"XML(
 </SensorML>
 )XML";
 
+// ---------- Log layout (formatted by the drainer, not the control path) ----------
+// "<ts> mean=.. std=.. slope=.. | class=.. conf=.. | action=.."
+static const LogFormat kInferLog = {
+  {"mean", "std", "slope", "conf", "| action", nullptr},
+  {2, 2, 4, 3, 0, 0},
+  "| class",
+  3
+};
+
+// Binary log: emit one COBS/CRC frame per window instead of text lines.
+// Decode on the host with host/tools/binlog_decode.
+static const bool kLogBinary = false;
+
+// Dual-task mode: sampler and inference run as FreeRTOS tasks (pipeline.h)
+// and loop() only reports metrics; logging is drained on core 0.
+// false keeps the single loop() below.
+static const bool kPipelined = false;
+static const unsigned long kMetricsPeriodMs = 5000;
+
+// Adaptive sampling (loop() mode): the rate drops towards minSamplingRateHz
+// while the light level is flat and returns to maxSamplingRateHz on activity
+// (adaptive_rate.h). false samples at samplingRateHz throughout.
+static const bool kAdaptiveRate = false;
+
+// Execution trace: build with -DSENSORML_TRACE, send 't' on Serial to dump
+// the ring, convert with host/tools/trace_to_chrome (trace.h)
+
+static uint8_t labelIndex(const char* label)
+{
+  if (label[0] == 'd') return 0;   // dark
+  if (label[0] == 'n') return 1;   // normal
+  return 2;                        // bright
+}
+
 // ---------- Global state ----------
 SensorConfig g_cfg;
 WindowBuffer g_win;
 TinyML g_ml;
 Controller g_ctrl;
+Pipeline g_pipe;
+
+// sampling timing: fixed grid at samplingRateHz (periodic.h); a late loop()
+// pass runs missed samples back to back (up to 2), older ones are skipped
+PeriodicTask g_sampleTask;
+static const PeriodicPolicy kSamplePolicy = PERIODIC_CATCH_UP;
+unsigned long g_samplePeriodUs = 50000; // default 20 Hz
+AdaptiveRate g_rate;
 
-// sampling timing
-unsigned long g_lastSampleMs = 0;
-unsigned long g_samplePeriodMs = 50; // default 20 Hz
+// Reports go through the log drainer (log_ring.h), so loop() never writes
+// Serial itself. loop() fills this snapshot while the drainer is idle.
+static struct {
+  bool metrics;
+  bool trace;
+  uint32_t nowUs;
+  MemStats mem;
+  PeriodicTask sample;   // copies, as of nowUs
+  AdaptiveRate rate;
+} g_report;
+
+static void printReport(Print& out)
+{
+  if (g_report.metrics) {
+    memPrint(out, g_report.mem);
+    if (kPipelined) {
+      g_pipe.printMetrics(out);   // counters are atomics
+    } else {
+      g_report.sample.printMetrics(out, "sample", g_report.nowUs);
+      if (kAdaptiveRate) g_report.rate.printStatus(out);
+    }
+  }
+#if defined(SENSORML_TRACE)
+  if (g_report.trace) traceDump(out);
+#endif
+}
 
 static float readLdrAdc()
 {
@@ -48,10 +122,34 @@ static float readLdrAdc()
   return (float)raw;
 }
 
+static void logWindow(uint32_t tMs, const Features& f, const InferenceResult& r, ControlAction a)
+{
+  if (kLogBinary) {
+    // ~35 bytes per window; fits the UART TX FIFO, no formatting
+    BinlogPipelineWin rec = {
+      tMs, f.mean, f.std, f.minv, f.maxv, f.slope,
+      r.confidence, labelIndex(r.label), (uint8_t)a
+    };
+    binlogWrite(Serial, BINLOG_PIPELINE_WIN, &rec, sizeof(rec));
+  } else {
+    // log (enqueue only; never blocks the sampling loop)
+    const float logv[] = {f.mean, f.std, f.slope, r.confidence, (float)a};
+    logPush(tMs, LOG_STAGE_INFER, &kInferLog, r.label, logv, 5);
+  }
+}
+
+// Pipelined mode: called on the worker task for every window
+static void onPipelineWindow(const PipelineWindow& w)
+{
+  logWindow(w.tUs / 1000, w.f, w.r, w.action);
+}
+
 void setup()
 {
   Serial.begin(115200);
   delay(200);
+  TRACE_THREAD("loop");
+  memWatchTask("loop");
 
   pinMode(PIN_LED, OUTPUT);
   digitalWrite(PIN_LED, LOW);
@@ -64,10 +162,20 @@ void setup()
     g_cfg.scale = 1.0f;
     g_cfg.offset = 0.0f;
     g_cfg.samplingRateHz = 20.0f;
+    g_cfg.minSamplingRateHz = 20.0f;
+    g_cfg.maxSamplingRateHz = 20.0f;
     g_cfg.uncertainty = 0.05f;
   }
 
-  g_samplePeriodMs = (unsigned long)(1000.0f / max(1.0f, g_cfg.samplingRateHz));
+  g_samplePeriodUs = (unsigned long)(1000000.0f / max(1.0f, g_cfg.samplingRateHz));
+  if (kAdaptiveRate && !kPipelined) {
+    // LDR thresholds (adc_counts) are the AdaptiveRateConfig defaults
+    AdaptiveRateConfig ac;
+    ac.minHz = g_cfg.minSamplingRateHz;
+    ac.maxHz = g_cfg.maxSamplingRateHz;
+    g_rate.begin(ac);
+    g_samplePeriodUs = g_rate.periodUs();
+  }
 
   Serial.println("==== SensorML Config ====");
   Serial.print("id: "); Serial.println(g_cfg.identifier);
@@ -75,8 +183,10 @@ void setup()
   Serial.print("scale: "); Serial.println(g_cfg.scale, 6);
   Serial.print("offset: "); Serial.println(g_cfg.offset, 6);
   Serial.print("samplingRateHz: "); Serial.println(g_cfg.samplingRateHz, 2);
+  Serial.print("adaptive range Hz: "); Serial.print(g_cfg.minSamplingRateHz, 2);
+  Serial.print(".."); Serial.println(g_cfg.maxSamplingRateHz, 2);
   Serial.print("uncertainty: "); Serial.println(g_cfg.uncertainty, 4);
-  Serial.print("samplePeriodMs: "); Serial.println(g_samplePeriodMs);
+  Serial.print("samplePeriodUs: "); Serial.println(g_samplePeriodUs);
 
   // Init window buffer
   initWindow(g_win, 40);  // 40 samples @ 20Hz ≈ 2 seconds
@@ -87,29 +197,93 @@ void setup()
 
   // Init controller (safety + actuator)
   g_ctrl.begin(PIN_LED);
+
+  // Logging runs in a low-priority drainer from here on
+  // (binary mode: the text banner above fails CRC and is dropped by the decoder)
+  if (!kLogBinary) logStartDrainer(Serial, kPipelined ? 0 : -1);
+
+  if (kPipelined) {
+    PipelineConfig pc;
+    pc.samplingRateHz = g_cfg.samplingRateHz;
+    pc.scale = g_cfg.scale;
+    pc.offset = g_cfg.offset;
+    pc.uncertainty = g_cfg.uncertainty;
+    pc.read = readLdrAdc;
+    pc.onWindow = onPipelineWindow;
+    if (!g_pipe.begin(pc, g_ml, g_ctrl)) Serial.println("[pipe] start failed");
+  } else {
+    g_sampleTask.begin(g_samplePeriodUs, micros(), kSamplePolicy);
+  }
 }
 
 void loop()
 {
+  static unsigned long lastMetricsMs = 0;
+  const bool report = millis() - lastMetricsMs >= kMetricsPeriodMs;
+  if (report) lastMetricsMs = millis();
+
+  bool traceWanted = false;
+#if defined(SENSORML_TRACE)
+  traceWanted = Serial.available() && Serial.read() == 't';
+  if (traceWanted && kLogBinary) traceDump(Serial);   // no drainer; loop() is the only writer
+#endif
+
+  // Heap, stack headroom, TFLM arena (mem_stats.h) and scheduler metrics
+  // over the last kMetricsPeriodMs, printed by the drainer. Binary mode has
+  // no text reports.
+  if ((report || traceWanted) && !kLogBinary && logReportIdle()) {
+    g_report.metrics = report;
+    g_report.trace = traceWanted;
+    if (report) {
+      memSample(g_report.mem, &g_ml);
+      g_report.sample = g_sampleTask;
+      g_report.rate = g_rate;
+      g_report.nowUs = micros();
+    }
+    logRequestReport(printReport);
+  }
+
+  if (kPipelined) {
+    // Sampling and inference run in their own tasks
+    delay(100);
+    return;
+  }
+
+  if (report) g_sampleTask.resetMetrics(micros());
+
+  if (!g_sampleTask.due(micros())) return;
   const unsigned long now = millis();
-  if (now - g_lastSampleMs < g_samplePeriodMs) return;
-  g_lastSampleMs = now;
 
   // 1) read sensor
+  TRACE_BEGIN("sample");
   float x = readLdrAdc();
 
   // 2) apply calibration from SensorML
   float xCal = (x * g_cfg.scale) + g_cfg.offset;
 
-  // 3) push into window
-  pushSample(g_win, xCal);
+  // 3) push into window (adaptive: interpolated onto the maxSamplingRateHz
+  //    grid, and a sudden change returns to full rate right away)
+  if (kAdaptiveRate) {
+    // This sample closes a gap of the stride it was read at, even if it jumps
+    const int s = g_rate.stride();
+    if (g_rate.onSample(xCal)) g_sampleTask.setPeriod(g_rate.periodUs());
+    pushResampled(g_win, xCal, s);
+  } else {
+    pushSample(g_win, xCal);
+  }
+  TRACE_END("sample");
 
   // 4) once window full -> features -> inference -> safety -> actuate
-  if (isWindowFull(g_win)) {
+  //    (adaptive: the window stays full; only every 10th real sample runs it)
+  if (isWindowFull(g_win) && (!kAdaptiveRate || g_rate.windowDue())) {
+    TRACE_SCOPE("window");
     Features f;
+    TRACE_BEGIN("features");
     computeFeatures(g_win, f);
+    TRACE_END("features");
 
     // inference
+    TRACE_BEGIN("infer");
     InferenceResult r;
     if (g_ml.isReady()) {
       r = g_ml.infer(f);
@@ -117,17 +291,18 @@ void loop()
       // fallback if no valid model is loaded
       r = fallbackClassify(f);
     }
+    TRACE_END("infer");
 
     // safety + actuation
+    TRACE_BEGIN("control");
     ControlAction a = g_ctrl.safetyAndActuate(r, g_cfg.uncertainty);
+    TRACE_END("control");
+
+    TRACE_BEGIN("log");
+    logWindow((uint32_t)now, f, r, a);
+    TRACE_END("log");
 
-    // log
-    Serial.print("mean="); Serial.print(f.mean, 2);
-    Serial.print(" std="); Serial.print(f.std, 2);
-    Serial.print(" slope="); Serial.print(f.slope, 4);
-    Serial.print(" | class="); Serial.print(r.label);
-    Serial.print(" conf="); Serial.print(r.confidence, 3);
-    Serial.print(" | action="); Serial.println((int)a);
+    if (kAdaptiveRate && g_rate.onWindow(f)) g_sampleTask.setPeriod(g_rate.periodUs());
 
     // slide window (hop size)
     popOldest(g_win, 10); // hop 10 samples
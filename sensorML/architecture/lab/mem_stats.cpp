@@ -0,0 +1,105 @@
+#include "mem_stats.h"
+#include <atomic>
+
+#if defined(ARDUINO)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+// Slot state: 0 free, 1 being filled, 2 watched
+struct MemWatchSlot {
+  std::atomic<uint8_t> state;
+  const void* task;
+  const char* name;
+};
+
+static MemWatchSlot g_watch[kMemMaxTasks];
+
+#if defined(ARDUINO)
+
+static const void* currentTask() { return xTaskGetCurrentTaskHandle(); }
+
+static uint32_t stackFreeBytes(const void* task)
+{
+  // ESP-IDF: StackType_t is one byte, so the high-water mark is in bytes
+  return (uint32_t)uxTaskGetStackHighWaterMark((TaskHandle_t)task);
+}
+
+static void sampleHeap(MemStats& m)
+{
+  m.heapFree = ESP.getFreeHeap();
+  m.heapLargest = ESP.getMaxAllocHeap();
+  m.heapMinFree = ESP.getMinFreeHeap();
+}
+
+#else
+
+static const void* currentTask()
+{
+  static thread_local char key;
+  return &key;
+}
+
+static uint32_t stackFreeBytes(const void*) { return 0; }
+
+static void sampleHeap(MemStats& m)
+{
+  m.heapFree = m.heapLargest = m.heapMinFree = 0;
+}
+
+#endif
+
+void memWatchTask(const char* name)
+{
+  const void* task = currentTask();
+  for (int k = 0; k < kMemMaxTasks; k++) {
+    uint8_t expected = 0;
+    if (!g_watch[k].state.compare_exchange_strong(expected, 1)) continue;
+    g_watch[k].task = task;
+    g_watch[k].name = name;
+    g_watch[k].state.store(2, std::memory_order_release);
+    return;
+  }
+}
+
+void memUnwatchTask()
+{
+  const void* task = currentTask();
+  for (int k = 0; k < kMemMaxTasks; k++) {
+    if (g_watch[k].state.load(std::memory_order_acquire) == 2 && g_watch[k].task == task) {
+      g_watch[k].state.store(0, std::memory_order_release);
+    }
+  }
+}
+
+void memSample(MemStats& m, const TinyML* ml)
+{
+  sampleHeap(m);
+  m.fragPct = m.heapFree ? (uint8_t)(100 - (uint64_t)m.heapLargest * 100 / m.heapFree) : 0;
+  m.arenaUsed = ml ? (uint32_t)ml->arenaUsedBytes() : 0;
+  m.arenaSize = ml ? (uint32_t)TinyML::arenaSizeBytes() : 0;
+
+  m.taskCount = 0;
+  for (int k = 0; k < kMemMaxTasks; k++) {
+    if (g_watch[k].state.load(std::memory_order_acquire) != 2) continue;
+    MemTaskStack& t = m.tasks[m.taskCount++];
+    t.name = g_watch[k].name;
+    t.freeMinBytes = stackFreeBytes(g_watch[k].task);
+  }
+}
+
+void memPrint(Print& out, const MemStats& m)
+{
+  out.print("[mem] heap_free="); out.print(m.heapFree);
+  out.print(" largest="); out.print(m.heapLargest);
+  out.print(" min_free="); out.print(m.heapMinFree);
+  out.print(" frag="); out.print(m.fragPct); out.print('%');
+  out.print(" arena="); out.print(m.arenaUsed);
+  out.print('/'); out.print(m.arenaSize);
+  out.print(" stack_free");
+  for (int i = 0; i < m.taskCount; i++) {
+    out.print(' '); out.print(m.tasks[i].name);
+    out.print('='); out.print(m.tasks[i].freeMinBytes);
+  }
+  out.println();
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <Arduino.h>
+
+#include "inference.h"
+
+// Memory telemetry
+// A device that degrades after days has usually leaked heap, fragmented it
+// (String temporaries, malloc'd windows) or run a task to the end of its
+// stack. memSample() takes a snapshot of:
+//  - heap: free bytes, the largest free block (the biggest malloc that can
+//    still succeed) and the lowest free heap since boot. frag_pct =
+//    100 - largest * 100 / free; it rising while free stays flat means
+//    fragmentation, min_free sinking from one report to the next means a leak
+//  - stack headroom of every task that called memWatchTask(): the FreeRTOS
+//    high-water mark, i.e. bytes of its stack never touched (near 0: about to
+//    overflow; large: the stack size can come down)
+//  - the TFLM arena: bytes AllocateTensors() used out of kArenaSize, so the
+//    arena can be sized from data instead of a guess
+// Heap and stack figures come from ESP-IDF/FreeRTOS and are 0 on host, where
+// the benches count allocations instead (host/bench/alloc_count.h).
+
+static constexpr int kMemMaxTasks = 8;
+
+struct MemTaskStack {
+  const char* name;
+  uint32_t freeMinBytes;   // stack high-water mark
+};
+
+struct MemStats {
+  uint32_t heapFree;
+  uint32_t heapLargest;    // largest free block
+  uint32_t heapMinFree;    // since boot
+  uint8_t fragPct;
+  uint32_t arenaUsed;      // TFLM, 0 without a model
+  uint32_t arenaSize;
+  uint8_t taskCount;
+  MemTaskStack tasks[kMemMaxTasks];
+};
+
+// Report the calling task's stack (call once at the top of the task) /
+// stop before the task deletes itself
+void memWatchTask(const char* name);
+void memUnwatchTask();
+
+// Snapshot; ml may be nullptr (no arena figures)
+void memSample(MemStats& m, const TinyML* ml);
+
+// [mem] heap_free=... largest=... min_free=... frag=...% arena=used/size stack_free loop=... ...
+void memPrint(Print& out, const MemStats& m);
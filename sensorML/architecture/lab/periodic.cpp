@@ -0,0 +1,87 @@
+#include "periodic.h"
+
+void PeriodicTask::begin(uint32_t periodUs, uint32_t nowUs, PeriodicPolicy policy,
+                         uint8_t maxCatchUp)
+{
+  period_ = periodUs ? periodUs : 1;
+  policy_ = policy;
+  maxCatchUp_ = maxCatchUp;
+  next_ = nowUs + period_;
+  resetMetrics(nowUs);
+}
+
+void PeriodicTask::setPeriod(uint32_t periodUs)
+{
+  if (periodUs == 0) periodUs = 1;
+  // Keep the pending slot's start: next_ = last slot + new period
+  next_ = next_ - period_ + periodUs;
+  period_ = periodUs;
+}
+
+bool PeriodicTask::due(uint32_t nowUs)
+{
+  int32_t late = (int32_t)(nowUs - next_);
+  if (late < 0) return false;
+
+  if ((uint32_t)late >= period_) {
+    overruns_++;
+    // Slots that ended before now (this one excluded)
+    const uint32_t missed = (uint32_t)late / period_;
+    uint32_t drop = 0;
+    if (policy_ == PERIODIC_SKIP) {
+      drop = missed;
+    } else if (missed > maxCatchUp_) {
+      drop = missed - maxCatchUp_;
+    }
+    next_ += drop * period_;
+    skipped_ += drop;
+    late -= (int32_t)(drop * period_);
+  }
+
+  jitter_.add((uint32_t)late);
+
+  next_ += period_;
+  runs_++;
+  return true;
+}
+
+uint32_t PeriodicTask::untilDueUs(uint32_t nowUs) const
+{
+  const int32_t d = (int32_t)(next_ - nowUs);
+  return d > 0 ? (uint32_t)d : 0;
+}
+
+PeriodicMetrics PeriodicTask::metrics(uint32_t nowUs) const
+{
+  PeriodicMetrics m;
+  m.runs = runs_;
+  m.overruns = overruns_;
+  m.skipped = skipped_;
+  m.jitter = jitter_;
+  m.nominalHz = 1000000.0f / (float)period_;
+  const uint32_t elapsed = nowUs - startUs_;
+  m.actualHz = elapsed ? (float)runs_ * 1000000.0f / (float)elapsed : 0.0f;
+  return m;
+}
+
+void PeriodicTask::resetMetrics(uint32_t nowUs)
+{
+  startUs_ = nowUs;
+  runs_ = 0;
+  overruns_ = 0;
+  skipped_ = 0;
+  jitter_.reset();
+}
+
+void PeriodicTask::printMetrics(Print& out, const char* name, uint32_t nowUs) const
+{
+  const PeriodicMetrics m = metrics(nowUs);
+  out.print("[sched] "); out.print(name);
+  out.print(" runs="); out.print(m.runs);
+  out.print(" rate="); out.print(m.actualHz, 2);
+  out.print('/'); out.print(m.nominalHz, 2); out.print("Hz");
+  out.print(" overruns="); out.print(m.overruns);
+  out.print(" skipped="); out.print(m.skipped);
+  m.jitter.print(out);
+  out.println();
+}
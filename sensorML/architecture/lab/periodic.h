@@ -0,0 +1,62 @@
+#pragma once
+#include <Arduino.h>
+
+#include "jitter_hist.h"
+
+// Drift-free periodic scheduling
+// The usual `if (now - last >= PERIOD) { last = now; ... }` restarts the
+// period from whenever loop() got there, so every late pass pushes all later
+// samples back and the real rate drops below samplingRateHz. PeriodicTask
+// keeps a fixed time grid instead: each run advances the deadline by exactly
+// one period. When loop() falls a whole period or more behind, the policy
+// decides what happens to the missed slots:
+//  - PERIODIC_CATCH_UP: run them back to back (at most maxCatchUp; older
+//    slots are skipped), so the average rate stays nominal
+//  - PERIODIC_SKIP: drop them and realign to the next slot on the grid
+// Time is passed in (micros()), so host code can drive a virtual clock.
+// 32-bit wraparound is handled (all comparisons are on differences).
+
+enum PeriodicPolicy : uint8_t {
+  PERIODIC_CATCH_UP = 0,
+  PERIODIC_SKIP     = 1
+};
+
+struct PeriodicMetrics {
+  uint32_t runs;
+  uint32_t overruns;      // runs that started a whole period or more late
+  uint32_t skipped;       // slots dropped by the policy
+  JitterHist jitter;      // lateness (run start - its slot)
+  float nominalHz;
+  float actualHz;         // runs / time since begin()
+};
+
+class PeriodicTask {
+public:
+  void begin(uint32_t periodUs, uint32_t nowUs, PeriodicPolicy policy = PERIODIC_CATCH_UP,
+             uint8_t maxCatchUp = 2);
+  void setPeriod(uint32_t periodUs);   // from the next slot on
+
+  // True once per slot; call it from loop() as often as you like
+  bool due(uint32_t nowUs);
+
+  uint32_t periodUs() const { return period_; }
+  uint32_t nextDueUs() const { return next_; }
+  uint32_t untilDueUs(uint32_t nowUs) const;   // 0 when due
+
+  PeriodicMetrics metrics(uint32_t nowUs) const;
+  void resetMetrics(uint32_t nowUs);
+  // [sched] <name> runs=... rate=19.99/20.00Hz overruns=... skipped=... jitter_max_us=... jitter_hist=...
+  void printMetrics(Print& out, const char* name, uint32_t nowUs) const;
+
+private:
+  uint32_t period_ = 1000000;
+  uint32_t next_ = 0;
+  PeriodicPolicy policy_ = PERIODIC_CATCH_UP;
+  uint8_t maxCatchUp_ = 2;
+
+  uint32_t startUs_ = 0;
+  uint32_t runs_ = 0;
+  uint32_t overruns_ = 0;
+  uint32_t skipped_ = 0;
+  JitterHist jitter_;
+};
@@ -0,0 +1,288 @@
+#include "pipeline.h"
+#include "mem_stats.h"
+#include "trace.h"
+
+#if defined(ARDUINO)
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+// Worker-side batch: slots are freed in one store before the (slow) inference
+static constexpr uint32_t kDrainBatch = 32;
+
+void Pipeline::push(const PipelineSample& s)
+{
+  depthSum_.fetch_add(ring_.size(), std::memory_order_relaxed);
+  ring_.push(s);   // full: counted in ring_.overruns()
+}
+
+// Sampler side, once per timer wake. periods > 1: the task woke late and
+// the periods in between get no sample.
+void Pipeline::sample(uint32_t periods, uint32_t& scheduledUs)
+{
+  scheduledUs += periods * periodUs_;
+  if (periods > 1) missed_.fetch_add(periods - 1, std::memory_order_relaxed);
+
+  TRACE_BEGIN("sample");
+  const uint32_t t = micros();
+  const int32_t late = (int32_t)(t - scheduledUs);
+  jitter_.add(late < 0 ? (uint32_t)-late : (uint32_t)late);
+  push({t, cfg_.read() * cfg_.scale + cfg_.offset});
+  TRACE_END("sample");
+}
+
+// Worker side: takes up to kDrainBatch samples, then the same steps as loop()
+// in main.ino for each
+int Pipeline::drain()
+{
+  PipelineSample batch[kDrainBatch];
+  const uint32_t n = ring_.popBatch(batch, kDrainBatch);
+  for (uint32_t i = 0; i < n; i++) {
+    const PipelineSample& s = batch[i];
+    pushSample(win_, s.value);
+    if (!isWindowFull(win_)) continue;
+
+    TRACE_SCOPE("window");
+    PipelineWindow w;
+    w.tUs = s.tUs;
+    TRACE_BEGIN("features");
+    computeFeatures(win_, w.f);
+    TRACE_END("features");
+    TRACE_BEGIN("infer");
+    w.r = ml_->isReady() ? ml_->infer(w.f) : fallbackClassify(w.f);
+    TRACE_END("infer");
+    TRACE_BEGIN("control");
+    w.action = ctrl_->safetyAndActuate(w.r, cfg_.uncertainty);
+    TRACE_END("control");
+    windows_.fetch_add(1, std::memory_order_relaxed);
+    if (cfg_.onWindow) {
+      TRACE_SCOPE("on_window");
+      cfg_.onWindow(w);
+    }
+
+    popOldest(win_, cfg_.hop);
+  }
+  return (int)n;
+}
+
+PipelineMetrics Pipeline::metrics() const
+{
+  PipelineMetrics m;
+  m.samples = ring_.pushed();
+  m.dropped = ring_.overruns();
+  m.missed = missed_.load(std::memory_order_relaxed);
+  m.windows = windows_.load(std::memory_order_relaxed);
+  m.jitter = jitter_.snapshot();
+  m.depthMax = ring_.highWater();
+  const uint32_t pushes = m.samples + m.dropped;
+  m.depthMean = pushes ? (float)depthSum_.load(std::memory_order_relaxed) / (float)pushes : 0.0f;
+  return m;
+}
+
+void Pipeline::printMetrics(Print& out) const
+{
+  const PipelineMetrics m = metrics();
+  out.print("[pipe] samples="); out.print(m.samples);
+  out.print(" dropped="); out.print(m.dropped);
+  out.print(" missed="); out.print(m.missed);
+  out.print(" windows="); out.print(m.windows);
+  m.jitter.print(out);
+  out.print(" depth_max="); out.print(m.depthMax);
+  out.print(" depth_mean="); out.println(m.depthMean, 2);
+}
+
+#if defined(ARDUINO)
+
+// Shortest sample period esp_timer_start_periodic() accepts
+static constexpr uint32_t kMinPeriodUs = 50;
+
+// esp_timer task: one notification per period
+static void samplerTick(void* sampler)
+{
+  xTaskNotifyGive((TaskHandle_t)sampler);
+}
+
+// The live count is the last thing a task touches: end() may free the
+// pipeline as soon as it reaches 0
+void Pipeline::samplerEntry(void* arg)
+{
+  Pipeline* p = static_cast<Pipeline*>(arg);
+  memWatchTask("pipeSampler");
+  p->samplerLoop();
+  memUnwatchTask();
+  p->tasksLive_.fetch_sub(1, std::memory_order_release);
+  vTaskDelete(nullptr);
+}
+
+void Pipeline::workerEntry(void* arg)
+{
+  Pipeline* p = static_cast<Pipeline*>(arg);
+  memWatchTask("pipeWorker");
+  p->workerLoop();
+  memUnwatchTask();
+  p->tasksLive_.fetch_sub(1, std::memory_order_release);
+  vTaskDelete(nullptr);
+}
+
+void Pipeline::samplerLoop()
+{
+  TRACE_THREAD("pipeSampler");
+  // A periodic esp_timer wakes this task. It keeps its phase in us, so the
+  // period is not rounded to FreeRTOS ticks (1 or 10 ms) and lateness does
+  // not accumulate. Periods missed while the task could not run arrive as
+  // one wake with a count > 1.
+  esp_timer_create_args_t args = {};
+  args.callback = samplerTick;
+  args.arg = xTaskGetCurrentTaskHandle();
+  args.name = "pipeSample";
+  esp_timer_handle_t timer = nullptr;
+  if (esp_timer_create(&args, &timer) != ESP_OK) {
+    running_.store(false);   // the worker stops too; metrics show no samples
+    return;
+  }
+  uint32_t scheduledUs = micros();
+  if (esp_timer_start_periodic(timer, periodUs_) != ESP_OK) running_.store(false);
+
+  while (running_.load(std::memory_order_relaxed)) {
+    const uint32_t periods = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    if (periods == 0) continue;
+    sample(periods, scheduledUs);
+    xTaskNotifyGive((TaskHandle_t)worker_);
+  }
+  // Before the task is deleted: no tick may notify it afterwards
+  esp_timer_stop(timer);
+  esp_timer_delete(timer);
+}
+
+void Pipeline::workerLoop()
+{
+  TRACE_THREAD("pipeWorker");
+  while (running_.load(std::memory_order_relaxed)) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    while (drain() > 0) {}
+  }
+}
+
+bool Pipeline::begin(const PipelineConfig& cfg, TinyML& ml, Controller& ctrl)
+{
+  if (!cfg.read || running_.load() || tasksLive_.load() > 0) return false;
+  cfg_ = cfg;
+  ml_ = &ml;
+  ctrl_ = &ctrl;
+  periodUs_ = (uint32_t)(1000000.0f / max(1.0f, cfg_.samplingRateHz));
+  if (periodUs_ < kMinPeriodUs) return false;
+  initWindow(win_, cfg_.window);
+  running_.store(true);
+
+  // Worker first: the sampler notifies it from its first sample on
+  TaskHandle_t worker = nullptr;
+  TaskHandle_t sampler = nullptr;
+  tasksLive_.store(2);
+  if (xTaskCreatePinnedToCore(workerEntry, "pipeWorker", 8192, this, cfg_.workerPriority, &worker,
+                              cfg_.workerCore) != pdPASS) {
+    worker = nullptr;
+    tasksLive_.fetch_sub(1);
+  }
+  worker_ = worker;
+  if (!worker_ || xTaskCreatePinnedToCore(samplerEntry, "pipeSampler", 3072, this, cfg_.samplerPriority,
+                                          &sampler, cfg_.samplerCore) != pdPASS) {
+    sampler = nullptr;
+    tasksLive_.fetch_sub(1);
+  }
+  sampler_ = sampler;
+  if (!worker_ || !sampler_) {
+    end();
+    return false;
+  }
+  return true;
+}
+
+void Pipeline::end()
+{
+  // Both tasks see the flag within 100 ms (their notify timeout); the
+  // window is freed only once neither can touch it
+  running_.store(false);
+  if (worker_) xTaskNotifyGive((TaskHandle_t)worker_);
+  while (tasksLive_.load(std::memory_order_acquire) > 0) vTaskDelay(1);
+  while (drain() > 0) {}   // samples pushed after the worker's last pass (single consumer again)
+  sampler_ = worker_ = nullptr;
+  free(win_.buf);
+  win_.buf = nullptr;
+}
+
+#else
+
+void Pipeline::samplerEntry(void* arg)
+{
+  static_cast<Pipeline*>(arg)->samplerLoop();
+}
+
+void Pipeline::workerEntry(void* arg)
+{
+  static_cast<Pipeline*>(arg)->workerLoop();
+}
+
+// Stands in for the ESP32 periodic timer: ticks keep their phase, and the
+// ticks that fire while the thread is busy or asleep arrive as one wake with
+// a count, as notifications do on device
+void Pipeline::samplerLoop()
+{
+  TRACE_THREAD("pipeSampler");
+  using Clock = std::chrono::steady_clock;
+  const std::chrono::microseconds period(periodUs_);
+  const Clock::time_point start = Clock::now();
+  uint32_t scheduledUs = micros();
+  uint64_t ticks = 0;   // timer ticks handed to sample() so far
+
+  while (running_.load(std::memory_order_relaxed)) {
+    std::this_thread::sleep_until(start + period * (ticks + 1));
+    const uint64_t due = (uint64_t)((Clock::now() - start) / period);
+    if (due <= ticks) continue;
+    sample((uint32_t)(due - ticks), scheduledUs);
+    ticks = due;
+  }
+}
+
+void Pipeline::workerLoop()
+{
+  TRACE_THREAD("pipeWorker");
+  while (running_.load(std::memory_order_relaxed)) {
+    if (drain() == 0) std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+}
+
+bool Pipeline::begin(const PipelineConfig& cfg, TinyML& ml, Controller& ctrl)
+{
+  if (!cfg.read || running_.load()) return false;
+  cfg_ = cfg;
+  ml_ = &ml;
+  ctrl_ = &ctrl;
+  const float hz = cfg_.samplingRateHz > 1.0f ? cfg_.samplingRateHz : 1.0f;
+  periodUs_ = (uint32_t)(1000000.0f / hz);
+  initWindow(win_, cfg_.window);
+  running_.store(true);
+  worker_ = new std::thread(workerEntry, this);
+  sampler_ = new std::thread(samplerEntry, this);
+  return true;
+}
+
+void Pipeline::end()
+{
+  running_.store(false);
+  std::thread* sampler = static_cast<std::thread*>(sampler_);
+  std::thread* worker = static_cast<std::thread*>(worker_);
+  if (sampler) sampler->join();
+  if (worker) worker->join();
+  while (drain() > 0) {}   // samples pushed after the worker's last pass (single consumer again)
+  delete sampler;
+  delete worker;
+  sampler_ = worker_ = nullptr;
+  free(win_.buf);
+  win_.buf = nullptr;
+}
+
+#endif
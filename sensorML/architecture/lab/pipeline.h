@@ -0,0 +1,106 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+#include "features.h"
+#include "inference.h"
+#include "jitter_hist.h"
+#include "controller.h"
+#include "spsc_ring.h"
+
+// Dual-task execution mode
+// In loop() mode a slow Serial line or network call delays the next
+// analogRead. Here the work is split:
+//  - sampler (core 1, high priority): woken by a periodic timer, reads the
+//    sensor, calibrates and pushes (time, value) into a wait-free
+//    single-producer / single-consumer ring (spsc_ring.h). It never blocks;
+//    a full ring counts a drop. A wake that covers several periods (the
+//    task could not run in time) takes one sample and counts the others as
+//    missed.
+//  - worker (core 1, lower priority): drains the ring into the window and
+//    runs features -> inference -> safety/actuation, then passes each window
+//    to onWindow (logging) on the same task.
+//  - core 0 keeps the WiFi stack and I/O tasks (log drainer, MQTT).
+// On host both tasks are std::threads (core and priority are ignored) and
+// the timer is emulated with the same coalescing of late periods, so the
+// same code can be stress-tested: host/bench/pipeline_stress.
+
+static constexpr uint32_t kPipelineRingCapacity = 256;   // power of two
+
+struct PipelineSample {
+  uint32_t tUs;          // when the sample was taken
+  float value;           // calibrated
+};
+
+struct PipelineWindow {
+  uint32_t tUs;          // time of the newest sample in the window
+  Features f;
+  InferenceResult r;
+  ControlAction action;
+};
+
+typedef float (*PipelineReadFn)();
+typedef void (*PipelineWindowFn)(const PipelineWindow& w);
+
+struct PipelineConfig {
+  float samplingRateHz = 20.0f;
+  float scale = 1.0f;
+  float offset = 0.0f;
+  float uncertainty = 0.05f;
+  int window = 40;
+  int hop = 10;
+  PipelineReadFn read = nullptr;         // raw reading (sampler task)
+  PipelineWindowFn onWindow = nullptr;   // optional (worker task)
+  int samplerCore = 1;
+  int workerCore = 1;
+  int samplerPriority = 5;
+  int workerPriority = 3;
+};
+
+// Snapshot of the counters (safe to read from any task)
+struct PipelineMetrics {
+  uint32_t samples;       // pushed by the sampler
+  uint32_t dropped;       // ring full
+  uint32_t missed;        // periods with no sample (sampler woke late)
+  uint32_t windows;       // processed by the worker
+  JitterHist jitter;      // |actual - scheduled| sample time
+  uint32_t depthMax;      // ring depth high-water mark (samples)
+  float depthMean;        // mean ring depth seen by the sampler
+};
+
+class Pipeline {
+public:
+  // Starts the sampler and worker tasks; ml and ctrl are used only by the worker
+  bool begin(const PipelineConfig& cfg, TinyML& ml, Controller& ctrl);
+  // Stops both tasks (host: joins the threads)
+  void end();
+  PipelineMetrics metrics() const;
+  void printMetrics(Print& out) const;
+
+private:
+  static void samplerEntry(void* arg);
+  static void workerEntry(void* arg);
+  void samplerLoop();
+  void workerLoop();
+  void sample(uint32_t periods, uint32_t& scheduledUs);
+  void push(const PipelineSample& s);
+  int drain();
+
+  PipelineConfig cfg_;
+  TinyML* ml_ = nullptr;
+  Controller* ctrl_ = nullptr;
+  WindowBuffer win_ = {};
+  uint32_t periodUs_ = 50000;
+
+  SpscRing<PipelineSample, kPipelineRingCapacity> ring_;
+  std::atomic<bool> running_{false};
+
+  std::atomic<uint32_t> windows_{0};
+  std::atomic<uint32_t> missed_{0};
+  AtomicJitterHist jitter_;
+  std::atomic<uint64_t> depthSum_{0};
+
+  void* sampler_ = nullptr;   // TaskHandle_t on ESP32, std::thread* on host
+  void* worker_ = nullptr;
+  std::atomic<int> tasksLive_{0};   // ESP32: tasks not yet finished (end() waits for 0)
+};
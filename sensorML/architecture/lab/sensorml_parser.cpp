@@ -36,6 +36,12 @@ bool parseSensorMLFromProgmem(const char* xmlProgmem, SensorConfig& out)
   if (extractTag(xml, "samplingRateHz", v)) out.samplingRateHz = v.toFloat();
   else { out.samplingRateHz = 20.0f; ok = false; }
 
+  // Optional; "<samplingRateHz>" does not match inside "<minSamplingRateHz>"
+  if (extractTag(xml, "minSamplingRateHz", v)) out.minSamplingRateHz = v.toFloat();
+  else out.minSamplingRateHz = out.samplingRateHz;
+  if (extractTag(xml, "maxSamplingRateHz", v)) out.maxSamplingRateHz = v.toFloat();
+  else out.maxSamplingRateHz = out.samplingRateHz;
+
   if (extractTag(xml, "scale", v)) out.scale = v.toFloat();
   else { out.scale = 1.0f; ok = false; }
 
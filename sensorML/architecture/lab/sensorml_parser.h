@@ -6,6 +6,8 @@ struct SensorConfig {
   String identifier;
   String uom;
   float samplingRateHz;
+  float minSamplingRateHz;   // adaptive sampling range (adaptive_rate.h);
+  float maxSamplingRateHz;   // both default to samplingRateHz
   float scale;
   float offset;
   float uncertainty;
@@ -0,0 +1,94 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Wait-free single-producer / single-consumer ring
+// For one producer (a timer ISR or the sampler task) and one consumer
+// (loop() or the inference task). Neither side ever waits, spins or masks
+// interrupts:
+//  - head is written only by the producer, tail only by the consumer, each
+//    with a release store after the slot copy; the other side reads it with
+//    an acquire load, so a slot is complete before its index is seen.
+//  - indices run freely (uint32_t) and wrap with a mask: N is a power of two.
+//  - a full ring rejects the new element and counts an overrun; the consumer's
+//    slots are never overwritten under it.
+//  - the consumer caches head and reloads it only when it has run out of
+//    known elements; the producer reads tail on every push so highWater()
+//    (the queue-depth metric) is exact.
+// Everything is inline with no allocation or locks, so push() can be called
+// from an IRAM_ATTR ISR on ESP32 (32-bit atomics are plain loads/stores there).
+// Unlike WindowBuffer (head/size as plain ints), it is safe to share between
+// an ISR and loop().
+
+#if defined(__GNUC__)
+#define SPSC_INLINE inline __attribute__((always_inline))
+#else
+#define SPSC_INLINE inline
+#endif
+
+template <typename T, uint32_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+  static constexpr uint32_t kCapacity = N;
+
+  // Producer side
+  SPSC_INLINE bool push(const T& v)
+  {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    const uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail >= N) {
+      // Single writer: no read-modify-write needed (ISR-safe on Xtensa)
+      overruns_.store(overruns_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    const uint32_t depth = head - tail + 1;
+    if (depth > highWater_.load(std::memory_order_relaxed)) {
+      highWater_.store(depth, std::memory_order_relaxed);
+    }
+    buf_[head & (N - 1)] = v;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  SPSC_INLINE bool pop(T& out)
+  {
+    return popBatch(&out, 1) == 1;
+  }
+
+  // Copies up to max elements (oldest first) and frees their slots with one
+  // release store. Returns the number copied.
+  SPSC_INLINE uint32_t popBatch(T* out, uint32_t max)
+  {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (headCache_ - tail < max) headCache_ = head_.load(std::memory_order_acquire);
+    uint32_t n = headCache_ - tail;
+    if (n > max) n = max;
+    for (uint32_t i = 0; i < n; i++) out[i] = buf_[(tail + i) & (N - 1)];
+    if (n) tail_.store(tail + n, std::memory_order_release);
+    return n;
+  }
+
+  // Either side (a snapshot; may be stale by the time it is used)
+  uint32_t size() const
+  {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+  uint32_t pushed() const { return head_.load(std::memory_order_relaxed); }
+  uint32_t overruns() const { return overruns_.load(std::memory_order_relaxed); }
+  uint32_t highWater() const { return highWater_.load(std::memory_order_relaxed); }
+
+private:
+  // Producer-owned line
+  alignas(64) std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> overruns_{0};
+  std::atomic<uint32_t> highWater_{0};
+  // Consumer-owned line
+  alignas(64) std::atomic<uint32_t> tail_{0};
+  uint32_t headCache_ = 0;
+
+  alignas(64) T buf_[N];
+};
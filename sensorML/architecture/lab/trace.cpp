@@ -0,0 +1,152 @@
+#include "trace.h"
+#include <atomic>
+#include <stdio.h>
+
+#if defined(ARDUINO)
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+typedef uint32_t TraceTicks;
+#else
+#include <chrono>
+typedef uint64_t TraceTicks;
+#endif
+
+static_assert((TRACE_RING_EVENTS & (TRACE_RING_EVENTS - 1)) == 0, "TRACE_RING_EVENTS must be a power of two");
+
+static constexpr int kTraceMaxThreads = 16;
+
+struct TraceEvent {
+  std::atomic<uint32_t> seq;   // index + 1 once written, 0 while being written
+  uint32_t tid;
+  TraceTicks ts;
+  const char* name;
+  char phase;
+};
+
+struct TraceThread {
+  std::atomic<bool> ready;
+  uint32_t tid;
+  const char* name;
+};
+
+static TraceEvent g_ring[TRACE_RING_EVENTS];
+static std::atomic<uint32_t> g_head{0};          // next index to claim
+static std::atomic<bool> g_enabled{true};
+static TraceThread g_threads[kTraceMaxThreads];
+static std::atomic<uint32_t> g_threadCount{0};
+
+#if defined(ARDUINO)
+
+static inline TraceTicks traceNow() { return ESP.getCycleCount(); }
+static inline uint32_t traceTid() { return (uint32_t)(uintptr_t)xTaskGetCurrentTaskHandle(); }
+static uint64_t traceHz() { return (uint64_t)getCpuFrequencyMhz() * 1000000ull; }
+static const int kTraceWrapBits = 32;
+
+#else
+
+static inline TraceTicks traceNow()
+{
+  return (TraceTicks)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline uint32_t traceTid()
+{
+  static std::atomic<uint32_t> next{1};
+  thread_local uint32_t tid = next.fetch_add(1, std::memory_order_relaxed);
+  return tid;
+}
+
+static uint64_t traceHz() { return 1000000000ull; }
+static const int kTraceWrapBits = 64;
+
+#endif
+
+void traceRecord(char phase, const char* name)
+{
+  if (!g_enabled.load(std::memory_order_relaxed)) return;
+  const uint32_t i = g_head.fetch_add(1, std::memory_order_relaxed);
+  TraceEvent& e = g_ring[i & (TRACE_RING_EVENTS - 1)];
+  e.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  e.ts = traceNow();
+  e.tid = traceTid();
+  e.name = name;
+  e.phase = phase;
+  e.seq.store(i + 1, std::memory_order_release);
+}
+
+void traceSetThreadName(const char* name)
+{
+  const uint32_t tid = traceTid();
+  const uint32_t n = g_threadCount.load(std::memory_order_acquire);
+  for (uint32_t k = 0; k < n && k < kTraceMaxThreads; k++) {
+    if (g_threads[k].ready.load(std::memory_order_acquire) && g_threads[k].tid == tid) {
+      g_threads[k].name = name;
+      return;
+    }
+  }
+  const uint32_t k = g_threadCount.fetch_add(1, std::memory_order_acq_rel);
+  if (k >= kTraceMaxThreads) return;
+  g_threads[k].tid = tid;
+  g_threads[k].name = name;
+  g_threads[k].ready.store(true, std::memory_order_release);
+}
+
+void traceEnable(bool on)
+{
+  g_enabled.store(on, std::memory_order_relaxed);
+}
+
+bool traceEnabled()
+{
+  return g_enabled.load(std::memory_order_relaxed);
+}
+
+void traceClear()
+{
+  for (uint32_t k = 0; k < TRACE_RING_EVENTS; k++) g_ring[k].seq.store(0, std::memory_order_relaxed);
+  g_head.store(0, std::memory_order_release);
+}
+
+uint32_t traceDump(Print& out, bool clear)
+{
+  const bool wasEnabled = g_enabled.exchange(false);
+  const uint32_t head = g_head.load(std::memory_order_acquire);
+  const uint32_t n = head < TRACE_RING_EVENTS ? head : TRACE_RING_EVENTS;
+  const uint32_t first = head - n;
+
+  char line[112];
+  snprintf(line, sizeof(line), "# trace begin hz=%llu wrap=%d events=%lu lost=%lu",
+           (unsigned long long)traceHz(), kTraceWrapBits, (unsigned long)n, (unsigned long)first);
+  out.println(line);
+  const uint32_t threads = g_threadCount.load(std::memory_order_acquire);
+  for (uint32_t k = 0; k < threads && k < kTraceMaxThreads; k++) {
+    if (!g_threads[k].ready.load(std::memory_order_acquire)) continue;
+    snprintf(line, sizeof(line), "# thread,%lu,%s", (unsigned long)g_threads[k].tid, g_threads[k].name);
+    out.println(line);
+  }
+
+  // A writer that claimed its slot before the pause may still be filling it:
+  // the sequence number is checked before and after copying
+  uint32_t written = 0;
+  for (uint32_t i = first; i != head; i++) {
+    const TraceEvent& e = g_ring[i & (TRACE_RING_EVENTS - 1)];
+    if (e.seq.load(std::memory_order_acquire) != i + 1) continue;
+    const TraceTicks ts = e.ts;
+    const uint32_t tid = e.tid;
+    const char* name = e.name;
+    const char phase = e.phase;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (e.seq.load(std::memory_order_relaxed) != i + 1) continue;
+    snprintf(line, sizeof(line), "%llu,%lu,%c,%s",
+             (unsigned long long)ts, (unsigned long)tid, phase, name);
+    out.println(line);
+    written++;
+  }
+  out.println("# trace end");
+
+  if (clear) traceClear();
+  g_enabled.store(wasEnabled, std::memory_order_relaxed);
+  return written;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <Arduino.h>
+#include <stdint.h>
+
+// Execution trace recorder
+// Averages hide how sampling, inference, logging and network work interleave.
+// The TRACE_* macros record begin/end events with a timestamp into a fixed
+// RAM ring (the oldest events are overwritten, like a flight recorder), and
+// traceDump() writes the ring as text:
+//   # trace begin hz=240000000 wrap=32 events=812 lost=0
+//   # thread,<tid>,<name>
+//   <ts>,<tid>,<B|E|I>,<name>
+//   # trace end
+// host/tools/trace_to_chrome turns a dump (or a whole Serial capture holding
+// one) into Chrome trace-event JSON for ui.perfetto.dev or chrome://tracing.
+//
+// Any task or thread may record: a slot is claimed with one atomic add, then
+// filled and published with a sequence number, so concurrent writers never
+// block each other and the dump skips a slot caught half-written.
+// Timestamps:
+//  - ESP32: the CCOUNT cycle counter of the recording core. It wraps every
+//    2^32 cycles (~18 s at 240 MHz); the converter unwraps gaps shorter than
+//    half of that. The two cores' counters are not synchronised, so pin the
+//    traced tasks to one core for exact cross-task ordering.
+//  - host: steady_clock in ns (64-bit)
+//
+// The macros expand to nothing unless SENSORML_TRACE is defined (build flag,
+// or the SENSORML_TRACE option of the host CMake build), so builds without
+// tracing carry no instrumentation at all. Event names must be string
+// literals: only the pointer is stored.
+
+#ifndef TRACE_RING_EVENTS
+#define TRACE_RING_EVENTS 1024   // power of two; 20 bytes each on ESP32
+#endif
+
+enum TracePhase : char {
+  TRACE_PH_BEGIN   = 'B',
+  TRACE_PH_END     = 'E',
+  TRACE_PH_INSTANT = 'I'
+};
+
+// Append one event for the calling task/thread (no-op while disabled)
+void traceRecord(char phase, const char* name);
+// Name the calling task/thread in dumps (up to 16 names)
+void traceSetThreadName(const char* name);
+// Recording is on from boot; a dump pauses it while the ring is read
+void traceEnable(bool on);
+bool traceEnabled();
+// Forget all recorded events
+void traceClear();
+// Write the ring (oldest first) to out; clear: start a new capture after it.
+// Returns the number of events written.
+uint32_t traceDump(Print& out, bool clear = true);
+
+// Begin on construction, end on scope exit
+class TraceScope {
+public:
+  explicit TraceScope(const char* name) : name_(name) { traceRecord(TRACE_PH_BEGIN, name_); }
+  ~TraceScope() { traceRecord(TRACE_PH_END, name_); }
+
+private:
+  const char* name_;
+};
+
+#if defined(SENSORML_TRACE)
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+#define TRACE_BEGIN(name)   traceRecord(TRACE_PH_BEGIN, name)
+#define TRACE_END(name)     traceRecord(TRACE_PH_END, name)
+#define TRACE_INSTANT(name) traceRecord(TRACE_PH_INSTANT, name)
+#define TRACE_SCOPE(name)   TraceScope TRACE_CAT(traceScope_, __LINE__)(name)
+#define TRACE_THREAD(name)  traceSetThreadName(name)
+#else
+#define TRACE_BEGIN(name)   ((void)0)
+#define TRACE_END(name)     ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#define TRACE_SCOPE(name)   ((void)0)
+#define TRACE_THREAD(name)  ((void)0)
+#endif
@@ -5,7 +5,10 @@
   - Uses samplingRateHz, scale, offset, uncertainty
   - Reads LDR via ADC and publishes self-describing JSON telemetry to MQTT
   - Publishes a compact metadata JSON (retained) at boot
-  - Optional: receives actuator command from Node-RED via MQTT topic
+  - Optional: receives commands from Node-RED via MQTT topic (JSON keys
+    dispatched in place to registered handlers: led, rate_hz, ...)
+  - Optional: live reconfiguration from a (partial) SensorML document sent
+    to the config topic; only the changed fields are applied, between samples
 
   Libraries:
   - WiFi (built-in for ESP32 Arduino core)
@@ -15,6 +18,7 @@
   - device/ldr01/metadata  (retained, publish once at boot)
   - device/ldr01/telemetry (publish periodically)
   - device/ldr01/cmd       (optional command back to ESP32)
+  - device/ldr01/config    (optional SensorML update, no reboot needed)
 
   Notes:
   - ADC pin: GPIO34 (input-only)
@@ -24,6 +28,7 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <PubSubClient.h>
+#include <atomic>
 
 // -------------------- User Config --------------------
 const char* WIFI_SSID = "YOUR_WIFI";
@@ -37,6 +42,7 @@ const int   MQTT_PORT = 1883;
 String TOPIC_META = "device/ldr01/metadata";
 String TOPIC_TLM  = "device/ldr01/telemetry";
 String TOPIC_CMD  = "device/ldr01/cmd";
+String TOPIC_CFG  = "device/ldr01/config";
 
 // Pins
 static const int LDR_PIN = 34;   // ADC input-only pin
@@ -58,7 +64,7 @@ const char* SENSORML_XML = R"xml(
       <scale>1.0</scale>
       <offset>0.0</offset>
     </calibration>
-    <uncertainty>0.05</uncertainty>
+    <uncertainty>20</uncertainty>  <!-- absolute, in uom (ADC noise) -->
   </System>
 </SensorML>
 )xml";
@@ -83,12 +89,64 @@ float getTagFloat(const String& xml, const String& tag, float defaultVal) {
   return v.toFloat();
 }
 
+// -------------------- Allocation-free JSON writer --------------------
+// Renders into a fixed stack/static buffer: no String, no printf, no heap.
+// Floats use fixed-point integer formatting (enough for sensor values).
+static const uint32_t POW10[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+template <size_t N>
+struct JsonWriter {
+  char buf[N];
+  size_t len = 0;
+  bool overflow = false;
+
+  void reset() { len = 0; overflow = false; }
+
+  void raw(const char* s, size_t n) {
+    if (len + n >= N) { overflow = true; return; }
+    memcpy(buf + len, s, n);
+    len += n;
+  }
+  void raw(const char* s) { raw(s, strlen(s)); }
+
+  void u32(uint32_t v) {
+    char tmp[10];
+    int n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    if (len + n >= N) { overflow = true; return; }
+    while (n) buf[len++] = tmp[--n];
+  }
+
+  // Fixed-decimal float, e.g. fixed(-1.23456f, 3) -> "-1.235"
+  void fixed(float v, int decimals) {
+    if (decimals < 0) decimals = 0;
+    if (decimals > 6) decimals = 6;
+    if (!(fabsf(v) < 4.0e9f)) { raw("null", 4); return; } // NaN, inf, too large
+
+    float a = fabsf(v);
+    uint32_t ip = (uint32_t)a;
+    uint32_t fp = (uint32_t)((a - (float)ip) * (float)POW10[decimals] + 0.5f);
+    if (fp >= POW10[decimals]) { ip++; fp -= POW10[decimals]; } // rounding carry
+
+    if (v < 0.0f && (ip != 0 || fp != 0)) raw("-", 1);
+    u32(ip);
+    if (decimals == 0) return;
+
+    char tmp[6];
+    for (int i = decimals - 1; i >= 0; i--) { tmp[i] = (char)('0' + fp % 10); fp /= 10; }
+    raw(".", 1);
+    raw(tmp, decimals);
+  }
+
+  const char* c_str() { buf[len] = '\0'; return buf; }
+};
+
 // -------------------- Parsed Config --------------------
 String sensorId, observedProperty, uom;
 float samplingRateHz = 20.0f;
 float scale = 1.0f;
 float offset = 0.0f;
-float uncertainty = 0.05f;
+float uncertainty = 20.0f;
 
 unsigned long samplePeriodMs = 50;
 unsigned long lastSampleMs = 0;
@@ -97,90 +155,586 @@ unsigned long lastSampleMs = 0;
 // mode: -1 = auto, 0 = force off, 1 = force on
 int ledOverride = -1;
 
-// -------------------- WiFi + MQTT --------------------
-void wifiConnect() {
+// Set by the "meta" command, handled in loop()
+bool metaRequested = false;
+
+// -------------------- Live Reconfiguration --------------------
+// A config update is a (partial) SensorML document, e.g.
+//   <SensorML><samplingRateHz>10</samplingRateHz><uncertainty>0.1</uncertainty></SensorML>
+// Only tags that are present AND differ from the active config are staged.
+// <identifier> is the device identity and is never changed at runtime.
+enum : uint8_t {
+  CFG_RATE   = 1 << 0,
+  CFG_SCALE  = 1 << 1,
+  CFG_OFFSET = 1 << 2,
+  CFG_UNC    = 1 << 3,
+  CFG_UOM    = 1 << 4,
+  CFG_PROP   = 1 << 5
+};
+
+struct ConfigPatch {
+  uint8_t mask = 0;  // CFG_* bits of the fields to change
+  float samplingRateHz = 0.0f;
+  float scale = 0.0f;
+  float offset = 0.0f;
+  float uncertainty = 0.0f;
+  String uom;
+  String observedProperty;
+};
+
+ConfigPatch pendingPatch;  // staged by mqttCallback, applied by loop()
+
+// -------------------- Connectivity state machine --------------------
+// Polled from loop() and never waits, so sampling keeps its cadence while
+// Wi-Fi or the broker is down:
+//  - WiFi.begin() is asynchronous; the link only watches WiFi.status().
+//  - PubSubClient::connect() blocks (TCP connect + CONNACK), so it runs in a
+//    small helper task while loop() keeps sampling; PubSubClient is not
+//    touched from loop() until the attempt has finished.
+//  - Failed attempts back off exponentially (LINK_BACKOFF_MIN_MS ..
+//    LINK_BACKOFF_MAX_MS) with random jitter, so a fleet does not reconnect
+//    in lockstep after a broker restart.
+// Copied in sensorML/lab/mpu6050/mqtt (host check: sketch_link_sim).
+enum LinkState : uint8_t {
+  LINK_WIFI_IDLE,       // waiting for the next Wi-Fi attempt
+  LINK_WIFI_JOINING,    // WiFi.begin() issued, waiting for WL_CONNECTED
+  LINK_MQTT_IDLE,       // Wi-Fi up, waiting for the next MQTT attempt
+  LINK_MQTT_CONNECTING, // helper task is running mqtt.connect()
+  LINK_UP               // publish/subscribe allowed
+};
+
+const uint32_t LINK_WIFI_JOIN_TIMEOUT_MS = 15000;
+const uint32_t LINK_BACKOFF_MIN_MS = 500;
+const uint32_t LINK_BACKOFF_MAX_MS = 30000;
+
+struct Link {
+  LinkState state = LINK_WIFI_IDLE;
+  uint32_t enteredMs = 0;               // when the current state was entered
+  uint32_t waitMs = 0;                  // idle time before the next attempt
+  uint32_t backoffMs = LINK_BACKOFF_MIN_MS;
+  uint32_t reconnects = 0;
+  char clientId[32];
+  void (*onUp)() = nullptr;             // runs in loop() on every (re)connect
+  TaskHandle_t worker = nullptr;
+  std::atomic<int8_t> result{0};        // 0 pending, 1 connected, -1 failed
+};
+
+Link link;
+
+static void linkEnter(LinkState s, uint32_t now, uint32_t waitMs = 0) {
+  link.state = s;
+  link.enteredMs = now;
+  link.waitMs = waitMs;
+}
+
+// Next wait: backoff/2 .. backoff (jittered), then double the backoff
+static uint32_t linkNextBackoff() {
+  uint32_t b = link.backoffMs;
+  link.backoffMs = min(b * 2, LINK_BACKOFF_MAX_MS);
+  return b / 2 + (uint32_t)random((long)(b / 2) + 1);
+}
+
+static void linkConnectTask(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    bool ok = mqtt.connect(link.clientId);
+    link.result.store(ok ? 1 : -1);
+  }
+}
+
+void linkBegin(const char* clientId, void (*onUp)()) {
+  strncpy(link.clientId, clientId, sizeof(link.clientId) - 1);
+  link.clientId[sizeof(link.clientId) - 1] = '\0';
+  link.onUp = onUp;
+
   WiFi.mode(WIFI_STA);
-  WiFi.begin(WIFI_SSID, WIFI_PASS);
+  mqtt.setSocketTimeout(5);  // bounds the CONNACK wait inside the helper task
+  xTaskCreatePinnedToCore(linkConnectTask, "mqttConnect", 4096, nullptr, 1, &link.worker, 0);
+  linkEnter(LINK_WIFI_IDLE, millis());
+}
+
+bool linkUp() { return link.state == LINK_UP; }
+
+// Call every loop() iteration; returns immediately in every state
+void linkPoll(uint32_t now) {
+  const uint32_t inState = now - link.enteredMs;
+
+  switch (link.state) {
+    case LINK_WIFI_IDLE:
+      if (inState < link.waitMs) return;
+      Serial.println("[WiFi] connecting");
+      WiFi.disconnect();
+      WiFi.begin(WIFI_SSID, WIFI_PASS);
+      linkEnter(LINK_WIFI_JOINING, now);
+      return;
+
+    case LINK_WIFI_JOINING:
+      if (WiFi.status() == WL_CONNECTED) {
+        Serial.print("[WiFi] connected, IP: ");
+        Serial.println(WiFi.localIP());
+        link.backoffMs = LINK_BACKOFF_MIN_MS;
+        linkEnter(LINK_MQTT_IDLE, now);
+      } else if (inState > LINK_WIFI_JOIN_TIMEOUT_MS) {
+        Serial.println("[WiFi] timeout, backing off");
+        linkEnter(LINK_WIFI_IDLE, now, linkNextBackoff());
+      }
+      return;
+
+    case LINK_MQTT_IDLE:
+      if (WiFi.status() != WL_CONNECTED) {
+        linkEnter(LINK_WIFI_IDLE, now);
+        return;
+      }
+      if (inState < link.waitMs) return;
+      Serial.print("[MQTT] connecting as ");
+      Serial.println(link.clientId);
+      link.result.store(0);
+      xTaskNotifyGive(link.worker);
+      linkEnter(LINK_MQTT_CONNECTING, now);
+      return;
+
+    case LINK_MQTT_CONNECTING: {
+      const int8_t r = link.result.load();
+      if (r == 0) return;
+      if (r > 0) {
+        Serial.println("[MQTT] connected");
+        link.backoffMs = LINK_BACKOFF_MIN_MS;
+        link.reconnects++;
+        linkEnter(LINK_UP, now);
+        if (link.onUp) link.onUp();
+      } else {
+        uint32_t wait = linkNextBackoff();
+        Serial.print("[MQTT] failed, rc=");
+        Serial.print(mqtt.state());
+        Serial.print(" retry in ");
+        Serial.print(wait);
+        Serial.println(" ms");
+        linkEnter(LINK_MQTT_IDLE, now, wait);
+      }
+      return;
+    }
 
-  Serial.print("[WiFi] connecting");
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
+    case LINK_UP:
+      if (WiFi.status() != WL_CONNECTED) {
+        Serial.println("[WiFi] lost");
+        mqtt.disconnect();  // drop the stale socket before the next connect()
+        linkEnter(LINK_WIFI_IDLE, now);
+      } else if (!mqtt.loop()) {
+        Serial.println("[MQTT] lost");
+        linkEnter(LINK_MQTT_IDLE, now, linkNextBackoff());
+      }
+      return;
   }
-  Serial.println();
-  Serial.print("[WiFi] connected, IP: ");
-  Serial.println(WiFi.localIP());
 }
 
-static bool payloadContainsLedCommand(const String& s, int& outLed) {
-  // Very simple parser for payload like {"led":1} or {"led":0}
-  int k = s.indexOf("\"led\"");
-  if (k < 0) k = s.indexOf("led");
-  if (k < 0) return false;
+// Compare a SensorML update against the active config and merge only the
+// changed fields into pendingPatch. Returns the CFG_* bits that changed.
+static uint8_t diffConfigUpdate(const String& xml) {
+  uint8_t changed = 0;
+  String v;
+
+  v = getTagValue(xml, "samplingRateHz");
+  if (v.length() > 0) {
+    float hz = v.toFloat();
+    if (hz < 1.0f) hz = 1.0f;
+    if (hz != samplingRateHz) { pendingPatch.samplingRateHz = hz; changed |= CFG_RATE; }
+  }
+  v = getTagValue(xml, "scale");
+  if (v.length() > 0 && v.toFloat() != scale) {
+    pendingPatch.scale = v.toFloat(); changed |= CFG_SCALE;
+  }
+  v = getTagValue(xml, "offset");
+  if (v.length() > 0 && v.toFloat() != offset) {
+    pendingPatch.offset = v.toFloat(); changed |= CFG_OFFSET;
+  }
+  v = getTagValue(xml, "uncertainty");
+  if (v.length() > 0 && v.toFloat() != uncertainty) {
+    pendingPatch.uncertainty = v.toFloat(); changed |= CFG_UNC;
+  }
+  v = getTagValue(xml, "uom");
+  if (v.length() > 0 && v != uom) {
+    pendingPatch.uom = v; changed |= CFG_UOM;
+  }
+  v = getTagValue(xml, "observedProperty");
+  if (v.length() > 0 && v != observedProperty) {
+    pendingPatch.observedProperty = v; changed |= CFG_PROP;
+  }
 
-  int colon = s.indexOf(':', k);
-  if (colon < 0) return false;
+  pendingPatch.mask |= changed;
+  return changed;
+}
+
+// -------------------- MQTT command dispatch --------------------
+// Incoming messages are handled in place, straight from PubSubClient's
+// receive buffer (no String copies of topic or payload):
+//  - The topic is matched against TOPIC_ROUTES by its FNV-1a hash, computed
+//    once in setup(); strcmp() only confirms a hash hit.
+//  - The cmd topic carries a flat JSON object. Every top-level key is
+//    dispatched to the handler registered for it in CMD_HANDLERS, so one
+//    message can carry several commands:
+//      {"led":1}   {"led":"auto"}   {"rate_hz":10,"uncertainty":15}
+//    A new command is one handler plus one CMD_HANDLERS row.
+// PubSubClient reuses its buffer for publish(), so handlers never publish
+// from the callback; they set state that loop() acts on.
+
+static uint32_t fnv1a(const char* s) {
+  uint32_t h = 2166136261u;
+  while (*s) { h ^= (uint8_t)*s++; h *= 16777619u; }
+  return h;
+}
 
-  // find first digit after colon
-  for (int i = colon + 1; i < (int)s.length(); i++) {
-    char c = s[i];
-    if (c == '0' || c == '1') {
-      outLed = (c == '1') ? 1 : 0;
-      return true;
+// A token inside the payload (not NUL-terminated)
+struct JsonSlice {
+  const char* p;
+  uint16_t n;
+  bool quoted;  // string value; p/n exclude the quotes
+};
+
+static bool sliceEquals(const JsonSlice& s, const char* lit) {
+  size_t n = strlen(lit);
+  return s.n == n && memcmp(s.p, lit, n) == 0;
+}
+
+// Numbers are converted from a small stack copy (strtof needs a terminator)
+static bool sliceToFloat(const JsonSlice& s, float& out) {
+  char tmp[24];
+  if (s.quoted || s.n == 0 || s.n >= sizeof(tmp)) return false;
+  memcpy(tmp, s.p, s.n);
+  tmp[s.n] = '\0';
+  char* end;
+  out = strtof(tmp, &end);
+  return end == tmp + s.n;
+}
+
+// Key scanner for a flat JSON object: jsonNext() yields one top-level
+// "key": value pair per call. Nested objects/arrays come back as one
+// unparsed slice; escapes in strings are skipped, not decoded.
+struct JsonScanner {
+  const char* p;
+  const char* end;
+};
+
+static void jsonSkipWs(JsonScanner& js) {
+  while (js.p < js.end && (*js.p == ' ' || *js.p == '\t' || *js.p == '\r' || *js.p == '\n')) js.p++;
+}
+
+static bool jsonBegin(JsonScanner& js, const uint8_t* payload, unsigned int len) {
+  js.p = (const char*)payload;
+  js.end = js.p + len;
+  jsonSkipWs(js);
+  if (js.p >= js.end || *js.p != '{') return false;
+  js.p++;
+  return true;
+}
+
+// js.p is on the opening quote
+static bool jsonString(JsonScanner& js, JsonSlice& out) {
+  const char* s = ++js.p;
+  while (js.p < js.end && *js.p != '"') {
+    if (*js.p == '\\') js.p++;
+    js.p++;
+  }
+  if (js.p >= js.end) return false;
+  out = { s, (uint16_t)(js.p - s), true };
+  js.p++;
+  return true;
+}
+
+static bool jsonValue(JsonScanner& js, JsonSlice& out) {
+  if (*js.p == '"') return jsonString(js, out);
+
+  const char* s = js.p;
+  if (*js.p == '{' || *js.p == '[') {
+    int depth = 0;
+    while (js.p < js.end) {
+      char c = *js.p;
+      if (c == '"') {
+        JsonSlice skip;
+        if (!jsonString(js, skip)) return false;
+        continue;
+      }
+      js.p++;
+      if (c == '{' || c == '[') depth++;
+      else if ((c == '}' || c == ']') && --depth == 0) break;
     }
+    if (depth != 0) return false;
+  } else {
+    // number / true / false / null
+    while (js.p < js.end && *js.p != ',' && *js.p != '}' &&
+           *js.p != ' ' && *js.p != '\t' && *js.p != '\r' && *js.p != '\n') js.p++;
   }
-  return false;
+  out = { s, (uint16_t)(js.p - s), false };
+  return out.n > 0;
 }
 
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  String t = String(topic);
-  String msg;
-  msg.reserve(length + 4);
-  for (unsigned int i = 0; i < length; i++) msg += (char)payload[i];
-  msg.trim();
+static bool jsonNext(JsonScanner& js, JsonSlice& key, JsonSlice& val) {
+  jsonSkipWs(js);
+  if (js.p < js.end && *js.p == ',') { js.p++; jsonSkipWs(js); }
+  if (js.p >= js.end || *js.p != '"') return false;  // '}' or malformed
+  if (!jsonString(js, key)) return false;
+  jsonSkipWs(js);
+  if (js.p >= js.end || *js.p != ':') return false;
+  js.p++;
+  jsonSkipWs(js);
+  if (js.p >= js.end) return false;
+  return jsonValue(js, val);
+}
+
+// ---- Command handlers (cmd topic). Return false if the value is invalid.
+typedef bool (*CommandHandler)(const JsonSlice& value);
+
+// {"led":0|1|"auto"} (true/false accepted too)
+static bool cmdLed(const JsonSlice& v) {
+  if (sliceEquals(v, "auto")) ledOverride = -1;
+  else if (sliceEquals(v, "1") || sliceEquals(v, "true")) ledOverride = 1;
+  else if (sliceEquals(v, "0") || sliceEquals(v, "false")) ledOverride = 0;
+  else return false;
+
+  Serial.print("[CMD] LED override = ");
+  if (ledOverride < 0) Serial.println("AUTO");
+  else Serial.println(ledOverride);
+  return true;
+}
+
+// {"rate_hz":10}: staged like a SensorML update, applied between samples
+static bool cmdRate(const JsonSlice& v) {
+  float hz;
+  if (!sliceToFloat(v, hz)) return false;
+  if (hz < 1.0f) hz = 1.0f;
+  if (hz != samplingRateHz) {
+    pendingPatch.samplingRateHz = hz;
+    pendingPatch.mask |= CFG_RATE;
+  }
+  return true;
+}
+
+// {"uncertainty":15}: also moves the report-by-exception band
+static bool cmdUncertainty(const JsonSlice& v) {
+  float u;
+  if (!sliceToFloat(v, u) || u < 0.0f) return false;
+  if (u != uncertainty) {
+    pendingPatch.uncertainty = u;
+    pendingPatch.mask |= CFG_UNC;
+  }
+  return true;
+}
+
+// {"meta":1}: republish the retained metadata
+static bool cmdMeta(const JsonSlice&) {
+  metaRequested = true;
+  return true;
+}
+
+struct CommandEntry {
+  const char* key;
+  uint8_t keyLen;
+  CommandHandler handler;
+};
+
+#define CMD_ENTRY(k, fn) { k, sizeof(k) - 1, fn }
+const CommandEntry CMD_HANDLERS[] = {
+  CMD_ENTRY("led", cmdLed),
+  CMD_ENTRY("rate_hz", cmdRate),
+  CMD_ENTRY("uncertainty", cmdUncertainty),
+  CMD_ENTRY("meta", cmdMeta),
+};
+
+static const CommandEntry* findCommand(const JsonSlice& key) {
+  for (const CommandEntry& c : CMD_HANDLERS) {
+    if (c.keyLen == key.n && memcmp(c.key, key.p, key.n) == 0) return &c;
+  }
+  return nullptr;
+}
+
+static void onCmdTopic(const uint8_t* payload, unsigned int length) {
+  JsonScanner js;
+  if (!jsonBegin(js, payload, length)) {
+    // Bare value (e.g. "auto", "1") is an LED command, as before
+    JsonSlice v = { (const char*)payload, (uint16_t)length, false };
+    while (v.n && isspace((unsigned char)v.p[v.n - 1])) v.n--;
+    while (v.n && isspace((unsigned char)*v.p)) { v.p++; v.n--; }
+    if (!cmdLed(v)) Serial.println("[CMD] ignored (not a JSON object)");
+    return;
+  }
 
+  JsonSlice key, val;
+  while (jsonNext(js, key, val)) {
+    const CommandEntry* c = findCommand(key);
+    if (c && c->handler(val)) continue;
+    Serial.print(c ? "[CMD] bad value for " : "[CMD] unknown command ");
+    Serial.write((const uint8_t*)key.p, key.n);
+    Serial.println();
+  }
+}
+
+// Full or partial SensorML document. Rare and XML, so this is the one
+// path that still copies the payload into a String for getTagValue().
+static void onCfgTopic(const uint8_t* payload, unsigned int length) {
+  String xml;
+  xml.concat((const char*)payload, length);
+  uint8_t changed = diffConfigUpdate(xml);
+  Serial.print("[CFG] update staged, changed=0x");
+  Serial.println(changed, HEX);
+}
+
+// ---- Topic table (subscribed in onLinkUp, hashes filled by topicRoutesInit)
+typedef void (*TopicHandler)(const uint8_t* payload, unsigned int length);
+
+struct TopicRoute {
+  const String* topic;
+  TopicHandler handler;
+  uint32_t hash;
+};
+
+TopicRoute TOPIC_ROUTES[] = {
+  { &TOPIC_CMD, onCmdTopic, 0 },
+  { &TOPIC_CFG, onCfgTopic, 0 },
+};
+
+static void topicRoutesInit() {
+  for (TopicRoute& r : TOPIC_ROUTES) r.hash = fnv1a(r.topic->c_str());
+}
+
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
   Serial.print("[MQTT] msg on ");
-  Serial.print(t);
+  Serial.print(topic);
   Serial.print(" : ");
-  Serial.println(msg);
-
-  if (t == TOPIC_CMD) {
-    int led = -1;
-    if (payloadContainsLedCommand(msg, led)) {
-      ledOverride = led ? 1 : 0;
-      Serial.print("[CMD] LED override = ");
-      Serial.println(ledOverride);
-    } else if (msg.indexOf("auto") >= 0) {
-      ledOverride = -1; // back to auto
-      Serial.println("[CMD] LED override = AUTO");
+  Serial.write(payload, length);
+  Serial.println();
+
+  const uint32_t h = fnv1a(topic);
+  for (const TopicRoute& r : TOPIC_ROUTES) {
+    if (r.hash == h && strcmp(topic, r.topic->c_str()) == 0) {
+      r.handler(payload, length);
+      return;
     }
   }
 }
 
-void mqttConnect() {
-  mqtt.setServer(MQTT_HOST, MQTT_PORT);
-  mqtt.setCallback(mqttCallback);
+// -------------------- Report-by-exception --------------------
+// REPORT_EVERY_SAMPLE:  publish every sample (original behavior)
+// REPORT_DEADBAND:      publish when |x - last published| > band, where
+//                       band = REPORT_K * uncertainty (SensorML, in uom).
+//                       Step-hold reconstruction error <= band.
+// REPORT_SWINGING_DOOR: swinging-door trend compression with the same band.
+//                       Published points are the trend's corners (sent one
+//                       sample late, value on the fitted line); linear
+//                       interpolation between them stays within band of
+//                       every sample.
+// In both exception modes a sample is also sent when nothing was published
+// for REPORT_HEARTBEAT_MS, so consumers can tell "flat" from "offline".
+// Copied in sensorML/lab/lm73/extension (host check: report_filter_sim).
+enum ReportMode { REPORT_EVERY_SAMPLE, REPORT_DEADBAND, REPORT_SWINGING_DOOR };
+const ReportMode REPORT_MODE = REPORT_DEADBAND;
+const float REPORT_K = 1.0f;
+const unsigned long REPORT_HEARTBEAT_MS = 60000;
+const unsigned long REPORT_STATS_MS = 60000;   // [REPORT] line on Serial
+
+struct ReportFilter {
+  ReportMode mode = REPORT_MODE;
+  bool started = false;
+  float lastV = 0;             // last published point
+  unsigned long lastMs = 0;
+  unsigned long prevMs = 0;    // most recent sample (swinging-door candidate)
+  float slopeHi = 0, slopeLo = 0;
+  uint32_t seen = 0, sent = 0;   // samples in, points published
+};
+
+static void reportStart(ReportFilter& f, float v, unsigned long t) {
+  f.lastV = v;
+  f.lastMs = f.prevMs = t;
+  f.slopeHi = INFINITY;
+  f.slopeLo = -INFINITY;
+}
 
-  while (!mqtt.connected()) {
-    String cid = "esp32-" + String((uint32_t)ESP.getEfuseMac(), HEX);
-    Serial.print("[MQTT] connecting as ");
-    Serial.println(cid);
-
-    if (mqtt.connect(cid.c_str())) {
-      Serial.println("[MQTT] connected");
-      mqtt.subscribe(TOPIC_CMD.c_str());
-    } else {
-      Serial.print("[MQTT] failed, rc=");
-      Serial.println(mqtt.state());
-      delay(1000);
-    }
+// Returns true if a point should be published; outV/outMs is that point
+// (for swinging door it can be the previous sample).
+static bool reportSample(ReportFilter& f, float v, unsigned long t, float band,
+                         float& outV, unsigned long& outMs) {
+  f.seen++;
+  outV = v;
+  outMs = t;
+
+  if (f.mode == REPORT_EVERY_SAMPLE || !f.started) {
+    f.started = true;
+    reportStart(f, v, t);
+    f.sent++;
+    return true;
+  }
+
+  if (f.mode == REPORT_DEADBAND) {
+    if (fabsf(v - f.lastV) <= band && t - f.lastMs < REPORT_HEARTBEAT_MS) return false;
+    reportStart(f, v, t);
+    f.sent++;
+    return true;
   }
+
+  // Swinging door: narrow the doors from the last corner with this sample
+  float dt = (float)(t - f.lastMs);
+  if (dt <= 0) return false;
+  const float hi = min(f.slopeHi, (v + band - f.lastV) / dt);
+  const float lo = max(f.slopeLo, (v - band - f.lastV) / dt);
+
+  if (lo > hi) {
+    // Doors crossed: close the segment at the previous sample. The corner
+    // is put on the mid-door line (within band of that sample), so every
+    // sample of the segment is within band of the interpolation.
+    const float s = 0.5f * (f.slopeHi + f.slopeLo);
+    outV = f.lastV + s * (float)(f.prevMs - f.lastMs);
+    outMs = f.prevMs;
+    f.lastV = outV;
+    f.lastMs = f.prevMs;
+    float d = (float)(t - f.lastMs);
+    f.slopeHi = (v + band - f.lastV) / d;
+    f.slopeLo = (v - band - f.lastV) / d;
+    f.prevMs = t;
+    f.sent++;
+    return true;
+  }
+
+  f.slopeHi = hi;
+  f.slopeLo = lo;
+
+  if (t - f.lastMs >= REPORT_HEARTBEAT_MS) {
+    // Heartbeat: close the segment at this sample (on the mid-door line)
+    outV = f.lastV + 0.5f * (hi + lo) * dt;
+    reportStart(f, outV, t);
+    f.sent++;
+    return true;
+  }
+
+  f.prevMs = t;
+  return false;
+}
+
+ReportFilter ldrReport;
+unsigned long lastReportStatsMs = 0;
+
+static const char* reportModeName() {
+  switch (REPORT_MODE) {
+    case REPORT_DEADBAND:      return "deadband";
+    case REPORT_SWINGING_DOOR: return "swinging_door";
+    default:                   return "every_sample";
+  }
+}
+
+// [REPORT] mode=deadband seen=<samples> sent=<published> (<percent>%)
+static void printReportStats() {
+  Serial.print("[REPORT] mode=");
+  Serial.print(reportModeName());
+  Serial.print(" seen=");
+  Serial.print(ldrReport.seen);
+  Serial.print(" sent=");
+  Serial.print(ldrReport.sent);
+  Serial.print(" (");
+  Serial.print(ldrReport.seen ? 100.0f * ldrReport.sent / ldrReport.seen : 0.0f, 2);
+  Serial.println("%)");
 }
 
 // -------------------- Publishing --------------------
 void publishMetadataRetained() {
   String meta;
-  meta.reserve(220);
+  meta.reserve(320);
 
   meta += "{";
   meta += "\"id\":\"" + sensorId + "\",";
@@ -191,28 +745,123 @@ void publishMetadataRetained() {
   meta += "\"scale\":" + String(scale, 6) + ",";
   meta += "\"offset\":" + String(offset, 6);
   meta += "},";
-  meta += "\"uncertainty\":" + String(uncertainty, 4);
+  meta += "\"uncertainty\":" + String(uncertainty, 4) + ",";
+  // How to reconstruct the series between published samples
+  meta += "\"report\":{\"mode\":\"" + String(reportModeName()) + "\",";
+  meta += "\"band\":" + String(REPORT_K * uncertainty, 4) + ",";
+  meta += "\"heartbeat_ms\":" + String(REPORT_HEARTBEAT_MS) + "}";
   meta += "}";
 
   // retained = true so Node-RED receives metadata immediately after subscribing
+  if (!linkUp()) return;  // republished by onLinkUp() after reconnect
   mqtt.publish(TOPIC_META.c_str(), meta.c_str(), true);
   Serial.println("[MQTT] published metadata (retained)");
 }
 
+// Static parts of every telemetry message, rendered once from SensorML
+// (and again after a live reconfiguration), so a sample only formats
+// its value and timestamp.
+struct JsonFragment {
+  char s[128];
+  size_t n;
+};
+
+JsonFragment fragHead;  // {"id":"...","property":"...","value":
+JsonFragment fragMid;   // ,"uom":"...","uncertainty":...,"ts_ms":
+
+// False when a SensorML string did not fit its fragment: a truncated
+// fragment is not valid JSON, so telemetry is skipped (and counted) until
+// a reconfiguration renders fragments that fit.
+bool fragsValid = false;
+uint32_t tlmSkipped = 0;
+unsigned long lastSkipReportMs = 0;
+
+// Count a skipped message; at most one [TLM] line per 10 s says how many
+static void countSkipped(unsigned long nowMs) {
+  tlmSkipped++;
+  if (tlmSkipped > 1 && nowMs - lastSkipReportMs < 10000) return;
+  lastSkipReportMs = nowMs;
+  Serial.print("[TLM] skipped=");
+  Serial.println(tlmSkipped);
+}
+
+void buildTelemetryFragments() {
+  JsonWriter<128> w;
+
+  w.raw("{\"id\":\""); w.raw(sensorId.c_str());
+  w.raw("\",\"property\":\""); w.raw(observedProperty.c_str());
+  w.raw("\",\"value\":");
+  bool ok = !w.overflow;
+  memcpy(fragHead.s, w.buf, w.len);
+  fragHead.n = w.len;
+
+  w.reset();
+  w.raw(",\"uom\":\""); w.raw(uom.c_str());
+  w.raw("\",\"uncertainty\":"); w.fixed(uncertainty, 4);
+  w.raw(",\"ts_ms\":");
+  ok = ok && !w.overflow;
+  memcpy(fragMid.s, w.buf, w.len);
+  fragMid.n = w.len;
+
+  fragsValid = ok;
+  if (!ok) Serial.println("[TLM] id/property/uom too long for a telemetry fragment; telemetry disabled");
+}
+
+// Render one telemetry line; the same bytes go to Serial and MQTT.
 void publishTelemetry(float value, unsigned long nowMs) {
-  String msg;
-  msg.reserve(180);
+  JsonWriter<192> msg;
+  msg.raw(fragHead.s, fragHead.n);
+  msg.fixed(value, 2);
+  msg.raw(fragMid.s, fragMid.n);
+  msg.u32((uint32_t)nowMs);
+  msg.raw("}", 1);
+  if (!fragsValid || msg.overflow) { countSkipped(nowMs); return; }
 
-  msg += "{";
-  msg += "\"id\":\"" + sensorId + "\",";
-  msg += "\"property\":\"" + observedProperty + "\",";
-  msg += "\"value\":" + String(value, 2) + ",";
-  msg += "\"uom\":\"" + uom + "\",";
-  msg += "\"uncertainty\":" + String(uncertainty, 4) + ",";
-  msg += "\"ts_ms\":" + String(nowMs);
-  msg += "}";
+  // Print to Serial (self-describing JSON)
+  Serial.write((const uint8_t*)msg.buf, msg.len);
+  Serial.write('\n');
 
-  mqtt.publish(TOPIC_TLM.c_str(), msg.c_str());
+  if (linkUp()) mqtt.publish(TOPIC_TLM.c_str(), (const uint8_t*)msg.buf, msg.len);
+}
+
+// Apply the staged patch in one step. Called from loop() right before a
+// sampling decision, so a sample never sees a half-updated config.
+// The sampling phase (lastSampleMs) is kept, so a rate change takes effect
+// on the next tick instead of restarting the schedule.
+static void applyPendingConfig() {
+  uint32_t t0 = micros();
+  const uint8_t m = pendingPatch.mask;
+
+  if (m & CFG_RATE) {
+    samplingRateHz = pendingPatch.samplingRateHz;
+    samplePeriodMs = (unsigned long)(1000.0f / samplingRateHz);
+  }
+  if (m & CFG_SCALE)  scale = pendingPatch.scale;
+  if (m & CFG_OFFSET) offset = pendingPatch.offset;
+  if (m & CFG_UNC)    uncertainty = pendingPatch.uncertainty;
+  if (m & CFG_UOM)    uom = pendingPatch.uom;
+  if (m & CFG_PROP)   observedProperty = pendingPatch.observedProperty;
+
+  pendingPatch.mask = 0;
+  if (m & (CFG_UNC | CFG_UOM | CFG_PROP)) buildTelemetryFragments();
+  uint32_t applyUs = micros() - t0;
+
+  Serial.print("[CFG] applied mask=0x");
+  Serial.print(m, HEX);
+  Serial.print(" in ");
+  Serial.print(applyUs);
+  Serial.print(" us, samplePeriodMs=");
+  Serial.println(samplePeriodMs);
+
+  // Consumers rely on the retained metadata to interpret telemetry
+  publishMetadataRetained();
+}
+
+// Runs in loop() after every (re)connect: subscriptions do not survive a
+// clean session, and late subscribers rely on the retained metadata
+static void onLinkUp() {
+  for (const TopicRoute& r : TOPIC_ROUTES) mqtt.subscribe(r.topic->c_str());
+  publishMetadataRetained();
 }
 
 // -------------------- Setup / Loop --------------------
@@ -237,7 +886,7 @@ void setup() {
   samplingRateHz = getTagFloat(xml, "samplingRateHz", 20.0f);
   scale = getTagFloat(xml, "scale", 1.0f);
   offset = getTagFloat(xml, "offset", 0.0f);
-  uncertainty = getTagFloat(xml, "uncertainty", 0.05f);
+  uncertainty = getTagFloat(xml, "uncertainty", 20.0f);
 
   if (sensorId.length() == 0) sensorId = "LDR_ESP32_01";
   if (observedProperty.length() == 0) observedProperty = "LightLevel";
@@ -245,6 +894,7 @@ void setup() {
   if (samplingRateHz < 1.0f) samplingRateHz = 1.0f;
 
   samplePeriodMs = (unsigned long)(1000.0f / samplingRateHz);
+  buildTelemetryFragments();
 
   Serial.println("=== SensorML Parsed Config ===");
   Serial.print("identifier: "); Serial.println(sensorId);
@@ -257,19 +907,34 @@ void setup() {
   Serial.print("samplePeriodMs: "); Serial.println(samplePeriodMs);
   Serial.println("================================");
 
-  // Connect Wi-Fi and MQTT
-  wifiConnect();
-  mqttConnect();
+  // Wi-Fi + MQTT connect in the background; sampling starts right away
+  mqtt.setServer(MQTT_HOST, MQTT_PORT);
+  topicRoutesInit();
+  mqtt.setCallback(mqttCallback);
+  mqtt.setBufferSize(1024); // room for SensorML config updates (default 256)
 
-  // Publish metadata once (retained)
-  publishMetadataRetained();
+  String cid = "esp32-" + String((uint32_t)ESP.getEfuseMac(), HEX);
+  randomSeed((uint32_t)ESP.getEfuseMac());
+  linkBegin(cid.c_str(), onLinkUp);
 }
 
 void loop() {
-  if (!mqtt.connected()) mqttConnect();
-  mqtt.loop();
-
   unsigned long now = millis();
+
+  // keep connections alive (never blocks; sampling continues offline)
+  linkPoll(now);
+
+  // Config updates land between samples, never in the middle of one
+  if (pendingPatch.mask) applyPendingConfig();
+  if (metaRequested) {
+    metaRequested = false;
+    publishMetadataRetained();
+  }
+  if (now - lastReportStatsMs >= REPORT_STATS_MS) {
+    lastReportStatsMs = now;
+    printReportStats();
+  }
+
   if (now - lastSampleMs < samplePeriodMs) return;
   lastSampleMs = now;
 
@@ -286,21 +951,11 @@ void loop() {
   else if (ledOverride == 0) digitalWrite(LED_PIN, LOW);
   else digitalWrite(LED_PIN, ledAuto ? HIGH : LOW);
 
-  // Print to Serial (self-describing JSON)
-  Serial.print("{\"id\":\"");
-  Serial.print(sensorId);
-  Serial.print("\",\"property\":\"");
-  Serial.print(observedProperty);
-  Serial.print("\",\"value\":");
-  Serial.print(calibrated, 2);
-  Serial.print(",\"uom\":\"");
-  Serial.print(uom);
-  Serial.print("\",\"uncertainty\":");
-  Serial.print(uncertainty, 4);
-  Serial.print(",\"ts_ms\":");
-  Serial.print(now);
-  Serial.println("}");
-
-  // Publish to MQTT
-  publishTelemetry(calibrated, now);
+  // Print to Serial + publish to MQTT (one rendered buffer), only when the
+  // value moved by more than the SensorML uncertainty band (REPORT_MODE)
+  float outV;
+  unsigned long outMs;
+  if (reportSample(ldrReport, calibrated, now, REPORT_K * uncertainty, outV, outMs)) {
+    publishTelemetry(outV, outMs);
+  }
 }
@@ -1,8 +1,11 @@
 /*
   ESP32 SensorML Multi-Sensor (LDR + WiFi RSSI + LM73)
   ---------------------------------------------------
-  - Parses simplified multi-sensor SensorML XML (3 sensors)
-  - Independent sampling per sensor
+  - Parses simplified multi-sensor SensorML XML in a single pass into a
+    SensorConfig array (any number of <Sensor> blocks, up to MAX_SENSORS)
+  - Independent sampling per sensor, driven by that array: a min-heap of
+    deadlines dispatches only the sensors that are due, then loop() sleeps
+    until the next one (per-sensor rate/lateness as [sched] lines)
   - Outputs self-describing JSON per reading
 
   Sensors:
@@ -43,7 +46,7 @@ const char* SENSORML_XML = R"xml(
         <scale>1.0</scale>
         <offset>0.0</offset>
       </calibration>
-      <uncertainty>0.05</uncertainty>
+      <uncertainty>20</uncertainty>  <!-- absolute, in uom (ADC noise) -->
     </Sensor>
 
     <Sensor>
@@ -95,29 +98,14 @@ static float getTagFloat(const String& xml, const String& tag, float defVal) {
   return v.toFloat();
 }
 
-// Extract the Nth <Sensor> ... </Sensor> block
-static bool getSensorBlock(const String& xml, int index, String& outBlock) {
-  const String open = "<Sensor>";
-  const String close = "</Sensor>";
-
-  int pos = 0;
-  for (int i = 0; i <= index; i++) {
-    int s = xml.indexOf(open, pos);
-    if (s < 0) return false;
-    int e = xml.indexOf(close, s);
-    if (e < 0) return false;
-    e += close.length();
-    if (i == index) {
-      outBlock = xml.substring(s, e);
-      outBlock.trim();
-      return true;
-    }
-    pos = e;
-  }
-  return false;
-}
-
 // -------------------- Sensor Config --------------------
+// What a <Sensor> block is wired to, derived from <observedProperty>
+enum SensorKind : uint8_t {
+  KIND_ADC = 0,   // analogRead(pin)
+  KIND_RSSI,      // WiFi.RSSI()
+  KIND_LM73       // LM73 over I2C
+};
+
 struct SensorConfig {
   String id;
   String prop;
@@ -127,8 +115,26 @@ struct SensorConfig {
   float offset = 0.0f;
   float uncertainty = 0.0f;
   String targetSSID; // RSSI only
+  int pin = LDR_PIN; // ADC only (<pin>, default GPIO34)
+
+  // Runtime state (filled after parsing)
+  SensorKind kind = KIND_ADC;
+  uint32_t periodUs = 1000000;
+  uint32_t nextDueUs = 0;    // deadline scheduler (see dueHeap)
+
+  // Scheduler stats since the last [sched] report
+  uint32_t runs = 0;
+  uint32_t skipped = 0;      // slots missed by a whole period or more
+  uint32_t lateSumUs = 0;
+  uint32_t lateMaxUs = 0;
 };
 
+static SensorKind kindFromProperty(const String& prop) {
+  if (prop == "WiFiRSSI") return KIND_RSSI;
+  if (prop == "Temperature") return KIND_LM73;
+  return KIND_ADC;
+}
+
 static bool parseSensorConfig(const String& block, SensorConfig& cfg) {
   cfg.id = getTagValue(block, "identifier");
   cfg.prop = getTagValue(block, "observedProperty");
@@ -138,25 +144,167 @@ static bool parseSensorConfig(const String& block, SensorConfig& cfg) {
   cfg.offset = getTagFloat(block, "offset", 0.0f);
   cfg.uncertainty = getTagFloat(block, "uncertainty", 0.0f);
   cfg.targetSSID = getTagValue(block, "targetSSID");
+  cfg.pin = (int)getTagFloat(block, "pin", (float)LDR_PIN);
 
   if (cfg.rateHz < 0.2f) cfg.rateHz = 0.2f; // avoid zero/very slow
   if (cfg.id.length() == 0 || cfg.prop.length() == 0 || cfg.uom.length() == 0) return false;
+
+  cfg.kind = kindFromProperty(cfg.prop);
+  cfg.periodUs = (uint32_t)(1000000.0f / cfg.rateHz);
   return true;
 }
 
-// -------------------- State --------------------
-SensorConfig cfgLdr, cfgRssi, cfgLm73;
+// Enumerate every <Sensor> ... </Sensor> block in ONE forward pass.
+// Each search resumes where the previous block ended, so the document is
+// scanned once regardless of how many sensors it declares.
+// Returns the number of valid configs written to out[0..capacity-1].
+static int parseAllSensors(const String& xml, SensorConfig* out, int capacity) {
+  const String open = "<Sensor>";
+  const String close = "</Sensor>";
 
-unsigned long periodLdrMs = 50;
-unsigned long periodRssiMs = 500;
-unsigned long periodLm73Ms = 500;
+  int count = 0;
+  int pos = 0;
+  while (true) {
+    int s = xml.indexOf(open, pos);
+    if (s < 0) break;
+    int e = xml.indexOf(close, s);
+    if (e < 0) break;
+    e += close.length();
+    pos = e;
 
-unsigned long lastLdrMs = 0;
-unsigned long lastRssiMs = 0;
-unsigned long lastLm73Ms = 0;
+    if (count >= capacity) {
+      Serial.println("[SensorML] MAX_SENSORS reached, ignoring extra <Sensor> blocks");
+      break;
+    }
+    if (parseSensorConfig(xml.substring(s, e), out[count])) count++;
+  }
+  return count;
+}
+
+// -------------------- State --------------------
+static const int MAX_SENSORS = 16;
+SensorConfig sensors[MAX_SENSORS];
+int sensorCount = 0;
+bool wifiNeeded = false; // true if any sensor is KIND_RSSI
+bool i2cNeeded = false;  // true if any sensor is KIND_LM73
 
 uint8_t lm73Addr = 0;
 
+// Latest calibrated readings used by the CPS LED rule
+float lastRssi = NAN;
+float lastTempC = NAN;
+
+// -------------------- Deadline scheduler --------------------
+// dueHeap holds sensor indices as a min-heap on nextDueUs. loop() pops only
+// the sensors whose deadline has passed, O(log n) each, then sleeps until the
+// earliest remaining deadline, so idle sensors cost nothing per pass.
+// A deadline advances by exactly one period (fixed grid, no drift); a sensor
+// that fell a whole period behind skips the missed slots and counts them.
+// Times are micros() differences, so the 32-bit wrap is harmless.
+static const unsigned long SCHED_REPORT_MS = 10000;   // [sched] line per sensor
+static const unsigned long SCHED_MAX_SLEEP_MS = 100;  // keeps the Wi-Fi check responsive
+
+uint8_t dueHeap[MAX_SENSORS];
+int dueHeapSize = 0;
+uint32_t schedStatsStartUs = 0;
+unsigned long lastSchedReportMs = 0;
+
+static bool dueBefore(int a, int b) {
+  return (int32_t)(sensors[a].nextDueUs - sensors[b].nextDueUs) < 0;
+}
+
+static void heapSiftDown(int pos) {
+  const uint8_t item = dueHeap[pos];
+  while (true) {
+    int child = 2 * pos + 1;
+    if (child >= dueHeapSize) break;
+    if (child + 1 < dueHeapSize && dueBefore(dueHeap[child + 1], dueHeap[child])) child++;
+    if (!dueBefore(dueHeap[child], item)) break;
+    dueHeap[pos] = dueHeap[child];
+    pos = child;
+  }
+  dueHeap[pos] = item;
+}
+
+static void schedResetStats(uint32_t nowUs) {
+  for (int i = 0; i < sensorCount; i++) {
+    SensorConfig& c = sensors[i];
+    c.runs = 0;
+    c.skipped = 0;
+    c.lateSumUs = 0;
+    c.lateMaxUs = 0;
+  }
+  schedStatsStartUs = nowUs;
+}
+
+// (Re)build the heap from sensors[0..sensorCount-1], every sensor due at startUs
+static void schedBegin(uint32_t startUs) {
+  dueHeapSize = sensorCount;
+  for (int i = 0; i < sensorCount; i++) {
+    sensors[i].nextDueUs = startUs;
+    dueHeap[i] = (uint8_t)i;
+  }
+  for (int i = dueHeapSize / 2 - 1; i >= 0; i--) heapSiftDown(i);
+  schedResetStats(startUs);
+}
+
+// Index of the earliest sensor if it is due (its deadline is advanced and
+// the heap reordered), else -1
+static int schedNextDue(uint32_t nowUs) {
+  if (dueHeapSize == 0) return -1;
+  const int i = dueHeap[0];
+  SensorConfig& c = sensors[i];
+  int32_t late = (int32_t)(nowUs - c.nextDueUs);
+  if (late < 0) return -1;
+
+  if ((uint32_t)late >= c.periodUs) {
+    const uint32_t missed = (uint32_t)late / c.periodUs;
+    c.nextDueUs += missed * c.periodUs;
+    c.skipped += missed;
+    late -= (int32_t)(missed * c.periodUs);
+  }
+  c.runs++;
+  c.lateSumUs += (uint32_t)late;
+  if ((uint32_t)late > c.lateMaxUs) c.lateMaxUs = (uint32_t)late;
+  c.nextDueUs += c.periodUs;
+  heapSiftDown(0);
+  return i;
+}
+
+static uint32_t schedUntilNextUs(uint32_t nowUs) {
+  if (dueHeapSize == 0) return SCHED_MAX_SLEEP_MS * 1000;
+  const int32_t d = (int32_t)(sensors[dueHeap[0]].nextDueUs - nowUs);
+  return d > 0 ? (uint32_t)d : 0;
+}
+
+// delay() blocks the task, so the idle task runs (and the CPU can light-sleep
+// with power management on); the sub-millisecond remainder is busy-waited
+static void schedSleep(uint32_t waitUs) {
+  if (waitUs >= SCHED_MAX_SLEEP_MS * 1000) delay(SCHED_MAX_SLEEP_MS);
+  else if (waitUs >= 1000) delay(waitUs / 1000);
+  else if (waitUs > 0) delayMicroseconds(waitUs);
+}
+
+// [sched] <id> rate=<actual>/<nominal>Hz late_avg_us=... late_max_us=... skipped=...
+static void printSchedStats(uint32_t nowUs) {
+  const float secs = (float)(nowUs - schedStatsStartUs) / 1e6f;
+  for (int i = 0; i < sensorCount; i++) {
+    const SensorConfig& c = sensors[i];
+    Serial.print("[sched] ");
+    Serial.print(c.id);
+    Serial.print(" rate=");
+    Serial.print(secs > 0 ? (float)c.runs / secs : 0.0f, 2);
+    Serial.print("/");
+    Serial.print(1e6f / (float)c.periodUs, 2);
+    Serial.print("Hz late_avg_us=");
+    Serial.print(c.runs ? c.lateSumUs / c.runs : 0);
+    Serial.print(" late_max_us=");
+    Serial.print(c.lateMaxUs);
+    Serial.print(" skipped=");
+    Serial.println(c.skipped);
+  }
+}
+
 // -------------------- Wi-Fi --------------------
 static void connectWiFi() {
   WiFi.mode(WIFI_STA);
@@ -206,8 +354,121 @@ static bool readLM73TempC(float &tempC) {
   return true;
 }
 
+// -------------------- Report-by-exception --------------------
+// REPORT_EVERY_SAMPLE:  publish every sample (original behavior)
+// REPORT_DEADBAND:      publish when |x - last published| > band, where
+//                       band = REPORT_K * uncertainty (SensorML, in uom).
+//                       Step-hold reconstruction error <= band.
+// REPORT_SWINGING_DOOR: swinging-door trend compression with the same band.
+//                       Published points are the trend's corners (sent one
+//                       sample late, value on the fitted line); linear
+//                       interpolation between them stays within band of
+//                       every sample.
+// In both exception modes a sample is also sent when nothing was published
+// for REPORT_HEARTBEAT_MS, so consumers can tell "flat" from "offline".
+// Copy of sensorML/lab/ldr/extension's filter (host check: report_filter_sim).
+enum ReportMode { REPORT_EVERY_SAMPLE, REPORT_DEADBAND, REPORT_SWINGING_DOOR };
+const ReportMode REPORT_MODE = REPORT_DEADBAND;
+const float REPORT_K = 1.0f;
+const unsigned long REPORT_HEARTBEAT_MS = 60000;
+
+struct ReportFilter {
+  ReportMode mode = REPORT_MODE;
+  bool started = false;
+  float lastV = 0;             // last published point
+  unsigned long lastMs = 0;
+  unsigned long prevMs = 0;    // most recent sample (swinging-door candidate)
+  float slopeHi = 0, slopeLo = 0;
+  uint32_t seen = 0, sent = 0;   // samples in, points published
+};
+
+static void reportStart(ReportFilter& f, float v, unsigned long t) {
+  f.lastV = v;
+  f.lastMs = f.prevMs = t;
+  f.slopeHi = INFINITY;
+  f.slopeLo = -INFINITY;
+}
+
+// Returns true if a point should be published; outV/outMs is that point
+// (for swinging door it can be the previous sample).
+static bool reportSample(ReportFilter& f, float v, unsigned long t, float band,
+                         float& outV, unsigned long& outMs) {
+  f.seen++;
+  outV = v;
+  outMs = t;
+
+  if (f.mode == REPORT_EVERY_SAMPLE || !f.started) {
+    f.started = true;
+    reportStart(f, v, t);
+    f.sent++;
+    return true;
+  }
+
+  if (f.mode == REPORT_DEADBAND) {
+    if (fabsf(v - f.lastV) <= band && t - f.lastMs < REPORT_HEARTBEAT_MS) return false;
+    reportStart(f, v, t);
+    f.sent++;
+    return true;
+  }
+
+  // Swinging door: narrow the doors from the last corner with this sample
+  float dt = (float)(t - f.lastMs);
+  if (dt <= 0) return false;
+  const float hi = min(f.slopeHi, (v + band - f.lastV) / dt);
+  const float lo = max(f.slopeLo, (v - band - f.lastV) / dt);
+
+  if (lo > hi) {
+    // Doors crossed: close the segment at the previous sample. The corner
+    // is put on the mid-door line (within band of that sample), so every
+    // sample of the segment is within band of the interpolation.
+    const float s = 0.5f * (f.slopeHi + f.slopeLo);
+    outV = f.lastV + s * (float)(f.prevMs - f.lastMs);
+    outMs = f.prevMs;
+    f.lastV = outV;
+    f.lastMs = f.prevMs;
+    float d = (float)(t - f.lastMs);
+    f.slopeHi = (v + band - f.lastV) / d;
+    f.slopeLo = (v - band - f.lastV) / d;
+    f.prevMs = t;
+    f.sent++;
+    return true;
+  }
+
+  f.slopeHi = hi;
+  f.slopeLo = lo;
+
+  if (t - f.lastMs >= REPORT_HEARTBEAT_MS) {
+    // Heartbeat: close the segment at this sample (on the mid-door line)
+    outV = f.lastV + 0.5f * (hi + lo) * dt;
+    reportStart(f, outV, t);
+    f.sent++;
+    return true;
+  }
+
+  f.prevMs = t;
+  return false;
+}
+
+ReportFilter reports[MAX_SENSORS];   // one per sensors[] entry
+
+// [report] <id> seen=<samples> sent=<published> (<percent>%), next to [sched]
+static void printReportStats() {
+  for (int i = 0; i < sensorCount; i++) {
+    const ReportFilter& f = reports[i];
+    Serial.print("[report] ");
+    Serial.print(sensors[i].id);
+    Serial.print(" seen=");
+    Serial.print(f.seen);
+    Serial.print(" sent=");
+    Serial.print(f.sent);
+    Serial.print(" (");
+    Serial.print(f.seen ? 100.0f * f.sent / f.seen : 0.0f, 2);
+    Serial.println("%)");
+  }
+}
+
 // -------------------- Output helpers --------------------
-static void printJsonBasic(const SensorConfig& cfg, float value, unsigned long ts) {
+static void printJson(const SensorConfig& cfg, float value, unsigned long ts) {
   Serial.print("{\"id\":\"");
   Serial.print(cfg.id);
   Serial.print("\",\"property\":\"");
@@ -218,45 +479,82 @@ static void printJsonBasic(const SensorConfig& cfg, float value, unsigned long t
   Serial.print(cfg.uom);
   Serial.print("\",\"uncertainty\":");
   Serial.print(cfg.uncertainty, 3);
+  if (cfg.kind == KIND_RSSI) {
+    Serial.print(",\"ssid\":\"");
+    Serial.print(WiFi.SSID());
+    Serial.print("\"");
+  } else if (cfg.kind == KIND_LM73) {
+    Serial.print(",\"i2c_addr\":\"0x");
+    Serial.print(lm73Addr, HEX);
+    Serial.print("\"");
+  }
   Serial.print(",\"ts_ms\":");
   Serial.print(ts);
   Serial.println("}");
 }
 
-static void printJsonRssi(float value, unsigned long ts) {
-  Serial.print("{\"id\":\"");
-  Serial.print(cfgRssi.id);
-  Serial.print("\",\"property\":\"");
-  Serial.print(cfgRssi.prop);
-  Serial.print("\",\"value\":");
-  Serial.print(value, 2);
-  Serial.print(",\"uom\":\"");
-  Serial.print(cfgRssi.uom);
-  Serial.print("\",\"uncertainty\":");
-  Serial.print(cfgRssi.uncertainty, 2);
-  Serial.print(",\"ssid\":\"");
-  Serial.print(WiFi.SSID());
-  Serial.print("\",\"ts_ms\":");
-  Serial.print(ts);
-  Serial.println("}");
+// -------------------- Per-sensor sampling --------------------
+// Reads the raw (uncalibrated) value; returns false if the read failed.
+static bool sampleSensor(const SensorConfig& cfg, float& raw) {
+  switch (cfg.kind) {
+    case KIND_RSSI:
+      raw = (float)WiFi.RSSI();
+      return true;
+    case KIND_LM73:
+      if (lm73Addr == 0) {
+        Serial.println("{\"error\":\"LM73 not found\"}");
+        return false;
+      }
+      if (!readLM73TempC(raw)) {
+        Serial.println("{\"error\":\"LM73 read failed\"}");
+        return false;
+      }
+      return true;
+    case KIND_ADC:
+    default:
+      raw = (float)analogRead(cfg.pin);
+      return true;
+  }
 }
 
-static void printJsonLm73(float value, unsigned long ts) {
-  Serial.print("{\"id\":\"");
-  Serial.print(cfgLm73.id);
-  Serial.print("\",\"property\":\"");
-  Serial.print(cfgLm73.prop);
-  Serial.print("\",\"value\":");
-  Serial.print(value, 3);
-  Serial.print(",\"uom\":\"");
-  Serial.print(cfgLm73.uom);
-  Serial.print("\",\"uncertainty\":");
-  Serial.print(cfgLm73.uncertainty, 3);
-  Serial.print(",\"i2c_addr\":\"0x");
-  Serial.print(lm73Addr, HEX);
-  Serial.print("\",\"ts_ms\":");
-  Serial.print(ts);
-  Serial.println("}");
+static void loadDefaultSensors() {
+  sensorCount = 3;
+
+  SensorConfig& ldr = sensors[0];
+  ldr.id = "LDR_ESP32_01";
+  ldr.prop = "LightLevel";
+  ldr.uom = "adc_counts";
+  ldr.rateHz = 20.0f;
+  ldr.scale = 1.0f;
+  ldr.offset = 0.0f;
+  ldr.uncertainty = 20.0f;
+  ldr.pin = LDR_PIN;
+  ldr.kind = KIND_ADC;
+
+  SensorConfig& rssi = sensors[1];
+  rssi.id = "WIFI_RSSI_ESP32_01";
+  rssi.prop = "WiFiRSSI";
+  rssi.uom = "dBm";
+  rssi.rateHz = 2.0f;
+  rssi.scale = 1.0f;
+  rssi.offset = 0.0f;
+  rssi.uncertainty = 2.0f;
+  rssi.targetSSID = WIFI_SSID;
+  rssi.kind = KIND_RSSI;
+
+  SensorConfig& temp = sensors[2];
+  temp.id = "LM73_ESP32_01";
+  temp.prop = "Temperature";
+  temp.uom = "degC";
+  temp.rateHz = 2.0f;
+  temp.scale = 1.0f;
+  temp.offset = 0.0f;
+  temp.uncertainty = 1.0f;
+  temp.kind = KIND_LM73;
+
+  for (int i = 0; i < sensorCount; i++) {
+    sensors[i].periodUs = (uint32_t)(1000000.0f / sensors[i].rateHz);
+  }
 }
 
 // -------------------- Setup / Loop --------------------
@@ -269,139 +567,107 @@ void setup() {
 
   analogReadResolution(12); // LDR
 
-  // I2C init
-  Wire.begin(I2C_SDA, I2C_SCL);
-
-  // Parse SensorML (3 sensors)
+  // Parse SensorML (all <Sensor> blocks, single pass)
   String xml = String(SENSORML_XML);
-
-  String b0, b1, b2;
-  bool ok0 = getSensorBlock(xml, 0, b0);
-  bool ok1 = getSensorBlock(xml, 1, b1);
-  bool ok2 = getSensorBlock(xml, 2, b2);
-
-  bool p0 = ok0 && parseSensorConfig(b0, cfgLdr);
-  bool p1 = ok1 && parseSensorConfig(b1, cfgRssi);
-  bool p2 = ok2 && parseSensorConfig(b2, cfgLm73);
+  sensorCount = parseAllSensors(xml, sensors, MAX_SENSORS);
 
   // Defaults if parsing fails
-  if (!p0) {
-    cfgLdr = {"LDR_ESP32_01","LightLevel","adc_counts",20.0f,1.0f,0.0f,0.05f,""};
-  }
-  if (!p1) {
-    cfgRssi = {"WIFI_RSSI_ESP32_01","WiFiRSSI","dBm",2.0f,1.0f,0.0f,2.0f,String(WIFI_SSID)};
+  if (sensorCount == 0) {
+    Serial.println("[SensorML] no valid <Sensor> blocks, using defaults.");
+    loadDefaultSensors();
   }
-  if (!p2) {
-    cfgLm73 = {"LM73_ESP32_01","Temperature","degC",2.0f,1.0f,0.0f,1.0f,""};
-  }
-
-  periodLdrMs  = (unsigned long)(1000.0f / cfgLdr.rateHz);
-  periodRssiMs = (unsigned long)(1000.0f / cfgRssi.rateHz);
-  periodLm73Ms = (unsigned long)(1000.0f / cfgLm73.rateHz);
-
-  Serial.println("=== Parsed SensorML (3-Sensor) ===");
-
-  Serial.println("[LDR]");
-  Serial.print("  id: "); Serial.println(cfgLdr.id);
-  Serial.print("  rateHz: "); Serial.println(cfgLdr.rateHz, 2);
-  Serial.print("  periodMs: "); Serial.println(periodLdrMs);
 
-  Serial.println("[RSSI]");
-  Serial.print("  id: "); Serial.println(cfgRssi.id);
-  Serial.print("  rateHz: "); Serial.println(cfgRssi.rateHz, 2);
-  Serial.print("  targetSSID: "); Serial.println(cfgRssi.targetSSID);
-  Serial.print("  periodMs: "); Serial.println(periodRssiMs);
-
-  Serial.println("[LM73]");
-  Serial.print("  id: "); Serial.println(cfgLm73.id);
-  Serial.print("  rateHz: "); Serial.println(cfgLm73.rateHz, 2);
-  Serial.print("  periodMs: "); Serial.println(periodLm73Ms);
+  Serial.print("=== Parsed SensorML (");
+  Serial.print(sensorCount);
+  Serial.println("-Sensor) ===");
+
+  for (int i = 0; i < sensorCount; i++) {
+    const SensorConfig& c = sensors[i];
+    if (c.kind == KIND_RSSI) wifiNeeded = true;
+    if (c.kind == KIND_LM73) i2cNeeded = true;
+
+    Serial.print("["); Serial.print(i); Serial.print("] ");
+    Serial.println(c.prop);
+    Serial.print("  id: "); Serial.println(c.id);
+    Serial.print("  rateHz: "); Serial.println(c.rateHz, 2);
+    if (c.kind == KIND_RSSI) {
+      Serial.print("  targetSSID: "); Serial.println(c.targetSSID);
+    } else if (c.kind == KIND_ADC) {
+      Serial.print("  pin: "); Serial.println(c.pin);
+    }
+    Serial.print("  periodUs: "); Serial.println(c.periodUs);
+  }
 
   Serial.println("==================================");
 
   // Connect Wi-Fi (for RSSI)
-  connectWiFi();
+  if (wifiNeeded) connectWiFi();
 
   // Find LM73 address
-  Serial.println("[I2C] scanning...");
-  lm73Addr = scanI2CFirstDevice();
-  if (lm73Addr == 0) {
-    Serial.println("[I2C] no device found. Check LM73 wiring/pullups/ADDR.");
-  } else {
-    Serial.print("[I2C] found device at 0x");
-    Serial.println(lm73Addr, HEX);
+  if (i2cNeeded) {
+    Wire.begin(I2C_SDA, I2C_SCL);
+    Serial.println("[I2C] scanning...");
+    lm73Addr = scanI2CFirstDevice();
+    if (lm73Addr == 0) {
+      Serial.println("[I2C] no device found. Check LM73 wiring/pullups/ADDR.");
+    } else {
+      Serial.print("[I2C] found device at 0x");
+      Serial.println(lm73Addr, HEX);
+    }
   }
+
+  schedBegin(micros());
+  lastSchedReportMs = millis();
 }
 
 void loop() {
-  unsigned long now = millis();
-
   // Reconnect Wi-Fi if needed (simple)
-  if (WiFi.status() != WL_CONNECTED) {
+  if (wifiNeeded && WiFi.status() != WL_CONNECTED) {
     connectWiFi();
     delay(300);
   }
 
-  // LDR
-  if (now - lastLdrMs >= periodLdrMs) {
-    lastLdrMs = now;
-
-    int raw = analogRead(LDR_PIN);
-    float cal = raw * cfgLdr.scale + cfgLdr.offset;
-
-    // Print LDR JSON
-    Serial.print("{\"id\":\"");
-    Serial.print(cfgLdr.id);
-    Serial.print("\",\"property\":\"");
-    Serial.print(cfgLdr.prop);
-    Serial.print("\",\"value\":");
-    Serial.print(cal, 2);
-    Serial.print(",\"uom\":\"");
-    Serial.print(cfgLdr.uom);
-    Serial.print("\",\"uncertainty\":");
-    Serial.print(cfgLdr.uncertainty, 4);
-    Serial.print(",\"ts_ms\":");
-    Serial.print(now);
-    Serial.println("}");
-  }
-
-  // RSSI
-  float rssiCal = NAN;
-  if (now - lastRssiMs >= periodRssiMs) {
-    lastRssiMs = now;
-
-    int rssiRaw = WiFi.RSSI();
-    rssiCal = rssiRaw * cfgRssi.scale + cfgRssi.offset;
-    printJsonRssi(rssiCal, now);
-  }
-
-  // LM73
-  float tempCal = NAN;
-  if (now - lastLm73Ms >= periodLm73Ms) {
-    lastLm73Ms = now;
-
-    if (lm73Addr != 0) {
-      float tC = 0;
-      if (readLM73TempC(tC)) {
-        tempCal = tC * cfgLm73.scale + cfgLm73.offset;
-        printJsonLm73(tempCal, now);
-      } else {
-        Serial.println("{\"error\":\"LM73 read failed\"}");
-      }
-    } else {
-      // If no device, print once in a while
-      Serial.println("{\"error\":\"LM73 not found\"}");
+  // Dispatch the sensors whose deadline has passed, earliest first (at most
+  // one pass over the array, so an overloaded schedule cannot starve loop())
+  for (int n = 0; n < sensorCount; n++) {
+    const int i = schedNextDue(micros());
+    if (i < 0) break;
+    SensorConfig& c = sensors[i];
+    const unsigned long now = millis();
+
+    float raw = 0.0f;
+    if (!sampleSensor(c, raw)) continue;
+
+    float cal = raw * c.scale + c.offset;
+    if (c.kind == KIND_RSSI) lastRssi = cal;
+    else if (c.kind == KIND_LM73) lastTempC = cal;
+
+    // Publish only what a consumer could not reconstruct (see REPORT_MODE)
+    float outV;
+    unsigned long outMs;
+    if (reportSample(reports[i], cal, now, REPORT_K * c.uncertainty, outV, outMs)) {
+      printJson(c, outV, outMs);
     }
   }
 
   // Optional CPS rules -> LED
-  // weak RSSI OR high temperature
+  // weak RSSI OR high temperature (latest readings)
   const float weakRssiThresh = -75.0f; // dBm
   const float highTempThresh = 35.0f;  // °C
 
-  bool weak = (!isnan(rssiCal) && (rssiCal < weakRssiThresh));
-  bool hot  = (!isnan(tempCal) && (tempCal > highTempThresh));
+  bool weak = (!isnan(lastRssi) && (lastRssi < weakRssiThresh));
+  bool hot  = (!isnan(lastTempC) && (lastTempC > highTempThresh));
 
   if (weak || hot) digitalWrite(LED_PIN, HIGH);
   else digitalWrite(LED_PIN, LOW);
+
+  if (millis() - lastSchedReportMs >= SCHED_REPORT_MS) {
+    lastSchedReportMs = millis();
+    printSchedStats(micros());
+    printReportStats();
+    schedResetStats(micros());
+  }
+
+  // Nothing is due: sleep until the earliest deadline instead of spinning
+  schedSleep(schedUntilNextUs(micros()));
 }
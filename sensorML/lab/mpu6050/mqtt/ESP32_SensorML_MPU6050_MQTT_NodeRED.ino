@@ -6,7 +6,10 @@
   - Applies samplingRateHz, ranges, per-axis calibration, uom, uncertainty
   - Publishes:
       * device/imu01/metadata   (retained, once at boot)
-      * device/imu01/telemetry  (stream)
+      * device/imu01/telemetry  (stream, JSON)
+      * device/imu01/telemetry_bin (stream, compact binary records or
+        delta-encoded batches, see TELEMETRY_MODE - field meaning comes
+        from the metadata)
       * device/imu01/cmd        (optional commands: {"led":1} etc. - not used here)
   - Also prints telemetry JSON to Serial
 
@@ -27,6 +30,7 @@
 #include <Wire.h>
 #include <WiFi.h>
 #include <PubSubClient.h>
+#include <atomic>
 #include <Adafruit_MPU6050.h>
 #include <Adafruit_Sensor.h>
 
@@ -39,6 +43,27 @@ const uint16_t MQTT_PORT = 1883;
 
 const char* TOPIC_META = "device/imu01/metadata";
 const char* TOPIC_TELE = "device/imu01/telemetry";
+const char* TOPIC_TELE_BIN = "device/imu01/telemetry_bin";
+
+// Telemetry encoding:
+//  - TELEMETRY_JSON:    self-describing JSON per sample on TOPIC_TELE
+//  - TELEMETRY_COMPACT: fixed binary record per sample on TOPIC_TELE_BIN
+//  - TELEMETRY_BATCH:   up to BATCH_MAX_SAMPLES delta-encoded samples per
+//                       message on TOPIC_TELE_BIN (flushed by count, by
+//                       BATCH_MAX_LATENCY_MS, or on an alarm event)
+// In the binary modes id/uom/unc and the layout are sent once in the
+// retained metadata. Pick one here, or with -DIMU_TELEMETRY_MODE=... .
+enum TelemetryMode { TELEMETRY_JSON, TELEMETRY_COMPACT, TELEMETRY_BATCH };
+#ifndef IMU_TELEMETRY_MODE
+#define IMU_TELEMETRY_MODE TELEMETRY_JSON
+#endif
+const TelemetryMode TELEMETRY_MODE = IMU_TELEMETRY_MODE;
+
+const uint8_t  BATCH_MAX_SAMPLES    = 25;   // 0.5 s at 50 Hz
+const uint32_t BATCH_MAX_LATENCY_MS = 500;  // oldest sample waits at most this long
+
+// Alarm example: flush the batch immediately on a shock
+const float ALARM_ACCEL_MS2 = 25.0f;        // |a| above ~2.5 g
 // ---------------------------------------------------------------
 
 static const int I2C_SDA = 21;
@@ -114,6 +139,58 @@ static bool getBlock(const String& xml, const String& tag, String& outBlock) {
   return true;
 }
 
+// -------------------- Allocation-free JSON writer --------------------
+// Renders into a fixed stack/static buffer: no String, no printf, no heap.
+// Floats use fixed-point integer formatting (enough for sensor values).
+static const uint32_t POW10[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+template <size_t N>
+struct JsonWriter {
+  char buf[N];
+  size_t len = 0;
+  bool overflow = false;
+
+  void reset() { len = 0; overflow = false; }
+
+  void raw(const char* s, size_t n) {
+    if (len + n >= N) { overflow = true; return; }
+    memcpy(buf + len, s, n);
+    len += n;
+  }
+  void raw(const char* s) { raw(s, strlen(s)); }
+
+  void u32(uint32_t v) {
+    char tmp[10];
+    int n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    if (len + n >= N) { overflow = true; return; }
+    while (n) buf[len++] = tmp[--n];
+  }
+
+  // Fixed-decimal float, e.g. fixed(-1.23456f, 3) -> "-1.235"
+  void fixed(float v, int decimals) {
+    if (decimals < 0) decimals = 0;
+    if (decimals > 6) decimals = 6;
+    if (!(fabsf(v) < 4.0e9f)) { raw("null", 4); return; } // NaN, inf, too large
+
+    float a = fabsf(v);
+    uint32_t ip = (uint32_t)a;
+    uint32_t fp = (uint32_t)((a - (float)ip) * (float)POW10[decimals] + 0.5f);
+    if (fp >= POW10[decimals]) { ip++; fp -= POW10[decimals]; } // rounding carry
+
+    if (v < 0.0f && (ip != 0 || fp != 0)) raw("-", 1);
+    u32(ip);
+    if (decimals == 0) return;
+
+    char tmp[6];
+    for (int i = decimals - 1; i >= 0; i--) { tmp[i] = (char)('0' + fp % 10); fp /= 10; }
+    raw(".", 1);
+    raw(tmp, decimals);
+  }
+
+  const char* c_str() { buf[len] = '\0'; return buf; }
+};
+
 // -------------------- Config structures --------------------
 struct AxisCal {
   float scaleX = 1.0f, scaleY = 1.0f, scaleZ = 1.0f;
@@ -201,47 +278,269 @@ static void applyMpuRanges(const ImuConfig& c) {
   mpu.setFilterBandwidth(MPU6050_BAND_21_HZ);
 }
 
-// -------------------- WiFi / MQTT --------------------
-static void connectWiFi() {
+// -------------------- Connectivity state machine --------------------
+// Copy of sensorML/lab/ldr/extension's link, documented there (host check: sketch_link_sim).
+enum LinkState : uint8_t {
+  LINK_WIFI_IDLE,       // waiting for the next Wi-Fi attempt
+  LINK_WIFI_JOINING,    // WiFi.begin() issued, waiting for WL_CONNECTED
+  LINK_MQTT_IDLE,       // Wi-Fi up, waiting for the next MQTT attempt
+  LINK_MQTT_CONNECTING, // helper task is running mqtt.connect()
+  LINK_UP               // publish/subscribe allowed
+};
+
+const uint32_t LINK_WIFI_JOIN_TIMEOUT_MS = 15000;
+const uint32_t LINK_BACKOFF_MIN_MS = 500;
+const uint32_t LINK_BACKOFF_MAX_MS = 30000;
+
+struct Link {
+  LinkState state = LINK_WIFI_IDLE;
+  uint32_t enteredMs = 0;               // when the current state was entered
+  uint32_t waitMs = 0;                  // idle time before the next attempt
+  uint32_t backoffMs = LINK_BACKOFF_MIN_MS;
+  uint32_t reconnects = 0;
+  char clientId[32];
+  void (*onUp)() = nullptr;             // runs in loop() on every (re)connect
+  TaskHandle_t worker = nullptr;
+  std::atomic<int8_t> result{0};        // 0 pending, 1 connected, -1 failed
+};
+
+Link link;
+
+static void linkEnter(LinkState s, uint32_t now, uint32_t waitMs = 0) {
+  link.state = s;
+  link.enteredMs = now;
+  link.waitMs = waitMs;
+}
+
+// Next wait: backoff/2 .. backoff (jittered), then double the backoff
+static uint32_t linkNextBackoff() {
+  uint32_t b = link.backoffMs;
+  link.backoffMs = min(b * 2, LINK_BACKOFF_MAX_MS);
+  return b / 2 + (uint32_t)random((long)(b / 2) + 1);
+}
+
+static void linkConnectTask(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    bool ok = mqtt.connect(link.clientId);
+    link.result.store(ok ? 1 : -1);
+  }
+}
+
+void linkBegin(const char* clientId, void (*onUp)()) {
+  strncpy(link.clientId, clientId, sizeof(link.clientId) - 1);
+  link.clientId[sizeof(link.clientId) - 1] = '\0';
+  link.onUp = onUp;
+
   WiFi.mode(WIFI_STA);
-  WiFi.begin(WIFI_SSID, WIFI_PASS);
-
-  Serial.print("[WiFi] connecting");
-  unsigned long t0 = millis();
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(300);
-    Serial.print(".");
-    if (millis() - t0 > 15000) {
-      Serial.println("\n[WiFi] timeout. Check SSID/PASS.");
+  mqtt.setSocketTimeout(5);  // bounds the CONNACK wait inside the helper task
+  xTaskCreatePinnedToCore(linkConnectTask, "mqttConnect", 4096, nullptr, 1, &link.worker, 0);
+  linkEnter(LINK_WIFI_IDLE, millis());
+}
+
+bool linkUp() { return link.state == LINK_UP; }
+
+// Call every loop() iteration; returns immediately in every state
+void linkPoll(uint32_t now) {
+  const uint32_t inState = now - link.enteredMs;
+
+  switch (link.state) {
+    case LINK_WIFI_IDLE:
+      if (inState < link.waitMs) return;
+      Serial.println("[WiFi] connecting");
+      WiFi.disconnect();
+      WiFi.begin(WIFI_SSID, WIFI_PASS);
+      linkEnter(LINK_WIFI_JOINING, now);
+      return;
+
+    case LINK_WIFI_JOINING:
+      if (WiFi.status() == WL_CONNECTED) {
+        Serial.print("[WiFi] connected, IP: ");
+        Serial.println(WiFi.localIP());
+        link.backoffMs = LINK_BACKOFF_MIN_MS;
+        linkEnter(LINK_MQTT_IDLE, now);
+      } else if (inState > LINK_WIFI_JOIN_TIMEOUT_MS) {
+        Serial.println("[WiFi] timeout, backing off");
+        linkEnter(LINK_WIFI_IDLE, now, linkNextBackoff());
+      }
+      return;
+
+    case LINK_MQTT_IDLE:
+      if (WiFi.status() != WL_CONNECTED) {
+        linkEnter(LINK_WIFI_IDLE, now);
+        return;
+      }
+      if (inState < link.waitMs) return;
+      Serial.print("[MQTT] connecting as ");
+      Serial.println(link.clientId);
+      link.result.store(0);
+      xTaskNotifyGive(link.worker);
+      linkEnter(LINK_MQTT_CONNECTING, now);
+      return;
+
+    case LINK_MQTT_CONNECTING: {
+      const int8_t r = link.result.load();
+      if (r == 0) return;
+      if (r > 0) {
+        Serial.println("[MQTT] connected");
+        link.backoffMs = LINK_BACKOFF_MIN_MS;
+        link.reconnects++;
+        linkEnter(LINK_UP, now);
+        if (link.onUp) link.onUp();
+      } else {
+        uint32_t wait = linkNextBackoff();
+        Serial.print("[MQTT] failed, rc=");
+        Serial.print(mqtt.state());
+        Serial.print(" retry in ");
+        Serial.print(wait);
+        Serial.println(" ms");
+        linkEnter(LINK_MQTT_IDLE, now, wait);
+      }
       return;
     }
+
+    case LINK_UP:
+      if (WiFi.status() != WL_CONNECTED) {
+        Serial.println("[WiFi] lost");
+        mqtt.disconnect();  // drop the stale socket before the next connect()
+        linkEnter(LINK_WIFI_IDLE, now);
+      } else if (!mqtt.loop()) {
+        Serial.println("[MQTT] lost");
+        linkEnter(LINK_MQTT_IDLE, now, linkNextBackoff());
+      }
+      return;
   }
-  Serial.println();
-  Serial.print("[WiFi] connected, IP: ");
-  Serial.println(WiFi.localIP());
 }
 
-static void ensureMqttConnected() {
-  if (mqtt.connected()) return;
+// -------------------- Compact telemetry (schema v1) --------------------
+// Little-endian fixed record, 20 bytes instead of ~190 bytes of JSON.
+// Values are int16 in fixed LSB units (see *_LSB); the layout, field names
+// and LSBs are announced in the retained metadata under "schema".
+static const uint8_t TELEMETRY_SCHEMA_VER = 1;
+static const float ACCEL_LSB = 0.005f;  // m/s2 per count (±163 m/s2 covers ±16 g)
+static const float GYRO_LSB  = 0.1f;    // deg/s per count (±3276 dps covers ±2000)
+static const float TEMP_LSB  = 0.01f;   // degC per count
+
+struct __attribute__((packed)) ImuRecordV1 {
+  uint8_t  ver;      // TELEMETRY_SCHEMA_VER
+  uint8_t  flags;    // reserved (0)
+  uint32_t tsMs;
+  int16_t  ax, ay, az;
+  int16_t  gx, gy, gz;
+  int16_t  temp;
+};
 
-  while (!mqtt.connected()) {
-    String clientId = "esp32-imu-" + String((uint32_t)ESP.getEfuseMac(), HEX);
-    Serial.print("[MQTT] connecting as ");
-    Serial.println(clientId);
+static const int IMU_VALUES = 7;  // ax, ay, az, gx, gy, gz, temp_c
 
-    if (mqtt.connect(clientId.c_str())) {
-      Serial.println("[MQTT] connected");
-      // publish metadata retained once connected
-      // (safe to send again on reconnect)
-      // handled below in publishMetadata()
-      return;
-    } else {
-      Serial.print("[MQTT] failed, rc=");
-      Serial.print(mqtt.state());
-      Serial.println(" retrying in 2s");
-      delay(2000);
-    }
+static int16_t toCounts(float v, float lsb) {
+  float q = v / lsb;
+  if (q > 32767.0f) return 32767;
+  if (q < -32768.0f) return -32768;
+  return (int16_t)lroundf(q);
+}
+
+static void quantizeSample(float axC, float ayC, float azC,
+                           float gxC, float gyC, float gzC,
+                           float tempC, int16_t out[IMU_VALUES]) {
+  out[0] = toCounts(axC, ACCEL_LSB);
+  out[1] = toCounts(ayC, ACCEL_LSB);
+  out[2] = toCounts(azC, ACCEL_LSB);
+  out[3] = toCounts(gxC, GYRO_LSB);
+  out[4] = toCounts(gyC, GYRO_LSB);
+  out[5] = toCounts(gzC, GYRO_LSB);
+  out[6] = toCounts(tempC, TEMP_LSB);
+}
+
+static void publishTelemetryCompact(const int16_t v[IMU_VALUES], unsigned long ts) {
+  ImuRecordV1 r;
+  r.ver = TELEMETRY_SCHEMA_VER;
+  r.flags = 0;
+  r.tsMs = (uint32_t)ts;
+  r.ax = v[0]; r.ay = v[1]; r.az = v[2];
+  r.gx = v[3]; r.gy = v[4]; r.gz = v[5];
+  r.temp = v[6];
+
+  if (linkUp()) mqtt.publish(TOPIC_TELE_BIN, (const uint8_t*)&r, sizeof(r), false);
+}
+
+// -------------------- Batched telemetry (schema v2) --------------------
+// One message carries N samples:
+//   [0]     uint8  ver (=2)
+//   [1]     uint8  count N
+//   [2..5]  uint32 t0_ms  (timestamp of sample 0, LE)
+//   [6..7]  uint16 period_ms (sample i is at t0_ms + i * period_ms, LE)
+//   [8..21] 7 x int16 LE  sample 0, absolute counts
+//   [22..]  samples 1..N-1: 7 zigzag varints each, delta to previous sample
+// IMU values change little between 20 ms samples, so most deltas fit in
+// one byte: ~7-10 bytes/sample instead of 20 (compact) or ~190 (JSON).
+// Samples are taken on a fixed grid (see loop()), and a sample that is not
+// at t0_ms + N * period_ms (slots skipped after a stall, or a new period)
+// closes the batch and starts the next one, so the header always holds.
+static const uint8_t BATCH_SCHEMA_VER = 2;
+static const size_t  BATCH_HEADER_SIZE = 8 + 2 * IMU_VALUES;
+static const size_t  BATCH_BUF_SIZE = BATCH_HEADER_SIZE + (BATCH_MAX_SAMPLES - 1) * IMU_VALUES * 3;
+
+struct TelemetryBatch {
+  uint8_t buf[BATCH_BUF_SIZE];
+  size_t len = 0;
+  uint8_t count = 0;
+  uint32_t t0Ms = 0;
+  uint16_t periodMs = 0;
+  int16_t prev[IMU_VALUES];
+};
+
+TelemetryBatch batch;
+
+static void putLe16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+
+static void putLe32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static void putVarint(TelemetryBatch& b, int32_t delta) {
+  uint32_t z = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);  // zigzag
+  while (z >= 0x80) { b.buf[b.len++] = (uint8_t)(z | 0x80); z >>= 7; }
+  b.buf[b.len++] = (uint8_t)z;
+}
+
+// Publish whatever is buffered. Also the flush-on-event hook: call it when
+// an alarm must leave the device now instead of after BATCH_MAX_LATENCY_MS.
+static void telemetryBatchFlush() {
+  if (batch.count == 0) return;
+  batch.buf[1] = batch.count;
+  if (linkUp()) mqtt.publish(TOPIC_TELE_BIN, batch.buf, batch.len, false);
+  batch.count = 0;
+  batch.len = 0;
+}
+
+static void telemetryBatchAdd(const int16_t v[IMU_VALUES], unsigned long ts) {
+  const uint16_t periodMs = (uint16_t)cfg.samplePeriodMs;
+  if (batch.count > 0 &&
+      (periodMs != batch.periodMs || (uint32_t)ts != batch.t0Ms + (uint32_t)batch.count * batch.periodMs)) {
+    telemetryBatchFlush();
   }
+
+  if (batch.count == 0) {
+    batch.t0Ms = (uint32_t)ts;
+    batch.periodMs = periodMs;
+    batch.buf[0] = BATCH_SCHEMA_VER;
+    batch.buf[1] = 0;
+    putLe32(batch.buf + 2, batch.t0Ms);
+    putLe16(batch.buf + 6, periodMs);
+    for (int i = 0; i < IMU_VALUES; i++) putLe16(batch.buf + 8 + 2 * i, (uint16_t)v[i]);
+    batch.len = BATCH_HEADER_SIZE;
+  } else {
+    for (int i = 0; i < IMU_VALUES; i++) putVarint(batch, (int32_t)v[i] - (int32_t)batch.prev[i]);
+  }
+  memcpy(batch.prev, v, sizeof(batch.prev));
+  batch.count++;
+
+  if (batch.count >= BATCH_MAX_SAMPLES) telemetryBatchFlush();
+}
+
+// Time-based flush, polled from loop() so a slow trickle still goes out
+static void telemetryBatchPoll(unsigned long now) {
+  if (batch.count > 0 && (uint32_t)now - batch.t0Ms >= BATCH_MAX_LATENCY_MS) telemetryBatchFlush();
 }
 
 // -------------------- Publishing helpers --------------------
@@ -252,6 +551,24 @@ static void publishMetadata() {
   meta += "\"samplingRateHz\":" + String(cfg.samplingRateHz, 2) + ",";
   meta += "\"accel\":{\"uom\":\"" + cfg.accelUom + "\",\"rangeG\":" + String(cfg.accelRangeG) + ",\"unc\":" + String(cfg.accelUnc, 3) + "},";
   meta += "\"gyro\":{\"uom\":\"" + cfg.gyroUom + "\",\"rangeDps\":" + String(cfg.gyroRangeDps) + ",\"unc\":" + String(cfg.gyroUnc, 3) + "}";
+  if (TELEMETRY_MODE != TELEMETRY_JSON) {
+    // Record layout for TOPIC_TELE_BIN (little-endian, see ImuRecordV1)
+    meta += ",\"schema\":{\"ver\":" + String(TELEMETRY_SCHEMA_VER);
+    meta += ",\"topic\":\"" + String(TOPIC_TELE_BIN) + "\"";
+    meta += ",\"size\":" + String((int)sizeof(ImuRecordV1));
+    meta += ",\"ts_offset\":2,\"values_offset\":6,\"value_type\":\"int16\"";
+    meta += ",\"fields\":[\"ax\",\"ay\",\"az\",\"gx\",\"gy\",\"gz\",\"temp_c\"]";
+    meta += ",\"lsb\":[" + String(ACCEL_LSB, 3) + "," + String(ACCEL_LSB, 3) + "," + String(ACCEL_LSB, 3)
+          + "," + String(GYRO_LSB, 3) + "," + String(GYRO_LSB, 3) + "," + String(GYRO_LSB, 3)
+          + "," + String(TEMP_LSB, 3) + "]";
+    if (TELEMETRY_MODE == TELEMETRY_BATCH) {
+      // Batches (ver 2) reuse fields/lsb; layout documented in telemetryBatchAdd()
+      meta += ",\"batch\":{\"ver\":" + String(BATCH_SCHEMA_VER)
+            + ",\"max_samples\":" + String(BATCH_MAX_SAMPLES)
+            + ",\"max_latency_ms\":" + String(BATCH_MAX_LATENCY_MS) + "}";
+    }
+    meta += "}";
+  }
   meta += "}";
 
   mqtt.publish(TOPIC_META, meta.c_str(), true); // retained
@@ -259,24 +576,84 @@ static void publishMetadata() {
   Serial.println(TOPIC_META);
 }
 
+// Static parts of every telemetry message, rendered once from SensorML
+// after parsing (id, uom, unc never change per sample).
+struct JsonFragment {
+  char s[96];
+  size_t n;
+};
+
+JsonFragment fragPrefix;  // {"id":"...","ts_ms":
+JsonFragment fragAccel;   // ,"accel":{"uom":"...","unc":...,"x":
+JsonFragment fragGyro;    // },"gyro":{"uom":"...","unc":...,"x":
+
+// False when a SensorML string did not fit its fragment: a truncated
+// fragment is not valid JSON, so telemetry is skipped (and counted) until
+// a reconfiguration renders fragments that fit.
+bool fragsValid = false;
+uint32_t tlmSkipped = 0;
+unsigned long lastSkipReportMs = 0;
+
+// Count a skipped message; at most one [TLM] line per 10 s says how many
+static void countSkipped(unsigned long nowMs) {
+  tlmSkipped++;
+  if (tlmSkipped > 1 && nowMs - lastSkipReportMs < 10000) return;
+  lastSkipReportMs = nowMs;
+  Serial.print("[TLM] skipped=");
+  Serial.println(tlmSkipped);
+}
+
+static void storeFragment(JsonFragment& f, JsonWriter<96>& w) {
+  if (w.overflow) fragsValid = false;
+  memcpy(f.s, w.buf, w.len);
+  f.n = w.len;
+}
+
+static void buildTelemetryFragments(const ImuConfig& c) {
+  JsonWriter<96> w;
+  fragsValid = true;
+
+  w.reset();
+  w.raw("{\"id\":\""); w.raw(c.id.c_str()); w.raw("\",\"ts_ms\":");
+  storeFragment(fragPrefix, w);
+
+  w.reset();
+  w.raw(",\"accel\":{\"uom\":\""); w.raw(c.accelUom.c_str());
+  w.raw("\",\"unc\":"); w.fixed(c.accelUnc, 3); w.raw(",\"x\":");
+  storeFragment(fragAccel, w);
+
+  w.reset();
+  w.raw("},\"gyro\":{\"uom\":\""); w.raw(c.gyroUom.c_str());
+  w.raw("\",\"unc\":"); w.fixed(c.gyroUnc, 3); w.raw(",\"x\":");
+  storeFragment(fragGyro, w);
+  if (!fragsValid) Serial.println("[TLM] id/uom too long for a telemetry fragment; telemetry disabled");
+}
+
 static void publishTelemetry(float axC, float ayC, float azC,
                              float gxC, float gyC, float gzC,
                              float tempC, unsigned long ts) {
-  // compact JSON for streaming
-  String msg = "{";
-  msg += "\"id\":\"" + cfg.id + "\",";
-  msg += "\"ts_ms\":" + String(ts) + ",";
-  msg += "\"accel\":{\"uom\":\"" + cfg.accelUom + "\",\"unc\":" + String(cfg.accelUnc, 3)
-      + ",\"x\":" + String(axC, 3) + ",\"y\":" + String(ayC, 3) + ",\"z\":" + String(azC, 3) + "},";
-  msg += "\"gyro\":{\"uom\":\"" + cfg.gyroUom + "\",\"unc\":" + String(cfg.gyroUnc, 3)
-      + ",\"x\":" + String(gxC, 3) + ",\"y\":" + String(gyC, 3) + ",\"z\":" + String(gzC, 3) + "},";
-  msg += "\"temp_c\":" + String(tempC, 2);
-  msg += "}";
-
-  mqtt.publish(TOPIC_TELE, msg.c_str(), false);
-
-  // also print to Serial (useful for debugging)
-  Serial.println(msg);
+  // compact JSON for streaming, rendered once into a stack buffer
+  JsonWriter<256> msg;
+  msg.raw(fragPrefix.s, fragPrefix.n);
+  msg.u32((uint32_t)ts);
+  msg.raw(fragAccel.s, fragAccel.n);
+  msg.fixed(axC, 3); msg.raw(",\"y\":", 5);
+  msg.fixed(ayC, 3); msg.raw(",\"z\":", 5);
+  msg.fixed(azC, 3);
+  msg.raw(fragGyro.s, fragGyro.n);
+  msg.fixed(gxC, 3); msg.raw(",\"y\":", 5);
+  msg.fixed(gyC, 3); msg.raw(",\"z\":", 5);
+  msg.fixed(gzC, 3);
+  msg.raw("},\"temp_c\":", 11);
+  msg.fixed(tempC, 2);
+  msg.raw("}", 1);
+  if (!fragsValid || msg.overflow) { countSkipped(ts); return; }
+
+  if (linkUp()) mqtt.publish(TOPIC_TELE, (const uint8_t*)msg.buf, msg.len, false);
+
+  // also print to Serial (useful for debugging) - same rendered bytes
+  Serial.write((const uint8_t*)msg.buf, msg.len);
+  Serial.write('\n');
 }
 
 // -------------------- Setup / Loop --------------------
@@ -287,6 +664,7 @@ void setup() {
   Wire.begin(I2C_SDA, I2C_SCL);
 
   parseSensorML(cfg);
+  buildTelemetryFragments(cfg);
 
   if (!mpu.begin()) {
     Serial.println("MPU6050 not found. Check wiring and I2C address (usually 0x68).");
@@ -294,21 +672,30 @@ void setup() {
   }
   applyMpuRanges(cfg);
 
-  connectWiFi();
   mqtt.setServer(MQTT_HOST, MQTT_PORT);
-  ensureMqttConnected();
-  publishMetadata();
+  mqtt.setBufferSize(1024); // metadata with schema / batches exceed the 256 B default
+
+  // Connects in the background; metadata is (re)published on every connect
+  String clientId = "esp32-imu-" + String((uint32_t)ESP.getEfuseMac(), HEX);
+  randomSeed((uint32_t)ESP.getEfuseMac());
+  linkBegin(clientId.c_str(), publishMetadata);
 }
 
 void loop() {
-  // keep connections alive
-  if (WiFi.status() != WL_CONNECTED) connectWiFi();
-  ensureMqttConnected();
-  mqtt.loop();
-
   unsigned long now = millis();
+
+  // keep connections alive (never blocks; sampling continues offline)
+  linkPoll(now);
+
+  if (TELEMETRY_MODE == TELEMETRY_BATCH) telemetryBatchPoll(now);
   if (now - lastSampleMs < cfg.samplePeriodMs) return;
-  lastSampleMs = now;
+
+  // Fixed grid: each sample is stamped with the slot it was due in, not
+  // with when loop() got to it, so timestamps stay t0 + i * period. Slots
+  // missed behind a long stall are dropped, not made up in a burst.
+  lastSampleMs += cfg.samplePeriodMs;
+  if (now - lastSampleMs >= cfg.samplePeriodMs) lastSampleMs = now - (now - lastSampleMs) % cfg.samplePeriodMs;
+  const unsigned long ts = lastSampleMs;
 
   sensors_event_t a, g, temp;
   mpu.getEvent(&a, &g, &temp);
@@ -333,5 +720,22 @@ void loop() {
   float gyC = gy * cfg.gyroCal.scaleY + cfg.gyroCal.offY;
   float gzC = gz * cfg.gyroCal.scaleZ + cfg.gyroCal.offZ;
 
-  publishTelemetry(axC, ayC, azC, gxC, gyC, gzC, temp.temperature, now);
+  if (TELEMETRY_MODE == TELEMETRY_JSON) {
+    publishTelemetry(axC, ayC, azC, gxC, gyC, gzC, temp.temperature, ts);
+    return;
+  }
+
+  int16_t counts[IMU_VALUES];
+  quantizeSample(axC, ayC, azC, gxC, gyC, gzC, temp.temperature, counts);
+
+  if (TELEMETRY_MODE == TELEMETRY_COMPACT) {
+    publishTelemetryCompact(counts, ts);
+    return;
+  }
+
+  telemetryBatchAdd(counts, ts);
+
+  // Alarm event: do not hold a shock back for up to BATCH_MAX_LATENCY_MS
+  float amag = sqrtf(axC * axC + ayC * ayC + azC * azC);
+  if (amag > ALARM_ACCEL_MS2) telemetryBatchFlush();
 }
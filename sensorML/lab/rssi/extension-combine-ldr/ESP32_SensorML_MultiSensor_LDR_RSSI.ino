@@ -1,13 +1,16 @@
 /*
   Combined Lab: Multi-Sensor SensorML -> ESP32 (LDR + Wi-Fi RSSI)
   ----------------------------------------------------------------
-  - Parses a simplified multi-sensor SensorML XML (2 sensors)
+  - Parses a simplified multi-sensor SensorML XML (any number of <Sensor>
+    blocks, up to MAX_SENSORS) in a single pass into a SensorConfig array
   - Each sensor has its own:
       identifier, observedProperty, uom, samplingRateHz,
       calibration (scale/offset), uncertainty
-  - LDR: analogRead(GPIO34)
+  - LDR / other ADC channels: analogRead(<pin>, default GPIO34)
   - RSSI: WiFi.RSSI() after connecting
   - Prints self-describing JSON lines for each sensor to Serial
+  - A min-heap of deadlines dispatches only the sensors that are due, then
+    loop() sleeps until the next one (per-sensor rate/lateness as [sched])
 
   Optional:
   - Turn on LED when RSSI is weak (< -75 dBm) (CPS rule)
@@ -86,29 +89,13 @@ static float getTagFloat(const String& xml, const String& tag, float defVal) {
   return v.toFloat();
 }
 
-// Extract the Nth <Sensor> ... </Sensor> block
-static bool getSensorBlock(const String& xml, int index, String& outBlock) {
-  const String open = "<Sensor>";
-  const String close = "</Sensor>";
-
-  int pos = 0;
-  for (int i = 0; i <= index; i++) {
-    int s = xml.indexOf(open, pos);
-    if (s < 0) return false;
-    int e = xml.indexOf(close, s);
-    if (e < 0) return false;
-    e += close.length();
-    if (i == index) {
-      outBlock = xml.substring(s, e);
-      outBlock.trim();
-      return true;
-    }
-    pos = e;
-  }
-  return false;
-}
-
 // -------------------- Sensor Config --------------------
+// What a <Sensor> block is wired to, derived from <observedProperty>
+enum SensorKind : uint8_t {
+  KIND_ADC = 0,   // analogRead(pin)
+  KIND_RSSI       // WiFi.RSSI()
+};
+
 struct SensorConfig {
   String id;
   String prop;
@@ -118,8 +105,25 @@ struct SensorConfig {
   float offset = 0.0f;
   float uncertainty = 0.0f;
   String targetSSID; // only for RSSI sensor
+  int pin = LDR_PIN; // only for ADC sensors (<pin>, default GPIO34)
+
+  // Runtime state (filled after parsing)
+  SensorKind kind = KIND_ADC;
+  uint32_t periodUs = 1000000;
+  uint32_t nextDueUs = 0;    // deadline scheduler (see dueHeap)
+
+  // Scheduler stats since the last [sched] report
+  uint32_t runs = 0;
+  uint32_t skipped = 0;      // slots missed by a whole period or more
+  uint32_t lateSumUs = 0;
+  uint32_t lateMaxUs = 0;
 };
 
+static SensorKind kindFromProperty(const String& prop) {
+  if (prop == "WiFiRSSI") return KIND_RSSI;
+  return KIND_ADC;
+}
+
 static bool parseSensorConfig(const String& block, SensorConfig& cfg) {
   cfg.id = getTagValue(block, "identifier");
   cfg.prop = getTagValue(block, "observedProperty");
@@ -129,21 +133,159 @@ static bool parseSensorConfig(const String& block, SensorConfig& cfg) {
   cfg.offset = getTagFloat(block, "offset", 0.0f);
   cfg.uncertainty = getTagFloat(block, "uncertainty", 0.0f);
   cfg.targetSSID = getTagValue(block, "targetSSID");
+  cfg.pin = (int)getTagFloat(block, "pin", (float)LDR_PIN);
 
   if (cfg.rateHz < 0.2f) cfg.rateHz = 0.2f; // avoid zero/very slow issues
   if (cfg.id.length() == 0 || cfg.prop.length() == 0 || cfg.uom.length() == 0) return false;
+
+  cfg.kind = kindFromProperty(cfg.prop);
+  cfg.periodUs = (uint32_t)(1000000.0f / cfg.rateHz);
   return true;
 }
 
+// Enumerate every <Sensor> ... </Sensor> block in ONE forward pass.
+// Each search resumes where the previous block ended, so the document is
+// scanned once regardless of how many sensors it declares.
+// Returns the number of valid configs written to out[0..capacity-1].
+static int parseAllSensors(const String& xml, SensorConfig* out, int capacity) {
+  const String open = "<Sensor>";
+  const String close = "</Sensor>";
+
+  int count = 0;
+  int pos = 0;
+  while (true) {
+    int s = xml.indexOf(open, pos);
+    if (s < 0) break;
+    int e = xml.indexOf(close, s);
+    if (e < 0) break;
+    e += close.length();
+    pos = e;
+
+    if (count >= capacity) {
+      Serial.println("[SensorML] MAX_SENSORS reached, ignoring extra <Sensor> blocks");
+      break;
+    }
+    if (parseSensorConfig(xml.substring(s, e), out[count])) count++;
+  }
+  return count;
+}
+
 // -------------------- State --------------------
-SensorConfig cfgLdr;
-SensorConfig cfgRssi;
+static const int MAX_SENSORS = 16;
+SensorConfig sensors[MAX_SENSORS];
+int sensorCount = 0;
+bool wifiNeeded = false; // true if any sensor is KIND_RSSI
+
+// -------------------- Deadline scheduler --------------------
+// dueHeap holds sensor indices as a min-heap on nextDueUs. loop() pops only
+// the sensors whose deadline has passed, O(log n) each, then sleeps until the
+// earliest remaining deadline, so idle sensors cost nothing per pass.
+// A deadline advances by exactly one period (fixed grid, no drift); a sensor
+// that fell a whole period behind skips the missed slots and counts them.
+// Times are micros() differences, so the 32-bit wrap is harmless.
+static const unsigned long SCHED_REPORT_MS = 10000;   // [sched] line per sensor
+static const unsigned long SCHED_MAX_SLEEP_MS = 100;  // keeps the Wi-Fi check responsive
+
+uint8_t dueHeap[MAX_SENSORS];
+int dueHeapSize = 0;
+uint32_t schedStatsStartUs = 0;
+unsigned long lastSchedReportMs = 0;
+
+static bool dueBefore(int a, int b) {
+  return (int32_t)(sensors[a].nextDueUs - sensors[b].nextDueUs) < 0;
+}
 
-unsigned long periodLdrMs = 50;
-unsigned long periodRssiMs = 500;
+static void heapSiftDown(int pos) {
+  const uint8_t item = dueHeap[pos];
+  while (true) {
+    int child = 2 * pos + 1;
+    if (child >= dueHeapSize) break;
+    if (child + 1 < dueHeapSize && dueBefore(dueHeap[child + 1], dueHeap[child])) child++;
+    if (!dueBefore(dueHeap[child], item)) break;
+    dueHeap[pos] = dueHeap[child];
+    pos = child;
+  }
+  dueHeap[pos] = item;
+}
 
-unsigned long lastLdrMs = 0;
-unsigned long lastRssiMs = 0;
+static void schedResetStats(uint32_t nowUs) {
+  for (int i = 0; i < sensorCount; i++) {
+    SensorConfig& c = sensors[i];
+    c.runs = 0;
+    c.skipped = 0;
+    c.lateSumUs = 0;
+    c.lateMaxUs = 0;
+  }
+  schedStatsStartUs = nowUs;
+}
+
+// (Re)build the heap from sensors[0..sensorCount-1], every sensor due at startUs
+static void schedBegin(uint32_t startUs) {
+  dueHeapSize = sensorCount;
+  for (int i = 0; i < sensorCount; i++) {
+    sensors[i].nextDueUs = startUs;
+    dueHeap[i] = (uint8_t)i;
+  }
+  for (int i = dueHeapSize / 2 - 1; i >= 0; i--) heapSiftDown(i);
+  schedResetStats(startUs);
+}
+
+// Index of the earliest sensor if it is due (its deadline is advanced and
+// the heap reordered), else -1
+static int schedNextDue(uint32_t nowUs) {
+  if (dueHeapSize == 0) return -1;
+  const int i = dueHeap[0];
+  SensorConfig& c = sensors[i];
+  int32_t late = (int32_t)(nowUs - c.nextDueUs);
+  if (late < 0) return -1;
+
+  if ((uint32_t)late >= c.periodUs) {
+    const uint32_t missed = (uint32_t)late / c.periodUs;
+    c.nextDueUs += missed * c.periodUs;
+    c.skipped += missed;
+    late -= (int32_t)(missed * c.periodUs);
+  }
+  c.runs++;
+  c.lateSumUs += (uint32_t)late;
+  if ((uint32_t)late > c.lateMaxUs) c.lateMaxUs = (uint32_t)late;
+  c.nextDueUs += c.periodUs;
+  heapSiftDown(0);
+  return i;
+}
+
+static uint32_t schedUntilNextUs(uint32_t nowUs) {
+  if (dueHeapSize == 0) return SCHED_MAX_SLEEP_MS * 1000;
+  const int32_t d = (int32_t)(sensors[dueHeap[0]].nextDueUs - nowUs);
+  return d > 0 ? (uint32_t)d : 0;
+}
+
+// delay() blocks the task, so the idle task runs (and the CPU can light-sleep
+// with power management on); the sub-millisecond remainder is busy-waited
+static void schedSleep(uint32_t waitUs) {
+  if (waitUs >= SCHED_MAX_SLEEP_MS * 1000) delay(SCHED_MAX_SLEEP_MS);
+  else if (waitUs >= 1000) delay(waitUs / 1000);
+  else if (waitUs > 0) delayMicroseconds(waitUs);
+}
+
+// [sched] <id> rate=<actual>/<nominal>Hz late_avg_us=... late_max_us=... skipped=...
+static void printSchedStats(uint32_t nowUs) {
+  const float secs = (float)(nowUs - schedStatsStartUs) / 1e6f;
+  for (int i = 0; i < sensorCount; i++) {
+    const SensorConfig& c = sensors[i];
+    Serial.print("[sched] ");
+    Serial.print(c.id);
+    Serial.print(" rate=");
+    Serial.print(secs > 0 ? (float)c.runs / secs : 0.0f, 2);
+    Serial.print("/");
+    Serial.print(1e6f / (float)c.periodUs, 2);
+    Serial.print("Hz late_avg_us=");
+    Serial.print(c.runs ? c.lateSumUs / c.runs : 0);
+    Serial.print(" late_max_us=");
+    Serial.print(c.lateMaxUs);
+    Serial.print(" skipped=");
+    Serial.println(c.skipped);
+  }
+}
 
 // -------------------- Wi-Fi --------------------
 static void connectWiFi() {
@@ -168,38 +310,64 @@ static void connectWiFi() {
 }
 
 // -------------------- Output helpers --------------------
-static void printJsonLdr(float value, unsigned long ts) {
+static void printJson(const SensorConfig& cfg, float value, unsigned long ts) {
   Serial.print("{\"id\":\"");
-  Serial.print(cfgLdr.id);
+  Serial.print(cfg.id);
   Serial.print("\",\"property\":\"");
-  Serial.print(cfgLdr.prop);
+  Serial.print(cfg.prop);
   Serial.print("\",\"value\":");
   Serial.print(value, 2);
   Serial.print(",\"uom\":\"");
-  Serial.print(cfgLdr.uom);
+  Serial.print(cfg.uom);
   Serial.print("\",\"uncertainty\":");
-  Serial.print(cfgLdr.uncertainty, 4);
+  Serial.print(cfg.uncertainty, 4);
+  if (cfg.kind == KIND_RSSI) {
+    Serial.print(",\"ssid\":\"");
+    Serial.print(WiFi.SSID());
+    Serial.print("\"");
+  }
   Serial.print(",\"ts_ms\":");
   Serial.print(ts);
   Serial.println("}");
 }
 
-static void printJsonRssi(float value, unsigned long ts) {
-  Serial.print("{\"id\":\"");
-  Serial.print(cfgRssi.id);
-  Serial.print("\",\"property\":\"");
-  Serial.print(cfgRssi.prop);
-  Serial.print("\",\"value\":");
-  Serial.print(value, 2);
-  Serial.print(",\"uom\":\"");
-  Serial.print(cfgRssi.uom);
-  Serial.print("\",\"uncertainty\":");
-  Serial.print(cfgRssi.uncertainty, 2);
-  Serial.print(",\"ssid\":\"");
-  Serial.print(WiFi.SSID());
-  Serial.print("\",\"ts_ms\":");
-  Serial.print(ts);
-  Serial.println("}");
+// -------------------- Per-sensor sampling --------------------
+static float sampleSensor(const SensorConfig& cfg) {
+  switch (cfg.kind) {
+    case KIND_RSSI: return (float)WiFi.RSSI();     // negative dBm
+    case KIND_ADC:
+    default:        return (float)analogRead(cfg.pin);
+  }
+}
+
+static void loadDefaultSensors() {
+  sensorCount = 2;
+
+  SensorConfig& ldr = sensors[0];
+  ldr.id = "LDR_ESP32_01";
+  ldr.prop = "LightLevel";
+  ldr.uom = "adc_counts";
+  ldr.rateHz = 20.0f;
+  ldr.scale = 1.0f;
+  ldr.offset = 0.0f;
+  ldr.uncertainty = 0.05f;
+  ldr.pin = LDR_PIN;
+  ldr.kind = KIND_ADC;
+
+  SensorConfig& rssi = sensors[1];
+  rssi.id = "WIFI_RSSI_ESP32_01";
+  rssi.prop = "WiFiRSSI";
+  rssi.uom = "dBm";
+  rssi.rateHz = 2.0f;
+  rssi.scale = 1.0f;
+  rssi.offset = 0.0f;
+  rssi.uncertainty = 2.0f;
+  rssi.targetSSID = WIFI_SSID;
+  rssi.kind = KIND_RSSI;
+
+  for (int i = 0; i < sensorCount; i++) {
+    sensors[i].periodUs = (uint32_t)(1000000.0f / sensors[i].rateHz);
+  }
 }
 
 // -------------------- Setup / Loop --------------------
@@ -213,100 +381,79 @@ void setup() {
   // ADC config for LDR
   analogReadResolution(12); // 0..4095
 
-  // Parse multi-sensor XML
+  // Parse multi-sensor XML (all <Sensor> blocks, single pass)
   String xml = String(SENSORML_XML);
-
-  String block0, block1;
-  bool ok0 = getSensorBlock(xml, 0, block0);
-  bool ok1 = getSensorBlock(xml, 1, block1);
-
-  bool parsed0 = ok0 && parseSensorConfig(block0, cfgLdr);
-  bool parsed1 = ok1 && parseSensorConfig(block1, cfgRssi);
-
-  if (!parsed0) {
-    // defaults
-    cfgLdr.id = "LDR_ESP32_01";
-    cfgLdr.prop = "LightLevel";
-    cfgLdr.uom = "adc_counts";
-    cfgLdr.rateHz = 20.0f;
-    cfgLdr.scale = 1.0f;
-    cfgLdr.offset = 0.0f;
-    cfgLdr.uncertainty = 0.05f;
-  }
-  if (!parsed1) {
-    cfgRssi.id = "WIFI_RSSI_ESP32_01";
-    cfgRssi.prop = "WiFiRSSI";
-    cfgRssi.uom = "dBm";
-    cfgRssi.rateHz = 2.0f;
-    cfgRssi.scale = 1.0f;
-    cfgRssi.offset = 0.0f;
-    cfgRssi.uncertainty = 2.0f;
-    cfgRssi.targetSSID = WIFI_SSID;
+  sensorCount = parseAllSensors(xml, sensors, MAX_SENSORS);
+  if (sensorCount == 0) {
+    Serial.println("[SensorML] no valid <Sensor> blocks, using defaults.");
+    loadDefaultSensors();
   }
 
-  periodLdrMs = (unsigned long)(1000.0f / cfgLdr.rateHz);
-  periodRssiMs = (unsigned long)(1000.0f / cfgRssi.rateHz);
-
-  Serial.println("=== Parsed SensorML (Multi-Sensor) ===");
-
-  Serial.println("[LDR]");
-  Serial.print("  id: "); Serial.println(cfgLdr.id);
-  Serial.print("  prop: "); Serial.println(cfgLdr.prop);
-  Serial.print("  uom: "); Serial.println(cfgLdr.uom);
-  Serial.print("  rateHz: "); Serial.println(cfgLdr.rateHz, 2);
-  Serial.print("  scale: "); Serial.println(cfgLdr.scale, 6);
-  Serial.print("  offset: "); Serial.println(cfgLdr.offset, 6);
-  Serial.print("  uncertainty: "); Serial.println(cfgLdr.uncertainty, 4);
-  Serial.print("  periodMs: "); Serial.println(periodLdrMs);
-
-  Serial.println("[RSSI]");
-  Serial.print("  id: "); Serial.println(cfgRssi.id);
-  Serial.print("  prop: "); Serial.println(cfgRssi.prop);
-  Serial.print("  uom: "); Serial.println(cfgRssi.uom);
-  Serial.print("  rateHz: "); Serial.println(cfgRssi.rateHz, 2);
-  Serial.print("  scale: "); Serial.println(cfgRssi.scale, 6);
-  Serial.print("  offset: "); Serial.println(cfgRssi.offset, 6);
-  Serial.print("  uncertainty: "); Serial.println(cfgRssi.uncertainty, 2);
-  Serial.print("  targetSSID: "); Serial.println(cfgRssi.targetSSID);
-  Serial.print("  periodMs: "); Serial.println(periodRssiMs);
+  Serial.print("=== Parsed SensorML (Multi-Sensor: ");
+  Serial.print(sensorCount);
+  Serial.println(") ===");
+
+  for (int i = 0; i < sensorCount; i++) {
+    const SensorConfig& c = sensors[i];
+    if (c.kind == KIND_RSSI) wifiNeeded = true;
+
+    Serial.print("["); Serial.print(i); Serial.println("]");
+    Serial.print("  id: "); Serial.println(c.id);
+    Serial.print("  prop: "); Serial.println(c.prop);
+    Serial.print("  uom: "); Serial.println(c.uom);
+    Serial.print("  rateHz: "); Serial.println(c.rateHz, 2);
+    Serial.print("  scale: "); Serial.println(c.scale, 6);
+    Serial.print("  offset: "); Serial.println(c.offset, 6);
+    Serial.print("  uncertainty: "); Serial.println(c.uncertainty, 4);
+    if (c.kind == KIND_ADC) {
+      Serial.print("  pin: "); Serial.println(c.pin);
+    } else {
+      Serial.print("  targetSSID: "); Serial.println(c.targetSSID);
+    }
+    Serial.print("  periodUs: "); Serial.println(c.periodUs);
+  }
 
   Serial.println("=====================================");
 
   // Connect Wi-Fi for RSSI sensor (Mode A)
-  connectWiFi();
+  if (wifiNeeded) connectWiFi();
+
+  schedBegin(micros());
+  lastSchedReportMs = millis();
 }
 
 void loop() {
-  unsigned long now = millis();
-
   // Reconnect Wi-Fi if needed (simple)
-  if (WiFi.status() != WL_CONNECTED) {
+  if (wifiNeeded && WiFi.status() != WL_CONNECTED) {
     connectWiFi();
     delay(500);
   }
 
-  // LDR sampling
-  if (now - lastLdrMs >= periodLdrMs) {
-    lastLdrMs = now;
-
-    int raw = analogRead(LDR_PIN);
-    float cal = raw * cfgLdr.scale + cfgLdr.offset;
-
-    printJsonLdr(cal, now);
-  }
-
-  // RSSI sampling
-  if (now - lastRssiMs >= periodRssiMs) {
-    lastRssiMs = now;
+  // Dispatch the sensors whose deadline has passed, earliest first (at most
+  // one pass over the array, so an overloaded schedule cannot starve loop())
+  for (int n = 0; n < sensorCount; n++) {
+    const int i = schedNextDue(micros());
+    if (i < 0) break;
+    SensorConfig& c = sensors[i];
+    const unsigned long now = millis();
 
-    int rssiRaw = WiFi.RSSI();          // negative dBm
-    float rssiCal = rssiRaw * cfgRssi.scale + cfgRssi.offset;
+    float cal = sampleSensor(c) * c.scale + c.offset;
 
     // Optional CPS rule: weak signal warning / LED
-    const float weakThresh = -75.0f; // dBm
-    if (rssiCal < weakThresh) digitalWrite(LED_PIN, HIGH);
-    else digitalWrite(LED_PIN, LOW);
+    if (c.kind == KIND_RSSI) {
+      const float weakThresh = -75.0f; // dBm
+      digitalWrite(LED_PIN, (cal < weakThresh) ? HIGH : LOW);
+    }
+
+    printJson(c, cal, now);
+  }
 
-    printJsonRssi(rssiCal, now);
+  if (millis() - lastSchedReportMs >= SCHED_REPORT_MS) {
+    lastSchedReportMs = millis();
+    printSchedStats(micros());
+    schedResetStats(micros());
   }
+
+  // Nothing is due: sleep until the earliest deadline instead of spinning
+  schedSleep(schedUntilNextUs(micros()));
 }
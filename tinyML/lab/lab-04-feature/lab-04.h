@@ -8,6 +8,8 @@
  *  - Compute features:
  *      mean, min, max, variance, RMS, slope
  *  - Print feature vector in CSV format
+ *    (or LOG_BINARY: COBS-framed binary records for
+ *     high-rate dataset capture, see binlog_decode)
  ***************************************************/
 
 #include <Arduino.h>
@@ -25,6 +27,19 @@ const uint32_t FEATURE_PERIOD_MS = 200; // feature output every 200 ms
 const float ADC_MAX = 4095.0;
 const float VREF    = 3.3;
 
+// ====== Output Format ======
+// 0 = CSV text (default)
+// 1 = binary frames: COBS( type | payload | crc16 ) 0x00
+//     type 1 = raw sample  {uint32 t_us, int16 raw}
+//     type 2 = features    {uint32 t_ms, float mean,min,max,var,rms,slope}
+//     Same layout as sensorML/architecture/lab/binlog.h, decode with
+//     sensorML/architecture/host/tools/binlog_decode
+#define LOG_BINARY 0
+// Binary mode only: raw samples per second for dataset capture, on their
+// own micros() grid beside the 50 Hz window. 0 = one raw frame per window
+// sample instead. 1000 Hz is ~11 KB/s of frames, well inside 921600 baud.
+#define RAW_CAPTURE_HZ 1000
+
 // ====== Sliding Window ======
 #define WINDOW_SIZE 20
 int windowBuf[WINDOW_SIZE];
@@ -88,14 +103,95 @@ void extractFeatures(float &mean, int &minV, int &maxV, float &var, float &rms,
   slope = (w[WINDOW_SIZE - 1] - w[0]) / (float)WINDOW_SIZE;
 }
 
+// ---------- Binary framing (LOG_BINARY) ----------
+#if LOG_BINARY
+struct __attribute__((packed)) RawRecord {
+  uint32_t tsUs;
+  int16_t raw;
+};
+
+struct __attribute__((packed)) FeatureRecord {
+  uint32_t tsMs;
+  float mean, minv, maxv, var, rms, slope;
+};
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+uint16_t crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// Frame and write one record; payload is at most 28 bytes here so a single
+// COBS block (< 254 bytes) always suffices.
+void writeFrame(uint8_t type, const void* payload, size_t len) {
+  uint8_t raw[1 + 32 + 2];
+  uint8_t out[sizeof(raw) + 2];
+
+  raw[0] = type;
+  memcpy(raw + 1, payload, len);
+  uint16_t crc = crc16(raw, 1 + len);
+  raw[1 + len] = (uint8_t)(crc & 0xFF);
+  raw[2 + len] = (uint8_t)(crc >> 8);
+  size_t rawLen = 3 + len;
+
+  // COBS encode
+  size_t codeIdx = 0, o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < rawLen; i++) {
+    if (raw[i] == 0) {
+      out[codeIdx] = code;
+      codeIdx = o++;
+      code = 1;
+    } else {
+      out[o++] = raw[i];
+      code++;
+    }
+  }
+  out[codeIdx] = code;
+  out[o++] = 0x00;   // frame delimiter
+
+  Serial.write(out, o);
+}
+
+#if RAW_CAPTURE_HZ
+const uint32_t RAW_CAPTURE_PERIOD_US = 1000000UL / RAW_CAPTURE_HZ;
+uint32_t nextRawUs = 0;
+
+// A slot missed behind a long loop() pass is skipped (a gap in t_us), not
+// sent late in a burst
+void captureRaw() {
+  uint32_t nowUs = micros();
+  if ((int32_t)(nowUs - nextRawUs) < 0) return;
+  nextRawUs += RAW_CAPTURE_PERIOD_US;
+  if ((int32_t)(nowUs - nextRawUs) >= 0) nextRawUs = nowUs + RAW_CAPTURE_PERIOD_US;
+  RawRecord rec = { nowUs, (int16_t)analogRead(SENSOR_PIN) };
+  writeFrame(1, &rec, sizeof(rec));
+}
+#endif
+#endif
+
 void setup() {
   pinMode(LED_PIN, OUTPUT);
+#if LOG_BINARY
+  Serial.begin(921600);   // raw samples + features, no text
+#else
   Serial.begin(115200);
+#endif
   delay(1000);
 
   // Initialize buffer with zeros to avoid garbage
   for (int i = 0; i < WINDOW_SIZE; i++) windowBuf[i] = 0;
 
+#if LOG_BINARY
+  return;  // no banner: the stream carries only frames
+#endif
+
   Serial.println("==============================================================");
   Serial.println(" Lab 3: Sliding Window Feature Engineering (TinyML Features)");
   Serial.println(" CSV: time_ms,mean,min,max,variance,rms,slope,raw_last,voltage");
@@ -106,6 +202,10 @@ void setup() {
 void loop() {
   uint32_t now = millis();
 
+#if LOG_BINARY && RAW_CAPTURE_HZ
+  captureRaw();
+#endif
+
   // 1) Periodic sampling (non-blocking)
   if (now - lastSampleTime >= SAMPLE_PERIOD_MS) {
     lastSampleTime = now;
@@ -113,6 +213,11 @@ void loop() {
     int raw = analogRead(SENSOR_PIN);
     addSample(raw);
 
+#if LOG_BINARY && !RAW_CAPTURE_HZ
+    RawRecord rec = { (uint32_t)micros(), (int16_t)raw };
+    writeFrame(1, &rec, sizeof(rec));
+#endif
+
     // Optional: LED indicator based on latest sample
     digitalWrite(LED_PIN, (raw > 2500) ? HIGH : LOW);
   }
@@ -131,6 +236,12 @@ void loop() {
     int rawLast = windowBuf[lastIdx];
     float voltageLast = (rawLast / ADC_MAX) * VREF;
 
+#if LOG_BINARY
+    FeatureRecord rec = { now, mean, (float)minV, (float)maxV, var, rms, slope };
+    writeFrame(2, &rec, sizeof(rec));
+    return;
+#endif
+
     // 3) Print feature vector in CSV format
     Serial.print(now);
     Serial.print(",");
@@ -38,6 +38,20 @@ const uint32_t INFER_PERIOD_MS  = 200;  // infer every 200 ms
 const float ADC_MAX = 4095.0f;
 const float VREF    = 3.3f;
 
+// ===================== Output Format =====================
+// 0 = CSV text (default)
+// 1 = binary frames: COBS( type | payload | crc16 ) 0x00
+//     type 1 = raw sample  {uint32 t_us, int16 raw}
+//     type 6 = CSV row     {uint32 t_ms, float mean,min,max,var,rms,slope,
+//                           uint8 float_pred,int8_pred, uint32 float_us,int8_us}
+//     Same layout as sensorML/architecture/lab/binlog.h, decode with
+//     sensorML/architecture/host/tools/binlog_decode
+#define LOG_BINARY 0
+// Binary mode only: raw samples per second for dataset capture, on their
+// own micros() grid beside the 50 Hz window. 0 = one raw frame per window
+// sample instead.
+#define RAW_CAPTURE_HZ 1000
+
 // ===================== Sliding Window =====================
 #define WINDOW_SIZE 20
 int windowBuf[WINDOW_SIZE];
@@ -204,30 +218,119 @@ void updateActuator(int label) {
   }
 }
 
+// ===================== Binary Framing (LOG_BINARY) =====================
+#if LOG_BINARY
+struct __attribute__((packed)) RawRecord {
+  uint32_t tsUs;
+  int16_t raw;
+};
+
+struct __attribute__((packed)) QuantRecord {
+  uint32_t tsMs;
+  float mean, minv, maxv, var, rms, slope;
+  uint8_t floatPred, int8Pred;
+  uint32_t floatUs, int8Us;
+};
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+uint16_t crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// Frame and write one record; payloads are at most 48 bytes so a single
+// COBS block (< 254 bytes) always suffices.
+void writeFrame(uint8_t type, const void* payload, size_t len) {
+  uint8_t raw[1 + 48 + 2];
+  uint8_t out[sizeof(raw) + 2];
+
+  raw[0] = type;
+  memcpy(raw + 1, payload, len);
+  uint16_t crc = crc16(raw, 1 + len);
+  raw[1 + len] = (uint8_t)(crc & 0xFF);
+  raw[2 + len] = (uint8_t)(crc >> 8);
+  size_t rawLen = 3 + len;
+
+  // COBS encode
+  size_t codeIdx = 0, o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < rawLen; i++) {
+    if (raw[i] == 0) {
+      out[codeIdx] = code;
+      codeIdx = o++;
+      code = 1;
+    } else {
+      out[o++] = raw[i];
+      code++;
+    }
+  }
+  out[codeIdx] = code;
+  out[o++] = 0x00;   // frame delimiter
+
+  Serial.write(out, o);
+}
+
+#if RAW_CAPTURE_HZ
+const uint32_t RAW_CAPTURE_PERIOD_US = 1000000UL / RAW_CAPTURE_HZ;
+uint32_t nextRawUs = 0;
+
+// A slot missed behind a long loop() pass is skipped (a gap in t_us), not
+// sent late in a burst
+void captureRaw() {
+  uint32_t nowUs = micros();
+  if ((int32_t)(nowUs - nextRawUs) < 0) return;
+  nextRawUs += RAW_CAPTURE_PERIOD_US;
+  if ((int32_t)(nowUs - nextRawUs) >= 0) nextRawUs = nowUs + RAW_CAPTURE_PERIOD_US;
+  RawRecord rec = { nowUs, (int16_t)analogRead(SENSOR_PIN) };
+  writeFrame(1, &rec, sizeof(rec));
+}
+#endif
+#endif
+
 // ===================== Setup =====================
 void setup() {
   pinMode(LED_PIN, OUTPUT);
+#if LOG_BINARY
+  Serial.begin(921600);   // raw samples + rows, no text
+#else
   Serial.begin(115200);
+#endif
   delay(1000);
 
   for (int i = 0; i < WINDOW_SIZE; i++) windowBuf[i] = 0;
 
+#if !LOG_BINARY
   Serial.println("======================================================================");
   Serial.println(" Lab 5: Float vs INT8 Quantized Inference (ESP32) + Latency Compare");
   Serial.println(" CSV: time_ms,mean,min,max,var,rms,slope,float_pred,int8_pred,float_us,int8_us");
   Serial.println("======================================================================");
   Serial.println("time_ms,mean,min,max,variance,rms,slope,float_pred,int8_pred,float_us,int8_us");
+#endif
 }
 
 // ===================== Loop =====================
 void loop() {
   uint32_t now = millis();
 
+#if LOG_BINARY && RAW_CAPTURE_HZ
+  captureRaw();
+#endif
+
   // Sampling
   if (now - lastSampleTime >= SAMPLE_PERIOD_MS) {
     lastSampleTime = now;
     int raw = analogRead(SENSOR_PIN);
     addSample(raw);
+#if LOG_BINARY && !RAW_CAPTURE_HZ
+    RawRecord rec = { (uint32_t)micros(), (int16_t)raw };
+    writeFrame(1, &rec, sizeof(rec));
+#endif
   }
 
   // Inference
@@ -254,6 +357,11 @@ void loop() {
     lastPredInt8 = predI;
     updateActuator(lastPredInt8);
 
+#if LOG_BINARY
+    QuantRecord rec = { now, features[0], features[1], features[2], features[3], features[4], features[5],
+                        (uint8_t)predF, (uint8_t)predI, float_us, int8_us };
+    writeFrame(6, &rec, sizeof(rec));
+#else
     // CSV log
     Serial.print(now);                Serial.print(",");
     Serial.print(features[0], 2);     Serial.print(",");
@@ -266,6 +374,7 @@ void loop() {
     Serial.print(predI);             Serial.print(",");
     Serial.print(float_us);          Serial.print(",");
     Serial.println(int8_us);
+#endif
   }
 
   // Keep blinking responsive when label==2
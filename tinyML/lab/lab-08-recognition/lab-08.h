@@ -43,6 +43,20 @@
 const uint32_t SAMPLE_PERIOD_MS = 20;   // 50 Hz accel sampling
 const uint32_t INFER_PERIOD_MS  = 200;  // inference every 200 ms
 
+// ===================== Output Format =====================
+// 0 = CSV text (default)
+// 1 = binary frames: COBS( type | payload | crc16 ) 0x00
+//     type 4 = raw accel   {uint32 t_us, int16 ax,ay,az}
+//     type 8 = CSV row     {uint32 t_ms, float rmsx,rmsy,rmsz,magrms,
+//                           uint8 pred,smoothed, uint32 infer_us}
+//     Same layout as sensorML/architecture/lab/binlog.h, decode with
+//     sensorML/architecture/host/tools/binlog_decode
+#define LOG_BINARY 0
+// Binary mode only: raw samples per second for dataset capture, on their
+// own micros() grid beside the 50 Hz window. 0 = one raw frame per window
+// sample instead.
+#define RAW_CAPTURE_HZ 1000
+
 // ===================== Sliding Window =====================
 #define WINDOW_SIZE 25
 int16_t axBuf[WINDOW_SIZE];
@@ -240,10 +254,91 @@ void updateActuator(int label) {
   }
 }
 
+// ===================== Binary Framing (LOG_BINARY) =====================
+#if LOG_BINARY
+struct __attribute__((packed)) AccelRecord {
+  uint32_t tsUs;
+  int16_t ax, ay, az;
+};
+
+struct __attribute__((packed)) ActivityRecord {
+  uint32_t tsMs;
+  float rmsx, rmsy, rmsz, magRms;
+  uint8_t pred, smoothed;
+  uint32_t inferUs;
+};
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+uint16_t crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// Frame and write one record; payloads are at most 48 bytes so a single
+// COBS block (< 254 bytes) always suffices.
+void writeFrame(uint8_t type, const void* payload, size_t len) {
+  uint8_t raw[1 + 48 + 2];
+  uint8_t out[sizeof(raw) + 2];
+
+  raw[0] = type;
+  memcpy(raw + 1, payload, len);
+  uint16_t crc = crc16(raw, 1 + len);
+  raw[1 + len] = (uint8_t)(crc & 0xFF);
+  raw[2 + len] = (uint8_t)(crc >> 8);
+  size_t rawLen = 3 + len;
+
+  // COBS encode
+  size_t codeIdx = 0, o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < rawLen; i++) {
+    if (raw[i] == 0) {
+      out[codeIdx] = code;
+      codeIdx = o++;
+      code = 1;
+    } else {
+      out[o++] = raw[i];
+      code++;
+    }
+  }
+  out[codeIdx] = code;
+  out[o++] = 0x00;   // frame delimiter
+
+  Serial.write(out, o);
+}
+
+#if RAW_CAPTURE_HZ
+const uint32_t RAW_CAPTURE_PERIOD_US = 1000000UL / RAW_CAPTURE_HZ;
+uint32_t nextRawUs = 0;
+
+// A slot missed behind a long loop() pass is skipped (a gap in t_us), not
+// sent late in a burst
+void captureRaw() {
+  uint32_t nowUs = micros();
+  if ((int32_t)(nowUs - nextRawUs) < 0) return;
+  nextRawUs += RAW_CAPTURE_PERIOD_US;
+  if ((int32_t)(nowUs - nextRawUs) >= 0) nextRawUs = nowUs + RAW_CAPTURE_PERIOD_US;
+  int16_t ax, ay, az;
+  if (!readAccelRaw(ax, ay, az)) return;
+  AccelRecord rec = { nowUs, ax, ay, az };
+  writeFrame(4, &rec, sizeof(rec));
+}
+#endif
+#endif
+
 // ===================== Setup =====================
 void setup() {
   pinMode(LED_PIN, OUTPUT);
+#if LOG_BINARY
+  Serial.begin(921600);   // raw samples + rows, no text
+#else
   Serial.begin(115200);
+#endif
   delay(1000);
 
   for (int i = 0; i < WINDOW_SIZE; i++) {
@@ -251,23 +346,31 @@ void setup() {
   }
   for (int i = 0; i < DECISION_WIN; i++) decisionBuf[i] = 0;
 
+#if !LOG_BINARY
   Serial.println("=====================================================================");
   Serial.println(" Lab 7: Activity Recognition (MPU6050) + Streaming Features + INT8 ML");
   Serial.println(" CSV: time_ms,rmsx,rmsy,rmsz,magrms,pred,smoothed,infer_us");
   Serial.println("=====================================================================");
   Serial.println("time_ms,rmsx,rmsy,rmsz,magrMS,pred,smoothed,infer_us");
+#endif
 
   if (!mpuInit()) {
     Serial.println("ERROR: MPU6050 not detected. Check wiring (SDA=21, SCL=22) and power.");
     while (1) { delay(1000); }
   }
+#if !LOG_BINARY
   Serial.println("MPU6050 OK");
+#endif
 }
 
 // ===================== Loop =====================
 void loop() {
   uint32_t now = millis();
 
+#if LOG_BINARY && RAW_CAPTURE_HZ
+  captureRaw();
+#endif
+
   // 1) Sampling
   if (now - lastSampleTime >= SAMPLE_PERIOD_MS) {
     lastSampleTime = now;
@@ -275,6 +378,10 @@ void loop() {
     int16_t ax, ay, az;
     if (readAccelRaw(ax, ay, az)) {
       addAccelSample(ax, ay, az);
+#if LOG_BINARY && !RAW_CAPTURE_HZ
+      AccelRecord rec = { (uint32_t)micros(), ax, ay, az };
+      writeFrame(4, &rec, sizeof(rec));
+#endif
     } else {
       // If read fails, keep last samples; could also add zeros or skip.
       // Keep system alive.
@@ -300,6 +407,11 @@ void loop() {
 
     updateActuator(smoothed);
 
+#if LOG_BINARY
+    ActivityRecord rec = { now, features[0], features[1], features[2], features[3],
+                           (uint8_t)pred, (uint8_t)smoothed, infer_us };
+    writeFrame(8, &rec, sizeof(rec));
+#else
     // CSV log
     Serial.print(now);              Serial.print(",");
     Serial.print(features[0], 2);   Serial.print(",");
@@ -309,6 +421,7 @@ void loop() {
     Serial.print(pred);             Serial.print(",");
     Serial.print(smoothed);         Serial.print(",");
     Serial.println(infer_us);
+#endif
   }
 
   // Keep blink responsive
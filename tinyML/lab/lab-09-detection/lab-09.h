@@ -34,6 +34,20 @@
 const uint32_t SAMPLE_PERIOD_MS  = 20;    // 50 Hz sampling
 const uint32_t FEATURE_PERIOD_MS = 200;   // compute features + score every 200 ms
 
+// ===================== Output Format =====================
+// 0 = CSV text (default)
+// 1 = binary frames: COBS( type | payload | crc16 ) 0x00
+//     type 1 = raw sample  {uint32 t_us, int16 raw}
+//     type 9 = CSV row     {uint32 t_ms, float rms,baseline_mean,baseline_std,score,
+//                           uint8 alarm, uint8 detect (0 TRAIN, 1 DETECT)}
+//     Same layout as sensorML/architecture/lab/binlog.h, decode with
+//     sensorML/architecture/host/tools/binlog_decode
+#define LOG_BINARY 0
+// Binary mode only: raw samples per second for dataset capture, on their
+// own micros() grid beside the 50 Hz window. 0 = one raw frame per window
+// sample instead.
+#define RAW_CAPTURE_HZ 1000
+
 // ===================== Sliding Window =====================
 #define WINDOW_SIZE 25
 int windowBuf[WINDOW_SIZE];
@@ -123,33 +137,122 @@ void updateAlarmLED() {
   }
 }
 
+// ===================== Binary Framing (LOG_BINARY) =====================
+#if LOG_BINARY
+struct __attribute__((packed)) RawRecord {
+  uint32_t tsUs;
+  int16_t raw;
+};
+
+struct __attribute__((packed)) AnomalyRecord {
+  uint32_t tsMs;
+  float rms, baselineMean, baselineStd, score;
+  uint8_t alarm;
+  uint8_t detect;   // 0 TRAIN, 1 DETECT
+};
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+uint16_t crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// Frame and write one record; payloads are at most 48 bytes so a single
+// COBS block (< 254 bytes) always suffices.
+void writeFrame(uint8_t type, const void* payload, size_t len) {
+  uint8_t raw[1 + 48 + 2];
+  uint8_t out[sizeof(raw) + 2];
+
+  raw[0] = type;
+  memcpy(raw + 1, payload, len);
+  uint16_t crc = crc16(raw, 1 + len);
+  raw[1 + len] = (uint8_t)(crc & 0xFF);
+  raw[2 + len] = (uint8_t)(crc >> 8);
+  size_t rawLen = 3 + len;
+
+  // COBS encode
+  size_t codeIdx = 0, o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < rawLen; i++) {
+    if (raw[i] == 0) {
+      out[codeIdx] = code;
+      codeIdx = o++;
+      code = 1;
+    } else {
+      out[o++] = raw[i];
+      code++;
+    }
+  }
+  out[codeIdx] = code;
+  out[o++] = 0x00;   // frame delimiter
+
+  Serial.write(out, o);
+}
+
+#if RAW_CAPTURE_HZ
+const uint32_t RAW_CAPTURE_PERIOD_US = 1000000UL / RAW_CAPTURE_HZ;
+uint32_t nextRawUs = 0;
+
+// A slot missed behind a long loop() pass is skipped (a gap in t_us), not
+// sent late in a burst
+void captureRaw() {
+  uint32_t nowUs = micros();
+  if ((int32_t)(nowUs - nextRawUs) < 0) return;
+  nextRawUs += RAW_CAPTURE_PERIOD_US;
+  if ((int32_t)(nowUs - nextRawUs) >= 0) nextRawUs = nowUs + RAW_CAPTURE_PERIOD_US;
+  RawRecord rec = { nowUs, (int16_t)analogRead(SENSOR_PIN) };
+  writeFrame(1, &rec, sizeof(rec));
+}
+#endif
+#endif
+
 // ===================== Setup =====================
 void setup() {
   pinMode(LED_PIN, OUTPUT);
+#if LOG_BINARY
+  Serial.begin(921600);   // raw samples + rows, no text
+#else
   Serial.begin(115200);
+#endif
   delay(1000);
 
   for (int i = 0; i < WINDOW_SIZE; i++) windowBuf[i] = 0;
 
   trainStartMs = millis();
 
+#if !LOG_BINARY
   Serial.println("=======================================================================");
   Serial.println(" Lab 8: TinyML Anomaly Detection (Normal-Only) - ESP32");
   Serial.println(" Baseline training first, then anomaly scoring.");
   Serial.println(" CSV: time_ms,rms,baseline_mean,baseline_std,score,alarm,mode");
   Serial.println("=======================================================================");
   Serial.println("time_ms,rms,baseline_mean,baseline_std,score,alarm,mode");
+#endif
 }
 
 // ===================== Loop =====================
 void loop() {
   uint32_t now = millis();
 
+#if LOG_BINARY && RAW_CAPTURE_HZ
+  captureRaw();
+#endif
+
   // 1) Continuous sampling (non-blocking)
   if (now - lastSampleTime >= SAMPLE_PERIOD_MS) {
     lastSampleTime = now;
     int raw = analogRead(SENSOR_PIN);
     addSample(raw);
+#if LOG_BINARY && !RAW_CAPTURE_HZ
+    RawRecord rec = { (uint32_t)micros(), (int16_t)raw };
+    writeFrame(1, &rec, sizeof(rec));
+#endif
   }
 
   // 2) Periodic feature + detection
@@ -173,6 +276,10 @@ void loop() {
       // Log (mode=TRAIN)
       double var = baselineVariance();
       double stdv = sqrt(var);
+#if LOG_BINARY
+      AnomalyRecord rec = { now, rms, (float)baselineMean, (float)stdv, 0.0f, (uint8_t)(alarmActive ? 1 : 0), 0 };
+      writeFrame(9, &rec, sizeof(rec));
+#else
       Serial.print(now);               Serial.print(",");
       Serial.print(rms, 3);            Serial.print(",");
       Serial.print((float)baselineMean, 3); Serial.print(",");
@@ -180,6 +287,7 @@ void loop() {
       Serial.print(0.0f, 3);           Serial.print(",");
       Serial.print(alarmActive ? 1 : 0); Serial.print(",");
       Serial.println("TRAIN");
+#endif
     }
     // Detection mode
     else {
@@ -193,6 +301,10 @@ void loop() {
       alarmActive = (score > THRESHOLD);
 
       // Log (mode=DETECT)
+#if LOG_BINARY
+      AnomalyRecord rec = { now, rms, (float)baselineMean, (float)stdv, score, (uint8_t)(alarmActive ? 1 : 0), 1 };
+      writeFrame(9, &rec, sizeof(rec));
+#else
       Serial.print(now);               Serial.print(",");
       Serial.print(rms, 3);            Serial.print(",");
       Serial.print((float)baselineMean, 3); Serial.print(",");
@@ -200,6 +312,7 @@ void loop() {
       Serial.print(score, 3);          Serial.print(",");
       Serial.print(alarmActive ? 1 : 0); Serial.print(",");
       Serial.println("DETECT");
+#endif
     }
   }
 
@@ -56,6 +56,22 @@ const uint32_t MQTT_PUB_MS      = 500;  // publish every 500 ms (2 Hz)
 const uint32_t WIFI_RETRY_MS    = 5000; // retry Wi-Fi every 5s
 const uint32_t MQTT_RETRY_MS    = 5000; // retry MQTT every 5s
 
+// ===================== Output Format =====================
+// 0 = CSV text (default)
+// 1 = binary frames: COBS( type | payload | crc16 ) 0x00
+//     type 1 = raw sample  {uint32 t_us, int16 raw}
+//     type 11 = CSV row    {uint32 t_ms, uint8 pred, float conf, uint32 infer_us,
+//                           uint8 wifi,mqtt}
+//     Wi-Fi/MQTT connect messages are text and left out (the wifi/mqtt
+//     columns carry the link state).
+//     Same layout as sensorML/architecture/lab/binlog.h, decode with
+//     sensorML/architecture/host/tools/binlog_decode
+#define LOG_BINARY 0
+// Binary mode only: raw samples per second for dataset capture, on their
+// own micros() grid beside the 50 Hz window. 0 = one raw frame per window
+// sample instead.
+#define RAW_CAPTURE_HZ 1000
+
 // ===================== Sliding Window =====================
 #define WINDOW_SIZE 20
 int windowBuf[WINDOW_SIZE];
@@ -197,8 +213,10 @@ void ensureWiFi() {
   if (now - lastWiFiAttempt < WIFI_RETRY_MS) return;
   lastWiFiAttempt = now;
 
+#if !LOG_BINARY
   Serial.print("Connecting Wi-Fi: ");
   Serial.println(WIFI_SSID);
+#endif
 
   WiFi.mode(WIFI_STA);
   WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
@@ -212,20 +230,27 @@ void ensureMQTT() {
   if (now - lastMQTTAttempt < MQTT_RETRY_MS) return;
   lastMQTTAttempt = now;
 
+#if !LOG_BINARY
   Serial.print("Connecting MQTT: ");
   Serial.print(MQTT_HOST);
   Serial.print(":");
   Serial.println(MQTT_PORT);
+#endif
 
   mqttClient.setServer(MQTT_HOST, MQTT_PORT);
 
   // Connect with clean session
-  if (mqttClient.connect(MQTT_CLIENT_ID)) {
+  bool ok = mqttClient.connect(MQTT_CLIENT_ID);
+#if !LOG_BINARY
+  if (ok) {
     Serial.println("MQTT connected.");
   } else {
     Serial.print("MQTT failed, rc=");
     Serial.println(mqttClient.state());
   }
+#else
+  (void)ok;
+#endif
 }
 
 // ===================== Publish MQTT =====================
@@ -252,14 +277,24 @@ void publishTelemetry() {
 
   mqttClient.publish(TOPIC_TELEM, payload);
 
-  // Also publish a simple status string occasionally (optional)
-  char statusMsg[96];
+  // Also publish a simple status string occasionally (optional), with heap
+  // and loop-task stack headroom
+  IPAddress ip = WiFi.localIP();
+  char ipStr[16];
+  snprintf(ipStr, sizeof(ipStr), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+
+  char statusMsg[192];
   snprintf(statusMsg, sizeof(statusMsg),
-           "{\"ip\":\"%s\",\"rssi\":%d,\"wifi\":%d,\"mqtt\":%d}",
-           WiFi.localIP().toString().c_str(),
+           "{\"ip\":\"%s\",\"rssi\":%d,\"wifi\":%d,\"mqtt\":%d,"
+           "\"heap_free\":%lu,\"heap_largest\":%lu,\"heap_min\":%lu,\"stack_free\":%lu}",
+           ipStr,
            WiFi.RSSI(),
            (WiFi.status() == WL_CONNECTED) ? 1 : 0,
-           mqttClient.connected() ? 1 : 0);
+           mqttClient.connected() ? 1 : 0,
+           (unsigned long)ESP.getFreeHeap(),
+           (unsigned long)ESP.getMaxAllocHeap(),
+           (unsigned long)ESP.getMinFreeHeap(),
+           (unsigned long)uxTaskGetStackHighWaterMark(nullptr));
 
   mqttClient.publish(TOPIC_STATUS, statusMsg);
 }
@@ -287,10 +322,90 @@ void updateLED(int label) {
   }
 }
 
+// ===================== Binary Framing (LOG_BINARY) =====================
+#if LOG_BINARY
+struct __attribute__((packed)) RawRecord {
+  uint32_t tsUs;
+  int16_t raw;
+};
+
+struct __attribute__((packed)) CloudRecord {
+  uint32_t tsMs;
+  uint8_t pred;
+  float conf;
+  uint32_t inferUs;
+  uint8_t wifi, mqtt;
+};
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+uint16_t crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// Frame and write one record; payloads are at most 48 bytes so a single
+// COBS block (< 254 bytes) always suffices.
+void writeFrame(uint8_t type, const void* payload, size_t len) {
+  uint8_t raw[1 + 48 + 2];
+  uint8_t out[sizeof(raw) + 2];
+
+  raw[0] = type;
+  memcpy(raw + 1, payload, len);
+  uint16_t crc = crc16(raw, 1 + len);
+  raw[1 + len] = (uint8_t)(crc & 0xFF);
+  raw[2 + len] = (uint8_t)(crc >> 8);
+  size_t rawLen = 3 + len;
+
+  // COBS encode
+  size_t codeIdx = 0, o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < rawLen; i++) {
+    if (raw[i] == 0) {
+      out[codeIdx] = code;
+      codeIdx = o++;
+      code = 1;
+    } else {
+      out[o++] = raw[i];
+      code++;
+    }
+  }
+  out[codeIdx] = code;
+  out[o++] = 0x00;   // frame delimiter
+
+  Serial.write(out, o);
+}
+
+#if RAW_CAPTURE_HZ
+const uint32_t RAW_CAPTURE_PERIOD_US = 1000000UL / RAW_CAPTURE_HZ;
+uint32_t nextRawUs = 0;
+
+// A slot missed behind a long loop() pass is skipped (a gap in t_us), not
+// sent late in a burst
+void captureRaw() {
+  uint32_t nowUs = micros();
+  if ((int32_t)(nowUs - nextRawUs) < 0) return;
+  nextRawUs += RAW_CAPTURE_PERIOD_US;
+  if ((int32_t)(nowUs - nextRawUs) >= 0) nextRawUs = nowUs + RAW_CAPTURE_PERIOD_US;
+  RawRecord rec = { nowUs, (int16_t)analogRead(SENSOR_PIN) };
+  writeFrame(1, &rec, sizeof(rec));
+}
+#endif
+#endif
+
 // ===================== Setup =====================
 void setup() {
   pinMode(LED_PIN, OUTPUT);
+#if LOG_BINARY
+  Serial.begin(921600);   // raw samples + rows, no text
+#else
   Serial.begin(115200);
+#endif
   delay(1000);
 
   for (int i = 0; i < WINDOW_SIZE; i++) windowBuf[i] = 0;
@@ -298,18 +413,24 @@ void setup() {
   WiFi.mode(WIFI_STA);
   mqttClient.setServer(MQTT_HOST, MQTT_PORT);
 
+#if !LOG_BINARY
   Serial.println("===================================================================================");
   Serial.println(" Lab 10: Edge-to-Cloud Monitoring (ESP32 TinyML local inference + MQTT publish)");
   Serial.println(" Publishes: tinyml/esp32/telemetry and tinyml/esp32/status");
   Serial.println(" CSV(local): time_ms,pred,conf,infer_us,wifi,mqtt");
   Serial.println("===================================================================================");
   Serial.println("time_ms,pred,conf,infer_us,wifi,mqtt");
+#endif
 }
 
 // ===================== Loop =====================
 void loop() {
   uint32_t now = millis();
 
+#if LOG_BINARY && RAW_CAPTURE_HZ
+  captureRaw();
+#endif
+
   // 0) Keep connectivity attempts non-blocking
   ensureWiFi();
   ensureMQTT();
@@ -322,6 +443,10 @@ void loop() {
     lastSampleTime = now;
     int raw = analogRead(SENSOR_PIN);
     addSample(raw);
+#if LOG_BINARY && !RAW_CAPTURE_HZ
+    RawRecord rec = { (uint32_t)micros(), (int16_t)raw };
+    writeFrame(1, &rec, sizeof(rec));
+#endif
   }
 
   // 2) Local inference (always local, regardless of Wi-Fi/MQTT)
@@ -341,12 +466,18 @@ void loop() {
 
     // Print local status line
     float conf = confidence_margin(lastScores, lastPred);
+#if LOG_BINARY
+    CloudRecord rec = { now, (uint8_t)lastPred, conf, lastInferUs,
+                        (uint8_t)(WiFi.status() == WL_CONNECTED), (uint8_t)mqttClient.connected() };
+    writeFrame(11, &rec, sizeof(rec));
+#else
     Serial.print(now); Serial.print(",");
     Serial.print(lastPred); Serial.print(",");
     Serial.print(conf, 3); Serial.print(",");
     Serial.print(lastInferUs); Serial.print(",");
     Serial.print((WiFi.status() == WL_CONNECTED) ? 1 : 0); Serial.print(",");
     Serial.println(mqttClient.connected() ? 1 : 0);
+#endif
   }
 
   // 3) Publish to cloud if connected (low-bandwidth semantic data only)
@@ -14,6 +14,15 @@
  *       - Sends ONLY semantic data (pred, confidence proxy, anomaly score proxy)
  *       - CPS continues working even offline
  *  6) Optional "Normal-only" anomaly score (z-score) using confidence proxy
+ *  7) Store-and-forward: telemetry produced while MQTT is down goes to a
+ *     flash journal and is replayed (rate-limited) after reconnect
+ *  8) Prioritized outbound queue: alarm > state change > telemetry > status
+ *  9) Stage latency histograms (sample -> actuate, cycle counter),
+ *     p50/p95/p99/max on the status topic and Serial
+ * 10) Optional execution trace (LAB_TRACE): begin/end events in a RAM ring,
+ *     dumped on Serial command for Perfetto
+ * 11) Memory telemetry: heap free / largest block / min-ever, fragmentation
+ *     and task stack headroom on the status topic
  *
  * REQUIRED LIBRARIES:
  *  - PubSubClient by Nick O'Leary (Library Manager)
@@ -38,6 +47,8 @@
 #include <PubSubClient.h>
 #include <math.h>
 #include <stdint.h>
+#include <atomic>
+#include "esp_partition.h"
 
 // ===================== USER CONFIG: Wi-Fi =====================
 const char* WIFI_SSID     = "YOUR_WIFI_SSID";
@@ -50,6 +61,8 @@ const uint16_t MQTT_PORT = 1883;
 const char* MQTT_CLIENT_ID = "esp32-tinyml-capstone-lab11";
 const char* TOPIC_TELEM    = "tinyml/esp32/lab11/telemetry";
 const char* TOPIC_STATUS   = "tinyml/esp32/lab11/status";
+const char* TOPIC_ALARM    = "tinyml/esp32/lab11/alarm";
+const char* TOPIC_STATE    = "tinyml/esp32/lab11/state";
 
 // ===================== Pins =====================
 #define SENSOR_PIN 34
@@ -64,6 +77,24 @@ const uint32_t MQTT_PUB_MS      = 500;   // 2 Hz publish
 const uint32_t WIFI_RETRY_MS    = 5000;
 const uint32_t MQTT_RETRY_MS    = 5000;
 
+// ===================== Output Format =====================
+// 0 = CSV text (default)
+// 1 = binary frames: COBS( type | payload | crc16 ) 0x00
+//     type 1 = raw sample  {uint32 t_us, int16 raw}
+//     type 12 = CSV row    {uint32 t_ms, uint8 pred,stable,post,act,
+//                           float conf,conf_z, uint8 anom, uint32 infer_us,
+//                           uint8 wifi,mqtt}
+//     logDrainTask writes every frame. The text diagnostics (connect,
+//     journal, lat_us, log dropped) are left out; latency and memory still
+//     go to the status topic.
+//     Same layout as sensorML/architecture/lab/binlog.h, decode with
+//     sensorML/architecture/host/tools/binlog_decode
+#define LOG_BINARY 0
+// Binary mode only: raw samples per second for dataset capture, on their
+// own micros() grid beside the 50 Hz window. 0 = one raw frame per window
+// sample instead.
+#define RAW_CAPTURE_HZ 1000
+
 // ===================== Sliding Window =====================
 #define WINDOW_SIZE 20
 int windowBuf[WINDOW_SIZE];
@@ -126,6 +157,221 @@ uint32_t confBaselineStart = 0;
 const float CONF_ANOM_THRESH = 3.0f;     // z-score threshold
 bool confAnomaly = false;
 
+// ===================== Async Log Ring =====================
+// loop() only enqueues a small binary record; a low-priority task formats
+// the CSV line and writes Serial. A full ring drops the record (counted)
+// instead of stalling sampling behind a slow UART.
+struct LogRecord {
+  uint32_t ts;
+  int8_t pred, stable, post;
+  uint8_t act, anom, wifi, mqtt;
+  float conf, confZ;
+  uint32_t inferUs;
+};
+
+#define LOG_RING_SIZE 32   // power of two
+LogRecord logRing[LOG_RING_SIZE];
+std::atomic<uint32_t> logHead{0};     // written by loop()
+std::atomic<uint32_t> logTail{0};     // written by drain task
+std::atomic<uint32_t> logDropped{0};
+
+// ===================== Store-and-Forward Journal =====================
+// Flash ring of fixed 64-byte slots. Record seq n lives in slot n % slots,
+// so head/tail are recovered by a scan at boot (no index to maintain).
+// Slot: seq(4) crc16(2) len(1) state(1) payload. state 0xFF erased,
+// 0xFE written, 0x00 acked; the ack is written in place (flash clears bits
+// without an erase), so the replay cursor survives a reboot.
+// Needs a data partition labelled "journal" (at least JOURNAL_SECTORS *
+// 4 KiB), e.g. this line in the partition table CSV:
+//   journal,  data, 0x40,    ,        128K,
+// Without one, store-and-forward is disabled. It never falls back to
+// another partition, whose contents it would overwrite.
+// loop() never erases: logDrainTask erases the next sector ahead of time
+// (journalEraseAhead), and the record is written into it later.
+// On host: sensorML/architecture/host/bench/journal_bench.cpp.
+#define JOURNAL_LABEL      "journal"
+#define JOURNAL_SECTORS    32     // 128 KiB = 2048 records (~17 min at 2 Hz)
+#define JOURNAL_SECTOR     4096
+#define JOURNAL_SLOT       64
+#define JOURNAL_HDR        8
+#define JOURNAL_PER_SECTOR (JOURNAL_SECTOR / JOURNAL_SLOT)
+
+const float JOURNAL_REPLAY_HZ    = 10.0f;  // replay cap (live traffic goes first)
+const float JOURNAL_REPLAY_BURST = 3.0f;
+
+// Telemetry as stored in the journal (rendered to JSON when published)
+struct __attribute__((packed)) TelemetryRecord {
+  uint32_t ts;
+  int8_t pred, stable, post;
+  uint8_t flags;          // bit0 act, bit1 anom
+  float conf, confZ;
+  uint32_t inferUs;
+};
+
+const esp_partition_t* journalPart = nullptr;
+uint32_t journalSlots = 0;
+uint32_t journalHead = 0;     // next seq to write
+uint32_t journalTail = 0;     // oldest unacked seq
+uint32_t journalDropped = 0;  // lost before replay (ring full, sector not erased yet)
+
+// Sector pre-erase, loop() -> logDrainTask. The sector is named by the
+// first seq it will hold, so a wrapped ring never reuses a stale "done".
+const uint32_t JOURNAL_NO_SEQ = 0xFFFFFFFF;
+std::atomic<uint32_t> journalEraseWant{JOURNAL_NO_SEQ};
+std::atomic<uint32_t> journalEraseDone{JOURNAL_NO_SEQ};
+
+// Runs on logDrainTask. Erasing takes ~30-40 ms per sector, so it stays off
+// loop(). The flash cache is still disabled during the erase, so code
+// running from flash on the other core stalls for it. Only IRAM code keeps
+// running.
+void journalEraseAhead() {
+  uint32_t want = journalEraseWant.load(std::memory_order_acquire);
+  if (want == JOURNAL_NO_SEQ || want == journalEraseDone.load(std::memory_order_relaxed)) return;
+  esp_partition_erase_range(journalPart, (want % journalSlots) * JOURNAL_SLOT, JOURNAL_SECTOR);
+  journalEraseDone.store(want, std::memory_order_release);
+}
+
+float replayTokens = 0.0f;
+uint32_t replayLastMs = 0;
+
+// ===================== Outbound Queue (priority) =====================
+// Every live publish goes through a per-class queue. outboxPump() always
+// sends the highest non-empty class first and is capped at OUTBOX_RATE_HZ
+// (the link budget), so an alarm waits at most one pump slot no matter how
+// much telemetry is queued. Policy when a class is full:
+//   alarm     -> keep the queued alarms, count the new one as dropped
+//   state     -> drop oldest
+//   telemetry -> drop oldest (newest data wins)
+//   status    -> drop oldest (only the latest matters)
+enum MsgClass : uint8_t { MSG_ALARM, MSG_STATE, MSG_TELEMETRY, MSG_STATUS, MSG_CLASSES };
+
+#define OUTBOX_PAYLOAD 320   // fits the stage latency status message
+
+struct OutMsg {
+  const char* topic;
+  uint32_t enqMs;
+  uint16_t len;
+  char payload[OUTBOX_PAYLOAD];
+};
+
+struct OutQueue {
+  OutMsg* slots;
+  uint8_t cap;
+  bool dropOldest;
+  uint8_t head;       // oldest message
+  uint8_t count;
+  uint32_t dropped;
+};
+
+OutMsg outAlarm[8], outState[4], outTelem[8], outStatus[2];
+OutQueue outbox[MSG_CLASSES] = {
+  { outAlarm,  8, false, 0, 0, 0 },
+  { outState,  4, true,  0, 0, 0 },
+  { outTelem,  8, true,  0, 0, 0 },
+  { outStatus, 2, true,  0, 0, 0 },
+};
+
+const float OUTBOX_RATE_HZ = 20.0f;   // max publishes/s (link budget)
+const float OUTBOX_BURST   = 4.0f;
+float outboxTokens = 0.0f;
+uint32_t outboxLastMs = 0;
+uint32_t alarmMaxLatencyMs = 0;       // enqueue -> publish, worst case
+
+bool lastAnomalyPublished = false;
+bool lastActPublished = false;
+
+// ===================== Stage Latency =====================
+// Cycle-counter stamps along one window, from the ADC read of its newest
+// sample to the LED write:
+//   sample -> wait -> features -> infer -> smooth -> control -> act
+// ("act" is everything after control up to driveOutputs(): confidence,
+// event queueing, log enqueue). Each stage duration, and the end-to-end
+// sum, goes into a fixed log-scale histogram: 4 buckets per power of two
+// of cycles, so a percentile read back is at most 25 % above the true
+// value. Recording a window is 7 subtractions and bucket increments
+// (a few dozen cycles, reported as cost_cyc); percentiles are only
+// computed every LAT_REPORT_MS, then the histograms restart.
+enum LatStage : uint8_t {
+  LAT_WAIT, LAT_FEATURES, LAT_INFER, LAT_SMOOTH, LAT_CONTROL, LAT_ACT, LAT_E2E, LAT_STAGES
+};
+const char* const LAT_NAMES[LAT_STAGES] = { "wait", "feat", "infer", "smooth", "ctrl", "act", "e2e" };
+
+#define LAT_SUB_BITS 2                       // 2^2 buckets per octave
+#define LAT_BUCKETS  (32 << LAT_SUB_BITS)
+
+const uint32_t LAT_REPORT_MS = 10000;
+
+uint32_t latHist[LAT_STAGES][LAT_BUCKETS];
+uint32_t latMaxCyc[LAT_STAGES];
+uint32_t latN = 0;                 // windows in the current histograms
+uint32_t latSampleCyc = 0;         // ADC read of the newest sample
+uint32_t latT[LAT_STAGES];         // stamps: sample, then the end of each stage
+bool latPending = false;           // window ran, act stamp still to take
+uint32_t latCostCyc = 0;           // cycles of the last latRecord()
+uint32_t lastLatReport = 0;
+
+// Last report, printed by logDrainTask: p50, p95, p99, max in us
+struct LatReport {
+  uint32_t n;
+  uint32_t costCyc;
+  uint32_t us[LAT_STAGES][4];
+};
+LatReport latReport;
+std::atomic<bool> latReportReady{false};
+
+// ===================== Memory Telemetry =====================
+// Every MEM_REPORT_MS a {"mem":{...}} message on TOPIC_STATUS carries:
+//  - heap_free, heap_largest (largest free block = biggest malloc that can
+//    still succeed) and heap_min (lowest free heap since boot)
+//  - frag_pct = 100 - largest * 100 / free: rising while heap_free is flat
+//    means fragmentation; heap_min sinking report after report is a leak
+//  - stack_free: never-touched stack bytes of loopTask and logDrain
+// Offset by half a period from the latency report, so the two never meet a
+// routine status message in the 2-slot status queue.
+const uint32_t MEM_REPORT_MS = 10000;
+uint32_t lastMemReport = MEM_REPORT_MS / 2;
+TaskHandle_t loopTaskHandle = nullptr;
+TaskHandle_t logDrainHandle = nullptr;
+
+// ===================== Execution Trace =====================
+// For the interleaving of sampling, inference, mqttClient.loop(), the outbox
+// and Serial output (a timeline, not averages), set LAB_TRACE to 1. Begin/end
+// events with the cycle counter and the task go into a RAM ring (oldest
+// overwritten); send 't' on Serial and logDrainTask dumps it (recording
+// pauses meanwhile, ~3 s for a full ring at 115200 baud). The dump format is
+// that of sensorML/architecture/lab/trace.h: convert the Serial capture with
+// sensorML/architecture/host/tools/trace_to_chrome and open the JSON in
+// ui.perfetto.dev. The cycle counters of the two cores are not synchronised;
+// both traced tasks here may run on either core, so cross-task order is
+// exact only to within that skew. With LAB_TRACE 0 the TRACE_* macros are
+// empty and nothing below is compiled.
+#define LAB_TRACE    0
+#define TRACE_EVENTS 512   // power of two, 20 bytes each
+
+#if LAB_TRACE && LOG_BINARY
+#error "the trace dump is text; set LOG_BINARY 0 to trace"
+#endif
+
+#if LAB_TRACE
+struct TraceEvent {
+  std::atomic<uint32_t> seq;   // index + 1 once written, 0 while being written
+  uint32_t ts;                 // cycle counter
+  TaskHandle_t task;
+  const char* name;            // string literal
+  char phase;                  // 'B' or 'E'
+};
+TraceEvent traceRing[TRACE_EVENTS];
+std::atomic<uint32_t> traceHead{0};
+std::atomic<bool> traceOn{true};
+std::atomic<bool> traceDumpRequested{false};
+
+#define TRACE_BEGIN(name) traceRecord('B', name)
+#define TRACE_END(name)   traceRecord('E', name)
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name)   ((void)0)
+#endif
+
 // ===================== Connectivity =====================
 WiFiClient wifiClient;
 PubSubClient mqttClient(wifiClient);
@@ -352,6 +598,385 @@ void driveOutputs() {
   // digitalWrite(ACT_PIN, LOW); // recommended for relay during alert
 }
 
+// ===================== Execution Trace =====================
+#if LAB_TRACE
+void traceRecord(char phase, const char* name) {
+  if (!traceOn.load(std::memory_order_relaxed)) return;
+  uint32_t i = traceHead.fetch_add(1, std::memory_order_relaxed);
+  TraceEvent& e = traceRing[i & (TRACE_EVENTS - 1)];
+  e.seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  e.ts = ESP.getCycleCount();
+  e.task = xTaskGetCurrentTaskHandle();
+  e.name = name;
+  e.phase = phase;
+  e.seq.store(i + 1, std::memory_order_release);
+}
+
+// Runs on logDrainTask; loop() keeps running, unrecorded, meanwhile
+void traceDump() {
+  traceOn.store(false);
+  uint32_t head = traceHead.load(std::memory_order_acquire);
+  uint32_t n = min(head, (uint32_t)TRACE_EVENTS);
+  char line[96];
+
+  snprintf(line, sizeof(line), "# trace begin hz=%lu wrap=32 events=%lu lost=%lu",
+           (unsigned long)getCpuFrequencyMhz() * 1000000UL, (unsigned long)n, (unsigned long)(head - n));
+  Serial.println(line);
+  TaskHandle_t named[8];
+  int namedCount = 0;
+  for (uint32_t i = head - n; i != head; i++) {
+    TaskHandle_t t = traceRing[i & (TRACE_EVENTS - 1)].task;
+    int k = 0;
+    while (k < namedCount && named[k] != t) k++;
+    if (k < namedCount || namedCount == 8 || !t) continue;
+    named[namedCount++] = t;
+    snprintf(line, sizeof(line), "# thread,%lu,%s", (unsigned long)(uintptr_t)t, pcTaskGetName(t));
+    Serial.println(line);
+  }
+  // A writer that claimed its slot before the pause may still be filling it:
+  // the sequence number is checked before and after copying
+  for (uint32_t i = head - n; i != head; i++) {
+    const TraceEvent& e = traceRing[i & (TRACE_EVENTS - 1)];
+    if (e.seq.load(std::memory_order_acquire) != i + 1) continue;
+    const uint32_t ts = e.ts;
+    const TaskHandle_t task = e.task;
+    const char* name = e.name;
+    const char phase = e.phase;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (e.seq.load(std::memory_order_relaxed) != i + 1) continue;
+    snprintf(line, sizeof(line), "%lu,%lu,%c,%s",
+             (unsigned long)ts, (unsigned long)(uintptr_t)task, phase, name);
+    Serial.println(line);
+  }
+  Serial.println("# trace end");
+
+  // Next dump starts a new capture
+  for (uint32_t k = 0; k < TRACE_EVENTS; k++) traceRing[k].seq.store(0, std::memory_order_relaxed);
+  traceHead.store(0, std::memory_order_release);
+  traceOn.store(true);
+}
+#endif
+
+// ===================== Binary Framing (LOG_BINARY) =====================
+#if LOG_BINARY
+struct __attribute__((packed)) RawRecord {
+  uint32_t tsUs;
+  int16_t raw;
+};
+
+struct __attribute__((packed)) CapstoneRecord {
+  uint32_t tsMs;
+  uint8_t pred, stable, post, act;
+  float conf, confZ;
+  uint8_t anom;
+  uint32_t inferUs;
+  uint8_t wifi, mqtt;
+};
+
+uint16_t crc16(const uint8_t* data, size_t len);   // Store-and-Forward Journal
+
+// Frame and write one record; payloads are at most 48 bytes so a single
+// COBS block (< 254 bytes) always suffices.
+void writeFrame(uint8_t type, const void* payload, size_t len) {
+  uint8_t raw[1 + 48 + 2];
+  uint8_t out[sizeof(raw) + 2];
+
+  raw[0] = type;
+  memcpy(raw + 1, payload, len);
+  uint16_t crc = crc16(raw, 1 + len);
+  raw[1 + len] = (uint8_t)(crc & 0xFF);
+  raw[2 + len] = (uint8_t)(crc >> 8);
+  size_t rawLen = 3 + len;
+
+  // COBS encode
+  size_t codeIdx = 0, o = 1;
+  uint8_t code = 1;
+  for (size_t i = 0; i < rawLen; i++) {
+    if (raw[i] == 0) {
+      out[codeIdx] = code;
+      codeIdx = o++;
+      code = 1;
+    } else {
+      out[o++] = raw[i];
+      code++;
+    }
+  }
+  out[codeIdx] = code;
+  out[o++] = 0x00;   // frame delimiter
+
+  Serial.write(out, o);
+}
+
+// loop() queues raw samples and logDrainTask frames them, so Serial keeps
+// its one writer. 64 slots cover the drain task's 5 ms naps with room to
+// spare; a full ring drops the sample (a gap in t_us).
+#define RAW_RING_SIZE 64   // power of two
+RawRecord rawRing[RAW_RING_SIZE];
+std::atomic<uint32_t> rawHead{0};   // written by loop()
+std::atomic<uint32_t> rawTail{0};   // written by drain task
+
+// Runs on logDrainTask
+void rawDrain() {
+  uint32_t t = rawTail.load(std::memory_order_relaxed);
+  for (; t != rawHead.load(std::memory_order_acquire); t++) {
+    RawRecord rec = rawRing[t & (RAW_RING_SIZE - 1)];
+    writeFrame(1, &rec, sizeof(rec));
+    rawTail.store(t + 1, std::memory_order_release);
+  }
+}
+
+#if RAW_CAPTURE_HZ
+const uint32_t RAW_CAPTURE_PERIOD_US = 1000000UL / RAW_CAPTURE_HZ;
+uint32_t nextRawUs = 0;
+
+// A slot missed behind a long loop() pass is skipped (a gap in t_us), not
+// sent late in a burst
+void captureRaw() {
+  uint32_t nowUs = micros();
+  if ((int32_t)(nowUs - nextRawUs) < 0) return;
+  nextRawUs += RAW_CAPTURE_PERIOD_US;
+  if ((int32_t)(nowUs - nextRawUs) >= 0) nextRawUs = nowUs + RAW_CAPTURE_PERIOD_US;
+  uint32_t h = rawHead.load(std::memory_order_relaxed);
+  if (h - rawTail.load(std::memory_order_acquire) >= RAW_RING_SIZE) return;
+  RawRecord& rec = rawRing[h & (RAW_RING_SIZE - 1)];
+  rec.tsUs = nowUs;
+  rec.raw = (int16_t)analogRead(SENSOR_PIN);
+  rawHead.store(h + 1, std::memory_order_release);
+}
+#endif
+#endif
+
+// ===================== Async Log Ring =====================
+bool logPush(const LogRecord& r) {
+  uint32_t h = logHead.load(std::memory_order_relaxed);
+  if (h - logTail.load(std::memory_order_acquire) >= LOG_RING_SIZE) {
+    logDropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  logRing[h & (LOG_RING_SIZE - 1)] = r;
+  logHead.store(h + 1, std::memory_order_release);
+  return true;
+}
+
+void logDrainTask(void*) {
+#if !LOG_BINARY
+  uint32_t reportedDrops = 0;
+#endif
+  for (;;) {
+#if LOG_BINARY
+    rawDrain();
+#endif
+    uint32_t t = logTail.load(std::memory_order_relaxed);
+    if (t == logHead.load(std::memory_order_acquire)) {
+#if !LOG_BINARY
+      uint32_t d = logDropped.load(std::memory_order_relaxed);
+      if (d != reportedDrops) {
+        Serial.print("# log dropped="); Serial.println(d);
+        reportedDrops = d;
+      }
+#endif
+      if (latReportReady.load(std::memory_order_acquire)) {
+#if !LOG_BINARY
+        // # lat_us n=50 cost_cyc=44 wait=p50/p95/p99/max feat=... e2e=...
+        Serial.print("# lat_us n="); Serial.print(latReport.n);
+        Serial.print(" cost_cyc="); Serial.print(latReport.costCyc);
+        for (int s = 0; s < LAT_STAGES; s++) {
+          Serial.print(" "); Serial.print(LAT_NAMES[s]); Serial.print("=");
+          for (int k = 0; k < 4; k++) {
+            if (k) Serial.print("/");
+            Serial.print(latReport.us[s][k]);
+          }
+        }
+        Serial.println();
+#endif
+        latReportReady.store(false, std::memory_order_release);
+      }
+#if LAB_TRACE
+      if (traceDumpRequested.exchange(false)) traceDump();
+#endif
+      journalEraseAhead();
+      vTaskDelay(pdMS_TO_TICKS(5));
+      continue;
+    }
+
+    const LogRecord& r = logRing[t & (LOG_RING_SIZE - 1)];
+#if LOG_BINARY
+    CapstoneRecord rec = { r.ts, (uint8_t)r.pred, (uint8_t)r.stable, (uint8_t)r.post, r.act,
+                           r.conf, r.confZ, r.anom, r.inferUs, r.wifi, r.mqtt };
+    writeFrame(12, &rec, sizeof(rec));
+#else
+    TRACE_BEGIN("serial_csv");
+    Serial.print(r.ts); Serial.print(",");
+    Serial.print(r.pred); Serial.print(",");
+    Serial.print(r.stable); Serial.print(",");
+    Serial.print(r.post); Serial.print(",");
+    Serial.print(r.act); Serial.print(",");
+    Serial.print(r.conf, 3); Serial.print(",");
+    Serial.print(r.confZ, 3); Serial.print(",");
+    Serial.print(r.anom); Serial.print(",");
+    Serial.print(r.inferUs); Serial.print(",");
+    Serial.print(r.wifi); Serial.print(",");
+    Serial.println(r.mqtt);
+    TRACE_END("serial_csv");
+#endif
+
+    logTail.store(t + 1, std::memory_order_release);
+  }
+}
+
+// ===================== Store-and-Forward Journal =====================
+uint16_t crc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;   // CRC-16/CCITT-FALSE
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int b = 0; b < 8; b++)
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+uint16_t journalSlotCrc(const uint8_t* slot) {
+  uint8_t tmp[5 + JOURNAL_SLOT - JOURNAL_HDR];
+  uint8_t len = min<uint8_t>(slot[6], JOURNAL_SLOT - JOURNAL_HDR);
+  memcpy(tmp, slot, 4);
+  tmp[4] = len;
+  memcpy(tmp + 5, slot + JOURNAL_HDR, len);
+  return crc16(tmp, 5 + len);
+}
+
+bool journalSlotValid(const uint8_t* slot, uint32_t seq) {
+  uint32_t s;
+  uint16_t crc;
+  memcpy(&s, slot, 4);
+  memcpy(&crc, slot + 4, 2);
+  return slot[7] != 0xFF && s == seq && crc == journalSlotCrc(slot);
+}
+
+void journalRead(uint32_t seq, uint8_t* slot) {
+  esp_partition_read(journalPart, (seq % journalSlots) * JOURNAL_SLOT, slot, JOURNAL_SLOT);
+}
+
+// Give up the unacked records in the sector that seq `first` will start,
+// then ask logDrainTask to erase it. The tail moves past the sector first,
+// so replay never reads it while it is being erased.
+void journalPrepareSector(uint32_t first) {
+  if (first >= journalSlots) {
+    uint32_t oldest = first - journalSlots + JOURNAL_PER_SECTOR;
+    if ((int32_t)(oldest - journalTail) > 0) {
+      journalDropped += oldest - journalTail;
+      journalTail = oldest;
+    }
+  }
+  journalEraseWant.store(first, std::memory_order_release);
+}
+
+void journalBegin() {
+  journalPart = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, JOURNAL_LABEL);
+  if (!journalPart) {
+#if !LOG_BINARY
+    Serial.println("# journal: no \"journal\" data partition, store-and-forward disabled");
+#endif
+    return;
+  }
+  journalSlots = min<uint32_t>(JOURNAL_SECTORS, journalPart->size / JOURNAL_SECTOR) * JOURNAL_PER_SECTOR;
+  if (journalSlots < 2 * JOURNAL_PER_SECTOR) {   // one to write, one erased ahead
+    journalPart = nullptr;
+#if !LOG_BINARY
+    Serial.println("# journal: partition smaller than 2 sectors, store-and-forward disabled");
+#endif
+    return;
+  }
+
+  // Recover head (newest valid seq + 1) and tail (oldest unacked seq)
+  uint8_t slot[JOURNAL_SLOT];
+  bool any = false;
+  uint32_t newest = 0;
+  for (uint32_t i = 0; i < journalSlots; i++) {
+    esp_partition_read(journalPart, i * JOURNAL_SLOT, slot, JOURNAL_SLOT);
+    uint32_t seq;
+    memcpy(&seq, slot, 4);
+    if (seq % journalSlots != i || !journalSlotValid(slot, seq)) continue;
+    if (!any || (int32_t)(seq - newest) > 0) newest = seq;
+    any = true;
+  }
+  journalHead = journalTail = any ? newest + 1 : 0;
+  for (uint32_t i = 1; any && i <= min(journalHead, journalSlots); i++) {
+    journalRead(journalHead - i, slot);
+    if (!journalSlotValid(slot, journalHead - i) || slot[7] == 0x00) break;
+    journalTail = journalHead - i;
+  }
+
+  // The sector the head is in was erased when it was entered; the next
+  // one (or this one, at a sector boundary) is erased ahead of time
+  journalPrepareSector((journalHead + JOURNAL_PER_SECTOR - 1) / JOURNAL_PER_SECTOR * JOURNAL_PER_SECTOR);
+
+#if !LOG_BINARY
+  Serial.print("# journal: slots="); Serial.print(journalSlots);
+  Serial.print(" pending="); Serial.println(journalHead - journalTail);
+#endif
+}
+
+// Called only while offline. Never erases: entering a sector needs
+// logDrainTask to have erased it already (it had a whole sector, 64
+// records = 32 s at 2 Hz, to do so). If it has not, the record is lost
+// and counted in journalDropped.
+void journalAppend(const TelemetryRecord& r) {
+  if (!journalPart) return;
+
+  uint8_t slot[JOURNAL_SLOT];
+  for (;;) {
+    uint32_t idx = journalHead % journalSlots;
+    if (idx % JOURNAL_PER_SECTOR == 0) {
+      if (journalEraseDone.load(std::memory_order_acquire) != journalHead) {
+        journalDropped++;
+        return;
+      }
+      journalPrepareSector(journalHead + JOURNAL_PER_SECTOR);
+      break;
+    }
+    // Skip a slot left dirty by a torn write (power loss)
+    journalRead(journalHead, slot);
+    uint32_t seq;
+    memcpy(&seq, slot, 4);
+    if (seq == 0xFFFFFFFF && slot[7] == 0xFF) break;
+    if (journalTail == journalHead) journalTail++;
+    journalHead++;
+  }
+
+  memset(slot, 0xFF, sizeof(slot));
+  memcpy(slot, &journalHead, 4);
+  slot[6] = sizeof(TelemetryRecord);
+  slot[7] = 0xFE;
+  memcpy(slot + JOURNAL_HDR, &r, sizeof(r));
+  uint16_t crc = journalSlotCrc(slot);
+  memcpy(slot + 4, &crc, 2);
+
+  esp_partition_write(journalPart, (journalHead % journalSlots) * JOURNAL_SLOT,
+                      slot, JOURNAL_HDR + sizeof(r));
+  journalHead++;
+}
+
+// Oldest unacked record, skipping corrupt slots
+bool journalPeek(TelemetryRecord& r) {
+  uint8_t slot[JOURNAL_SLOT];
+  while (journalTail != journalHead) {
+    journalRead(journalTail, slot);
+    if (journalSlotValid(slot, journalTail) && slot[7] == 0xFE && slot[6] == sizeof(r)) {
+      memcpy(&r, slot + JOURNAL_HDR, sizeof(r));
+      return true;
+    }
+    journalTail++;
+  }
+  return false;
+}
+
+void journalAck() {
+  uint8_t acked = 0x00;
+  esp_partition_write(journalPart, (journalTail % journalSlots) * JOURNAL_SLOT + 7, &acked, 1);
+  journalTail++;
+}
+
 // ===================== Connectivity =====================
 void ensureWiFi() {
   if (WiFi.status() == WL_CONNECTED) return;
@@ -359,8 +984,10 @@ void ensureWiFi() {
   if (now - lastWiFiAttempt < WIFI_RETRY_MS) return;
   lastWiFiAttempt = now;
 
+#if !LOG_BINARY
   Serial.print("Wi-Fi connect attempt: ");
   Serial.println(WIFI_SSID);
+#endif
   WiFi.mode(WIFI_STA);
   WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
 }
@@ -374,49 +1001,278 @@ void ensureMQTT() {
   lastMQTTAttempt = now;
 
   mqttClient.setServer(MQTT_HOST, MQTT_PORT);
-  if (mqttClient.connect(MQTT_CLIENT_ID)) {
+  bool ok = mqttClient.connect(MQTT_CLIENT_ID);
+#if !LOG_BINARY
+  if (ok) {
     Serial.println("MQTT connected");
   } else {
     Serial.print("MQTT connect failed, rc=");
     Serial.println(mqttClient.state());
   }
+#else
+  (void)ok;
+#endif
 }
 
-void publishTelemetry(float conf, float confScoreZ) {
-  if (!mqttClient.connected()) return;
+// ===================== Outbound Queue =====================
+bool outboxPush(MsgClass c, const char* topic, const char* payload, int len) {
+  OutQueue& q = outbox[c];
+  if (len <= 0 || len > OUTBOX_PAYLOAD) return false;
+
+  if (q.count == q.cap) {
+    q.dropped++;
+    if (!q.dropOldest) return false;
+    q.head = (q.head + 1) % q.cap;
+    q.count--;
+  }
 
+  OutMsg& m = q.slots[(q.head + q.count) % q.cap];
+  m.topic = topic;
+  m.enqMs = millis();
+  m.len = (uint16_t)len;
+  memcpy(m.payload, payload, len);
+  q.count++;
+  return true;
+}
+
+bool outboxEmpty() {
+  for (int c = 0; c < MSG_CLASSES; c++)
+    if (outbox[c].count) return false;
+  return true;
+}
+
+// Publish queued messages, highest class first, within the rate budget.
+// A failed publish stays queued and is retried on the next call.
+void outboxPump() {
   uint32_t now = millis();
-  if (now - lastMQTTPublish < MQTT_PUB_MS) return;
-  lastMQTTPublish = now;
+  outboxTokens += (float)(now - outboxLastMs) * OUTBOX_RATE_HZ / 1000.0f;
+  outboxLastMs = now;
+  if (outboxTokens > OUTBOX_BURST) outboxTokens = OUTBOX_BURST;
+
+  while (outboxTokens >= 1.0f && mqttClient.connected()) {
+    int c = 0;
+    while (c < MSG_CLASSES && outbox[c].count == 0) c++;
+    if (c == MSG_CLASSES) return;
+
+    OutQueue& q = outbox[c];
+    OutMsg& m = q.slots[q.head];
+    if (!mqttClient.publish(m.topic, (const uint8_t*)m.payload, m.len)) return;
+
+    if (c == MSG_ALARM) alarmMaxLatencyMs = max(alarmMaxLatencyMs, now - m.enqMs);
+    q.head = (q.head + 1) % q.cap;
+    q.count--;
+    outboxTokens -= 1.0f;
+  }
+}
 
+// Alarm on the rising edge of confAnomaly (queued even while offline)
+void publishAlarm(uint32_t now, float conf, float confZ) {
+  char payload[96];
+  int n = snprintf(payload, sizeof(payload),
+                   "{\"ts\":%lu,\"alarm\":\"conf_anomaly\",\"conf\":%.3f,\"conf_z\":%.3f}",
+                   (unsigned long)now, conf, confZ);
+  outboxPush(MSG_ALARM, TOPIC_ALARM, payload, n);
+}
+
+void publishStateChange(uint32_t now) {
+  char payload[64];
+  int n = snprintf(payload, sizeof(payload),
+                   "{\"ts\":%lu,\"act\":%d,\"post\":%d}",
+                   (unsigned long)now, actuatorState ? 1 : 0, lastPostLabel);
+  outboxPush(MSG_STATE, TOPIC_STATE, payload, n);
+}
+
+// Render one record as JSON. Replayed records keep their original
+// timestamp and carry "replay":1.
+int renderRecord(const TelemetryRecord& r, bool replay, char* payload, size_t cap) {
   // Send only semantic data (NO raw sensor stream)
-  char payload[220];
-  snprintf(payload, sizeof(payload),
+  return snprintf(payload, cap,
            "{\"ts\":%lu,\"pred\":%d,\"stable\":%d,\"post\":%d,"
            "\"act\":%d,\"conf\":%.3f,\"conf_z\":%.3f,\"anom\":%d,"
-           "\"infer_us\":%lu,\"uptime_s\":%lu}",
-           (unsigned long)now,
-           lastPred,
-           lastStableLabel,
-           lastPostLabel,
-           actuatorState ? 1 : 0,
-           conf,
-           confScoreZ,
-           confAnomaly ? 1 : 0,
-           (unsigned long)lastInferUs,
-           (unsigned long)(now / 1000));
-
-  mqttClient.publish(TOPIC_TELEM, payload);
-
-  char status[140];
-  snprintf(status, sizeof(status),
-           "{\"ip\":\"%s\",\"rssi\":%d,\"wifi\":%d,\"mqtt\":%d}",
-           WiFi.localIP().toString().c_str(),
-           WiFi.RSSI(),
-           (WiFi.status() == WL_CONNECTED) ? 1 : 0,
-           mqttClient.connected() ? 1 : 0);
-
-  mqttClient.publish(TOPIC_STATUS, status);
+           "\"infer_us\":%lu,\"uptime_s\":%lu%s}",
+           (unsigned long)r.ts,
+           r.pred,
+           r.stable,
+           r.post,
+           (r.flags & 1) ? 1 : 0,
+           r.conf,
+           r.confZ,
+           (r.flags & 2) ? 1 : 0,
+           (unsigned long)r.inferUs,
+           (unsigned long)(r.ts / 1000),
+           replay ? ",\"replay\":1" : "");
+}
+
+void publishTelemetry(float conf, float confScoreZ) {
+  uint32_t now = millis();
+  if (now - lastMQTTPublish < MQTT_PUB_MS) return;
+  lastMQTTPublish = now;
+
+  TelemetryRecord rec;
+  rec.ts = now;
+  rec.pred = (int8_t)lastPred;
+  rec.stable = (int8_t)lastStableLabel;
+  rec.post = (int8_t)lastPostLabel;
+  rec.flags = (actuatorState ? 1 : 0) | (confAnomaly ? 2 : 0);
+  rec.conf = conf;
+  rec.confZ = confScoreZ;
+  rec.inferUs = lastInferUs;
+
+  // Offline: keep it for replay instead of losing it
+  if (!mqttClient.connected()) {
+    journalAppend(rec);
+    return;
+  }
+
+  char payload[OUTBOX_PAYLOAD];
+  int n = renderRecord(rec, false, payload, sizeof(payload));
+  outboxPush(MSG_TELEMETRY, TOPIC_TELEM, payload, n);
+
+  IPAddress ip = WiFi.localIP();
+  char ipStr[16];
+  snprintf(ipStr, sizeof(ipStr), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+
+  n = snprintf(payload, sizeof(payload),
+               "{\"ip\":\"%s\",\"rssi\":%d,\"wifi\":%d,\"mqtt\":%d,"
+               "\"backlog\":%lu,\"dropped\":%lu,"
+               "\"q\":[%u,%u,%u,%u],\"qdrop\":[%lu,%lu,%lu,%lu],\"alarm_max_ms\":%lu}",
+               ipStr,
+               WiFi.RSSI(),
+               (WiFi.status() == WL_CONNECTED) ? 1 : 0,
+               mqttClient.connected() ? 1 : 0,
+               (unsigned long)(journalHead - journalTail),
+               (unsigned long)journalDropped,
+               outbox[MSG_ALARM].count, outbox[MSG_STATE].count,
+               outbox[MSG_TELEMETRY].count, outbox[MSG_STATUS].count,
+               (unsigned long)outbox[MSG_ALARM].dropped, (unsigned long)outbox[MSG_STATE].dropped,
+               (unsigned long)outbox[MSG_TELEMETRY].dropped, (unsigned long)outbox[MSG_STATUS].dropped,
+               (unsigned long)alarmMaxLatencyMs);
+  outboxPush(MSG_STATUS, TOPIC_STATUS, payload, n);
+}
+
+// Drain the journal in order after reconnect. Runs only when the outbox is
+// empty, and a token bucket caps replay at JOURNAL_REPLAY_HZ, so the backlog
+// never crowds out live traffic.
+void replayJournal() {
+  uint32_t now = millis();
+  replayTokens += (float)(now - replayLastMs) * JOURNAL_REPLAY_HZ / 1000.0f;
+  replayLastMs = now;
+  if (replayTokens > JOURNAL_REPLAY_BURST) replayTokens = JOURNAL_REPLAY_BURST;
+
+  if (!journalPart || !mqttClient.connected() || !outboxEmpty()) return;
+  if (replayTokens < 1.0f) return;
+
+  TelemetryRecord rec;
+  if (!journalPeek(rec)) return;
+  char payload[OUTBOX_PAYLOAD];
+  int n = renderRecord(rec, true, payload, sizeof(payload));
+  if (!mqttClient.publish(TOPIC_TELEM, (const uint8_t*)payload, n)) return;   // retry next time
+  journalAck();
+  replayTokens -= 1.0f;
+}
+
+// ===================== Stage Latency =====================
+static inline uint32_t latBucket(uint32_t cyc) {
+  if (cyc < (1u << LAT_SUB_BITS)) return cyc;
+  uint32_t msb = 31 - __builtin_clz(cyc);
+  uint32_t sub = (cyc >> (msb - LAT_SUB_BITS)) & ((1u << LAT_SUB_BITS) - 1);
+  return ((msb - LAT_SUB_BITS + 1) << LAT_SUB_BITS) | sub;
+}
+
+// Largest cycle count that falls into bucket b
+static uint32_t latBucketTop(uint32_t b) {
+  if (b < (1u << LAT_SUB_BITS)) return b;
+  uint32_t shift = (b >> LAT_SUB_BITS) - 1;
+  uint64_t lo = (uint64_t)((1u << LAT_SUB_BITS) | (b & ((1u << LAT_SUB_BITS) - 1))) << shift;
+  uint64_t top = lo + (1ull << shift) - 1;
+  return top > UINT32_MAX ? UINT32_MAX : (uint32_t)top;
+}
+
+// Called once per window, after the act stamp
+void latRecord() {
+  uint32_t c0 = ESP.getCycleCount();
+  for (int s = 0; s < LAT_E2E; s++) {
+    uint32_t d = latT[s + 1] - latT[s];
+    latHist[s][latBucket(d)]++;
+    if (d > latMaxCyc[s]) latMaxCyc[s] = d;
+  }
+  uint32_t e2e = latT[LAT_E2E] - latT[LAT_WAIT];
+  latHist[LAT_E2E][latBucket(e2e)]++;
+  if (e2e > latMaxCyc[LAT_E2E]) latMaxCyc[LAT_E2E] = e2e;
+  latN++;
+  latCostCyc = ESP.getCycleCount() - c0;
+}
+
+// Cycles at quantile q (bucket top, capped at the exact max)
+uint32_t latQuantileCyc(int s, float q) {
+  uint32_t rank = (uint32_t)ceilf(q * (float)latN);
+  if (rank < 1) rank = 1;
+  uint32_t seen = 0;
+  for (uint32_t b = 0; b < LAT_BUCKETS; b++) {
+    seen += latHist[s][b];
+    if (seen >= rank) return min(latBucketTop(b), latMaxCyc[s]);
+  }
+  return latMaxCyc[s];
+}
+
+// Every LAT_REPORT_MS: percentiles to the status topic and (via
+// logDrainTask) Serial, then start new histograms
+void latReportIfDue(uint32_t now) {
+  if (now - lastLatReport < LAT_REPORT_MS) return;
+  lastLatReport = now;
+  if (latN == 0) return;
+
+  static const float Q[3] = { 0.50f, 0.95f, 0.99f };
+  uint32_t mhz = getCpuFrequencyMhz();
+  uint32_t us[LAT_STAGES][4];
+  for (int s = 0; s < LAT_STAGES; s++) {
+    for (int k = 0; k < 3; k++) us[s][k] = latQuantileCyc(s, Q[k]) / mhz;
+    us[s][3] = latMaxCyc[s] / mhz;
+  }
+
+  char payload[OUTBOX_PAYLOAD];
+  int n = snprintf(payload, sizeof(payload), "{\"lat_us\":{\"n\":%lu", (unsigned long)latN);
+  for (int s = 0; s < LAT_STAGES && n < (int)sizeof(payload); s++) {
+    n += snprintf(payload + n, sizeof(payload) - n, ",\"%s\":[%lu,%lu,%lu,%lu]", LAT_NAMES[s],
+                  (unsigned long)us[s][0], (unsigned long)us[s][1],
+                  (unsigned long)us[s][2], (unsigned long)us[s][3]);
+  }
+  if (n < (int)sizeof(payload))
+    n += snprintf(payload + n, sizeof(payload) - n, "},\"cost_cyc\":%lu}", (unsigned long)latCostCyc);
+  if (n < (int)sizeof(payload)) outboxPush(MSG_STATUS, TOPIC_STATUS, payload, n);
+
+  // Skip the Serial copy if the drain task is still printing the last one
+  if (!latReportReady.load(std::memory_order_acquire)) {
+    latReport.n = latN;
+    latReport.costCyc = latCostCyc;
+    memcpy(latReport.us, us, sizeof(us));
+    latReportReady.store(true, std::memory_order_release);
+  }
+
+  memset(latHist, 0, sizeof(latHist));
+  memset(latMaxCyc, 0, sizeof(latMaxCyc));
+  latN = 0;
+}
+
+// ===================== Memory Telemetry =====================
+void memReportIfDue(uint32_t now) {
+  if (now - lastMemReport < MEM_REPORT_MS) return;
+  lastMemReport = now;
+
+  uint32_t heapFree = ESP.getFreeHeap();
+  uint32_t heapLargest = ESP.getMaxAllocHeap();
+  uint32_t fragPct = heapFree ? 100 - (uint32_t)((uint64_t)heapLargest * 100 / heapFree) : 0;
+  char payload[OUTBOX_PAYLOAD];
+  int n = snprintf(payload, sizeof(payload),
+                   "{\"mem\":{\"heap_free\":%lu,\"heap_largest\":%lu,\"heap_min\":%lu,"
+                   "\"frag_pct\":%lu,\"stack_free\":{\"loop\":%lu,\"logDrain\":%lu}}}",
+                   (unsigned long)heapFree,
+                   (unsigned long)heapLargest,
+                   (unsigned long)ESP.getMinFreeHeap(),
+                   (unsigned long)fragPct,
+                   (unsigned long)uxTaskGetStackHighWaterMark(loopTaskHandle),
+                   (unsigned long)(logDrainHandle ? uxTaskGetStackHighWaterMark(logDrainHandle) : 0));
+  outboxPush(MSG_STATUS, TOPIC_STATUS, payload, n);
 }
 
 // ===================== Setup =====================
@@ -425,7 +1281,11 @@ void setup() {
   // pinMode(ACT_PIN, OUTPUT);
   // digitalWrite(ACT_PIN, LOW);
 
+#if LOG_BINARY
+  Serial.begin(921600);   // raw samples + rows, no text
+#else
   Serial.begin(115200);
+#endif
   delay(1000);
 
   for (int i = 0; i < WINDOW_SIZE; i++) windowBuf[i] = 0;
@@ -441,28 +1301,66 @@ void setup() {
 
   confBaselineStart = millis();
 
+  // Records left over from before a reboot are replayed too
+  journalBegin();
+
+#if !LOG_BINARY
   Serial.println("=====================================================================================");
   Serial.println(" Lab 11 Capstone: Sensing + Features + INT8 TinyML + Safe Control + MQTT Monitoring");
   Serial.println(" Local CSV: time_ms,pred,stable,post,act,conf,conf_z,anom,infer_us,wifi,mqtt");
   Serial.println(" MQTT topic: tinyml/esp32/lab11/telemetry (JSON)");
   Serial.println("=====================================================================================");
   Serial.println("time_ms,pred,stable,post,act,conf,conf_z,anom,infer_us,wifi,mqtt");
+#endif
+
+  // CSV lines are written by this task from now on. loopTask runs at
+  // priority 1, so the drainer sits at idle priority, below it: it runs
+  // beside the idle task on whichever core loop() leaves free
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  xTaskCreatePinnedToCore(logDrainTask, "logDrain", 4096, nullptr, tskIDLE_PRIORITY, &logDrainHandle,
+                          tskNO_AFFINITY);
 }
 
 // ===================== Loop =====================
 void loop() {
   uint32_t now = millis();
 
+#if LOG_BINARY && RAW_CAPTURE_HZ
+  captureRaw();
+#endif
+
+#if LAB_TRACE
+  // 't' on Serial: logDrainTask dumps the trace ring
+  if (Serial.available() && Serial.read() == 't') traceDumpRequested.store(true);
+#endif
+
   // Connectivity (non-blocking)
+  TRACE_BEGIN("ensure_net");
   ensureWiFi();
   ensureMQTT();
-  if (mqttClient.connected()) mqttClient.loop();
+  TRACE_END("ensure_net");
+  if (mqttClient.connected()) {
+    TRACE_BEGIN("mqtt_loop");
+    mqttClient.loop();
+    TRACE_END("mqtt_loop");
+  }
 
   // 1) Sampling
   if (now - lastSampleTime >= SAMPLE_PERIOD_MS) {
     lastSampleTime = now;
+    TRACE_BEGIN("sample");
+    latSampleCyc = ESP.getCycleCount();
     int raw = analogRead(SENSOR_PIN);
     addSample(raw);
+#if LOG_BINARY && !RAW_CAPTURE_HZ
+    // Same ring as the capture grid, one entry per window sample
+    uint32_t h = rawHead.load(std::memory_order_relaxed);
+    if (h - rawTail.load(std::memory_order_acquire) < RAW_RING_SIZE) {
+      rawRing[h & (RAW_RING_SIZE - 1)] = { (uint32_t)micros(), (int16_t)raw };
+      rawHead.store(h + 1, std::memory_order_release);
+    }
+#endif
+    TRACE_END("sample");
   }
 
   float conf = 0.0f;
@@ -471,21 +1369,34 @@ void loop() {
   // 2) Inference + CPS control
   if (sampleCount >= WINDOW_SIZE && (now - lastInferTime >= INFER_PERIOD_MS)) {
     lastInferTime = now;
+    TRACE_BEGIN("window");
+
+    latT[LAT_WAIT] = latSampleCyc;
+    latT[LAT_FEATURES] = ESP.getCycleCount();
 
     float features[INPUT_SIZE];
+    TRACE_BEGIN("features");
     extractFeatures(features);
+    TRACE_END("features");
+    latT[LAT_INFER] = ESP.getCycleCount();
 
+    TRACE_BEGIN("infer");
     uint32_t t0 = micros();
     lastPred = predict_int8(features, lastScores);
     uint32_t t1 = micros();
     lastInferUs = (uint32_t)(t1 - t0);
+    TRACE_END("infer");
+    latT[LAT_SMOOTH] = ESP.getCycleCount();
 
     // Stabilize decision
     addDecision(lastPred);
     lastStableLabel = smoothDecision();
+    latT[LAT_CONTROL] = ESP.getCycleCount();
 
     // Safety control
     safeControlUpdate(lastStableLabel);
+    latT[LAT_ACT] = ESP.getCycleCount();
+    latPending = true;
 
     // Confidence + anomaly-like z-score (optional)
     conf = confidence_margin(lastScores, lastPred);
@@ -505,25 +1416,46 @@ void loop() {
       confAnomaly = (confZ > CONF_ANOM_THRESH);
     }
 
-    // Local CSV log (semantic)
-    Serial.print(now); Serial.print(",");
-    Serial.print(lastPred); Serial.print(",");
-    Serial.print(lastStableLabel); Serial.print(",");
-    Serial.print(lastPostLabel); Serial.print(",");
-    Serial.print(actuatorState ? 1 : 0); Serial.print(",");
-    Serial.print(conf, 3); Serial.print(",");
-    Serial.print(confZ, 3); Serial.print(",");
-    Serial.print(confAnomaly ? 1 : 0); Serial.print(",");
-    Serial.print(lastInferUs); Serial.print(",");
-    Serial.print((WiFi.status() == WL_CONNECTED) ? 1 : 0); Serial.print(",");
-    Serial.println(mqttClient.connected() ? 1 : 0);
+    // Events jump the queue ahead of routine telemetry
+    if (confAnomaly && !lastAnomalyPublished) publishAlarm(now, conf, confZ);
+    lastAnomalyPublished = confAnomaly;
+    if (actuatorState != lastActPublished) publishStateChange(now);
+    lastActPublished = actuatorState;
+
+    // Local CSV log (semantic) - enqueued, formatted by logDrainTask
+    LogRecord rec;
+    rec.ts = now;
+    rec.pred = (int8_t)lastPred;
+    rec.stable = (int8_t)lastStableLabel;
+    rec.post = (int8_t)lastPostLabel;
+    rec.act = actuatorState ? 1 : 0;
+    rec.conf = conf;
+    rec.confZ = confZ;
+    rec.anom = confAnomaly ? 1 : 0;
+    rec.inferUs = lastInferUs;
+    rec.wifi = (WiFi.status() == WL_CONNECTED) ? 1 : 0;
+    rec.mqtt = mqttClient.connected() ? 1 : 0;
+    logPush(rec);
+    TRACE_END("window");
   }
 
   // 3) Actuation always responsive
   driveOutputs();
+  if (latPending) {
+    latT[LAT_E2E] = ESP.getCycleCount();
+    latRecord();
+    latPending = false;
+  }
+  latReportIfDue(now);
+  memReportIfDue(now);
 
-  // 4) Publish telemetry (if connected)
+  // 4) Queue telemetry (journaled while offline), send by priority, then
+  //    replay the backlog with whatever budget is left
+  TRACE_BEGIN("publish");
   publishTelemetry(conf, confZ);
+  outboxPump();
+  replayJournal();
+  TRACE_END("publish");
 }
 
 /*********************** CAPSTONE CHECKLIST ************************